@@ -41,6 +41,9 @@ extern "C" {
 #ifndef COLOR_FormatYUV420Flexible
 #define COLOR_FormatYUV420Flexible 0x7F420888
 #endif
+#ifndef COLOR_FormatSurface
+#define COLOR_FormatSurface 0x7F000789  // input surface (no input buffers)
+#endif
 
 // Helper functions for MediaCodec encoding
 
@@ -80,6 +83,17 @@ typedef struct {
   int bitrate_mode;
   // Debug verbosity (0 = quiet, 1+ = verbose)
   int debug_level;
+  // Asynchronous mode (callbacks, Android 9+) with up to async_frames frames
+  // in flight, 0 for the synchronous dequeue loop
+  int async_frames;
+  // Input surface fed from pre-filled hardware buffers (zero-copy, Android
+  // 10+, see android_mediacodec_surface_prefill()), 0 to copy each frame
+  // into the codec input buffers
+  int surface_input;
+  // Take the codec from a per-process pool of started instances with the
+  // same configuration, and flush it back into the pool in cleanup (no
+  // create/configure/start when warm). Not used with surface_input.
+  int pool;
 } MediaCodecFormat;
 
 // Forward declaration for Android MediaCodec
@@ -110,11 +124,10 @@ int android_mediacodec_encode_setup(const MediaCodecFormat* format,
 //
 // Returns:
 //   0 on success, non-zero error code on failure
-//   On success, output->frame_buffers[] contains encoded data for each frame
+//   On success, output->frame_arena contains encoded data for each frame
+//               (if output->dump_output is true)
 //               output->frame_sizes[] contains size of each frame
 //               output->timings[] contains timing data for each frame
-//   Caller is responsible for allocating output arrays and freeing
-//   frame_buffers
 int android_mediacodec_encode_frame(struct AMediaCodec* codec,
                                     const uint8_t* input_buffer,
                                     size_t input_size,
@@ -129,6 +142,12 @@ int android_mediacodec_encode_frame(struct AMediaCodec* codec,
 void android_mediacodec_encode_cleanup(struct AMediaCodec* codec,
                                        int debug_level);
 
+// Stop and delete the idle codecs of the pool (format pool=1)
+//
+// Parameters:
+//   debug_level: Debug verbosity level
+void android_mediacodec_pool_clear(int debug_level);
+
 // Set global debug level for MediaCodec operations
 //
 // Parameters:
@@ -165,6 +184,64 @@ int android_mediacodec_encode_frame_full(const uint8_t* input_buffer,
 
 // C++ only functions (after extern "C" block)
 
+namespace anicet {
+namespace input {
+class FrameRing;
+}  // namespace input
+}  // namespace anicet
+
+// Setup MediaCodec encoder (see android_mediacodec_encode_setup()), and
+// report the create, configure and start times
+//
+// Parameters:
+//   format:  Encoding configuration (codec, dimensions, quality, etc.)
+//   codec:   Output parameter to receive AMediaCodec handle
+//   startup: Output parameter to receive the step times (warm and 0 for a
+//            codec taken from the pool, -1 for the steps not reached)
+//
+// Returns:
+//   0 on success, non-zero error code on failure
+int android_mediacodec_encode_setup_timed(const MediaCodecFormat* format,
+                                          struct AMediaCodec** codec,
+                                          CodecStartup* startup);
+
+// Encode frames from an input frame ring using pre-configured MediaCodec
+// encoder (same as android_mediacodec_encode_frame(), but frame i of the
+// ring is copied into the i-th codec input buffer)
+//
+// Parameters:
+//   codec:         Codec handle from android_mediacodec_encode_setup()
+//   frames:        Input frame ring (one frame per run)
+//   format:        Encoding configuration (color_format, dimensions, etc.)
+//   num_runs:      Number of frames to encode
+//   output:        CodecOutput struct (see android_mediacodec_encode_frame())
+//
+// Returns:
+//   0 on success, non-zero error code on failure
+int android_mediacodec_encode_frames(struct AMediaCodec* codec,
+                                     anicet::input::FrameRing* frames,
+                                     const MediaCodecFormat* format,
+                                     int num_runs, CodecOutput* output);
+
+// Upload input frames into the hardware buffers of a codec set up with
+// surface_input (no-op otherwise). Call before encoding: run i then draws
+// buffer (i % num_frames) into the input surface, so the CPU does not touch
+// the pixels while encoding. Must be called from the thread that set up the
+// codec (EGL context).
+//
+// Parameters:
+//   codec:         Codec handle from android_mediacodec_encode_setup()
+//   frames:        Input frame ring (its first num_frames frames are read)
+//   format:        Encoding configuration (color_format, dimensions, etc.)
+//   num_frames:    Number of hardware buffers to fill
+//
+// Returns:
+//   0 on success, non-zero error code on failure
+int android_mediacodec_surface_prefill(struct AMediaCodec* codec,
+                                       anicet::input::FrameRing* frames,
+                                       const MediaCodecFormat* format,
+                                       int num_frames);
+
 // Get list of available encoder codec names with their media types
 //
 // Parameters:
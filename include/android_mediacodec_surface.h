@@ -0,0 +1,88 @@
+// android_mediacodec_surface.h
+// Zero-copy MediaCodec input: frames are uploaded once into AHardwareBuffers,
+// then drawn by the GPU into the codec input surface
+
+#ifndef ANDROID_MEDIACODEC_SURFACE_H
+#define ANDROID_MEDIACODEC_SURFACE_H
+
+#if defined(__cplusplus) && defined(__ANDROID__)
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GLES2/gl2.h>
+#include <stdint.h>
+
+#include <vector>
+
+struct AHardwareBuffer;
+struct AMediaCodec;
+struct ANativeWindow;
+
+namespace anicet {
+namespace input {
+class FrameRing;
+}  // namespace input
+
+namespace surface {
+
+// Codec input surface fed from pre-filled hardware buffers
+// The CPU only writes the pixels in prefill() (outside the encode loop).
+// Each queue_frame() is a GPU draw of a YUV AHardwareBuffer (EGLImage,
+// external texture) into the surface, and the buffer travels to the encoder
+// without any CPU copy, as in the camera path.
+// Needs Android 10 (API 29, AHardwareBuffer_lockPlanes()). All calls but the
+// destructor's must come from the thread that called init() (EGL context).
+class SurfaceInput {
+ public:
+  SurfaceInput() = default;
+  ~SurfaceInput();
+  SurfaceInput(const SurfaceInput&) = delete;
+  SurfaceInput& operator=(const SurfaceInput&) = delete;
+
+  // Create the codec input surface and its EGL context. Call after
+  // AMediaCodec_configure() (with COLOR_FormatSurface) and before
+  // AMediaCodec_start(). Returns false on error (with error message printed).
+  bool init(AMediaCodec* codec, int width, int height);
+
+  // Upload the first num_frames frames of the ring (color_format "yuv420p",
+  // "nv12" or "nv21") into hardware buffers. Returns false on error.
+  bool prefill(anicet::input::FrameRing* frames, const char* color_format,
+               int num_frames);
+
+  // Draw pre-filled buffer (run % num_buffers()) into the surface and queue
+  // it to the encoder with presentation time pts_us
+  bool queue_frame(int run, int64_t pts_us);
+
+  // Signal the end of the input stream
+  bool signal_eos();
+
+  int num_buffers() const { return (int)buffers_.size(); }
+
+ private:
+  struct Buffer {
+    AHardwareBuffer* buffer = nullptr;
+    EGLImageKHR image = EGL_NO_IMAGE_KHR;
+    GLuint texture = 0;
+  };
+
+  // Release the hardware buffers and their images/textures
+  void release_buffers();
+
+  AMediaCodec* codec_ = nullptr;
+  ANativeWindow* window_ = nullptr;
+  int width_ = 0;
+  int height_ = 0;
+  EGLDisplay display_ = EGL_NO_DISPLAY;
+  EGLContext context_ = EGL_NO_CONTEXT;
+  EGLSurface surface_ = EGL_NO_SURFACE;
+  GLuint program_ = 0;
+  GLint position_attrib_ = -1;
+  std::vector<Buffer> buffers_;
+};
+
+}  // namespace surface
+}  // namespace anicet
+
+#endif  // __cplusplus && __ANDROID__
+
+#endif  // ANDROID_MEDIACODEC_SURFACE_H
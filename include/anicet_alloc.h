@@ -0,0 +1,84 @@
+// anicet_alloc.h
+// Heap allocation tracking (malloc/free/mmap interposition)
+
+#ifndef ANICET_ALLOC_H
+#define ANICET_ALLOC_H
+
+#ifdef __cplusplus
+
+#include <stdint.h>
+
+namespace anicet {
+namespace alloc {
+
+// Allocations over one or more intervals (a frame or a runner phase)
+struct AllocStats {
+  // Whether the interval was tracked (false for padding, e.g. frames of
+  // codecs that do not tag their encode calls)
+  bool valid = false;
+  // malloc/calloc/realloc/memalign calls (and C++ new, which uses malloc)
+  // and the bytes they asked for
+  int64_t allocs = 0;
+  int64_t bytes = 0;
+  // free calls (non-null pointers)
+  int64_t frees = 0;
+  // Anonymous mmap calls made outside the allocator, and their bytes
+  int64_t mmaps = 0;
+  int64_t mmap_bytes = 0;
+  // Peak of the live heap (usable sizes) above its level at the start of
+  // the interval (bytes, the maximum over the intervals)
+  int64_t peak_live_bytes = 0;
+};
+
+// Add the allocations of src to total (counts summed, peak maximum)
+void add_alloc_stats(AllocStats* total, const AllocStats& src);
+
+// Independent live heap peaks, so that the frames of a phase do not reset
+// the peak of the phase
+enum PeakSlot {
+  PEAK_PHASE = 0,
+  PEAK_FRAME,
+  NUM_PEAK_SLOTS
+};
+
+// Whether the hooks are built in (ANICET_ALLOC_HOOKS) and found the libc
+// allocator
+bool available();
+
+// Start counting (process-wide, all threads). There is no disable: the live
+// heap only stays balanced while every free is counted. Allocations made
+// before are not part of the live heap, so only its growth is reported.
+// Returns false (with error message printed) if the hooks are not available.
+bool enable();
+bool enabled();
+
+// One tracked interval, attributed to one AllocStats
+// The counters are process-wide, so concurrent runner calls
+// (--parallel-codecs, --workers) see each other's allocations.
+class AllocInterval {
+ public:
+  explicit AllocInterval(PeakSlot slot) : slot_(slot) {}
+
+  // Snapshot the counters and restart the peak of the slot
+  void start();
+  // Add the allocations since start() to stats
+  void stop(AllocStats* stats);
+  bool running() const { return running_; }
+
+ private:
+  PeakSlot slot_;
+  bool running_ = false;
+  int64_t allocs_ = 0;
+  int64_t bytes_ = 0;
+  int64_t frees_ = 0;
+  int64_t mmaps_ = 0;
+  int64_t mmap_bytes_ = 0;
+  int64_t live_bytes_ = 0;
+};
+
+}  // namespace alloc
+}  // namespace anicet
+
+#endif  // __cplusplus
+
+#endif  // ANICET_ALLOC_H
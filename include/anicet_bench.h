@@ -0,0 +1,134 @@
+// anicet_bench.h
+// Regression benchmark (--bench): a versioned suite of library mode jobs,
+// its results and their comparison against a baseline
+
+#ifndef ANICET_BENCH_H
+#define ANICET_BENCH_H
+
+#ifdef __cplusplus
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+#include "anicet_manifest.h"
+
+struct CodecOutput;
+
+namespace anicet {
+namespace bench {
+
+// Noise thresholds of the comparison. A metric regresses when it grows by
+// more than its threshold (percent of the baseline) and, for the encode time,
+// when the growth is also significant.
+struct Thresholds {
+  // Significance level of the one-sided Mann-Whitney test on the per-frame
+  // encode times
+  double alpha = 0.01;
+  double time_percent = 5.0;
+  double memory_percent = 10.0;
+  double bytes_per_pixel_percent = 1.0;
+  // Peak memory changes below this are noise (kilobytes)
+  int64_t memory_slack_kb = 1024;
+};
+
+// Benchmark suite: the jobs (a --manifest job list) and the run settings
+// applied to all of them, so that every run of a suite version measures the
+// same thing
+struct Suite {
+  std::string name;
+  int version = 0;
+  // Warm-up and measured runs per job (a job's "num_runs" overrides
+  // num_runs)
+  int warmup_runs = 2;
+  int num_runs = 20;
+  // CPU list or cluster to pin to (empty keeps --cpus)
+  std::string cpus;
+  // Cooldown before each batch (see anicet::stats::RunPolicy)
+  double cooldown_temp_c = 0.0;
+  int cooldown_ms = 0;
+  Thresholds thresholds;
+  std::vector<anicet::manifest::ManifestJob> jobs;
+};
+
+// Load a suite, e.g.
+//   {"suite": "regression", "version": 1, "warmup_runs": 2, "num_runs": 20,
+//    "cpus": "cluster:big", "cooldown_ms": 2000,
+//    "thresholds": {"time_percent": 5},
+//    "jobs": [{"image": "gradient_640x480.yuv", ...}]}
+// Relative job images are taken from corpus_dir (empty for the directory of
+// the suite file). Returns true on success, false on error (with error
+// message printed).
+bool load_suite(const std::string& path, const std::string& corpus_dir,
+                Suite* suite);
+
+// Results of one codec configuration (a codec and grid point of a job)
+struct Result {
+  // Identifies the configuration across runs (image, size, codec and
+  // parameters)
+  std::string key;
+  std::string codec;
+  // Encode time of each measured frame (microseconds)
+  std::vector<double> encode_time_us;
+  // Peak memory of the runner calls (kilobytes)
+  int64_t peak_memory_kb = 0;
+  // Mean output size per input pixel
+  double bytes_per_pixel = 0.0;
+};
+
+// Build the result of one configuration from its codec output
+Result make_result(const std::string& key, const CodecOutput& output,
+                   int width, int height);
+
+// Results of one suite run (the --bench output, and a later baseline)
+struct Report {
+  std::string suite;
+  int version = 0;
+  std::string anicet_version;
+  std::string device;
+  std::vector<Result> results;
+};
+
+// Load a report written by write_report()
+// Returns true on success, false on error (with error message printed)
+bool load_report(const std::string& path, Report* report);
+
+// Comparison of one metric of one configuration
+enum class Verdict { UNCHANGED, IMPROVED, REGRESSED };
+const char* verdict_name(Verdict verdict);
+
+struct Comparison {
+  std::string key;
+  // "encode_time_us" (medians), "peak_memory_kb" or "bytes_per_pixel"
+  std::string metric;
+  double baseline = 0.0;
+  double current = 0.0;
+  double change_percent = 0.0;
+  // Mann-Whitney p-value of the change direction (-1 for the single-value
+  // metrics)
+  double p_value = -1.0;
+  Verdict verdict = Verdict::UNCHANGED;
+};
+
+// Compare the configurations found in both reports. Keys of the baseline
+// missing from current go to missing.
+// Returns the number of regressions.
+int compare(const Report& baseline, const Report& current,
+            const Thresholds& thresholds, std::vector<Comparison>* comparisons,
+            std::vector<std::string>* missing);
+
+// Write a report (and the comparison when baseline_file is set) as one
+// indented JSON document
+void write_report(FILE* fp, const Report& report,
+                  const std::string& baseline_file,
+                  const std::vector<Comparison>& comparisons,
+                  const std::vector<std::string>& missing, int regressions);
+
+}  // namespace bench
+}  // namespace anicet
+
+#endif  // __cplusplus
+
+#endif  // ANICET_BENCH_H
@@ -0,0 +1,58 @@
+// anicet_color.h
+// Input color formats and conversion to the formats the codecs accept
+
+#ifndef ANICET_COLOR_H
+#define ANICET_COLOR_H
+
+#ifdef __cplusplus
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <initializer_list>
+
+namespace anicet {
+namespace color {
+
+// Input color formats (4:2:0 with even width and height, or RGBA)
+enum class ColorFormat {
+  // 8-bit planar Y, U, V (I420)
+  YUV420P,
+  // 8-bit Y plane, then interleaved UV (NV12) or VU (NV21)
+  NV12,
+  NV21,
+  // 16-bit little-endian Y plane, then interleaved UV, 10 bits in the most
+  // significant bits of each sample (camera HDR output)
+  P010,
+  // 8-bit R, G, B, A pixels
+  RGBA,
+};
+
+// Parse a color format name ("yuv420p", "nv12", "nv21", "p010", "rgba")
+// Returns false for an unknown name.
+bool parse_color_format(const char* name, ColorFormat* format);
+
+// Get the color format name (as accepted by parse_color_format())
+const char* color_format_name(ColorFormat format);
+
+// Size of one width x height frame in bytes
+size_t frame_size(ColorFormat format, int width, int height);
+
+// Format a codec is fed with: the input format itself when the codec
+// accepts it natively (frames are passed through without a copy), yuv420p
+// otherwise
+ColorFormat codec_format(ColorFormat input,
+                         std::initializer_list<ColorFormat> native);
+
+// Convert one frame to yuv420p (dst holds frame_size(YUV420P, width, height)
+// bytes). Uses NEON kernels on ARM and their bit-exact scalar versions
+// elsewhere. RGBA uses BT.601 limited range, with chroma from the 2x2 mean.
+void convert_to_yuv420p(ColorFormat format, const uint8_t* src, int width,
+                        int height, uint8_t* dst);
+
+}  // namespace color
+}  // namespace anicet
+
+#endif  // __cplusplus
+
+#endif  // ANICET_COLOR_H
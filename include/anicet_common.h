@@ -32,4 +32,20 @@ double anicet_get_timestamp_s();
     }                                                                        \
   } while (0)
 
+#ifdef __cplusplus
+#include <atomic>
+#include <functional>
+
+namespace anicet {
+
+// Background sampler loop: call sample() every interval_us microseconds
+// (absolute CLOCK_MONOTONIC deadlines, the schedule restarts from now when
+// it falls behind) until stop is set. sample() runs once more after stop is
+// seen, so that the end of the sampled interval is covered.
+void run_sampler_loop(int interval_us, const std::atomic<bool>& stop,
+                      const std::function<void()>& sample);
+
+}  // namespace anicet
+#endif  // __cplusplus
+
 #endif
@@ -0,0 +1,104 @@
+// anicet_cpu.h
+// CPU list parsing, affinity and topology helpers
+
+#ifndef ANICET_CPU_H
+#define ANICET_CPU_H
+
+#ifdef __cplusplus
+
+#include <stdint.h>
+
+#include <set>
+#include <string>
+#include <vector>
+
+namespace anicet {
+namespace cpu {
+
+// Parse a CPU list string (e.g. "0", "1-3", "0,2,4-6") into a set of CPUs
+// Returns true on success, false on a malformed list
+bool parse_cpulist(const std::string& cpus, std::set<int>* cpu_set);
+
+// Format a set of CPUs back into a compact CPU list string (e.g. "0-3,6")
+std::string format_cpulist(const std::set<int>& cpu_set);
+
+// Pin the calling thread to the CPUs in the list
+// (threads created afterwards by the calling thread inherit the affinity)
+// Returns true on success, false on error
+bool set_affinity_from_cpulist(const std::string& cpus);
+
+// Get the CPUs the calling thread may run on (empty on error)
+std::set<int> get_affinity();
+
+// Get the CPUs shared by two CPU lists (empty if disjoint or malformed)
+std::set<int> cpulist_overlap(const std::string& cpus_a,
+                              const std::string& cpus_b);
+
+// CPUs sharing a cpufreq policy (one core type on big.LITTLE SoCs)
+struct CpuCluster {
+  // "little", "mid" ("mid1", "mid2", ... if several) and "big" in
+  // ascending capacity order ("big" alone on a single-cluster system)
+  std::string name;
+  std::set<int> cpus;
+  // cpufreq cpuinfo_max_freq (0 if not exposed)
+  int64_t max_freq_khz = 0;
+  // Scheduler cpu_capacity, 1024 for the biggest core (0 if not exposed)
+  int capacity = 0;
+};
+
+// CPU topology of the online CPUs
+struct CpuTopology {
+  // Clusters in ascending (capacity, max_freq_khz) order
+  std::vector<CpuCluster> clusters;
+  // AT_HWCAP/AT_HWCAP2 auxv values and their decoded feature names
+  // (decoded on aarch64 only)
+  uint64_t hwcap = 0;
+  uint64_t hwcap2 = 0;
+  std::vector<std::string> features;
+};
+
+// Read the topology from /sys/devices/system/cpu (clusters from cpufreq
+// related_cpus, cpuinfo_max_freq and cpu_capacity) and the auxv HWCAPs
+// CPUs without cpufreq are grouped by capacity.
+CpuTopology get_topology();
+
+// SIMD levels of the codecs with runtime dispatch (SVT-AV1, jpegli), in
+// ascending order. A codec run at a level uses the extensions of that level
+// and of the levels below it that the CPU supports.
+enum class SimdLevel {
+  C,        // No SIMD
+  NEON,     // Armv8.0-A ASIMD
+  DOTPROD,  // Dot product (asimddp)
+  I8MM,     // Int8 matrix multiply
+  SVE,
+  SVE2,
+};
+
+// Parse a level name ("c", "neon", "dotprod", "i8mm", "sve", "sve2", or
+// "auto" for max_simd_level()). Returns false for an unknown name.
+bool parse_simd_level(const std::string& name, SimdLevel* level);
+
+// Get the level name (as accepted by parse_simd_level())
+const char* simd_level_name(SimdLevel level);
+
+// Whether the CPU has the extension of a level (AT_HWCAP/AT_HWCAP2, aarch64
+// only: other architectures only have SimdLevel::C)
+bool cpu_has_simd_level(SimdLevel level);
+
+// Highest level the CPU has
+SimdLevel max_simd_level();
+
+// Whether an optimization value can run on this CPU (a level the CPU has,
+// or "auto"). Used to prune the unsupported values of sweeps.
+bool simd_level_supported(const std::string& name);
+
+// Resolve a CPU list that may name a cluster ("cluster:big") into a plain
+// CPU list. Returns false (with a message) on an unknown cluster.
+bool resolve_cpulist(const std::string& spec, std::string* cpus);
+
+}  // namespace cpu
+}  // namespace anicet
+
+#endif  // __cplusplus
+
+#endif  // ANICET_CPU_H
@@ -0,0 +1,93 @@
+// anicet_energy.h
+// Energy sampler (on-device power monitor rails or battery current/voltage)
+
+#ifndef ANICET_ENERGY_H
+#define ANICET_ENERGY_H
+
+#ifdef __cplusplus
+
+#include <stdint.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct CodecInput;
+struct CodecOutput;
+
+namespace anicet {
+namespace energy {
+
+// Energy source
+enum class EnergySource {
+  // None found
+  NONE,
+  // On-device power monitor (ODPM): cumulative energy of the power rails
+  // (/sys/bus/iio/devices/iio:device*/energy_value), summed over the rails
+  RAILS,
+  // Battery current_now * voltage_now (/sys/class/power_supply/*), integrated
+  // over time. Only meaningful when the device is not charging.
+  BATTERY,
+};
+
+// Get the energy source name ("none", "rails", "battery")
+const char* energy_source_name(EnergySource source);
+
+// One sample
+struct EnergySample {
+  // anicet_get_timestamp() (same clock as the frame timestamps)
+  int64_t time_us;
+  // Energy since the first sample (microjoules)
+  double energy_uj;
+};
+
+// Energy of one frame, -1 without samples
+struct FrameEnergy {
+  double energy_mj = -1.0;
+  // Per megapixel of input (width * height)
+  double energy_mj_per_mp = -1.0;
+};
+
+// Sampler thread for a codec run
+// Construct it right before the runner call and call finish() right after.
+// Energy is integrated over each frame's input_timestamp_us ..
+// output_timestamp_us window and each phase window, interpolating linearly
+// between samples: windows shorter than the interval get the mean power
+// around them. Results go to output->frame_energy, output->phase_energy_mj,
+// output->energy_mj and output->energy_source. Does nothing unless
+// input->energy_sample_interval_ms > 0.
+class EnergySampler {
+ public:
+  explicit EnergySampler(const CodecInput* input);
+  ~EnergySampler();
+  EnergySampler(const EnergySampler&) = delete;
+  EnergySampler& operator=(const EnergySampler&) = delete;
+
+  // Stop the thread and store the results in output
+  void finish(CodecOutput* output);
+
+ private:
+  void thread_main();
+  // Read the rail energy (microjoules) or battery power (microwatts)
+  bool read_source(double* value) const;
+  // Energy between two timestamps (microjoules), -1 if not covered
+  double energy_between(int64_t start_us, int64_t end_us) const;
+
+  EnergySource source_ = EnergySource::NONE;
+  // energy_value fds (rails) or current_now and voltage_now (battery)
+  std::vector<int> fds_;
+  int interval_us_ = 0;
+  double megapixels_ = 0.0;
+  std::atomic<bool> stop_{false};
+  // Written by the sampler thread only (read after join)
+  std::vector<EnergySample> samples_;
+  std::thread thread_;
+};
+
+}  // namespace energy
+}  // namespace anicet
+
+#endif  // __cplusplus
+
+#endif  // ANICET_ENERGY_H
@@ -0,0 +1,222 @@
+// anicet_input.h
+// Input file loading (read or zero-copy mmap) with load cost accounting, and
+// streaming multi-frame sources
+
+#ifndef ANICET_INPUT_H
+#define ANICET_INPUT_H
+
+#ifdef __cplusplus
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <sys/types.h>
+
+#include <initializer_list>
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "anicet_color.h"
+#include "anicet_runner.h"
+#include "resource_profiler.h"
+
+namespace anicet {
+namespace input {
+
+// How the input file is brought into memory
+enum class InputMode {
+  READ,  // read() into a heap buffer (one extra copy of the file)
+  MMAP,  // read-only private file mapping (zero-copy, page cache backed)
+};
+
+// Page prefetching for InputMode::MMAP
+enum class InputPrefetch {
+  NONE,      // Pages are faulted in by the first encoder that touches them
+  POPULATE,  // MAP_POPULATE: fault all pages in at load time
+  WILLNEED,  // madvise(MADV_WILLNEED): start readahead, map lazily
+  HUGEPAGE,  // Anonymous mapping with madvise(MADV_HUGEPAGE) filled by read()
+             // (transparent huge pages do not apply to file mappings)
+};
+
+// Parse/format mode names ("read", "mmap") and prefetch names ("none",
+// "populate", "willneed", "hugepage")
+// Parse functions return true on success, false on unknown name
+bool parse_input_mode(const std::string& name, InputMode* mode);
+bool parse_input_prefetch(const std::string& name, InputPrefetch* prefetch);
+const char* input_mode_name(InputMode mode);
+const char* input_prefetch_name(InputPrefetch prefetch);
+
+// Input file loaded in memory
+// The buffer stays valid until close() or destruction
+class InputFile {
+ public:
+  InputFile() = default;
+  ~InputFile();
+  InputFile(const InputFile&) = delete;
+  InputFile& operator=(const InputFile&) = delete;
+
+  // Load a file. Resource usage of the load (open + read/map + prefetch) is
+  // measured separately from the encoders and available via load_delta().
+  // Returns true on success, false on error (with error message printed).
+  bool open(const std::string& path, InputMode mode, InputPrefetch prefetch);
+
+  // Release the buffer/mapping
+  void close();
+
+  const uint8_t* data() const { return data_; }
+  size_t size() const { return size_; }
+  InputMode mode() const { return mode_; }
+  InputPrefetch prefetch() const { return prefetch_; }
+  const ResourceDelta& load_delta() const { return load_delta_; }
+
+ private:
+  const uint8_t* data_ = nullptr;
+  size_t size_ = 0;
+  // mmap'ed region (file or anonymous mapping), nullptr for READ mode
+  void* map_addr_ = nullptr;
+  size_t map_size_ = 0;
+  // Heap buffer for READ mode
+  std::vector<uint8_t> buffer_;
+  InputMode mode_ = InputMode::MMAP;
+  InputPrefetch prefetch_ = InputPrefetch::POPULATE;
+  ResourceDelta load_delta_ = {};
+};
+
+// Least recently used cache of loaded input files (--manifest jobs that
+// share an image load it once)
+// get() returns a shared reference, so an evicted file stays mapped until
+// its last user releases it.
+class InputCache {
+ public:
+  // Keep up to capacity files (>= 1), loaded with mode/prefetch
+  InputCache(size_t capacity, InputMode mode, InputPrefetch prefetch);
+  InputCache(const InputCache&) = delete;
+  InputCache& operator=(const InputCache&) = delete;
+
+  // Get a loaded file, loading it (and evicting the least recently used
+  // file) on a miss. *hit tells whether it was already loaded.
+  // Returns nullptr on error (with error message printed).
+  std::shared_ptr<const InputFile> get(const std::string& path, bool* hit);
+
+  int hits() const { return hits_; }
+  int misses() const { return misses_; }
+  int evictions() const { return evictions_; }
+
+ private:
+  struct Entry {
+    std::string path;
+    std::shared_ptr<const InputFile> file;
+  };
+
+  size_t capacity_;
+  InputMode mode_;
+  InputPrefetch prefetch_;
+  // Most recently used first
+  std::list<Entry> entries_;
+  int hits_ = 0;
+  int misses_ = 0;
+  int evictions_ = 0;
+};
+
+// Multi-frame 8-bit 4:2:0 clip (raw frames back to back, or y4m)
+// Only the frame index and a copy of the first frame are kept in memory.
+// Frames are read on demand with pread() (see FrameRing), so memory use does
+// not grow with the clip length.
+class FrameSource {
+ public:
+  FrameSource() = default;
+  ~FrameSource();
+  FrameSource(const FrameSource&) = delete;
+  FrameSource& operator=(const FrameSource&) = delete;
+
+  // Open a clip of width x height frames of frame_size bytes (0 for 8-bit
+  // 4:2:0). y4m files are detected by their "YUV4MPEG2" signature, and their
+  // header must match width/height (8-bit 4:2:0 only).
+  // Returns true on success, false on error (with error message printed).
+  bool open(const std::string& path, int width, int height,
+            size_t frame_size = 0);
+
+  // Close the file and drop the frame index
+  void close();
+
+  // Read frame (index modulo num_frames()) into dst (frame_size() bytes)
+  // Thread-safe: readers share the file descriptor through pread()
+  // Returns true on success, false on error (with error message printed)
+  bool read_frame(int index, uint8_t* dst) const;
+
+  int num_frames() const { return (int)frame_offsets_.size(); }
+  size_t frame_size() const { return frame_size_; }
+  size_t file_size() const { return file_size_; }
+  bool is_y4m() const { return y4m_; }
+  // First frame (valid while open), for callers that need a single buffer
+  const uint8_t* first_frame() const { return first_frame_.data(); }
+  const ResourceDelta& load_delta() const { return load_delta_; }
+
+ private:
+  int fd_ = -1;
+  size_t frame_size_ = 0;
+  size_t file_size_ = 0;
+  bool y4m_ = false;
+  // File offset of the pixel data of each frame
+  std::vector<off_t> frame_offsets_;
+  std::vector<uint8_t> first_frame_;
+  ResourceDelta load_delta_ = {};
+};
+
+// Per-consumer ring of input frames used by the codec runners
+// frame(run) returns source frame ((input->run_offset + run) % num_frames).
+// Frames are read into one of input->frame_ring_size slots, so a returned
+// pointer stays valid for the next frame_ring_size - 1 calls. Clips that fit
+// in the ring are read only once. Without a frame source every run gets
+// input->input_buffer.
+// Frames in a format the codec does not accept natively (see
+// anicet::color::codec_format()) are converted to yuv420p on every
+// frame(run), as a capture pipeline would. A native format is passed through
+// without a copy.
+class FrameRing {
+ public:
+  explicit FrameRing(const CodecInput* input,
+                     std::initializer_list<anicet::color::ColorFormat>
+                         native = {anicet::color::ColorFormat::YUV420P});
+  FrameRing(const FrameRing&) = delete;
+  FrameRing& operator=(const FrameRing&) = delete;
+
+  // Get the input frame for a run, or nullptr on read error
+  const uint8_t* frame(int run);
+
+  // Size of one input frame in bytes (after conversion)
+  size_t frame_size() const;
+
+  // Color format of the returned frames
+  anicet::color::ColorFormat format() const { return format_; }
+
+  // Get and reset the time spent converting frames (milliseconds, wall and
+  // calling thread CPU)
+  void take_conversion_time(double* wall_ms, double* cpu_ms);
+
+ private:
+  // Source frame for a run (before conversion)
+  const uint8_t* source_frame(int run);
+
+  const CodecInput* input_;
+  std::vector<uint8_t> slots_;
+  // Source frame index held by each slot (-1 = empty)
+  std::vector<int> slot_frame_;
+  anicet::color::ColorFormat input_format_ =
+      anicet::color::ColorFormat::YUV420P;
+  anicet::color::ColorFormat format_ = anicet::color::ColorFormat::YUV420P;
+  // Converted frames (one per slot), empty when passing through
+  std::vector<uint8_t> converted_;
+  int converted_slots_ = 0;
+  double conversion_wall_ms_ = 0.0;
+  double conversion_cpu_ms_ = 0.0;
+};
+
+}  // namespace input
+}  // namespace anicet
+
+#endif  // __cplusplus
+
+#endif  // ANICET_INPUT_H
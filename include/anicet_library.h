@@ -0,0 +1,76 @@
+// anicet_library.h
+// Process-wide cache of dlopen'ed codec libraries and their symbol tables
+
+#ifndef ANICET_LIBRARY_H
+#define ANICET_LIBRARY_H
+
+#ifdef __cplusplus
+
+#include <dlfcn.h>
+
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <string>
+
+#include "anicet_common.h"
+
+namespace anicet {
+namespace library {
+
+// Get the function table (Api) of a dlopen'ed codec library
+// Libraries are opened with RTLD_NOW | RTLD_LOCAL to isolate symbols (so the
+// opt and nonopt variants of the same codec can coexist), resolved once via
+// resolve(), and kept open for the lifetime of the process. Each Api type
+// has its own cache, keyed by library name.
+//
+// Parameters:
+//   label:         Codec name used in error messages (e.g. "x265")
+//   library_name:  Library file name (e.g. "libx265-8bit-opt.so")
+//   resolve:       Fills the Api from the handle with dlsym(), returns false
+//                  if any symbol is missing
+//   load_time_ms:  Set to the dlopen + dlsym time spent in this call
+//                  (0 when the library was already cached)
+//
+// Returns:
+//   Pointer to the cached Api (valid until exit), or nullptr on error
+template <typename Api>
+const Api* get_library_api(const char* label, const char* library_name,
+                           bool (*resolve)(void* handle, Api* api),
+                           double* load_time_ms) {
+  static std::mutex cache_mutex;
+  static std::map<std::string, Api> cache;
+
+  std::lock_guard<std::mutex> lock(cache_mutex);
+  *load_time_ms = 0.0;
+  auto it = cache.find(library_name);
+  if (it != cache.end()) {
+    return &it->second;
+  }
+
+  int64_t start_us = anicet_get_timestamp();
+  void* handle = dlopen(library_name, RTLD_NOW | RTLD_LOCAL);
+  if (!handle) {
+    fprintf(stderr, "%s: Failed to load library %s: %s\n", label,
+            library_name, dlerror());
+    return nullptr;
+  }
+
+  Api api = {};
+  if (!resolve(handle, &api)) {
+    fprintf(stderr, "%s: Failed to load symbols: %s\n", label, dlerror());
+    dlclose(handle);
+    return nullptr;
+  }
+  *load_time_ms = (anicet_get_timestamp() - start_us) / 1000.0;
+
+  // Handle is intentionally never dlclose'd
+  return &cache.emplace(library_name, api).first->second;
+}
+
+}  // namespace library
+}  // namespace anicet
+
+#endif  // __cplusplus
+
+#endif  // ANICET_LIBRARY_H
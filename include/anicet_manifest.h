@@ -0,0 +1,50 @@
+// anicet_manifest.h
+// Batch manifest (--manifest): a list of library mode jobs run in one
+// process
+
+#ifndef ANICET_MANIFEST_H
+#define ANICET_MANIFEST_H
+
+#ifdef __cplusplus
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace anicet {
+namespace manifest {
+
+// One manifest entry. Fields left unset (empty, 0) take the CLI value.
+struct ManifestJob {
+  std::string image;
+  int width = 0;
+  int height = 0;
+  std::string color_format;
+  // Codec list, same syntax as --codec
+  std::string codec;
+  // Codec parameter strings, same syntax as --x265 etc. (e.g.
+  // {"x265", "crf=28:preset=fast"}), parsed after the CLI ones
+  std::vector<std::pair<std::string, std::string>> params;
+  // Number of runs, or auto_runs for "auto"
+  int num_runs = 0;
+  bool auto_runs = false;
+  // Added to the CLI --tag values
+  std::vector<std::pair<std::string, std::string>> tags;
+};
+
+// Load a manifest: a JSON array of job objects (or an object with a "jobs"
+// array), e.g.
+//   [{"image": "a.yuv", "width": 640, "height": 480,
+//     "color_format": "yuv420p", "codec": "webp",
+//     "params": {"webp": "quality=75|90"}, "num_runs": 20,
+//     "tags": {"set": "thumbnails"}}]
+// "params" may also be a single string for a job with one codec.
+// Returns true on success, false on error (with error message printed).
+bool load_manifest(const std::string& path, std::vector<ManifestJob>* jobs);
+
+}  // namespace manifest
+}  // namespace anicet
+
+#endif  // __cplusplus
+
+#endif  // ANICET_MANIFEST_H
@@ -0,0 +1,118 @@
+// anicet_memory.h
+// Background memory sampler (RSS timeline and per-frame peak memory) and
+// per-frame heap allocations
+
+#ifndef ANICET_MEMORY_H
+#define ANICET_MEMORY_H
+
+#ifdef __cplusplus
+
+#include <stdint.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "anicet_alloc.h"
+
+struct CodecInput;
+struct CodecOutput;
+
+namespace anicet {
+namespace memory {
+
+// One memory sample (process-wide)
+struct MemorySample {
+  // anicet_get_timestamp() (same clock as the frame timestamps)
+  int64_t time_us;
+  // Run (frame) being encoded, -1 for setup, conversion and cleanup
+  int run;
+  // Resident set size, split into anonymous and file-backed (incl. shmem)
+  int64_t rss_kb;
+  int64_t anon_kb;
+  int64_t file_kb;
+  // Proportional set size, -1 when not sampled (too expensive or
+  // unavailable)
+  int64_t pss_kb;
+};
+
+// Peak memory of one frame, -1 when no sample fell inside the frame (frame
+// shorter than the sampling interval)
+struct FramePeak {
+  int64_t rss_kb;
+  int64_t anon_kb;
+};
+
+// Sampler thread for a codec run
+// Construct it before the codec setup and call begin()/end() around each
+// encode call. The thread reads /proc/self/statm every interval (and
+// smaps_rollup for PSS, unless one read costs more than a quarter of the
+// interval). On finish() (or destruction) the timeline and the per-frame
+// peaks go to output->memory_timeline and output->memory_frame_peaks.
+// Does nothing unless input->memory_sample_interval_ms > 0.
+// With allocation tracking enabled (anicet::alloc::enable()), the heap
+// allocations from begin(run) to end(run) (or to the next begin()) also go
+// to output->frame_allocs[run]. The counters are process-wide: they include
+// the encoder threads, but also the background file writer and, with
+// --parallel-codecs or --workers, the other runner calls, so frame_allocs
+// is only per codec for a single runner call. Pipelined frames are
+// attributed to the run last begun. The sampler's own timeline only grows
+// between frames, so it does not count.
+class MemorySampler {
+ public:
+  MemorySampler(const CodecInput* input, CodecOutput* output, int num_runs);
+  ~MemorySampler();
+  MemorySampler(const MemorySampler&) = delete;
+  MemorySampler& operator=(const MemorySampler&) = delete;
+
+  // Tag the following samples (and allocations) with run
+  void begin(int run) {
+    current_run_.store(run, std::memory_order_relaxed);
+    if (track_allocs_) begin_allocs(run);
+  }
+  // Stop tagging samples with run (no-op if another run was begun since)
+  void end(int run) {
+    if (track_allocs_) end_allocs(run);
+    current_run_.compare_exchange_strong(run, -1, std::memory_order_relaxed);
+  }
+
+  // Stop the thread and store the results
+  void finish();
+
+ private:
+  void thread_main();
+  // Read one sample (without the run tag) from the /proc fds
+  bool read_sample(MemorySample* sample, bool with_pss) const;
+  // Attribute the allocations since the last begin() and start counting
+  // those of run (-1 for none)
+  void begin_allocs(int run);
+  void end_allocs(int run);
+
+  CodecOutput* output_;
+  int num_runs_;
+  int interval_us_ = 0;
+  bool with_pss_ = false;
+  // /proc/self/statm and /proc/self/smaps_rollup (kept open, read with pread)
+  int statm_fd_ = -1;
+  int smaps_fd_ = -1;
+  std::atomic<int> current_run_{-1};
+  std::atomic<bool> stop_{false};
+  // Timeline growth kept out of the frames (allocation tracking)
+  bool grow_between_frames_ = false;
+  // Written by the sampler thread only (read after join)
+  std::vector<MemorySample> samples_;
+  int dropped_samples_ = 0;
+  std::thread thread_;
+  // Per-frame allocations (encoding thread only)
+  bool track_allocs_ = false;
+  int alloc_run_ = -1;
+  anicet::alloc::AllocInterval alloc_interval_{anicet::alloc::PEAK_FRAME};
+  std::vector<anicet::alloc::AllocStats> frame_allocs_;
+};
+
+}  // namespace memory
+}  // namespace anicet
+
+#endif  // __cplusplus
+
+#endif  // ANICET_MEMORY_H
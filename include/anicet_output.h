@@ -0,0 +1,184 @@
+// anicet_output.h
+// Encoded frame storage (output arena shared between CodecOutputs) and the
+// --dump-output file writer
+
+#ifndef ANICET_OUTPUT_H
+#define ANICET_OUTPUT_H
+
+#ifdef __cplusplus
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace anicet {
+namespace output {
+
+// Arena of encoded frames
+// Frames are appended into one contiguous slab (with an offset and size per
+// frame) instead of one heap buffer per frame. Slabs are reference counted:
+// splice() makes another arena point at the same slabs without copying the
+// bitstreams, so aggregating CodecOutputs is cheap.
+class FrameArena {
+ public:
+  // Drop all frames. The open slab is kept (for reuse) unless it is shared
+  // with another arena.
+  void clear();
+
+  // Make room for bytes more in the open slab and touch the pages, so that
+  // frames appended later neither reallocate nor page-fault. Call it outside
+  // the measured encoding loop.
+  void reserve(size_t bytes);
+
+  // Reserve room for num_frames more frames the size of the average frame so
+  // far (plus some headroom). Runners call it after their first frame, in
+  // between the timed frames.
+  void reserve_frames(size_t num_frames);
+
+  // Start a new (empty) frame at the end of the arena
+  void add_frame();
+
+  // Append data to the last frame (which must come from add_frame(), not
+  // from splice())
+  void append(const uint8_t* data, size_t size);
+
+  // Add a complete frame
+  void push_frame(const uint8_t* data, size_t size) {
+    add_frame();
+    append(data, size);
+  }
+
+  // Append all frames of other to this arena, sharing its slabs (no copy)
+  void splice(const FrameArena& other);
+
+  size_t num_frames() const { return frames_.size(); }
+  // Frame data (valid until the arena and all arenas sharing it are cleared)
+  const uint8_t* frame_data(size_t index) const;
+  size_t frame_size(size_t index) const { return frames_[index].size; }
+
+ private:
+  using Slab = std::vector<uint8_t>;
+
+  // Location of one frame
+  struct FrameRef {
+    size_t slab;
+    size_t offset;
+    size_t size;
+  };
+
+  // Get the slab frames can be appended to, or nullptr if there is none
+  // (after splice() the last slab belongs to another arena)
+  Slab* open_slab();
+
+  std::vector<std::shared_ptr<Slab>> slabs_;
+  std::vector<FrameRef> frames_;
+  // Whether the last slab is ours to append to (false after splice())
+  bool open_ = false;
+  // Bytes in use in the open slab (slab size may be larger after reserve())
+  size_t open_used_ = 0;
+};
+
+// Where dumped files are written
+enum class WriterMode {
+  SYNC,   // On the calling (benchmark) thread, right after each codec run
+  ASYNC,  // On a background thread, while the next codec runs
+};
+
+// How dumped files are written
+enum class WriterIo {
+  WRITE,   // Plain write() through the page cache
+  DIRECT,  // O_DIRECT from an aligned bounce buffer (skips the page cache;
+           // falls back to WRITE where the filesystem does not support it)
+};
+
+// Parse/format writer mode names ("sync", "async") and I/O names ("write",
+// "direct")
+// Parse functions return true on success, false on unknown name
+bool parse_writer_mode(const std::string& name, WriterMode* mode);
+bool parse_writer_io(const std::string& name, WriterIo* io);
+const char* writer_mode_name(WriterMode mode);
+const char* writer_io_name(WriterIo io);
+
+// File writer statistics
+struct WriterStats {
+  // Number of files and bytes written
+  int files = 0;
+  size_t bytes = 0;
+  // Failed writes
+  int errors = 0;
+  // Time spent in open/write/close (on whichever thread did the writing)
+  double write_time_ms = 0.0;
+  // Time the benchmark thread spent waiting in flush() for queued files
+  double flush_time_ms = 0.0;
+};
+
+// Writer for --dump-output files
+// Frames are handed off as a batch (one batch per codec run) that shares
+// the arena slabs, so no bitstream is copied. In ASYNC mode at most
+// queue_depth batches are pending; submit() blocks when the queue is full.
+class FileWriter {
+ public:
+  FileWriter(WriterMode mode, WriterIo io, size_t queue_depth = 4);
+  // Flushes pending files
+  ~FileWriter();
+  FileWriter(const FileWriter&) = delete;
+  FileWriter& operator=(const FileWriter&) = delete;
+
+  // Write frame i of frames to filenames[i]
+  void submit(std::vector<std::string> filenames, const FrameArena& frames);
+
+  // Wait until all submitted files are written
+  void flush();
+
+  WriterMode mode() const { return mode_; }
+  WriterIo io() const { return io_.load(std::memory_order_relaxed); }
+  // Statistics (call after flush())
+  WriterStats stats();
+
+ private:
+  // Files of one codec run
+  struct Batch {
+    std::vector<std::string> filenames;
+    FrameArena frames;
+  };
+
+  void thread_main();
+  void write_batch(const Batch& batch);
+  bool write_file(const std::string& filename, const uint8_t* data,
+                  size_t size);
+  bool write_file_direct(int fd, const uint8_t* data, size_t size);
+
+  WriterMode mode_;
+  // Falls back to WRITE from the writer thread (O_DIRECT not supported)
+  std::atomic<WriterIo> io_;
+  size_t queue_depth_;
+  std::mutex mutex_;
+  // Signaled when the queue gets a batch, gets room, or drains
+  std::condition_variable queue_cv_;
+  std::deque<Batch> queue_;
+  // Whether the writer thread is writing a batch (outside the queue)
+  bool busy_ = false;
+  bool stop_ = false;
+  WriterStats stats_;
+  // Serializes write_batch() (SYNC writes may come from parallel codecs)
+  std::mutex io_mutex_;
+  // Aligned bounce buffer for WriterIo::DIRECT
+  void* direct_buffer_ = nullptr;
+  size_t direct_buffer_size_ = 0;
+  std::thread thread_;
+};
+
+}  // namespace output
+}  // namespace anicet
+
+#endif  // __cplusplus
+
+#endif  // ANICET_OUTPUT_H
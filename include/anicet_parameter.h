@@ -11,6 +11,7 @@
 #include <optional>
 #include <string>
 #include <variant>
+#include <vector>
 
 #include "anicet_runner.h"
 
@@ -46,9 +47,17 @@ struct ParameterDescriptor {
 
   // Display order (lower values appear first, 100 is default for unspecified)
   int order = 100;
+
+  // Optional check of STRING_LIST values against the running device
+  // (nullptr: all valid values run). An unsupported value is an error, and
+  // is pruned from sweeps.
+  bool (*value_supported)(const std::string& value) = nullptr;
 };
 
 // Parse comma or colon-separated parameter string "key=value:key=value"
+// Values can also describe a sweep, which is stored in setup->sweep_map:
+//   key=a..b[:step]  numeric range (INTEGER_RANGE/DOUBLE_RANGE, step=1)
+//   key=v1|v2|v3     explicit list of values (any parameter type)
 // Returns true on success, false on error (with error message printed)
 bool parse_parameter_string(
     const std::string& codec_name, const std::string& param_string,
@@ -70,6 +79,14 @@ bool validate_parameter_dependencies(
     const std::map<std::string, ParameterDescriptor>& descriptors,
     const CodecSetup& setup);
 
+// Expand the sweep axes in setup.sweep_map that belong to this codec into
+// one CodecSetup per grid point (cartesian product). Points that violate
+// parameter dependencies (e.g. crf with rate-control=cqp) are skipped.
+// Returns a single point (a copy of setup) when there is nothing to expand.
+std::vector<CodecSetup> expand_parameter_grid(
+    const std::string& codec_name, const CodecSetup& setup,
+    const std::map<std::string, ParameterDescriptor>& descriptors);
+
 // Print parameter help with configurable verbosity
 enum class HelpVerbosity {
   COMPACT,  // One-liner
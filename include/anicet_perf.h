@@ -0,0 +1,110 @@
+// anicet_perf.h
+// In-process hardware performance counters (perf_event_open group reads)
+
+#ifndef ANICET_PERF_H
+#define ANICET_PERF_H
+
+#ifdef __cplusplus
+
+#include <stdint.h>
+
+#include <vector>
+
+struct CodecInput;
+struct CodecOutput;
+
+namespace anicet {
+namespace perf {
+
+// Hardware counters read as one perf_event group
+enum Counter {
+  CYCLES = 0,
+  INSTRUCTIONS,
+  L1D_READ_MISSES,
+  LLC_READ_MISSES,
+  BRANCH_MISSES,
+  STALLED_CYCLES_FRONTEND,
+  STALLED_CYCLES_BACKEND,
+  NUM_COUNTERS
+};
+
+// Counter name used in the JSON output (e.g. "cycles", "l1d_read_misses")
+const char* counter_name(int counter);
+
+// Counter deltas for one encode call
+struct CounterValues {
+  // Counts (scaled for multiplexing), -1 if the counter is not available
+  int64_t values[NUM_COUNTERS];
+  // Fraction of the interval the group was on the PMU (1.0 = no
+  // multiplexing, 0.0 = never scheduled, the values are then -1)
+  double running_ratio;
+};
+
+// Raw group read
+struct CounterSample {
+  uint64_t time_enabled;
+  uint64_t time_running;
+  uint64_t values[NUM_COUNTERS];
+};
+
+// perf_event group with the counters of the calling thread. With inherit,
+// threads created afterwards by the calling thread (e.g. encoder thread
+// pools) are counted too. Only user-space events are counted.
+class CounterGroup {
+ public:
+  CounterGroup() = default;
+  ~CounterGroup();
+  CounterGroup(const CounterGroup&) = delete;
+  CounterGroup& operator=(const CounterGroup&) = delete;
+
+  // Open the group (counters the PMU does not support are skipped)
+  // Returns true if at least the cycles counter could be opened
+  bool open(bool inherit);
+  void close();
+  bool is_open() const { return leader_fd_ >= 0; }
+  // Whether child threads are counted (some kernels reject inherit with
+  // group reads, then only the calling thread is counted)
+  bool inherited() const { return inherited_; }
+
+  // Read all counters at once
+  bool read(CounterSample* sample) const;
+
+  // Compute the (multiplexing-scaled) deltas between two reads
+  void compute_delta(const CounterSample& start, const CounterSample& end,
+                     CounterValues* delta) const;
+
+ private:
+  int leader_fd_ = -1;
+  int fds_[NUM_COUNTERS] = {-1, -1, -1, -1, -1, -1, -1};
+  // Position of each counter in the group read, -1 if not open
+  int group_index_[NUM_COUNTERS] = {-1, -1, -1, -1, -1, -1, -1};
+  int num_open_ = 0;
+  bool inherited_ = false;
+};
+
+// Per-frame counters for a codec run
+// Construct it before the codec setup (so that the encoder threads inherit
+// the counters) and call start()/stop() next to capture_resources() around
+// each encode call. Results go to output->perf_counters (one entry per run).
+// Does nothing unless input->perf_counters is set.
+class FrameCounters {
+ public:
+  FrameCounters(const CodecInput* input, CodecOutput* output, int num_runs);
+
+  void start(int run);
+  void stop(int run);
+
+ private:
+  CounterGroup group_;
+  CodecOutput* output_;
+  std::vector<CounterSample> starts_;
+  // Whether the start sample of each run was read successfully
+  std::vector<bool> started_;
+};
+
+}  // namespace perf
+}  // namespace anicet
+
+#endif  // __cplusplus
+
+#endif  // ANICET_PERF_H
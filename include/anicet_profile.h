@@ -0,0 +1,124 @@
+// anicet_profile.h
+// Sampling profiler of the encode phase (perf_event_open call stacks,
+// symbolized against the loaded ELF objects)
+
+#ifndef ANICET_PROFILE_H
+#define ANICET_PROFILE_H
+
+#ifdef __cplusplus
+
+#include <stdint.h>
+
+#include <atomic>
+#include <map>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace anicet {
+namespace profile {
+
+// Samples of one function
+struct FunctionSamples {
+  // Samples with the function on top of the stack (self), and with the
+  // function anywhere in the stack (total, recursion counted once)
+  int64_t self = 0;
+  int64_t total = 0;
+};
+
+// Sampled call stacks of one codec
+struct Profile {
+  // Codec name (empty until the runner call is attributed to its codec)
+  std::string codec;
+  // Samples taken, and samples the kernel dropped (ring buffer full)
+  int64_t samples = 0;
+  int64_t lost = 0;
+  // Folded stacks ("root;caller;leaf" -> samples, the flamegraph input)
+  std::map<std::string, int64_t> folded;
+  // Samples per (library, function)
+  std::map<std::pair<std::string, std::string>, FunctionSamples> functions;
+};
+
+// Add src to the profile of the same codec in profiles (or append it)
+void merge_profiles(std::vector<Profile>* profiles,
+                    const std::vector<Profile>& src);
+
+// Functions of a profile by decreasing self samples (at most max_functions,
+// 0 for all)
+struct FunctionEntry {
+  std::string library;
+  std::string function;
+  FunctionSamples samples;
+};
+std::vector<FunctionEntry> top_functions(const Profile& profile,
+                                         size_t max_functions);
+
+// Write the folded stacks of a profile ("frame;frame;frame count" lines)
+// Returns false (with error message printed) on failure
+bool write_folded(const Profile& profile, const std::string& path);
+
+// Sample the encode phase of every runner call at frequency_hz (process-
+// wide setting, call before the experiment). Returns false (with error
+// message printed) if the frequency is invalid.
+bool enable(int frequency_hz);
+bool enabled();
+int frequency_hz();
+
+// Stack sampler of one runner call
+// open() it before the codec setup, in the thread calling the codec, so
+// that the encoder threads created afterwards inherit the events (one
+// perf_event per CPU, user space only). Samples are only taken between
+// resume() and pause(). finish() symbolizes the stacks while the codec
+// library is still loaded. Stacks are walked with frame pointers: the
+// function on top is always right, its callers only for code built with
+// frame pointers.
+class StackSampler {
+ public:
+  StackSampler() = default;
+  ~StackSampler();
+  StackSampler(const StackSampler&) = delete;
+  StackSampler& operator=(const StackSampler&) = delete;
+
+  // Start the ring buffer thread and open the events (disabled)
+  // Returns false if no event could be opened (warned once per process)
+  bool open();
+  bool is_open() const { return !rings_.empty(); }
+
+  // Enable/disable sampling (the calling thread and its encoder threads)
+  void resume();
+  void pause();
+
+  // Stop sampling and add the symbolized stacks to profile
+  void finish(Profile* profile);
+
+ private:
+  // One mmap'ed ring buffer per CPU event
+  struct Ring {
+    int fd;
+    uint8_t* base;
+    size_t data_size;
+  };
+
+  void thread_main();
+  // Read the records of all ring buffers into stacks_
+  void drain();
+  void close();
+
+  std::vector<Ring> rings_;
+  std::atomic<bool> ready_{false};
+  std::atomic<bool> stop_{false};
+  std::thread thread_;
+  // Written by the ring buffer thread (read after join): raw stacks (return
+  // addresses, top of the stack first) and lost samples
+  std::map<std::vector<uint64_t>, int64_t> stacks_;
+  int64_t lost_ = 0;
+  std::vector<uint8_t> record_;
+};
+
+}  // namespace profile
+}  // namespace anicet
+
+#endif  // __cplusplus
+
+#endif  // ANICET_PROFILE_H
@@ -0,0 +1,83 @@
+// anicet_report.h
+// Streaming result writers: JSON written member by member (no document
+// tree), and CSV fields
+
+#ifndef ANICET_REPORT_H
+#define ANICET_REPORT_H
+
+#ifdef __cplusplus
+
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+namespace anicet {
+namespace report {
+
+// Result output format (--output-format)
+enum class ReportFormat {
+  JSON,   // Indented JSON document (2 spaces)
+  JSONL,  // Compact JSON, one line per document
+  CSV,    // One row per encoded frame
+};
+
+// Parse/format format names ("json", "jsonl", "csv")
+// parse_report_format() returns false on unknown name
+bool parse_report_format(const std::string& name, ReportFormat* format);
+const char* report_format_name(ReportFormat format);
+
+// JSON writer that streams a document to a FILE as it is built
+// Containers are opened and closed explicitly, and leaf values (or small
+// subtrees) are nlohmann::ordered_json values serialized right away, so
+// that only one frame of an arbitrarily long result is in memory at a time.
+// The output is the same as nlohmann::ordered_json::dump(indent) of the
+// whole document.
+class JsonWriter {
+ public:
+  // indent: spaces per level, or -1 for compact one-line output
+  JsonWriter(FILE* fp, int indent);
+  JsonWriter(const JsonWriter&) = delete;
+  JsonWriter& operator=(const JsonWriter&) = delete;
+
+  // Open an object/array as the next array element (or the document), or
+  // as a member of the enclosing object
+  void begin_object();
+  void begin_object(const std::string& key);
+  void end_object() { end_container('}'); }
+  void begin_array();
+  void begin_array(const std::string& key);
+  void end_array() { end_container(']'); }
+
+  // Write a member of the enclosing object, or the next array element
+  void member(const std::string& key, const nlohmann::ordered_json& value);
+  void element(const nlohmann::ordered_json& value);
+
+  // End the document (all containers closed) with a newline and flush it
+  void finish();
+
+ private:
+  // Separator, line break and indentation before the next item (and its
+  // key)
+  void start_item(const std::string* key);
+  void end_container(char close);
+  void newline(size_t depth);
+  void write_value(const nlohmann::ordered_json& value);
+
+  FILE* fp_;
+  int indent_;
+  // Per open container: no item written yet
+  std::vector<bool> empty_;
+};
+
+// Quote a CSV field when it contains a comma, quote or line break
+std::string csv_field(const std::string& value);
+
+}  // namespace report
+}  // namespace anicet
+
+#endif  // __cplusplus
+
+#endif  // ANICET_REPORT_H
@@ -15,6 +15,16 @@
 #include <string>
 #include <variant>
 #include <vector>
+
+#include "anicet_alloc.h"
+#include "anicet_cpu.h"
+#include "anicet_energy.h"
+#include "anicet_output.h"
+#include "anicet_memory.h"
+#include "anicet_perf.h"
+#include "anicet_profile.h"
+#include "anicet_stats.h"
+#include "anicet_thermal.h"
 #endif
 
 #ifdef __cplusplus
@@ -32,18 +42,46 @@ typedef struct {
 #ifdef __cplusplus
 }
 
+namespace anicet {
+namespace input {
+class FrameRing;
+class FrameSource;
+}  // namespace input
+}  // namespace anicet
+
 // Codec setup parameters (C++ only)
 // Generic mechanism for passing codec-specific parameters
 using CodecSetupValue = std::variant<int, double, std::string>;
 using CodecSetupParameterMap = std::map<std::string, CodecSetupValue>;
+// Parameter sweep axes (parameter name -> list of values to sweep over)
+using CodecSetupSweepMap = std::map<std::string, std::vector<CodecSetupValue>>;
 
 struct CodecSetup {
   // Number of runs per experiment
   int num_runs;
   // Codec-specific parameters
   CodecSetupParameterMap parameter_map;
+  // Swept parameters (e.g. "crf=18..40:4" or "preset=fast|medium"). Expanded
+  // into one parameter_map per grid point before calling the codec runner.
+  CodecSetupSweepMap sweep_map;
+};
+
+// Codec run phases (the (a)-(d) steps of every runner)
+enum CodecPhase {
+  // (a) Encoder allocation, configuration and open
+  CODEC_PHASE_SETUP = 0,
+  // (b) Input conversion (plane setup, picture import)
+  CODEC_PHASE_CONVERSION,
+  // (c) Encoding loop (includes per-run input reads outside the timed frames)
+  CODEC_PHASE_ENCODE,
+  // (d) Encoder close and buffer release
+  CODEC_PHASE_CLEANUP,
+  NUM_CODEC_PHASES
 };
 
+// Phase name used in the JSON output ("setup", "conversion", ...)
+const char* codec_phase_name(int phase);
+
 // Codec input data (C++ only)
 // This structure holds all input parameters for encoding
 struct CodecInput {
@@ -59,38 +97,265 @@ struct CodecInput {
   const char* color_format;
   // Debug level (0 = silent, higher = more verbose)
   int debug_level;
+  // Optional multi-frame source. When set, each run encodes a distinct frame
+  // (see anicet::input::FrameRing) instead of re-encoding input_buffer.
+  const anicet::input::FrameSource* frame_source = nullptr;
+  // Number of frames each runner keeps resident when streaming
+  int frame_ring_size = 2;
+  // Index of the first run in the clip (later batches of --num-runs auto
+  // continue where the previous batch stopped)
+  int run_offset = 0;
+  // Sample hardware performance counters around each encode call
+  bool perf_counters = false;
+  // Memory sampler interval (milliseconds, 0 = no sampler thread)
+  int memory_sample_interval_ms = 0;
+  // CPU frequency and thermal sampler interval (milliseconds, 0 = no
+  // sampler thread), and the thermal zones it reads (see
+  // anicet::thermal::ThermalReader, nullptr for the default zones)
+  int thermal_sample_interval_ms = 0;
+  const char* thermal_zones = nullptr;
+  // Energy sampler interval (milliseconds, 0 = no sampler thread)
+  int energy_sample_interval_ms = 0;
+};
+
+// Thread-scaling result of one codec run (--thread-scaling)
+struct ThreadScalingPoint {
+  // Thread count (0 when not part of a thread-scaling run) and the CPUs the
+  // run was pinned to
+  int threads = 0;
+  std::string cpus;
+  // Median encode time per frame, and the speedup and parallel efficiency
+  // relative to the first thread count
+  double median_encode_time_us = 0.0;
+  double speedup = 0.0;
+  double efficiency = 0.0;
+  // CPU time over wall time of the encode calls, relative to the pinned CPUs
+  // (100 = all of them busy)
+  double cpu_utilization_percent = 0.0;
+};
+
+// Codec instance startup of one runner call (microseconds, -1 when not
+// measured). Only reported by codecs with a separate instance setup
+// (MediaCodec); a warm instance comes from a pool (no create/configure/start).
+struct CodecStartup {
+  bool warm = false;
+  int64_t create_us = -1;
+  int64_t configure_us = -1;
+  int64_t start_us = -1;
+  // First frame, from its input to its encoded output
+  int64_t first_output_us = -1;
+};
+
+// Strip-parallel encode of one runner call (JPEG strips=N, N > 1) against
+// the single-threaded encode of the same frames, re-encoded after the runs
+struct StripComparison {
+  int strips = 0;
+  // Frames encoded both ways (the last runs of the call)
+  int frames = 0;
+  // Total encode time and output size of those frames, each way
+  int64_t strip_time_us = 0;
+  int64_t single_time_us = 0;
+  size_t strip_bytes = 0;
+  size_t single_bytes = 0;
+};
+
+// One worker of a concurrent encode (--workers), over its measured frames
+struct WorkerResult {
+  int worker = 0;
+  // Encode time of each measured frame
+  std::vector<double> encode_time_us;
+  // First input to last output (anicet_get_timestamp())
+  int64_t start_us = 0;
+  int64_t end_us = 0;
+  // Context switches of the worker thread (whole runner calls)
+  int64_t vol_ctx_switches = 0;
+  int64_t invol_ctx_switches = 0;
+  // LLC read misses of the measured frames (-1 without perf counters)
+  int64_t llc_read_misses = -1;
+};
+
+// Concurrent encode of one grid point by several workers (--workers, 0
+// workers otherwise). The point's frames are those of all workers.
+struct WorkerRun {
+  int workers = 0;
+  // Measured frames of all workers over the time from the first input to
+  // the last output
+  double throughput_fps = 0.0;
+  std::vector<WorkerResult> results;
 };
 
 // Codec encoding output with timing data (C++ only)
 // This structure uses C++ vectors for automatic memory management
 struct CodecOutput {
-  // Output buffers (one per frame)
-  std::vector<std::vector<uint8_t>> frame_buffers;
-  // Output sizes (one per frame) - redundant but kept for compatibility
+  // Encoded frames (one per frame) - only populated if dump_output is true
+  anicet::output::FrameArena frame_arena;
+  // Output sizes (one per frame)
   std::vector<size_t> frame_sizes;
   // Timing data (one per frame)
   std::vector<CodecFrameTiming> timings;
   // Output filenames (one per frame) - populated if dump_output is true
   std::vector<std::string> output_files;
-  // Whether to copy encoded data to frame_buffers
+  // Whether to copy encoded data to frame_arena
   bool dump_output;
+  // Warm-up frames (one flag per frame), excluded from the summary
+  std::vector<bool> warmup_frames;
 
   // Resource consumption statistics
   // CPU time per frame (milliseconds)
   std::vector<double> profile_encode_cpu_ms;
+  // Hardware counters per frame (empty unless CodecInput::perf_counters)
+  std::vector<anicet::perf::CounterValues> perf_counters;
+  // Memory timeline and peak memory per frame (empty unless
+  // CodecInput::memory_sample_interval_ms > 0)
+  std::vector<anicet::memory::MemorySample> memory_timeline;
+  std::vector<anicet::memory::FramePeak> memory_frame_peaks;
+  // CPU frequency/temperature timeline and per-frame values (empty unless
+  // CodecInput::thermal_sample_interval_ms > 0)
+  anicet::thermal::ThermalTimeline thermal_timeline;
+  std::vector<anicet::thermal::FrameThermal> thermal_frames;
+  // Cooldown waits before the runs (RunPolicy::cooldown_temp_c/cooldown_ms)
+  anicet::thermal::CooldownStats cooldown;
+  // Energy per frame, per phase and in total (millijoules, empty/-1 unless
+  // CodecInput::energy_sample_interval_ms > 0), and its source
+  std::vector<anicet::energy::FrameEnergy> frame_energy;
+  double phase_energy_mj[NUM_CODEC_PHASES] = {-1.0, -1.0, -1.0, -1.0};
+  double energy_mj = -1.0;
+  std::string energy_source;
   // Peak memory usage (kilobytes)
   long profile_encode_mem_kb;
+  // Heap allocations per frame and per phase (empty/invalid unless
+  // anicet::alloc::enable() was called)
+  std::vector<anicet::alloc::AllocStats> frame_allocs;
+  anicet::alloc::AllocStats phase_allocs[NUM_CODEC_PHASES];
+  // Sampled call stacks of the encode phase, one profile per codec (empty
+  // unless anicet::profile::enable() was called)
+  std::vector<anicet::profile::Profile> profiles;
   // Detailed resource usage delta for the encoding operation
   ResourceDelta resource_delta;
+  // Resource usage of each phase (see CodecPhaseTimer)
+  ResourceDelta phases[NUM_CODEC_PHASES] = {};
+  // Time window of each phase in the last runner call
+  // (anicet_get_timestamp(), first start to last stop, 0 if not run)
+  int64_t phase_start_us[NUM_CODEC_PHASES] = {};
+  int64_t phase_end_us[NUM_CODEC_PHASES] = {};
+  // Codec library load time (dlopen + dlsym, milliseconds). Not part of
+  // resource_delta. 0 when the library was already loaded in this process.
+  double library_load_time_ms = 0.0;
+  // SIMD level the codec ran with (codecs with runtime dispatch, empty for
+  // the others), e.g. "sve2" or "neon (NEON)" with the Highway target
+  std::string simd_level;
+  // Codec instance startup, one per runner call (empty for codecs without
+  // it)
+  std::vector<CodecStartup> codec_startup;
+  // Strip-parallel encodes, one per runner call (empty unless strips > 1)
+  std::vector<StripComparison> strip_comparison;
 
   // Codec name and parameters used for this encoding
   std::string codec_name;
   std::map<std::string, std::string> codec_params;
+  // Runner result of this codec and grid point. Failed points (non-zero,
+  // no frames) are only kept in the per-point results.
+  int exit_code = 0;
+  // Thread-scaling point (--thread-scaling only)
+  ThreadScalingPoint thread_scaling;
+  // Concurrent workers (--workers only)
+  WorkerRun worker_run;
+  // CPU cluster the run was pinned to (--per-cluster only, empty name
+  // otherwise)
+  anicet::cpu::CpuCluster cluster;
 
   // Helper method to get number of frames
-  size_t num_frames() const { return frame_buffers.size(); }
+  size_t num_frames() const { return frame_sizes.size(); }
 };
 
+// Experiment-wide options (C++ only)
+// Controls how anicet_experiment() schedules the selected codecs
+struct ExperimentOptions {
+  // Run each selected codec concurrently on its own worker thread
+  bool parallel_codecs = false;
+  // Per-codec CPU list for the worker threads (e.g. {"x265", "4-7"})
+  // Codecs without an entry inherit the affinity of the calling thread
+  std::map<std::string, std::string> codec_cpus;
+  // Multi-frame input source (nullptr to re-encode the single input buffer)
+  const anicet::input::FrameSource* frame_source = nullptr;
+  // Number of frames each runner keeps resident when streaming
+  int frame_ring_size = 2;
+  // Sample hardware performance counters (cycles, instructions, cache and
+  // branch misses, stalls) around each encode call
+  bool perf_counters = false;
+  // Sample process memory (RSS, anon/file RSS, PSS) on a background thread
+  // every memory_sample_interval_ms milliseconds (0 = disabled)
+  int memory_sample_interval_ms = 0;
+  // Sample the power monitor rails (or the battery) every
+  // energy_sample_interval_ms milliseconds (0 = disabled)
+  int energy_sample_interval_ms = 0;
+  // Sample the CPU frequency of the pinned clusters and the thermal zones
+  // every thermal_sample_interval_ms milliseconds (0 = disabled)
+  int thermal_sample_interval_ms = 0;
+  // Thermal zones to read (comma-separated type substrings, empty for the
+  // CPU/SoC zones), also used by the cooldown
+  std::string thermal_zones;
+  // Warm-up runs, --num-runs auto and cooldown
+  anicet::stats::RunPolicy run_policy;
+  // Thread counts to run each codec with (--thread-scaling, empty = off).
+  // Not combinable with parallel_codecs.
+  std::vector<int> thread_counts;
+  // Run the codecs once per CPU cluster, pinned to its CPUs (--per-cluster,
+  // not combinable with parallel_codecs)
+  bool per_cluster = false;
+  // Encode each grid point with this many concurrent instances of the codec,
+  // one per thread (--workers, 0/1 = a single instance). Not combinable with
+  // parallel_codecs or thread_counts.
+  int workers = 0;
+  // Writer for --dump-output files (nullptr to write them synchronously
+  // after each codec run). Files may still be pending when
+  // anicet_experiment() returns: call writer->flush() before using them.
+  anicet::output::FileWriter* writer = nullptr;
+};
+
+// Phase timer used by the runners (one per runner call, it resets
+// output->phases)
+// start(phase) at the beginning of each (a)-(d) step (ending the previous
+// one), stop() after the cleanup. A phase still running on destruction
+// (early error return) is stopped.
+// With profiling enabled, it also samples the call stacks of the encode
+// phase (construct it before the codec setup, see
+// anicet::profile::StackSampler) and adds them to output->profiles on
+// destruction.
+class CodecPhaseTimer {
+ public:
+  explicit CodecPhaseTimer(CodecOutput* output);
+  ~CodecPhaseTimer();
+  CodecPhaseTimer(const CodecPhaseTimer&) = delete;
+  CodecPhaseTimer& operator=(const CodecPhaseTimer&) = delete;
+
+  void start(CodecPhase phase);
+  void stop();
+
+  // Move the time frames spent converting frames (fetched while encoding)
+  // from the running phase to the conversion phase (wall and CPU time)
+  void add_conversion(anicet::input::FrameRing* frames);
+  // Move conversion time measured by the runner (e.g. a codec picture
+  // import) from the running phase to the conversion phase
+  void add_conversion(double wall_ms, double cpu_ms);
+
+ private:
+  CodecOutput* output_;
+  // Running phase, -1 if none
+  int phase_ = -1;
+  ResourceSnapshot start_;
+  // Allocations of the running phase (when tracking is enabled)
+  anicet::alloc::AllocInterval allocs_{anicet::alloc::PEAK_PHASE};
+  // Call stacks of the encode phase (when profiling is enabled)
+  anicet::profile::StackSampler stacks_;
+  // Conversion time to take out of the running phase when it stops
+  double moved_wall_ms_ = 0.0;
+  double moved_cpu_ms_ = 0.0;
+};
+
+// Add the resource usage of delta to total
+void add_resource_delta(ResourceDelta* total, const ResourceDelta& delta);
+
 // Helper function to validate parameter against a list of valid values
 // Returns true if valid, false if invalid (with error message printed)
 bool validate_parameter_list(const std::string& label,
@@ -105,9 +370,9 @@ bool validate_parameter_list(const std::string& label,
 //   - Return: 0 on success, -1 on error
 //
 // NOTE: All encoders write to memory buffers only, no file I/O
-// NOTE: If output->dump_output is false, encoders skip copying frame_buffers
-//       to save memory but still populate frame_sizes and timings for
-//       statistics
+// NOTE: If output->dump_output is false, encoders skip copying frames to
+//       frame_arena to save memory but still populate frame_sizes and
+//       timings for statistics
 
 // WebP encoder - optimized
 int anicet_run_webp(const CodecInput* input, int num_runs, CodecOutput* output);
@@ -144,16 +409,18 @@ int anicet_run_mediacodec(const CodecInput* input, const char* codec_name,
                           int num_runs, CodecOutput* output);
 
 // Run encoding experiment with multiple encoders
-// Encodes the same raw YUV420p image using specified encoder(s)
+// Encodes the same raw image (YUV420p, or converted from color_format) using
+// specified encoder(s)
 // and reports the compressed size for each
 //
 // Parameters:
-//   buffer:             Raw YUV420p image data
+//   buffer:             Raw image data (color_format)
 //   buf_size:           Size of buffer in bytes
 //   height:             Image height in pixels
 //   width:              Image width in pixels
-//   color_format:       Color format string (currently only "yuv420p"
-//   supported) codec_name:         Codec to use: "x265", "svt-av1",
+//   color_format:       Color format string ("yuv420p", "nv12", "nv21",
+//                       "p010" or "rgba", see anicet::color::ColorFormat)
+//   codec_name:         Codec to use: "x265", "svt-av1",
 //                       "libjpeg-turbo", "libjpeg-turbo-nonopt", "jpegli",
 //                       "webp", "mediacodec", "all" (default: all encoders)
 //   num_runs:           Number of times to encode the same frame
@@ -167,6 +434,10 @@ int anicet_run_mediacodec(const CodecInput* input, const char* codec_name,
 //                       (can be nullptr if not needed)
 //   codec_setup:        Optional codec setup with parameters
 //                       (can be nullptr to use defaults)
+//   results:            Optional vector to receive one CodecOutput per
+//                       codec and sweep grid point (can be nullptr)
+//   options:            Optional experiment options, e.g. parallel codec
+//                       execution (can be nullptr to run codecs serially)
 //
 // Returns:
 //   Number of encoding errors (0 = all succeeded)
@@ -176,7 +447,9 @@ int anicet_experiment(const uint8_t* buffer, size_t buf_size, int height,
                       const char* dump_output_dir,
                       const char* dump_output_prefix, int debug_level,
                       CodecOutput* output = nullptr,
-                      CodecSetup* codec_setup = nullptr);
+                      CodecSetup* codec_setup = nullptr,
+                      std::vector<CodecOutput>* results = nullptr,
+                      const ExperimentOptions* options = nullptr);
 
 #endif  // __cplusplus
 
@@ -11,6 +11,7 @@
 #include <map>
 #include <string>
 
+#include "anicet_cpu.h"
 #include "anicet_parameter.h"
 
 namespace anicet {
@@ -34,18 +35,32 @@ const std::map<std::string, anicet::parameter::ParameterDescriptor>
           .requires_param = std::nullopt,
           .requires_value = std::nullopt,
           .order = 0}},
-        {"highway_target",
-         {.name = "highway_target",
+        {"strips",
+         {.name = "strips",
+          .type = anicet::parameter::ParameterType::INTEGER_RANGE,
+          .description = "Encode N MCU-aligned strips in parallel, stitched "
+                         "with restart markers (1=single-threaded)",
+          .valid_values = {},
+          .min_value = 1,
+          .max_value = 64,
+          .default_value = 1,
+          .requires_param = std::nullopt,
+          .requires_value = std::nullopt,
+          .order = 1}},
+        {"optimization",
+         {.name = "optimization",
           .type = anicet::parameter::ParameterType::STRING_LIST,
-          .description =
-              "Highway SIMD target (all=auto-dispatch, none=scalar-only)",
-          .valid_values = {"all", "none"},
+          .description = "Runtime SIMD level (c=no SIMD, auto=all the CPU "
+                         "has; levels the CPU lacks are rejected)",
+          .valid_values = {"c", "neon", "dotprod", "i8mm", "sve", "sve2",
+                           "auto"},
           .min_value = 0,
           .max_value = 0,
-          .default_value = std::string("all"),
+          .default_value = std::string("auto"),
           .requires_param = std::nullopt,
           .requires_value = std::nullopt,
-          .order = 1}}};
+          .order = 2,
+          .value_supported = anicet::cpu::simd_level_supported}}};
 
 // jpegli encoder (JPEG XL's JPEG encoder)
 int anicet_run(const CodecInput* input, CodecSetup* setup, CodecOutput* output);
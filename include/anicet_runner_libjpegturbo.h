@@ -56,7 +56,19 @@ const std::map<std::string, anicet::parameter::ParameterDescriptor>
           .default_value = std::string("fastdct"),
           .requires_param = std::nullopt,
           .requires_value = std::nullopt,
-          .order = 2}}};
+          .order = 2}},
+        {"strips",
+         {.name = "strips",
+          .type = anicet::parameter::ParameterType::INTEGER_RANGE,
+          .description = "Encode N MCU-aligned strips in parallel, stitched "
+                         "with restart markers (1=single-threaded)",
+          .valid_values = {},
+          .min_value = 1,
+          .max_value = 64,
+          .default_value = 1,
+          .requires_param = std::nullopt,
+          .requires_value = std::nullopt,
+          .order = 3}}};
 
 // Runner - dispatches to opt or nonopt based on setup parameters
 int anicet_run(const CodecInput* input, CodecSetup* setup, CodecOutput* output);
@@ -68,7 +68,45 @@ const std::map<std::string, anicet::parameter::ParameterDescriptor>
           .default_value = DEFAULT_BITRATE_MODE,
           .requires_param = std::nullopt,
           .requires_value = std::nullopt,
-          .order = 3}}};
+          .order = 3}},
+        {"async_frames",
+         {.name = "async_frames",
+          .type = anicet::parameter::ParameterType::INTEGER_RANGE,
+          .description = "Asynchronous (callback) mode with up to N frames "
+                         "in flight, Android 9+ (0=synchronous polling)",
+          .valid_values = {},
+          .min_value = 0,
+          .max_value = 64,
+          .default_value = 0,
+          .requires_param = std::nullopt,
+          .requires_value = std::nullopt,
+          .order = 4}},
+        {"surface_input",
+         {.name = "surface_input",
+          .type = anicet::parameter::ParameterType::INTEGER_RANGE,
+          .description = "Zero-copy input surface fed from pre-filled "
+                         "hardware buffers, Android 10+ (0=copy each frame "
+                         "into the input buffers)",
+          .valid_values = {},
+          .min_value = 0,
+          .max_value = 1,
+          .default_value = 0,
+          .requires_param = std::nullopt,
+          .requires_value = std::nullopt,
+          .order = 5}},
+        {"pool",
+         {.name = "pool",
+          .type = anicet::parameter::ParameterType::INTEGER_RANGE,
+          .description = "Reuse warm (started, flushed) codec instances "
+                         "across runs (0=create, configure and start every "
+                         "run)",
+          .valid_values = {},
+          .min_value = 0,
+          .max_value = 1,
+          .default_value = 0,
+          .requires_param = std::nullopt,
+          .requires_value = std::nullopt,
+          .order = 6}}};
 
 // Hardcoded MediaCodec parameters (not exposed as CLI parameters)
 #define MEDIACODEC_FRAME_RATE 30
@@ -87,7 +125,7 @@ std::string get_codec_extension(const std::string& codec_name);
 
 // Android MediaCodec encoder (Android only)
 // Expects parameters in setup->parameter_map: codec_name, quality, bitrate,
-// bitrate_mode
+// bitrate_mode, and optionally async_frames, surface_input and pool
 int anicet_run(const CodecInput* input, CodecSetup* setup, CodecOutput* output);
 
 }  // namespace mediacodec
@@ -12,6 +12,7 @@
 #include <map>
 #include <string>
 
+#include "anicet_cpu.h"
 #include "anicet_parameter.h"
 
 namespace anicet {
@@ -38,18 +39,6 @@ const std::map<std::string, anicet::parameter::ParameterDescriptor>
           .requires_param = std::nullopt,
           .requires_value = std::nullopt,
           .order = 0}},
-        {"use_cpu_flags",
-         {.name = "use_cpu_flags",
-          .type = anicet::parameter::ParameterType::STRING_LIST,
-          .description =
-              "CPU optimization flags (all=auto detect, none=no SIMD)",
-          .valid_values = {"all", "none"},
-          .min_value = 0,
-          .max_value = 0,
-          .default_value = std::string("all"),
-          .requires_param = std::nullopt,
-          .requires_value = std::nullopt,
-          .order = 1}},
         {"tune",
          {.name = "tune",
           .type = anicet::parameter::ParameterType::INTEGER_RANGE,
@@ -60,7 +49,7 @@ const std::map<std::string, anicet::parameter::ParameterDescriptor>
           .default_value = 1,
           .requires_param = std::nullopt,
           .requires_value = std::nullopt,
-          .order = 2}},
+          .order = 1}},
         {"qp",
          {.name = "qp",
           .type = anicet::parameter::ParameterType::INTEGER_RANGE,
@@ -71,7 +60,46 @@ const std::map<std::string, anicet::parameter::ParameterDescriptor>
           .default_value = DEFAULT_QP,
           .requires_param = std::nullopt,
           .requires_value = std::nullopt,
-          .order = 3}}};
+          .order = 2}},
+        {"lp",
+         {.name = "lp",
+          .type = anicet::parameter::ParameterType::INTEGER_RANGE,
+          .description =
+              "Level of parallelism (level_of_parallelism, 0=auto from the "
+              "CPU count)",
+          .valid_values = {},
+          .min_value = 0,
+          .max_value = 256,
+          .default_value = 0,
+          .requires_param = std::nullopt,
+          .requires_value = std::nullopt,
+          .order = 3}},
+        {"mode",
+         {.name = "mode",
+          .type = anicet::parameter::ParameterType::STRING_LIST,
+          .description = "Frame scheduling (latency=low delay, one picture "
+                         "at a time, throughput=pictures in flight)",
+          .valid_values = {"latency", "throughput"},
+          .min_value = 0,
+          .max_value = 0,
+          .default_value = std::string("latency"),
+          .requires_param = std::nullopt,
+          .requires_value = std::nullopt,
+          .order = 4}},
+        {"optimization",
+         {.name = "optimization",
+          .type = anicet::parameter::ParameterType::STRING_LIST,
+          .description = "Runtime SIMD level (c=no SIMD, auto=all the CPU "
+                         "has; levels the CPU lacks are rejected)",
+          .valid_values = {"c", "neon", "dotprod", "i8mm", "sve", "sve2",
+                           "auto"},
+          .min_value = 0,
+          .max_value = 0,
+          .default_value = std::string("auto"),
+          .requires_param = std::nullopt,
+          .requires_value = std::nullopt,
+          .order = 5,
+          .value_supported = anicet::cpu::simd_level_supported}}};
 
 // SVT-AV1 encoder
 int anicet_run(const CodecInput* input, CodecSetup* setup, CodecOutput* output);
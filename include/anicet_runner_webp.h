@@ -59,7 +59,18 @@ const std::map<std::string, anicet::parameter::ParameterDescriptor>
           .default_value = DEFAULT_METHOD,
           .requires_param = std::nullopt,
           .requires_value = std::nullopt,
-          .order = 2}}};
+          .order = 2}},
+        {"thread_level",
+         {.name = "thread_level",
+          .type = anicet::parameter::ParameterType::INTEGER_RANGE,
+          .description = "Multi-threaded encoding (0=off, 1=on, 2 threads)",
+          .valid_values = {},
+          .min_value = 0,
+          .max_value = 1,
+          .default_value = 0,
+          .requires_param = std::nullopt,
+          .requires_value = std::nullopt,
+          .order = 3}}};
 
 // Runner - dispatches to opt or nonopt based on setup parameters
 int anicet_run(const CodecInput* input, CodecSetup* setup, CodecOutput* output);
@@ -119,7 +119,41 @@ const std::map<std::string, anicet::parameter::ParameterDescriptor>
           .default_value = 1000000,
           .requires_param = "rate-control",
           .requires_value = "abr",
-          .order = 6}}};
+          .order = 6}},
+        {"pools",
+         {.name = "pools",
+          .type = anicet::parameter::ParameterType::INTEGER_RANGE,
+          .description = "Worker threads in the thread pool (0=one per CPU)",
+          .valid_values = {},
+          .min_value = 0,
+          .max_value = 256,
+          .default_value = 0,
+          .requires_param = std::nullopt,
+          .requires_value = std::nullopt,
+          .order = 7}},
+        {"frame-threads",
+         {.name = "frame-threads",
+          .type = anicet::parameter::ParameterType::INTEGER_RANGE,
+          .description = "Concurrently encoded frames (0=auto from pool size)",
+          .valid_values = {},
+          .min_value = 0,
+          .max_value = 16,
+          .default_value = 0,
+          .requires_param = std::nullopt,
+          .requires_value = std::nullopt,
+          .order = 8}},
+        {"mode",
+         {.name = "mode",
+          .type = anicet::parameter::ParameterType::STRING_LIST,
+          .description = "Frame scheduling (latency=one picture at a time, "
+                         "throughput=frame threads with pictures in flight)",
+          .valid_values = {"latency", "throughput"},
+          .min_value = 0,
+          .max_value = 0,
+          .default_value = std::string("latency"),
+          .requires_param = std::nullopt,
+          .requires_value = std::nullopt,
+          .order = 9}}};
 
 // Runner - dispatches to opt or nonopt based on setup parameters
 int anicet_run(const CodecInput* input, CodecSetup* setup, CodecOutput* output);
@@ -0,0 +1,114 @@
+// anicet_sched.h
+// Per-thread CPU and scheduling sampler for a wrapped child process
+// (/proc/<pid>/task/*/stat and schedstat)
+
+#ifndef ANICET_SCHED_H
+#define ANICET_SCHED_H
+
+#ifdef __cplusplus
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <atomic>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace anicet {
+namespace sched {
+
+// One thread of the child (or of its descendants, e.g. the encoder under
+// simpleperf), as of its last sample
+struct ThreadStats {
+  pid_t pid = 0;
+  pid_t tid = 0;
+  std::string comm;
+  // CPU time: user and system (stat, clock ticks), and the schedstat run
+  // time (nanoseconds, -1 without schedstat)
+  int64_t utime_ms = 0;
+  int64_t stime_ms = 0;
+  int64_t run_time_ns = -1;
+  // Time spent runnable, waiting on a run queue (nanoseconds, -1 without
+  // schedstat), and the number of times it was scheduled in
+  int64_t run_delay_ns = -1;
+  int64_t timeslices = -1;
+  // CPU it last ran on, and the number of samples on each CPU
+  int last_cpu = -1;
+  std::map<int, int> cpu_samples;
+  // anicet_get_timestamp() of the first and last sample it was seen in
+  int64_t first_seen_us = 0;
+  int64_t last_seen_us = 0;
+
+  // CPU time in milliseconds (schedstat when available)
+  double cpu_time_ms() const {
+    return run_time_ns >= 0 ? run_time_ns / 1e6
+                            : (double)(utime_ms + stime_ms);
+  }
+};
+
+// Utilization over one sampling interval (from the previous sample, the
+// first one from the fork)
+struct TimelineSample {
+  int64_t time_us;
+  // Threads alive, and those that ran during the interval
+  int threads;
+  int busy_threads;
+  // CPU time of all threads over the interval length (2.5 = two and a half
+  // CPUs busy on average)
+  double busy_cpus;
+  // Run-queue wait of all threads during the interval (milliseconds)
+  double run_delay_ms;
+};
+
+// Sampler thread for a child process
+// Construct it right after fork() and call finish() once the child has
+// exited but before it is reaped (waitid(WNOWAIT)), so that the last sample
+// still sees it. Threads that exit between two samples are kept with their
+// last values.
+class TaskSampler {
+ public:
+  TaskSampler(pid_t pid, int interval_ms);
+  ~TaskSampler();
+  TaskSampler(const TaskSampler&) = delete;
+  TaskSampler& operator=(const TaskSampler&) = delete;
+
+  // Take a last sample and stop the thread
+  void finish();
+
+  // Results (valid after finish()), threads in order of appearance
+  const std::vector<ThreadStats>& threads() const { return threads_; }
+  const std::vector<TimelineSample>& timeline() const { return timeline_; }
+  int interval_ms() const { return interval_us_ / 1000; }
+
+ private:
+  void thread_main();
+  // Read all threads of pid and its descendants into threads_
+  void sample(int64_t now_us);
+  void sample_process(pid_t pid, int64_t now_us, int depth,
+                      double* cpu_ms, double* run_delay_ms, int* threads,
+                      int* busy_threads);
+
+  pid_t pid_;
+  int interval_us_;
+  long ticks_per_s_;
+  std::atomic<bool> stop_{false};
+  // Written by the sampler thread only (read after join)
+  std::vector<ThreadStats> threads_;
+  std::map<pid_t, size_t> thread_index_;
+  std::vector<TimelineSample> timeline_;
+  // End of the last timeline interval, and the CPU time and run-queue wait
+  // since then
+  int64_t last_sample_us_ = 0;
+  double pending_cpu_ms_ = 0.0;
+  double pending_run_delay_ms_ = 0.0;
+  std::thread thread_;
+};
+
+}  // namespace sched
+}  // namespace anicet
+
+#endif  // __cplusplus
+
+#endif  // ANICET_SCHED_H
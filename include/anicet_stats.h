@@ -0,0 +1,101 @@
+// anicet_stats.h
+// Summary statistics over the encoded frames (warm-up exclusion,
+// percentiles, outliers, confidence interval of the median)
+
+#ifndef ANICET_STATS_H
+#define ANICET_STATS_H
+
+#ifdef __cplusplus
+
+#include <vector>
+
+struct CodecOutput;
+
+namespace anicet {
+namespace stats {
+
+// How many runs each grid point encodes
+struct RunPolicy {
+  // Runs encoded before the measured runs (after each codec setup) and
+  // excluded from the summary
+  int warmup_runs = 0;
+  // Encode batches of runs until the 95% confidence interval of the median
+  // encode time is within +/-target_ci_percent of the median
+  // (--num-runs auto). Otherwise the codec setup's num_runs are encoded.
+  bool auto_runs = false;
+  double target_ci_percent = 2.0;
+  // Measured runs per batch, minimum and maximum total (--num-runs auto)
+  int batch_runs = 10;
+  int min_runs = 10;
+  int max_runs = 200;
+  // Before each batch (so between runs of a codec, grid points and codecs),
+  // wait until the hottest thermal zone is at or below cooldown_temp_c, for
+  // at most cooldown_ms milliseconds, or pause cooldown_ms milliseconds
+  // without a temperature (0 = no cooldown)
+  double cooldown_temp_c = 0.0;
+  int cooldown_ms = 0;
+};
+
+// Summary of one metric
+struct Summary {
+  int count = 0;
+  double min = 0.0;
+  double max = 0.0;
+  double mean = 0.0;
+  // Sample standard deviation (0 for a single value)
+  double stddev = 0.0;
+  double median = 0.0;
+  double p90 = 0.0;
+  double p99 = 0.0;
+  // Median absolute deviation
+  double mad = 0.0;
+  // Values further than 3 scaled MADs (3 * 1.4826 * MAD) from the median
+  int outliers = 0;
+  // Distribution-free 95% confidence interval of the median (order
+  // statistics), and its half width relative to the median
+  double median_ci_low = 0.0;
+  double median_ci_high = 0.0;
+  double median_ci_percent = 0.0;
+};
+
+// Summarize values. Returns false if values is empty.
+bool summarize(std::vector<double> values, Summary* summary);
+
+// One-sided Mann-Whitney U test: probability of values of current at least
+// this much larger than those of baseline if both came from the same
+// distribution (normal approximation with tie and continuity corrections).
+// Small values mean current is larger. 1.0 if either set is empty.
+double mann_whitney_greater_p(const std::vector<double>& baseline,
+                              const std::vector<double>& current);
+
+// Per-frame metrics of the measured (non warm-up) frames
+std::vector<double> encode_times_us(const CodecOutput& output);
+std::vector<double> cpu_times_ms(const CodecOutput& output);
+// (frames without an energy value are skipped)
+std::vector<double> energy_mj(const CodecOutput& output);
+// Heap allocations and allocated bytes (frames without allocation tracking
+// are skipped)
+std::vector<double> alloc_counts(const CodecOutput& output);
+std::vector<double> alloc_bytes(const CodecOutput& output);
+
+// Number of measured (non warm-up) frames
+int num_measured_frames(const CodecOutput& output);
+
+// Sustained throughput of the measured frames (frames per second): frames
+// divided by the time during which at least one of them was in the codec
+// (union of the input_timestamp_us .. output_timestamp_us windows, so that
+// pipelined frames are not double counted and gaps between runner calls are
+// not counted). 0 without timings.
+double throughput_fps(const CodecOutput& output);
+
+// CPU time of the encode step per frame (milliseconds, warm-up frames
+// included): unlike the per-frame CPU times, frames in flight together are
+// not double counted. 0 without frames.
+double encode_cpu_per_frame_ms(const CodecOutput& output);
+
+}  // namespace stats
+}  // namespace anicet
+
+#endif  // __cplusplus
+
+#endif  // ANICET_STATS_H
@@ -0,0 +1,88 @@
+// anicet_strips.h
+// Strip-parallel JPEG encoding: MCU-aligned horizontal bands encoded on a
+// thread pool, then stitched into one baseline JPEG with restart markers
+
+#ifndef ANICET_STRIPS_H
+#define ANICET_STRIPS_H
+
+#ifdef __cplusplus
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace anicet {
+namespace strips {
+
+// MCU height of yuv420p JPEG encodes (2x2 luma sampling, 8x8 blocks)
+constexpr int MCU_HEIGHT_420 = 16;
+
+// Horizontal band of a frame (luma rows)
+struct Strip {
+  int y = 0;
+  int height = 0;
+};
+
+// Encoded strip (JPEG buffer allocated by the encoder)
+struct EncodedStrip {
+  unsigned char* data = nullptr;
+  unsigned long size = 0;
+};
+
+// Split a frame into at most num_strips bands of the same number of whole
+// MCU rows (the last band takes the rest, and may end mid-MCU)
+std::vector<Strip> split_strips(int height, int num_strips, int mcu_height);
+
+// Stitch the JPEGs of consecutive strips into one JPEG of the given height
+// Each strip must be a single-scan baseline JPEG without restart markers,
+// with the same headers (other than its height), and all strips but the last
+// the same number of MCU rows. The result has a restart interval of one strip
+// and a restart marker between strips. Returns false on error (with error
+// message printed).
+bool stitch_strips(const std::vector<EncodedStrip>& strips, int height,
+                   std::vector<uint8_t>* out);
+
+// Persistent worker threads for the strips of each frame (created once per
+// runner call, so that no thread is started inside the timed encodes)
+class StripPool {
+ public:
+  // num_threads threads in total: the thread calling run() and
+  // num_threads - 1 workers (which inherit its CPU affinity)
+  explicit StripPool(int num_threads);
+  ~StripPool();
+  StripPool(const StripPool&) = delete;
+  StripPool& operator=(const StripPool&) = delete;
+
+  // Run task(0) .. task(count - 1) concurrently, returns when all of them
+  // have finished
+  void run(int count, const std::function<void(int)>& task);
+
+ private:
+  void thread_main();
+  // Run the remaining tasks of the current batch (lock held on entry and
+  // exit)
+  void run_tasks(std::unique_lock<std::mutex>& lock);
+
+  std::mutex mutex_;
+  // Signaled when a batch starts (workers) and when it completes (run())
+  std::condition_variable work_cv_;
+  std::condition_variable done_cv_;
+  const std::function<void(int)>* task_ = nullptr;
+  int count_ = 0;
+  int next_ = 0;
+  int pending_ = 0;
+  bool stop_ = false;
+  std::vector<std::thread> threads_;
+};
+
+}  // namespace strips
+}  // namespace anicet
+
+#endif  // __cplusplus
+
+#endif  // ANICET_STRIPS_H
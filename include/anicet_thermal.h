@@ -0,0 +1,133 @@
+// anicet_thermal.h
+// CPU frequency and thermal zone sampling, and cooldown between runs
+
+#ifndef ANICET_THERMAL_H
+#define ANICET_THERMAL_H
+
+#ifdef __cplusplus
+
+#include <stdint.h>
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct CodecInput;
+struct CodecOutput;
+
+namespace anicet {
+namespace thermal {
+
+// CPU frequency domains and thermal zones (sysfs files kept open, read with
+// pread)
+class ThermalReader {
+ public:
+  // zones: comma-separated substrings of the thermal zone types to read
+  // (nullptr or empty: zones whose type contains "cpu" or "soc", or all
+  // zones if none does). Zones whose temp read takes more than 1 ms are
+  // skipped. cpus: one scaling_cur_freq is read per CPU cluster (see
+  // anicet::cpu::get_topology()) with a CPU in cpus, named after it.
+  ThermalReader(const char* zones, const std::set<int>& cpus);
+  ~ThermalReader();
+  ThermalReader(const ThermalReader&) = delete;
+  ThermalReader& operator=(const ThermalReader&) = delete;
+
+  const std::vector<std::string>& freq_domains() const {
+    return freq_domains_;
+  }
+  const std::vector<std::string>& zones() const { return zones_; }
+
+  // Read the current frequencies (kHz) and temperatures (millidegrees C),
+  // -1 for a failed read
+  void read(std::vector<int64_t>* freq_khz,
+            std::vector<int64_t>* temp_mc) const;
+  // Temperature of the hottest zone (millidegrees C, -1 if none)
+  int64_t max_temp_mc() const;
+
+ private:
+  std::vector<std::string> freq_domains_;
+  std::vector<int> freq_fds_;
+  std::vector<std::string> zones_;
+  std::vector<int> zone_fds_;
+};
+
+// One sample (columns as in ThermalTimeline)
+struct ThermalSample {
+  // anicet_get_timestamp() (same clock as the frame timestamps)
+  int64_t time_us;
+  // Frame being encoded, -1 outside the encode calls
+  int run;
+  std::vector<int64_t> freq_khz;
+  std::vector<int64_t> temp_mc;
+};
+
+// Samples of one codec run
+struct ThermalTimeline {
+  std::vector<std::string> freq_domains;
+  std::vector<std::string> zones;
+  std::vector<ThermalSample> samples;
+};
+
+// Frequency and temperature of one frame: lowest frequency per domain and
+// hottest zone over the samples inside the frame (or the last sample before
+// its end when the frame is shorter than the interval), empty/-1 without
+// samples
+struct FrameThermal {
+  std::map<std::string, int64_t> freq_khz;
+  int64_t max_temp_mc = -1;
+};
+
+// Sampler thread for a codec run
+// Construct it right before the runner call and call finish() right after:
+// samples are matched to the frames by their timestamps, and the timeline
+// and per-frame values go to output->thermal_timeline and
+// output->thermal_frames. Frequencies are read for the CPUs the calling
+// thread may run on. Does nothing unless
+// input->thermal_sample_interval_ms > 0.
+class ThermalSampler {
+ public:
+  explicit ThermalSampler(const CodecInput* input);
+  ~ThermalSampler();
+  ThermalSampler(const ThermalSampler&) = delete;
+  ThermalSampler& operator=(const ThermalSampler&) = delete;
+
+  // Stop the thread and store the results in output
+  void finish(CodecOutput* output);
+
+ private:
+  void thread_main();
+
+  std::unique_ptr<ThermalReader> reader_;
+  int interval_us_ = 0;
+  std::atomic<bool> stop_{false};
+  // Written by the sampler thread only (read after join)
+  std::vector<ThermalSample> samples_;
+  std::thread thread_;
+};
+
+// Cooldown waits before the runs of a codec
+struct CooldownStats {
+  int waits = 0;
+  double wait_ms = 0.0;
+  // Waits that reached the time limit above the target temperature
+  int timeouts = 0;
+  // Hottest zone when a wait started (millidegrees C, -1 if unknown)
+  int64_t max_start_temp_mc = -1;
+};
+
+// Wait before a run: until the hottest zone (see ThermalReader) is at or
+// below temp_c, for at most max_ms milliseconds, or max_ms milliseconds
+// when temp_c <= 0. No-op when both are 0. The wait is added to stats.
+void cooldown(const char* zones, double temp_c, int max_ms,
+              CooldownStats* stats);
+
+}  // namespace thermal
+}  // namespace anicet
+
+#endif  // __cplusplus
+
+#endif  // ANICET_THERMAL_H
@@ -4,6 +4,7 @@
 #ifndef RESOURCE_PROFILER_H
 #define RESOURCE_PROFILER_H
 
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -11,6 +12,24 @@
 #include <time.h>
 #include <unistd.h>
 
+#include <mutex>
+
+// Resource accounting scope for capture_resources() on the calling thread
+enum class ResourceScope {
+  // Whole process (getrusage(RUSAGE_SELF), CLOCK_PROCESS_CPUTIME_ID)
+  PROCESS,
+  // Calling thread only (getrusage(RUSAGE_THREAD), CLOCK_THREAD_CPUTIME_ID).
+  // Used when several codecs run concurrently in the same process. Memory
+  // fields are still process-wide.
+  THREAD,
+};
+
+// Get/set the accounting scope of the calling thread (default: PROCESS)
+inline ResourceScope& resource_scope() {
+  static thread_local ResourceScope scope = ResourceScope::PROCESS;
+  return scope;
+}
+
 #ifdef __linux__
 #include <sys/time.h>
 
@@ -48,40 +67,88 @@ struct ResourceSnapshot {
   long invol_ctx_switches;
 };
 
+// Persistent /proc/self/status fd (opened once per process, reopened after
+// fork), so that each snapshot is a single pread() instead of
+// fopen/fgets/fclose
+static int proc_status_fd() {
+  static int fd = -1;
+  static pid_t fd_pid = -1;
+  pid_t pid = getpid();
+  if (fd < 0 || fd_pid != pid) {
+    if (fd >= 0) close(fd);
+    fd = open("/proc/self/status", O_RDONLY | O_CLOEXEC);
+    fd_pid = pid;
+  }
+  return fd;
+}
+
+// Helper: parse the kB value of a "Key:   1234 kB" line at p
+static long parse_status_kb(const char* p) {
+  while (*p == ' ' || *p == '\t') p++;
+  long value = 0;
+  while (*p >= '0' && *p <= '9') {
+    value = value * 10 + (*p++ - '0');
+  }
+  return value;
+}
+
 // Read memory stats from /proc/self/status
 static void read_proc_status(ResourceSnapshot* snap) {
-  FILE* f = fopen("/proc/self/status", "r");
-  if (!f) return;
-
-  char line[256];
-  while (fgets(line, sizeof(line), f)) {
-    if (strncmp(line, "VmSize:", 7) == 0) {
-      sscanf(line + 7, "%ld", &snap->vm_size_kb);
-    } else if (strncmp(line, "VmRSS:", 6) == 0) {
-      sscanf(line + 6, "%ld", &snap->vm_rss_kb);
-    } else if (strncmp(line, "VmPeak:", 7) == 0) {
-      sscanf(line + 7, "%ld", &snap->vm_peak_kb);
-    } else if (strncmp(line, "VmHWM:", 6) == 0) {
-      sscanf(line + 6, "%ld", &snap->rss_peak_kb);
+  // The whole file is ~1.5 KB; only the Vm* lines are parsed
+  static std::mutex fd_mutex;
+  char buf[4096];
+  ssize_t n;
+  {
+    std::lock_guard<std::mutex> lock(fd_mutex);
+    int fd = proc_status_fd();
+    if (fd < 0) return;
+    n = pread(fd, buf, sizeof(buf) - 1, 0);
+  }
+  if (n <= 0) return;
+  buf[n] = '\0';
+
+  // VmPeak, VmSize, VmHWM and VmRSS come in this order, before the other
+  // Vm* lines: stop once all four are found
+  int found = 0;
+  for (const char* line = buf; line != nullptr && found < 4;) {
+    if (line[0] == 'V' && line[1] == 'm') {
+      if (strncmp(line, "VmPeak:", 7) == 0) {
+        snap->vm_peak_kb = parse_status_kb(line + 7);
+        found++;
+      } else if (strncmp(line, "VmSize:", 7) == 0) {
+        snap->vm_size_kb = parse_status_kb(line + 7);
+        found++;
+      } else if (strncmp(line, "VmHWM:", 6) == 0) {
+        snap->rss_peak_kb = parse_status_kb(line + 6);
+        found++;
+      } else if (strncmp(line, "VmRSS:", 6) == 0) {
+        snap->vm_rss_kb = parse_status_kb(line + 6);
+        found++;
+      }
     }
+    line = strchr(line, '\n');
+    if (line != nullptr) line++;
   }
-  fclose(f);
 }
 
 // Capture current resource usage
 static void capture_resources(ResourceSnapshot* snap) {
+  bool thread_scope = resource_scope() == ResourceScope::THREAD;
+
   // Wall clock time
   clock_gettime(CLOCK_MONOTONIC, &snap->wall_time);
 
   // CPU time
-  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &snap->cpu_time);
+  clock_gettime(thread_scope ? CLOCK_THREAD_CPUTIME_ID
+                             : CLOCK_PROCESS_CPUTIME_ID,
+                &snap->cpu_time);
 
   // Memory from /proc
   read_proc_status(snap);
 
   // rusage for CPU time and page faults
   struct rusage usage;
-  getrusage(RUSAGE_SELF, &usage);
+  getrusage(thread_scope ? RUSAGE_THREAD : RUSAGE_SELF, &usage);
   snap->user_time_us = usage.ru_utime.tv_sec * 1000000 + usage.ru_utime.tv_usec;
   snap->system_time_us =
       usage.ru_stime.tv_sec * 1000000 + usage.ru_stime.tv_usec;
@@ -91,6 +158,18 @@ static void capture_resources(ResourceSnapshot* snap) {
   snap->invol_ctx_switches = usage.ru_nivcsw;
 }
 
+// Capture wall and CPU time only (two vDSO clock reads, no syscall)
+// Used around each frame, where only the CPU time delta is reported. The
+// memory, rusage, fault and context switch fields are zeroed.
+static void capture_resources_lite(ResourceSnapshot* snap) {
+  memset(snap, 0, sizeof(*snap));
+  clock_gettime(CLOCK_MONOTONIC, &snap->wall_time);
+  clock_gettime(resource_scope() == ResourceScope::THREAD
+                    ? CLOCK_THREAD_CPUTIME_ID
+                    : CLOCK_PROCESS_CPUTIME_ID,
+                &snap->cpu_time);
+}
+
 // Calculate difference between two snapshots
 struct ResourceDelta {
   double wall_time_ms;
@@ -135,6 +214,62 @@ static void compute_delta(const ResourceSnapshot* start,
       end->invol_ctx_switches - start->invol_ctx_switches;
 }
 
+// Cost of the profiler itself
+struct ResourceProfilerOverhead {
+  // Time per capture_resources() and capture_resources_lite() call
+  double capture_us;
+  double capture_lite_us;
+  // Wall and CPU time measured for an empty frame (back-to-back lite
+  // captures, as the runners do around each encode call). This bias is
+  // included in every per-frame number.
+  double frame_wall_us;
+  double frame_cpu_us;
+};
+
+// Helper: microseconds between two timespecs
+static double timespec_delta_us(const struct timespec* start,
+                                const struct timespec* end) {
+  return (end->tv_sec - start->tv_sec) * 1000000.0 +
+         (end->tv_nsec - start->tv_nsec) / 1000.0;
+}
+
+// Measure the profiler overhead (mean over iterations, after one warm-up
+// call of each capture)
+static inline void calibrate_resource_profiler(
+    int iterations, ResourceProfilerOverhead* overhead) {
+  memset(overhead, 0, sizeof(*overhead));
+  if (iterations < 1) return;
+  ResourceSnapshot start, end;
+  struct timespec t0, t1;
+
+  capture_resources(&start);
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  for (int i = 0; i < iterations; i++) {
+    capture_resources(&start);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  overhead->capture_us = timespec_delta_us(&t0, &t1) / iterations;
+
+  capture_resources_lite(&start);
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  for (int i = 0; i < iterations; i++) {
+    capture_resources_lite(&start);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  overhead->capture_lite_us = timespec_delta_us(&t0, &t1) / iterations;
+
+  double wall_us = 0.0;
+  double cpu_us = 0.0;
+  for (int i = 0; i < iterations; i++) {
+    capture_resources_lite(&start);
+    capture_resources_lite(&end);
+    wall_us += timespec_delta_us(&start.wall_time, &end.wall_time);
+    cpu_us += timespec_delta_us(&start.cpu_time, &end.cpu_time);
+  }
+  overhead->frame_wall_us = wall_us / iterations;
+  overhead->frame_cpu_us = cpu_us / iterations;
+}
+
 static void print_resource_delta(const char* label,
                                  const ResourceDelta* delta) {
   printf("\n=== Resource Usage: %s ===\n", label);
@@ -203,6 +338,7 @@ struct ResourceDelta {
   int dummy;
 };
 static void capture_resources(ResourceSnapshot* snap) { (void)snap; }
+static void capture_resources_lite(ResourceSnapshot* snap) { (void)snap; }
 static void compute_delta(const ResourceSnapshot* s, const ResourceSnapshot* e,
                           ResourceDelta* d) {
   (void)s;
@@ -213,6 +349,17 @@ static void print_resource_delta(const char* l, const ResourceDelta* d) {
   (void)l;
   (void)d;
 }
+struct ResourceProfilerOverhead {
+  double capture_us;
+  double capture_lite_us;
+  double frame_wall_us;
+  double frame_cpu_us;
+};
+static inline void calibrate_resource_profiler(
+    int iterations, ResourceProfilerOverhead* overhead) {
+  (void)iterations;
+  memset(overhead, 0, sizeof(*overhead));
+}
 class ScopedResourceProfiler {
  public:
   explicit ScopedResourceProfiler(const char* label) { (void)label; }
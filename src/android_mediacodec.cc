@@ -309,6 +309,9 @@ static int encode_frames(const Options& opt) {
   format.quality = opt.quality;
   format.bitrate = opt.bitrate;
   format.debug_level = opt.debug_level;
+  format.async_frames = 0;
+  format.surface_input = 0;
+  format.pool = 0;
   // Note: frame_count is not part of MediaCodecFormat
   // The frame_count option is ignored for this standalone encoder
 
@@ -6,21 +6,30 @@
 
 #include <sys/time.h>
 
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
 #include <cstdio>
 #include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
 #ifdef __ANDROID__
 #include <android/log.h>
+#include <dlfcn.h>
 #include <media/NdkMediaCodec.h>
 #include <media/NdkMediaError.h>
 #include <media/NdkMediaFormat.h>
 
 #include "android_binder_init.h"
+#include "android_mediacodec_surface.h"
 #endif
 
 #include "anicet_common.h"
+#include "anicet_input.h"
 #include "anicet_runner_mediacodec.h"
 #include "resource_profiler.h"
 
@@ -197,16 +206,257 @@ void android_mediacodec_set_format(AMediaFormat* format, const char* mime_type,
 
 #ifdef __ANDROID__
 
-// Context structure for MediaCodec encoder
+// Time without any codec callback after which an asynchronous encode fails
+#define ASYNC_STALL_TIMEOUT_MS 5000
+
+// Output buffer returned by the onAsyncOutputAvailable callback
+struct AsyncOutput {
+  int32_t index;
+  AMediaCodecBufferInfo info;
+  // Callback time (the frame output timestamp)
+  int64_t timestamp_us;
+};
+
+// Callback queues of a codec in asynchronous mode (filled on the codec's
+// callback thread, drained by encode_loop_async())
+struct AsyncQueue {
+  std::mutex mutex;
+  std::condition_variable cond;
+  // Available input buffer indices
+  std::deque<int32_t> inputs;
+  std::deque<AsyncOutput> outputs;
+  bool error = false;
+};
+
+// Asynchronous codecs (set up with async_frames > 0) and their queues
+static std::mutex g_async_mutex;
+static std::map<AMediaCodec*, std::unique_ptr<AsyncQueue>> g_async_queues;
+
+// Helper: get the queue of an asynchronous codec (nullptr if synchronous)
+static AsyncQueue* find_async_queue(AMediaCodec* codec) {
+  std::lock_guard<std::mutex> lock(g_async_mutex);
+  auto it = g_async_queues.find(codec);
+  return (it != g_async_queues.end()) ? it->second.get() : nullptr;
+}
+
+static void on_async_input_available(AMediaCodec* codec, void* userdata,
+                                     int32_t index) {
+  (void)codec;
+  AsyncQueue* queue = (AsyncQueue*)userdata;
+  std::lock_guard<std::mutex> lock(queue->mutex);
+  queue->inputs.push_back(index);
+  queue->cond.notify_one();
+}
+
+static void on_async_output_available(AMediaCodec* codec, void* userdata,
+                                      int32_t index,
+                                      AMediaCodecBufferInfo* info) {
+  (void)codec;
+  int64_t timestamp_us = anicet_get_timestamp();
+  AsyncQueue* queue = (AsyncQueue*)userdata;
+  std::lock_guard<std::mutex> lock(queue->mutex);
+  queue->outputs.push_back({index, *info, timestamp_us});
+  queue->cond.notify_one();
+}
+
+static void on_async_format_changed(AMediaCodec* codec, void* userdata,
+                                    AMediaFormat* format) {
+  (void)codec;
+  (void)userdata;
+  // The format is not deleted: its ownership differs between platform
+  // versions
+  DEBUG(2, "Output format changed: %s", AMediaFormat_toString(format));
+}
+
+static void on_async_error(AMediaCodec* codec, void* userdata,
+                           media_status_t error, int32_t action_code,
+                           const char* detail) {
+  (void)codec;
+  fprintf(stderr, "Error: MediaCodec error %d (action %d): %s\n", error,
+          action_code, detail ? detail : "");
+  AsyncQueue* queue = (AsyncQueue*)userdata;
+  std::lock_guard<std::mutex> lock(queue->mutex);
+  queue->error = true;
+  queue->cond.notify_one();
+}
+
+// AMediaCodec_setAsyncNotifyCallback() is API 28: resolved at runtime so
+// that the binary still runs on older devices in synchronous mode
+typedef media_status_t (*SetAsyncNotifyCallbackFunc)(
+    AMediaCodec*, AMediaCodecOnAsyncNotifyCallback, void*);
+
+// Helper: register the callbacks of an asynchronous codec (before configure)
+static bool set_async_callback(AMediaCodec* codec) {
+  static SetAsyncNotifyCallbackFunc set_callback =
+      (SetAsyncNotifyCallbackFunc)dlsym(RTLD_DEFAULT,
+                                        "AMediaCodec_setAsyncNotifyCallback");
+  if (set_callback == nullptr) {
+    fprintf(stderr, "Error: Asynchronous MediaCodec needs Android 9 (API "
+                    "28)\n");
+    return false;
+  }
+  auto queue = std::make_unique<AsyncQueue>();
+  AMediaCodecOnAsyncNotifyCallback callback;
+  callback.onAsyncInputAvailable = on_async_input_available;
+  callback.onAsyncOutputAvailable = on_async_output_available;
+  callback.onAsyncFormatChanged = on_async_format_changed;
+  callback.onAsyncError = on_async_error;
+  DEBUG(3, "AMediaCodec_setAsyncNotifyCallback(codec, callback, queue);");
+  if (set_callback(codec, callback, queue.get()) != AMEDIA_OK) {
+    fprintf(stderr, "Error: Cannot set asynchronous MediaCodec callback\n");
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(g_async_mutex);
+  g_async_queues[codec] = std::move(queue);
+  return true;
+}
+
+// Helper: forget the queue of a deleted codec
+static void remove_async_queue(AMediaCodec* codec) {
+  std::lock_guard<std::mutex> lock(g_async_mutex);
+  g_async_queues.erase(codec);
+}
+
+// Frames in flight in the synchronous loop with surface input (there are no
+// input buffers to dequeue, and an unbounded feed would block in
+// eglSwapBuffers() while the outputs are not drained)
+#define SURFACE_FRAMES_IN_FLIGHT 4
+
+// Surface input codecs (set up with surface_input) and their input surfaces
+static std::mutex g_surface_mutex;
+static std::map<AMediaCodec*, std::unique_ptr<anicet::surface::SurfaceInput>>
+    g_surface_inputs;
+
+// Helper: get the input surface of a codec (nullptr for buffer input)
+static anicet::surface::SurfaceInput* find_surface_input(AMediaCodec* codec) {
+  std::lock_guard<std::mutex> lock(g_surface_mutex);
+  auto it = g_surface_inputs.find(codec);
+  return (it != g_surface_inputs.end()) ? it->second.get() : nullptr;
+}
+
+// Helper: release the input surface of a codec (before deleting it)
+static void remove_surface_input(AMediaCodec* codec) {
+  std::lock_guard<std::mutex> lock(g_surface_mutex);
+  g_surface_inputs.erase(codec);
+}
+
+// Idle instances kept per pool key
+#define MEDIACODEC_POOL_SIZE 2
+
+// Warm codec pool (format pool=1): started instances are flushed after
+// encoding and reused by the next setup with the same configuration
+static std::mutex g_pool_mutex;
+// Idle started instances, by pool key
+static std::map<std::string, std::vector<AMediaCodec*>> g_pool_idle;
+// Pool key of each instance owned by the pool (idle or in use)
+static std::map<AMediaCodec*, std::string> g_pool_keys;
+
+// Helper: pool key of a format (every setting that goes to configure)
+static std::string pool_key(const MediaCodecFormat* fmt) {
+  char key[512];
+  snprintf(key, sizeof(key), "%s:%dx%d:%s:q%d:b%d:m%d:a%d", fmt->codec_name,
+           fmt->width, fmt->height, fmt->color_format, fmt->quality,
+           fmt->bitrate, fmt->bitrate_mode, fmt->async_frames);
+  return key;
+}
+
+// Helper: take an idle instance from the pool (nullptr if none)
+static AMediaCodec* take_pooled_codec(const std::string& key) {
+  std::lock_guard<std::mutex> lock(g_pool_mutex);
+  auto it = g_pool_idle.find(key);
+  if (it == g_pool_idle.end() || it->second.empty()) {
+    return nullptr;
+  }
+  AMediaCodec* codec = it->second.back();
+  it->second.pop_back();
+  return codec;
+}
+
+// Helper: flush an instance owned by the pool and keep it idle. Returns
+// false if the codec is not pooled (or cannot be reused): the caller stops
+// and deletes it.
+static bool release_to_pool(AMediaCodec* codec) {
+  std::string key;
+  {
+    std::lock_guard<std::mutex> lock(g_pool_mutex);
+    auto it = g_pool_keys.find(codec);
+    if (it == g_pool_keys.end()) {
+      return false;
+    }
+    key = it->second;
+    if (g_pool_idle[key].size() >= MEDIACODEC_POOL_SIZE) {
+      g_pool_keys.erase(it);
+      return false;
+    }
+  }
+
+  // flush() after the EOS resets the codec for a new stream
+  DEBUG(3, "AMediaCodec_flush(codec);");
+  bool reusable = AMediaCodec_flush(codec) == AMEDIA_OK;
+  AsyncQueue* queue = find_async_queue(codec);
+  if (reusable && queue != nullptr) {
+    // The buffer indices are stale after a flush, and an asynchronous codec
+    // must be started again
+    {
+      std::lock_guard<std::mutex> lock(queue->mutex);
+      reusable = !queue->error;
+      queue->inputs.clear();
+      queue->outputs.clear();
+    }
+    DEBUG(3, "AMediaCodec_start(codec);");
+    reusable = reusable && AMediaCodec_start(codec) == AMEDIA_OK;
+  }
+
+  std::lock_guard<std::mutex> lock(g_pool_mutex);
+  if (!reusable) {
+    fprintf(stderr, "Warning: Cannot reset pooled codec, deleting it\n");
+    g_pool_keys.erase(codec);
+    return false;
+  }
+  g_pool_idle[key].push_back(codec);
+  DEBUG(2, "Codec returned to the pool (%s)", key.c_str());
+  return true;
+}
+
 // Setup MediaCodec encoder
 int android_mediacodec_encode_setup(const MediaCodecFormat* fmt,
                                     AMediaCodec** codec_out) {
-  // Initialize output parameter
+  CodecStartup startup;
+  return android_mediacodec_encode_setup_timed(fmt, codec_out, &startup);
+}
+
+// Setup MediaCodec encoder, timing each step
+int android_mediacodec_encode_setup_timed(const MediaCodecFormat* fmt,
+                                          AMediaCodec** codec_out,
+                                          CodecStartup* startup) {
+  // Initialize output parameters
   *codec_out = nullptr;
+  *startup = CodecStartup();
 
   // Set global debug level for this encoding session
   g_debug_level = fmt->debug_level;
 
+  // Warm pool: reuse a started instance (the surface input cannot be reused
+  // after its end of stream)
+  bool pool = fmt->pool && !fmt->surface_input;
+  if (fmt->pool && fmt->surface_input) {
+    fprintf(stderr, "Warning: MediaCodec pool is not used with surface "
+                    "input\n");
+  }
+  std::string key = pool ? pool_key(fmt) : std::string();
+  if (pool) {
+    AMediaCodec* codec = take_pooled_codec(key);
+    if (codec != nullptr) {
+      DEBUG(2, "Using a warm codec from the pool (%s)", key.c_str());
+      startup->warm = true;
+      startup->create_us = 0;
+      startup->configure_us = 0;
+      startup->start_us = 0;
+      *codec_out = codec;
+      return 0;
+    }
+  }
+
   // initialize Binder thread pool for MediaCodec callbacks
   if (!init_binder_thread_pool(g_debug_level)) {
     fprintf(stderr, "Warning: Failed to initialize Binder thread pool\n");
@@ -248,6 +498,12 @@ int android_mediacodec_encode_setup(const MediaCodecFormat* fmt,
   android_mediacodec_set_format(format, mime_type, fmt->width, fmt->height,
                                 fmt->color_format, &bitrate_local, fmt->quality,
                                 fmt->bitrate_mode);
+  if (fmt->surface_input) {
+    // Frames come from the input surface, not from input buffers
+    AMediaFormat_setInt32(format, "color-format", COLOR_FormatSurface);
+    DEBUG(3, "AMediaFormat_setInt32(format, \"color-format\", %d);",
+          COLOR_FormatSurface);
+  }
   DEBUG(2, "Encoding with: %s", fmt->codec_name);
   DEBUG(2, "MIME type: %s", mime_type);
   DEBUG(2, "resolution: %dx%d bitrate: %d", fmt->width, fmt->height,
@@ -259,6 +515,7 @@ int android_mediacodec_encode_setup(const MediaCodecFormat* fmt,
   // disconnections
   AMediaCodec* codec = nullptr;
   const int max_retries = 3;
+  int64_t step_start_us = anicet_get_timestamp();
   for (int attempt = 0; attempt < max_retries && !codec; attempt++) {
     if (attempt > 0) {
       DEBUG(2, "Retry %d/%d: Waiting 50ms before retrying codec creation...",
@@ -271,6 +528,7 @@ int android_mediacodec_encode_setup(const MediaCodecFormat* fmt,
           fmt->codec_name, attempt + 1, max_retries);
     codec = AMediaCodec_createCodecByName(fmt->codec_name);
   }
+  startup->create_us = anicet_get_timestamp() - step_start_us;
 
   if (!codec) {
     fprintf(stderr, "Error: Cannot create codec after %d attempts: %s\n",
@@ -287,8 +545,16 @@ int android_mediacodec_encode_setup(const MediaCodecFormat* fmt,
   }
   DEBUG(2, "Codec created successfully");
 
+  // Asynchronous mode: the callbacks must be set before configure
+  if (fmt->async_frames > 0 && !set_async_callback(codec)) {
+    AMediaFormat_delete(format);
+    AMediaCodec_delete(codec);
+    return 4;
+  }
+
   // 3. configure codec
   DEBUG(2, "Configuring codec...");
+  step_start_us = anicet_get_timestamp();
   DEBUG(3,
         "AMediaCodec_configure(codec, format, nullptr, nullptr, "
         "AMEDIACODEC_CONFIGURE_FLAG_ENCODE);");
@@ -299,76 +565,238 @@ int android_mediacodec_encode_setup(const MediaCodecFormat* fmt,
   if (status != AMEDIA_OK) {
     fprintf(stderr, "Error: Cannot configure codec: %d\n", status);
     AMediaCodec_delete(codec);
+    remove_async_queue(codec);
     return 2;
   }
   DEBUG(2, "Codec configured successfully");
 
+  // Surface input: the input surface is created between configure and start
+  if (fmt->surface_input) {
+    auto surface = std::make_unique<anicet::surface::SurfaceInput>();
+    if (!surface->init(codec, fmt->width, fmt->height)) {
+      surface.reset();
+      AMediaCodec_delete(codec);
+      remove_async_queue(codec);
+      return 5;
+    }
+    std::lock_guard<std::mutex> lock(g_surface_mutex);
+    g_surface_inputs[codec] = std::move(surface);
+  }
+  startup->configure_us = anicet_get_timestamp() - step_start_us;
+
   // 4. start codec
   DEBUG(2, "Starting codec...");
   DEBUG(3, "AMediaCodec_start(codec);");
+  step_start_us = anicet_get_timestamp();
   status = AMediaCodec_start(codec);
+  startup->start_us = anicet_get_timestamp() - step_start_us;
   if (status != AMEDIA_OK) {
     fprintf(stderr, "Error: Cannot start codec: %d\n", status);
+    remove_surface_input(codec);
     AMediaCodec_delete(codec);
+    remove_async_queue(codec);
     return 3;
   }
   DEBUG(2, "Codec started successfully");
 
+  if (pool) {
+    std::lock_guard<std::mutex> lock(g_pool_mutex);
+    g_pool_keys[codec] = key;
+  }
   *codec_out = codec;
   return 0;
 }
 
-// Encode frames using pre-configured MediaCodec encoder
-int android_mediacodec_encode_frame(AMediaCodec* codec,
-                                    const uint8_t* input_buffer,
-                                    size_t input_size,
-                                    const MediaCodecFormat* fmt, int num_runs,
-                                    CodecOutput* output) {
-  // Initialize output - clear vectors and pre-allocate space
-  output->frame_buffers.clear();
-  output->frame_buffers.resize(num_runs);
-  output->frame_sizes.clear();
-  output->frame_sizes.resize(num_runs);
-  output->timings.clear();
-  output->timings.resize(num_runs);
-  output->profile_encode_cpu_ms.clear();
-  output->profile_encode_cpu_ms.resize(num_runs);
+// Encoding state shared by the synchronous and asynchronous loops
+struct EncodeState {
+  // Input: input_buffer (reused for every frame) or, if not null, the frames
+  // ring (one frame per run)
+  const uint8_t* input_buffer = nullptr;
+  anicet::input::FrameRing* frames = nullptr;
+  // Input surface with pre-filled frames (replaces the two above)
+  anicet::surface::SurfaceInput* surface = nullptr;
+  size_t frame_size = 0;
+  int num_runs = 0;
+  CodecOutput* output = nullptr;
+  // Per-frame output sizes (a frame may span several output buffers). The
+  // data itself goes straight into output->frame_arena.
+  std::vector<size_t> frame_bytes;
+  int frames_sent = 0;
+  int frames_recv = 0;
+  // Which frame we're currently receiving
+  int current_frame_idx = -1;
+  bool input_eos_sent = false;
+  bool output_eos_recv = false;
+  // Set when the frame ring fails to read an input frame
+  bool input_error = false;
+};
+
+// Fill codec input buffer input_buffer_index with the next frame and queue
+// it, or queue the EOS once all frames were sent
+static void queue_input(AMediaCodec* codec, size_t input_buffer_index,
+                        EncodeState* state) {
+  size_t input_buffer_size;
+  uint8_t* codec_input_buffer =
+      AMediaCodec_getInputBuffer(codec, input_buffer_index, &input_buffer_size);
+  DEBUG(2,
+        "AMediaCodec_getInputBuffer(codec, input_buffer_index: %zu, "
+        "&input_buffer_size: %zu) -> input_buffer: %p",
+        input_buffer_index, input_buffer_size, codec_input_buffer);
+
+  const uint8_t* frame = nullptr;
+  if (state->frames_sent < state->num_runs && !state->input_error) {
+    frame = state->frames ? state->frames->frame(state->frames_sent)
+                          : state->input_buffer;
+    if (!frame) {
+      // Stop feeding (send EOS) and drain what was already queued
+      fprintf(stderr, "Error: Cannot read input frame %d\n",
+              state->frames_sent);
+      state->input_error = true;
+    }
+  }
 
-  // Set debug level for this encoding session
-  g_debug_level = fmt->debug_level;
+  if (frame) {
+    // Copy frame from input buffer (or from the frame ring)
+    memcpy(codec_input_buffer, frame, state->frame_size);
+    uint64_t pts_timestamp_us = state->frames_sent * 33'000;
 
-  // Calculate frame size
-  std::string color_format_str(fmt->color_format);
-  size_t frame_size = get_frame_size(color_format_str, fmt->width, fmt->height);
+    // Capture timing BEFORE queueInputBuffer
+    state->output->timings[state->frames_sent].input_timestamp_us =
+        anicet_get_timestamp();
 
-  // Validate input size
-  if (input_size < frame_size) {
-    fprintf(stderr,
-            "Error: Input buffer too small (got %zu, need %zu for one frame)\n",
-            input_size, frame_size);
-    return 4;
+    AMediaCodec_queueInputBuffer(codec, input_buffer_index, 0,
+                                 state->frame_size, pts_timestamp_us, 0);
+    DEBUG(2,
+          "AMediaCodec_queueInputBuffer(codec, input_buffer_index: %zu, "
+          "0, frame_size: %zu, pts_timestamp_us: %zu, flags: 0)",
+          input_buffer_index, state->frame_size, pts_timestamp_us);
+    state->frames_sent++;
+  } else {
+    // Send EOS
+    DEBUG(2,
+          "AMediaCodec_queueInputBuffer(codec, input_buffer_index: %zu, "
+          "0, frame_size: 0, pts_timestamp_us: 0, flags: "
+          "AMEDIACODEC_BUFFER_FLAG_END_OF_STREAM)",
+          input_buffer_index);
+    AMediaCodec_queueInputBuffer(codec, input_buffer_index, 0, 0, 0,
+                                 AMEDIACODEC_BUFFER_FLAG_END_OF_STREAM);
+    state->input_eos_sent = true;
+  }
+}
+
+// Draw the next pre-filled frame into the input surface, or signal the EOS
+// once all frames were sent
+static void queue_surface_input(EncodeState* state) {
+  if (state->frames_sent < state->num_runs && !state->input_error) {
+    uint64_t pts_timestamp_us = state->frames_sent * 33'000;
+
+    // Capture timing BEFORE the frame is drawn and queued
+    state->output->timings[state->frames_sent].input_timestamp_us =
+        anicet_get_timestamp();
+
+    if (state->surface->queue_frame(state->frames_sent, pts_timestamp_us)) {
+      DEBUG(2, "Queued surface frame %d (pts_timestamp_us: %zu)",
+            state->frames_sent, pts_timestamp_us);
+      state->frames_sent++;
+      return;
+    }
+    // Stop feeding (send EOS) and drain what was already queued
+    state->input_error = true;
   }
 
-  // Per-frame buffers (will accumulate data for each frame separately)
-  std::vector<std::vector<uint8_t>> frame_buffers(num_runs);
+  DEBUG(2, "AMediaCodec_signalEndOfInputStream(codec)");
+  if (!state->surface->signal_eos()) {
+    // No EOS will come out: stop the encoding loop
+    state->input_error = true;
+    state->output_eos_recv = true;
+  }
+  state->input_eos_sent = true;
+}
 
-  // Capture resources before encoding
-  ResourceSnapshot encode_start;
-  capture_resources(&encode_start);
+// Append codec output buffer output_buffer_index to the current frame and
+// release it. output_ts is the frame output time (0 to take it after
+// getOutputBuffer).
+static void consume_output(AMediaCodec* codec, size_t output_buffer_index,
+                           const AMediaCodecBufferInfo& info,
+                           int64_t output_ts, EncodeState* state) {
+  CodecOutput* output = state->output;
+  int num_runs = state->num_runs;
+  size_t codec_output_buffer_size;
+  uint8_t* codec_output_buffer = AMediaCodec_getOutputBuffer(
+      codec, output_buffer_index, &codec_output_buffer_size);
+  DEBUG(2,
+        "AMediaCodec_getOutputBuffer(codec, output_buffer_index: %zu, "
+        "&output_buffer_size: %zu)",
+        output_buffer_index, codec_output_buffer_size);
+
+  // Capture timing AFTER getOutputBuffer
+  if (output_ts == 0) {
+    output_ts = anicet_get_timestamp();
+  }
+
+  if (info.size > 0 && codec_output_buffer) {
+    const bool is_config =
+        (info.flags & AMEDIACODEC_BUFFER_FLAG_CODEC_CONFIG) != 0;
+    if (is_config) {
+      DEBUG(2, "... this is a config frame");
+    } else {
+      DEBUG(2, "... this is a buffer frame");
+      state->current_frame_idx = state->frames_recv;
+      state->frames_recv++;
+      int current_frame_idx = state->current_frame_idx;
+      if (output->dump_output && current_frame_idx < num_runs) {
+        // Size the output arena for the remaining runs from the first
+        // frame
+        if (current_frame_idx == 1) {
+          output->frame_arena.reserve_frames(num_runs - 1);
+        }
+        output->frame_arena.add_frame();
+      }
 
-  // Encoding loop
+      // Store timing for this frame
+      if (current_frame_idx < num_runs) {
+        output->timings[current_frame_idx].output_timestamp_us = output_ts;
+      }
+    }
+
+    // Append to the current frame
+    if (state->current_frame_idx >= 0 && state->current_frame_idx < num_runs) {
+      state->frame_bytes[state->current_frame_idx] += info.size;
+      if (output->dump_output) {
+        output->frame_arena.append(codec_output_buffer + info.offset,
+                                   info.size);
+      }
+    }
+  }
+
+  const bool is_eos = (info.flags & AMEDIACODEC_BUFFER_FLAG_END_OF_STREAM) != 0;
+  if (is_eos) {
+    state->output_eos_recv = true;
+  }
+
+  AMediaCodec_releaseOutputBuffer(codec, output_buffer_index, false);
+  DEBUG(2,
+        "AMediaCodec_releaseOutputBuffer(codec, output_buffer_index: %zu, "
+        "false)",
+        output_buffer_index);
+}
+
+// Synchronous loop: poll the input and output queues (10ms timeout each)
+static void encode_loop_sync(AMediaCodec* codec, EncodeState* state) {
   AMediaCodecBufferInfo info;
-  int frames_sent = 0;
-  int frames_recv = 0;
-  // Which frame we're currently receiving
-  int current_frame_idx = -1;
-  bool input_eos_sent = false;
-  bool output_eos_recv = false;
   // 10ms timeout
   int64_t timeout_us = 10000;
 
-  while (!output_eos_recv) {
-    if (!input_eos_sent) {
+  while (!state->output_eos_recv) {
+    if (!state->input_eos_sent && state->surface != nullptr) {
+      // Draw the next frame, keeping up to SURFACE_FRAMES_IN_FLIGHT queued
+      bool all_sent =
+          state->frames_sent >= state->num_runs || state->input_error;
+      if (all_sent || state->frames_sent - state->frames_recv <
+                          SURFACE_FRAMES_IN_FLIGHT) {
+        queue_surface_input(state);
+      }
+    } else if (!state->input_eos_sent) {
       // Get (dequeue) input buffer(s)
       ssize_t input_buffer_index =
           AMediaCodec_dequeueInputBuffer(codec, timeout_us);
@@ -383,43 +811,7 @@ int android_mediacodec_encode_frame(AMediaCodec* codec,
               "AMediaCodec_dequeueInputBuffer(codec, timeout_us: %zu) -> "
               "input_buffer_index: %zu",
               timeout_us, input_buffer_index);
-
-        size_t input_buffer_size;
-        uint8_t* codec_input_buffer = AMediaCodec_getInputBuffer(
-            codec, (size_t)input_buffer_index, &input_buffer_size);
-        DEBUG(2,
-              "AMediaCodec_getInputBuffer(codec, input_buffer_index: %zu, "
-              "&input_buffer_size: %zu) -> input_buffer: %p",
-              input_buffer_index, input_buffer_size, codec_input_buffer);
-
-        if (frames_sent < num_runs) {
-          // Copy frame from input buffer (reuse same frame data each time)
-          memcpy(codec_input_buffer, input_buffer, frame_size);
-          uint64_t pts_timestamp_us = frames_sent * 33'000;
-
-          // Capture timing BEFORE queueInputBuffer
-          output->timings[frames_sent].input_timestamp_us =
-              anicet_get_timestamp();
-
-          AMediaCodec_queueInputBuffer(codec, (size_t)input_buffer_index, 0,
-                                       frame_size, pts_timestamp_us, 0);
-          DEBUG(2,
-                "AMediaCodec_queueInputBuffer(codec, input_buffer_index: %zu, "
-                "0, frame_size: %zu, pts_timestamp_us: %zu, flags: 0)",
-                input_buffer_index, frame_size, pts_timestamp_us);
-          frames_sent++;
-        } else {
-          // Send EOS
-          DEBUG(2,
-                "AMediaCodec_queueInputBuffer(codec, input_buffer_index: %zu, "
-                "0, frame_size: 0, pts_timestamp_us: 0, flags: "
-                "AMEDIACODEC_BUFFER_FLAG_END_OF_STREAM)",
-                input_buffer_index);
-          AMediaCodec_queueInputBuffer(codec, (size_t)input_buffer_index, 0, 0,
-                                       0,
-                                       AMEDIACODEC_BUFFER_FLAG_END_OF_STREAM);
-          input_eos_sent = true;
-        }
+        queue_input(codec, (size_t)input_buffer_index, state);
       }
     }
 
@@ -452,61 +844,122 @@ int android_mediacodec_encode_frame(AMediaCodec* codec,
           "%u .presentationTimeUs: %lu .flags: %u}, timeout_us: %zu) -> %zu",
           info.offset, info.size, info.presentationTimeUs, info.flags,
           timeout_us, output_buffer_index);
+      consume_output(codec, (size_t)output_buffer_index, info, 0, state);
+    }
+  }
+}
 
-      size_t codec_output_buffer_size;
-      uint8_t* codec_output_buffer = AMediaCodec_getOutputBuffer(
-          codec, (size_t)output_buffer_index, &codec_output_buffer_size);
-      DEBUG(2,
-            "AMediaCodec_getOutputBuffer(codec, output_buffer_index: %zi, "
-            "&output_buffer_size: %zu)",
-            output_buffer_index, codec_output_buffer_size);
-
-      // Capture timing AFTER getOutputBuffer
-      int64_t get_output_ts = anicet_get_timestamp();
-
-      if (info.size > 0 && codec_output_buffer) {
-        const bool is_config =
-            (info.flags & AMEDIACODEC_BUFFER_FLAG_CODEC_CONFIG) != 0;
-        if (is_config) {
-          DEBUG(2, "... this is a config frame");
-        } else {
-          DEBUG(2, "... this is a buffer frame");
-          current_frame_idx = frames_recv;
-          frames_recv++;
-
-          // Store timing for this frame
-          if (current_frame_idx < num_runs) {
-            output->timings[current_frame_idx].output_timestamp_us =
-                get_output_ts;
-          }
-        }
-
-        // Append to appropriate frame buffer
-        if (current_frame_idx >= 0 && current_frame_idx < num_runs) {
-          std::vector<uint8_t>& buf = frame_buffers[current_frame_idx];
-          size_t old_size = buf.size();
-          buf.resize(old_size + info.size);
-          memcpy(buf.data() + old_size, codec_output_buffer + info.offset,
-                 info.size);
-        }
-      }
-
-      const bool is_eos =
-          (info.flags & AMEDIACODEC_BUFFER_FLAG_END_OF_STREAM) != 0;
-      if (is_eos) {
-        output_eos_recv = true;
+// Asynchronous loop: wait for the codec callbacks, keeping up to in_flight
+// frames queued. Returns false on a codec error or a stall.
+static bool encode_loop_async(AMediaCodec* codec, AsyncQueue* queue,
+                              int in_flight, EncodeState* state) {
+  // A frame could be queued (the EOS is not limited by in_flight)
+  auto can_queue = [&]() {
+    bool all_sent =
+        state->frames_sent >= state->num_runs || state->input_error;
+    // (an input surface needs no input buffer)
+    bool has_input = state->surface != nullptr || !queue->inputs.empty();
+    return !state->input_eos_sent && has_input &&
+           (all_sent || state->frames_sent - state->frames_recv < in_flight);
+  };
+
+  while (!state->output_eos_recv) {
+    std::unique_lock<std::mutex> lock(queue->mutex);
+    bool ready = queue->cond.wait_for(
+        lock, std::chrono::milliseconds(ASYNC_STALL_TIMEOUT_MS), [&]() {
+          return queue->error || !queue->outputs.empty() || can_queue();
+        });
+    if (queue->error) {
+      return false;
+    }
+    if (!ready) {
+      fprintf(stderr, "Error: No codec callback for %d ms (%d/%d frames)\n",
+              ASYNC_STALL_TIMEOUT_MS, state->frames_recv, state->num_runs);
+      return false;
+    }
+    // Take the work and release the lock while calling into the codec
+    std::deque<AsyncOutput> outputs;
+    outputs.swap(queue->outputs);
+    int32_t input_buffer_index = -1;
+    bool surface_input = false;
+    if (can_queue()) {
+      if (state->surface != nullptr) {
+        surface_input = true;
+      } else {
+        input_buffer_index = queue->inputs.front();
+        queue->inputs.pop_front();
       }
+    }
+    lock.unlock();
 
-      AMediaCodec_releaseOutputBuffer(codec, (size_t)output_buffer_index,
-                                      false);
-      DEBUG(2,
-            "AMediaCodec_releaseOutputBuffer(codec, output_buffer_index: %zi, "
-            "false)",
-            output_buffer_index);
+    for (const AsyncOutput& out : outputs) {
+      consume_output(codec, (size_t)out.index, out.info, out.timestamp_us,
+                     state);
     }
+    if (surface_input) {
+      queue_surface_input(state);
+    } else if (input_buffer_index >= 0) {
+      queue_input(codec, (size_t)input_buffer_index, state);
+    }
+  }
+  return true;
+}
+
+// Encode frames from input_buffer (reused for every frame) or, if not null,
+// from the frames ring (one frame per run)
+static int encode_frames(AMediaCodec* codec, const uint8_t* input_buffer,
+                         size_t input_size, anicet::input::FrameRing* frames,
+                         const MediaCodecFormat* fmt, int num_runs,
+                         CodecOutput* output) {
+  // Initialize output - clear vectors and pre-allocate space
+  output->frame_arena.clear();
+  output->frame_sizes.clear();
+  output->frame_sizes.resize(num_runs);
+  output->timings.clear();
+  output->timings.resize(num_runs);
+  output->profile_encode_cpu_ms.clear();
+  output->profile_encode_cpu_ms.resize(num_runs);
+
+  // Set debug level for this encoding session
+  g_debug_level = fmt->debug_level;
+
+  // Calculate frame size
+  std::string color_format_str(fmt->color_format);
+  size_t frame_size = get_frame_size(color_format_str, fmt->width, fmt->height);
+
+  // Validate input size
+  if (input_size < frame_size) {
+    fprintf(stderr,
+            "Error: Input buffer too small (got %zu, need %zu for one frame)\n",
+            input_size, frame_size);
+    return 4;
+  }
+
+  EncodeState state;
+  state.input_buffer = input_buffer;
+  state.frames = frames;
+  state.surface = find_surface_input(codec);
+  state.frame_size = frame_size;
+  state.num_runs = num_runs;
+  state.output = output;
+  state.frame_bytes.assign(num_runs, 0);
+
+  // Capture resources before encoding
+  ResourceSnapshot encode_start;
+  capture_resources(&encode_start);
+
+  // Encoding loop (asynchronous if the codec was set up with async_frames)
+  bool codec_error = false;
+  AsyncQueue* queue = find_async_queue(codec);
+  if (queue != nullptr) {
+    codec_error = !encode_loop_async(codec, queue, fmt->async_frames, &state);
+  } else {
+    encode_loop_sync(codec, &state);
   }
+  int frames_recv = state.frames_recv;
 
-  DEBUG(2, "Encoded %d frames, received %d frames", frames_sent, frames_recv);
+  DEBUG(2, "Encoded %d frames, received %d frames", state.frames_sent,
+        frames_recv);
 
   // Capture resources after encoding
   ResourceSnapshot encode_end;
@@ -522,26 +975,59 @@ int android_mediacodec_encode_frame(AMediaCodec* codec,
     output->profile_encode_cpu_ms[i] = 0.0;
   }
 
-  // Copy frame buffers to output structure using vectors
   // Resize to actual number of frames received (may be less than num_runs)
-  // Only copy frame_buffers if dump_output is true to save memory
-  if (output->dump_output) {
-    output->frame_buffers.resize(frames_recv);
-  }
+  // The frame data (if dump_output is true) is already in frame_arena
+  frames_recv = std::min(frames_recv, num_runs);
   output->frame_sizes.resize(frames_recv);
   output->timings.resize(frames_recv);
   output->profile_encode_cpu_ms.resize(frames_recv);
 
   for (int i = 0; i < frames_recv; i++) {
-    if (output->dump_output) {
-      output->frame_buffers[i] = frame_buffers[i];  // Vector copy
-    }
-    output->frame_sizes[i] = frame_buffers[i].size();
+    output->frame_sizes[i] = state.frame_bytes[i];
   }
 
+  if (state.input_error) {
+    return 5;
+  }
+  if (codec_error) {
+    return 6;
+  }
   return 0;  // Success
 }
 
+// Encode frames using pre-configured MediaCodec encoder
+int android_mediacodec_encode_frame(AMediaCodec* codec,
+                                    const uint8_t* input_buffer,
+                                    size_t input_size,
+                                    const MediaCodecFormat* fmt, int num_runs,
+                                    CodecOutput* output) {
+  return encode_frames(codec, input_buffer, input_size, nullptr, fmt,
+                       num_runs, output);
+}
+
+// Encode frames from an input frame ring using pre-configured MediaCodec
+int android_mediacodec_encode_frames(AMediaCodec* codec,
+                                     anicet::input::FrameRing* frames,
+                                     const MediaCodecFormat* fmt, int num_runs,
+                                     CodecOutput* output) {
+  return encode_frames(codec, nullptr, frames->frame_size(), frames, fmt,
+                       num_runs, output);
+}
+
+// Upload input frames into the hardware buffers of a surface input codec
+int android_mediacodec_surface_prefill(AMediaCodec* codec,
+                                       anicet::input::FrameRing* frames,
+                                       const MediaCodecFormat* fmt,
+                                       int num_frames) {
+  anicet::surface::SurfaceInput* surface = find_surface_input(codec);
+  if (surface == nullptr) {
+    return 0;
+  }
+  g_debug_level = fmt->debug_level;
+  DEBUG(2, "Pre-filling %d surface input buffers", num_frames);
+  return surface->prefill(frames, fmt->color_format, num_frames) ? 0 : 7;
+}
+
 // Cleanup MediaCodec encoder and free resources
 void android_mediacodec_encode_cleanup(AMediaCodec* codec, int debug_level) {
   if (!codec) {
@@ -551,13 +1037,22 @@ void android_mediacodec_encode_cleanup(AMediaCodec* codec, int debug_level) {
   // Set debug level for cleanup
   g_debug_level = debug_level;
 
+  // Pooled instances are flushed and kept for the next setup
+  if (release_to_pool(codec)) {
+    return;
+  }
+
   // Stop and delete codec
   // NOTE: Do NOT call flush() here - it's for reset/reuse, not cleanup
   // After EOS is sent/received, go straight to stop then delete
   DEBUG(3, "Stopping codec...");
   AMediaCodec_stop(codec);
+  // Release the input surface before the codec
+  remove_surface_input(codec);
   DEBUG(3, "Deleting codec...");
   AMediaCodec_delete(codec);
+  // No callbacks after the delete
+  remove_async_queue(codec);
 
   // NOTE: We do NOT stop the binder thread pool here!
   // The binder thread pool is a process-wide resource that should remain
@@ -571,6 +1066,28 @@ void android_mediacodec_encode_cleanup(AMediaCodec* codec, int debug_level) {
   // Letting the kernel handle cleanup is the safest approach.
 }
 
+// Stop and delete the idle pooled codecs
+void android_mediacodec_pool_clear(int debug_level) {
+  g_debug_level = debug_level;
+  std::vector<AMediaCodec*> codecs;
+  {
+    std::lock_guard<std::mutex> lock(g_pool_mutex);
+    for (auto& [key, idle] : g_pool_idle) {
+      for (AMediaCodec* codec : idle) {
+        codecs.push_back(codec);
+        g_pool_keys.erase(codec);
+      }
+    }
+    g_pool_idle.clear();
+  }
+  for (AMediaCodec* codec : codecs) {
+    DEBUG(3, "Stopping and deleting pooled codec...");
+    AMediaCodec_stop(codec);
+    AMediaCodec_delete(codec);
+    remove_async_queue(codec);
+  }
+}
+
 // Full all-in-one encode function (convenience wrapper)
 int android_mediacodec_encode_frame_full(const uint8_t* input_buffer,
                                          size_t input_size,
@@ -587,6 +1104,7 @@ int android_mediacodec_encode_frame_full(const uint8_t* input_buffer,
   // Create CodecOutput structure for single frame (num_runs=1)
   // Vectors will be initialized by the encode function
   CodecOutput mediacodec_output;
+  mediacodec_output.dump_output = true;
 
   // Encode single frame (num_runs=1)
   // Set dump_output=true since caller needs the buffer
@@ -598,7 +1116,7 @@ int android_mediacodec_encode_frame_full(const uint8_t* input_buffer,
     *output_size = mediacodec_output.frame_sizes[0];
     *output_buffer = (uint8_t*)malloc(*output_size);
     if (*output_buffer) {
-      memcpy(*output_buffer, mediacodec_output.frame_buffers[0].data(),
+      memcpy(*output_buffer, mediacodec_output.frame_arena.frame_data(0),
              *output_size);
     } else {
       *output_size = 0;
@@ -698,19 +1216,48 @@ int android_mediacodec_encode_frame(AMediaCodec* codec,
   (void)input_size;
   (void)format;
   (void)num_runs;
-  output->frame_buffers.clear();
+  output->frame_arena.clear();
   output->frame_sizes.clear();
   output->timings.clear();
   fprintf(stderr, "Error: MediaCodec encoding only works on Android\n");
   return 1;
 }
 
+int android_mediacodec_encode_frames(AMediaCodec* codec,
+                                     anicet::input::FrameRing* frames,
+                                     const MediaCodecFormat* format,
+                                     int num_runs, CodecOutput* output) {
+  (void)frames;
+  return android_mediacodec_encode_frame(codec, nullptr, 0, format, num_runs,
+                                         output);
+}
+
+int android_mediacodec_surface_prefill(AMediaCodec* codec,
+                                       anicet::input::FrameRing* frames,
+                                       const MediaCodecFormat* format,
+                                       int num_frames) {
+  (void)codec;
+  (void)frames;
+  (void)format;
+  (void)num_frames;
+  return 0;
+}
+
 void android_mediacodec_encode_cleanup(AMediaCodec* codec, int debug_level) {
   (void)codec;
   (void)debug_level;
   // Stub - nothing to do on non-Android platforms
 }
 
+int android_mediacodec_encode_setup_timed(const MediaCodecFormat* format,
+                                          AMediaCodec** codec,
+                                          CodecStartup* startup) {
+  *startup = CodecStartup();
+  return android_mediacodec_encode_setup(format, codec);
+}
+
+void android_mediacodec_pool_clear(int debug_level) { (void)debug_level; }
+
 void android_mediacodec_set_format(AMediaFormat* format, const char* mime_type,
                                    int width, int height,
                                    const char* color_format, int* bitrate,
@@ -0,0 +1,375 @@
+// android_mediacodec_surface.cc
+// Zero-copy MediaCodec surface input implementation
+
+#include "android_mediacodec_surface.h"
+
+#ifdef __ANDROID__
+
+#include <GLES2/gl2ext.h>
+#include <android/hardware_buffer.h>
+#include <android/native_window.h>
+#include <dlfcn.h>
+#include <media/NdkMediaCodec.h>
+
+#include <cstdio>
+#include <cstring>
+
+#include "anicet_input.h"
+
+namespace anicet {
+namespace surface {
+
+// Full-screen quad (triangle strip)
+static const GLfloat QUAD[] = {-1.0f, -1.0f, 1.0f, -1.0f,
+                               -1.0f, 1.0f,  1.0f, 1.0f};
+
+// The first texture row (top of the frame) goes to the top of the surface
+static const char* VERTEX_SHADER =
+    "attribute vec2 a_position;\n"
+    "varying vec2 v_texcoord;\n"
+    "void main() {\n"
+    "  v_texcoord = vec2(a_position.x * 0.5 + 0.5, 0.5 - a_position.y * 0.5);\n"
+    "  gl_Position = vec4(a_position, 0.0, 1.0);\n"
+    "}\n";
+
+// YUV to RGB is done by the external texture sampler, and RGB back to YUV by
+// the encoder input surface
+static const char* FRAGMENT_SHADER =
+    "#extension GL_OES_EGL_image_external : require\n"
+    "precision mediump float;\n"
+    "uniform samplerExternalOES u_texture;\n"
+    "varying vec2 v_texcoord;\n"
+    "void main() {\n"
+    "  gl_FragColor = texture2D(u_texture, v_texcoord);\n"
+    "}\n";
+
+// API 26+ functions and EGL/GLES extensions, resolved at runtime (the
+// minimum platform is android-21)
+struct SurfaceApi {
+  media_status_t (*create_input_surface)(AMediaCodec*, ANativeWindow**);
+  media_status_t (*signal_eos)(AMediaCodec*);
+  int (*allocate)(const AHardwareBuffer_Desc*, AHardwareBuffer**);
+  void (*release)(AHardwareBuffer*);
+  int (*lock_planes)(AHardwareBuffer*, uint64_t, int32_t, const ARect*,
+                     AHardwareBuffer_Planes*);
+  int (*unlock)(AHardwareBuffer*, int32_t*);
+  PFNEGLGETNATIVECLIENTBUFFERANDROIDPROC get_native_client_buffer;
+  PFNEGLCREATEIMAGEKHRPROC create_image;
+  PFNEGLDESTROYIMAGEKHRPROC destroy_image;
+  PFNEGLPRESENTATIONTIMEANDROIDPROC presentation_time;
+  PFNGLEGLIMAGETARGETTEXTURE2DOESPROC image_target_texture;
+};
+
+// Helper: resolve the API once (nullptr if a function is missing)
+static const SurfaceApi* get_api() {
+  static SurfaceApi api;
+  static bool resolved = []() {
+    api.create_input_surface =
+        (media_status_t(*)(AMediaCodec*, ANativeWindow**))dlsym(
+            RTLD_DEFAULT, "AMediaCodec_createInputSurface");
+    api.signal_eos = (media_status_t(*)(AMediaCodec*))dlsym(
+        RTLD_DEFAULT, "AMediaCodec_signalEndOfInputStream");
+    api.allocate = (int (*)(const AHardwareBuffer_Desc*, AHardwareBuffer**))
+        dlsym(RTLD_DEFAULT, "AHardwareBuffer_allocate");
+    api.release = (void (*)(AHardwareBuffer*))dlsym(
+        RTLD_DEFAULT, "AHardwareBuffer_release");
+    api.lock_planes =
+        (int (*)(AHardwareBuffer*, uint64_t, int32_t, const ARect*,
+                 AHardwareBuffer_Planes*))dlsym(RTLD_DEFAULT,
+                                                "AHardwareBuffer_lockPlanes");
+    api.unlock = (int (*)(AHardwareBuffer*, int32_t*))dlsym(
+        RTLD_DEFAULT, "AHardwareBuffer_unlock");
+    api.get_native_client_buffer =
+        (PFNEGLGETNATIVECLIENTBUFFERANDROIDPROC)eglGetProcAddress(
+            "eglGetNativeClientBufferANDROID");
+    api.create_image =
+        (PFNEGLCREATEIMAGEKHRPROC)eglGetProcAddress("eglCreateImageKHR");
+    api.destroy_image =
+        (PFNEGLDESTROYIMAGEKHRPROC)eglGetProcAddress("eglDestroyImageKHR");
+    api.presentation_time =
+        (PFNEGLPRESENTATIONTIMEANDROIDPROC)eglGetProcAddress(
+            "eglPresentationTimeANDROID");
+    api.image_target_texture =
+        (PFNGLEGLIMAGETARGETTEXTURE2DOESPROC)eglGetProcAddress(
+            "glEGLImageTargetTexture2DOES");
+    return api.create_input_surface && api.signal_eos && api.allocate &&
+           api.release && api.lock_planes && api.unlock &&
+           api.get_native_client_buffer && api.create_image &&
+           api.destroy_image && api.presentation_time &&
+           api.image_target_texture;
+  }();
+  return resolved ? &api : nullptr;
+}
+
+// Helper: compile a shader (0 on error)
+static GLuint compile_shader(GLenum type, const char* source) {
+  GLuint shader = glCreateShader(type);
+  glShaderSource(shader, 1, &source, nullptr);
+  glCompileShader(shader);
+  GLint compiled = GL_FALSE;
+  glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+  if (!compiled) {
+    char log[512] = "";
+    glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+    fprintf(stderr, "Error: Cannot compile shader: %s\n", log);
+    glDeleteShader(shader);
+    return 0;
+  }
+  return shader;
+}
+
+// Helper: build the external texture program (0 on error)
+static GLuint create_program() {
+  GLuint vertex = compile_shader(GL_VERTEX_SHADER, VERTEX_SHADER);
+  GLuint fragment = compile_shader(GL_FRAGMENT_SHADER, FRAGMENT_SHADER);
+  GLuint program = 0;
+  if (vertex != 0 && fragment != 0) {
+    program = glCreateProgram();
+    glAttachShader(program, vertex);
+    glAttachShader(program, fragment);
+    glLinkProgram(program);
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (!linked) {
+      char log[512] = "";
+      glGetProgramInfoLog(program, sizeof(log), nullptr, log);
+      fprintf(stderr, "Error: Cannot link shader program: %s\n", log);
+      glDeleteProgram(program);
+      program = 0;
+    }
+  }
+  if (vertex != 0) glDeleteShader(vertex);
+  if (fragment != 0) glDeleteShader(fragment);
+  return program;
+}
+
+// Helper: write a 4:2:0 frame into the planes of a YUV hardware buffer
+static bool write_frame(const SurfaceApi* api, AHardwareBuffer* buffer,
+                        const uint8_t* frame, const char* color_format,
+                        int width, int height) {
+  AHardwareBuffer_Planes planes;
+  if (api->lock_planes(buffer, AHARDWAREBUFFER_USAGE_CPU_WRITE_RARELY, -1,
+                       nullptr, &planes) != 0 ||
+      planes.planeCount < 3) {
+    fprintf(stderr, "Error: Cannot lock the hardware buffer planes\n");
+    return false;
+  }
+  // Source chroma samples: planar (yuv420p) or interleaved (nv12/nv21)
+  int chroma_width = width / 2;
+  int chroma_height = height / 2;
+  const uint8_t* src_chroma = frame + (size_t)width * height;
+  const uint8_t* src_u = src_chroma;
+  const uint8_t* src_v = src_chroma + (size_t)chroma_width * chroma_height;
+  int src_step = 1;
+  int src_stride = chroma_width;
+  if (strcmp(color_format, "nv12") == 0 || strcmp(color_format, "nv21") == 0) {
+    bool nv21 = strcmp(color_format, "nv21") == 0;
+    src_u = src_chroma + (nv21 ? 1 : 0);
+    src_v = src_chroma + (nv21 ? 0 : 1);
+    src_step = 2;
+    src_stride = chroma_width * 2;
+  }
+
+  const AHardwareBuffer_Plane& y_plane = planes.planes[0];
+  for (int y = 0; y < height; y++) {
+    uint8_t* dst = (uint8_t*)y_plane.data + (size_t)y * y_plane.rowStride;
+    const uint8_t* src = frame + (size_t)y * width;
+    if (y_plane.pixelStride == 1) {
+      memcpy(dst, src, width);
+    } else {
+      for (int x = 0; x < width; x++) dst[x * y_plane.pixelStride] = src[x];
+    }
+  }
+  const uint8_t* src_planes[2] = {src_u, src_v};
+  for (int p = 0; p < 2; p++) {
+    const AHardwareBuffer_Plane& plane = planes.planes[1 + p];
+    for (int y = 0; y < chroma_height; y++) {
+      uint8_t* dst = (uint8_t*)plane.data + (size_t)y * plane.rowStride;
+      const uint8_t* src = src_planes[p] + (size_t)y * src_stride;
+      for (int x = 0; x < chroma_width; x++) {
+        dst[x * plane.pixelStride] = src[x * src_step];
+      }
+    }
+  }
+  api->unlock(buffer, nullptr);
+  return true;
+}
+
+SurfaceInput::~SurfaceInput() {
+  if (display_ != EGL_NO_DISPLAY && context_ != EGL_NO_CONTEXT) {
+    eglMakeCurrent(display_, surface_, surface_, context_);
+    release_buffers();
+    if (program_ != 0) glDeleteProgram(program_);
+    eglMakeCurrent(display_, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+  }
+  if (surface_ != EGL_NO_SURFACE) eglDestroySurface(display_, surface_);
+  if (context_ != EGL_NO_CONTEXT) eglDestroyContext(display_, context_);
+  // No eglTerminate(): the default display is shared by the process
+  if (window_ != nullptr) ANativeWindow_release(window_);
+}
+
+bool SurfaceInput::init(AMediaCodec* codec, int width, int height) {
+  const SurfaceApi* api = get_api();
+  if (api == nullptr) {
+    fprintf(stderr, "Error: Surface input needs Android 10 (API 29)\n");
+    return false;
+  }
+  codec_ = codec;
+  width_ = width;
+  height_ = height;
+  if (api->create_input_surface(codec, &window_) != AMEDIA_OK) {
+    fprintf(stderr, "Error: Cannot create the codec input surface\n");
+    window_ = nullptr;
+    return false;
+  }
+
+  display_ = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+  if (display_ == EGL_NO_DISPLAY ||
+      !eglInitialize(display_, nullptr, nullptr)) {
+    fprintf(stderr, "Error: Cannot initialize EGL (0x%x)\n", eglGetError());
+    display_ = EGL_NO_DISPLAY;
+    return false;
+  }
+  // The surface is recordable: its buffers can go to the encoder
+  const EGLint config_attribs[] = {EGL_RED_SIZE,
+                                   8,
+                                   EGL_GREEN_SIZE,
+                                   8,
+                                   EGL_BLUE_SIZE,
+                                   8,
+                                   EGL_RENDERABLE_TYPE,
+                                   EGL_OPENGL_ES2_BIT,
+                                   EGL_SURFACE_TYPE,
+                                   EGL_WINDOW_BIT,
+                                   EGL_RECORDABLE_ANDROID,
+                                   EGL_TRUE,
+                                   EGL_NONE};
+  EGLConfig config;
+  EGLint num_configs = 0;
+  if (!eglChooseConfig(display_, config_attribs, &config, 1, &num_configs) ||
+      num_configs < 1) {
+    fprintf(stderr, "Error: No recordable EGL config\n");
+    return false;
+  }
+  const EGLint context_attribs[] = {EGL_CONTEXT_CLIENT_VERSION, 2, EGL_NONE};
+  context_ =
+      eglCreateContext(display_, config, EGL_NO_CONTEXT, context_attribs);
+  if (context_ != EGL_NO_CONTEXT) {
+    surface_ = eglCreateWindowSurface(display_, config, window_, nullptr);
+  }
+  if (context_ == EGL_NO_CONTEXT || surface_ == EGL_NO_SURFACE ||
+      !eglMakeCurrent(display_, surface_, surface_, context_)) {
+    fprintf(stderr, "Error: Cannot create the EGL surface (0x%x)\n",
+            eglGetError());
+    return false;
+  }
+
+  program_ = create_program();
+  if (program_ == 0) {
+    return false;
+  }
+  glUseProgram(program_);
+  glUniform1i(glGetUniformLocation(program_, "u_texture"), 0);
+  position_attrib_ = glGetAttribLocation(program_, "a_position");
+  glVertexAttribPointer(position_attrib_, 2, GL_FLOAT, GL_FALSE, 0, QUAD);
+  glEnableVertexAttribArray(position_attrib_);
+  glViewport(0, 0, width, height);
+  return true;
+}
+
+void SurfaceInput::release_buffers() {
+  const SurfaceApi* api = get_api();
+  for (Buffer& buffer : buffers_) {
+    if (buffer.texture != 0) glDeleteTextures(1, &buffer.texture);
+    if (buffer.image != EGL_NO_IMAGE_KHR) {
+      api->destroy_image(display_, buffer.image);
+    }
+    if (buffer.buffer != nullptr) api->release(buffer.buffer);
+  }
+  buffers_.clear();
+}
+
+bool SurfaceInput::prefill(anicet::input::FrameRing* frames,
+                           const char* color_format, int num_frames) {
+  const SurfaceApi* api = get_api();
+  release_buffers();
+  for (int i = 0; i < num_frames; i++) {
+    const uint8_t* frame = frames->frame(i);
+    if (frame == nullptr) {
+      fprintf(stderr, "Error: Cannot read input frame %d\n", i);
+      return false;
+    }
+    AHardwareBuffer_Desc desc = {};
+    desc.width = width_;
+    desc.height = height_;
+    desc.layers = 1;
+    desc.format = AHARDWAREBUFFER_FORMAT_Y8Cb8Cr8_420;
+    desc.usage = AHARDWAREBUFFER_USAGE_CPU_WRITE_RARELY |
+                 AHARDWAREBUFFER_USAGE_GPU_SAMPLED_IMAGE;
+    // Added before being filled, so that release_buffers() frees it on error
+    buffers_.emplace_back();
+    Buffer& buffer = buffers_.back();
+    if (api->allocate(&desc, &buffer.buffer) != 0) {
+      fprintf(stderr, "Error: Cannot allocate a %dx%d YUV hardware buffer\n",
+              width_, height_);
+      buffer.buffer = nullptr;
+      return false;
+    }
+    if (!write_frame(api, buffer.buffer, frame, color_format, width_,
+                     height_)) {
+      return false;
+    }
+
+    const EGLint image_attribs[] = {EGL_IMAGE_PRESERVED_KHR, EGL_TRUE,
+                                    EGL_NONE};
+    buffer.image = api->create_image(
+        display_, EGL_NO_CONTEXT, EGL_NATIVE_BUFFER_ANDROID,
+        api->get_native_client_buffer(buffer.buffer), image_attribs);
+    if (buffer.image == EGL_NO_IMAGE_KHR) {
+      fprintf(stderr, "Error: Cannot create an EGL image (0x%x)\n",
+              eglGetError());
+      return false;
+    }
+    glGenTextures(1, &buffer.texture);
+    glBindTexture(GL_TEXTURE_EXTERNAL_OES, buffer.texture);
+    glTexParameteri(GL_TEXTURE_EXTERNAL_OES, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_EXTERNAL_OES, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_EXTERNAL_OES, GL_TEXTURE_WRAP_S,
+                    GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_EXTERNAL_OES, GL_TEXTURE_WRAP_T,
+                    GL_CLAMP_TO_EDGE);
+    api->image_target_texture(GL_TEXTURE_EXTERNAL_OES,
+                              (GLeglImageOES)buffer.image);
+  }
+  return true;
+}
+
+bool SurfaceInput::queue_frame(int run, int64_t pts_us) {
+  if (buffers_.empty()) {
+    fprintf(stderr, "Error: Surface input was not pre-filled\n");
+    return false;
+  }
+  const Buffer& buffer = buffers_[run % buffers_.size()];
+  glBindTexture(GL_TEXTURE_EXTERNAL_OES, buffer.texture);
+  glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+  get_api()->presentation_time(display_, surface_, pts_us * 1000);
+  if (!eglSwapBuffers(display_, surface_)) {
+    fprintf(stderr, "Error: Cannot queue a surface frame (0x%x)\n",
+            eglGetError());
+    return false;
+  }
+  return true;
+}
+
+bool SurfaceInput::signal_eos() {
+  if (get_api()->signal_eos(codec_) != AMEDIA_OK) {
+    fprintf(stderr, "Error: Cannot signal the end of the input stream\n");
+    return false;
+  }
+  return true;
+}
+
+}  // namespace surface
+}  // namespace anicet
+
+#endif  // __ANDROID__
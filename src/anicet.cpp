@@ -18,11 +18,13 @@
 #include <cstring>
 #include <ctime>
 #include <map>
+#include <memory>
 #include <set>
 #include <string>
 #include <vector>
 
 // Encoder experiment runner
+#include "anicet_alloc.h"
 #include "anicet_runner.h"
 #include "anicet_runner_jpegli.h"
 #include "anicet_runner_mediacodec.h"
@@ -30,6 +32,29 @@
 // Parameter descriptor system
 #include "anicet_parameter.h"
 
+// CPU list and affinity helpers
+#include "anicet_cpu.h"
+
+// Input file loading and color conversion
+#include "anicet_color.h"
+#include "anicet_input.h"
+#include "anicet_output.h"
+
+// Batch manifest
+#include "anicet_manifest.h"
+
+// Regression benchmark suite and baseline comparison
+#include "anicet_bench.h"
+
+// Streaming result writers
+#include "anicet_report.h"
+
+// Per-thread sampler of the wrapped command
+#include "anicet_sched.h"
+
+// Sampling profiler and symbolizer
+#include "anicet_profile.h"
+
 // Codec-specific runners
 #include "anicet_runner_libjpegturbo.h"
 #include "anicet_runner_svtav1.h"
@@ -114,45 +139,6 @@ static long parse_vmhwm_kb_from_status(const std::string& status) {
   return -1;
 }
 
-static bool set_affinity_from_cpulist(const std::string& cpus) {
-#ifdef __linux__
-  cpu_set_t set;
-  CPU_ZERO(&set);
-  // cpus format examples: "0", "1-3", "0,2,4-6"
-  size_t i = 0, n = cpus.size();
-  while (i < n) {
-    // parse number
-    char* endptr = nullptr;
-    long a = strtol(cpus.c_str() + i, &endptr, 10);
-    if (endptr == cpus.c_str() + i) return false;
-    i = endptr - cpus.c_str();
-    long b = a;
-    if (i < n && cpus[i] == '-') {
-      ++i;
-      long r = strtol(cpus.c_str() + i, &endptr, 10);
-      if (endptr == cpus.c_str() + i) {
-        return false;
-      }
-      i = endptr - cpus.c_str();
-      b = r;
-    }
-    if (a > b) {
-      std::swap(a, b);
-    }
-    for (long c = a; c <= b; ++c) {
-      CPU_SET((int)c, &set);
-    }
-    if (i < n && cpus[i] == ',') {
-      ++i;
-    }
-  }
-  return sched_setaffinity(0, sizeof(set), &set) == 0;
-#else
-  (void)cpus;
-  return false;
-#endif
-}
-
 static void set_nice(int prio) {
   // prio: from -20 (high priority) to 19 (low). On Android non-root, range may
   // be limited.
@@ -321,9 +307,547 @@ static std::vector<std::pair<std::string, std::string>> get_sorted_params(
   return sorted_params;
 }
 
+// Write the "output" JSON section (frames array with codec, params,
+// exit_code and size_bytes per frame), one frame at a time
+static void write_output_json(anicet::report::JsonWriter& writer,
+                              const CodecOutput& codec_output, int exit_code,
+                              bool dump_output) {
+  using json = nlohmann::ordered_json;
+  // Parameters in custom order (the same for every frame)
+  auto sorted_params = get_sorted_params(codec_output.codec_params,
+                                         codec_output.codec_name);
+  writer.begin_object("output");
+  writer.begin_array("frames");
+  for (size_t i = 0; i < codec_output.num_frames(); i++) {
+    json output_frame;
+    if (dump_output && i < codec_output.output_files.size()) {
+      output_frame["file"] = codec_output.output_files[i];
+    }
+
+    // Use codec name and parameters from CodecOutput
+    output_frame["codec"] = codec_output.codec_name;
+    for (const auto& [key, value] : sorted_params) {
+      output_frame[key] = value;
+    }
+
+    output_frame["exit_code"] = exit_code;
+    if (i < codec_output.frame_sizes.size()) {
+      output_frame["size_bytes"] = codec_output.frame_sizes[i];
+    }
+    writer.element(output_frame);
+  }
+  writer.end_array();
+  writer.end_object();
+}
+
+// Build the per-frame "perf" JSON object (hardware counters, unavailable
+// counters are omitted)
+static nlohmann::ordered_json build_perf_json(
+    const anicet::perf::CounterValues& values) {
+  using json = nlohmann::ordered_json;
+  json perf = json::object();
+  for (int c = 0; c < anicet::perf::NUM_COUNTERS; c++) {
+    if (values.values[c] >= 0) {
+      perf[anicet::perf::counter_name(c)] = values.values[c];
+    }
+  }
+  int64_t cycles = values.values[anicet::perf::CYCLES];
+  int64_t instructions = values.values[anicet::perf::INSTRUCTIONS];
+  if (cycles > 0 && instructions >= 0) {
+    perf["ipc"] = (double)instructions / cycles;
+  }
+  perf["running_ratio"] = values.running_ratio;
+  return perf;
+}
+
+// Build a CPU cluster JSON object (name, CPUs, max frequency, capacity)
+static nlohmann::ordered_json build_cluster_json(
+    const anicet::cpu::CpuCluster& cluster) {
+  return {
+    {"name", cluster.name},
+    {"cpus", anicet::cpu::format_cpulist(cluster.cpus)},
+    {"max_freq_khz", cluster.max_freq_khz},
+    {"capacity", cluster.capacity}
+  };
+}
+
+// Build a summary JSON object (count, min, median, mean, stddev, p90, p99,
+// MAD, outliers and the 95% confidence interval of the median)
+static nlohmann::ordered_json build_summary_json(
+    const std::vector<double>& values) {
+  using json = nlohmann::ordered_json;
+  anicet::stats::Summary summary;
+  if (!anicet::stats::summarize(values, &summary)) {
+    return json::object();
+  }
+  return {
+    {"count", summary.count},
+    {"min", summary.min},
+    {"max", summary.max},
+    {"mean", summary.mean},
+    {"stddev", summary.stddev},
+    {"median", summary.median},
+    {"p90", summary.p90},
+    {"p99", summary.p99},
+    {"mad", summary.mad},
+    {"outliers", summary.outliers},
+    {"median_ci95", {summary.median_ci_low, summary.median_ci_high}},
+    {"median_ci95_percent", summary.median_ci_percent}
+  };
+}
+
+// Build the JSON of a concurrent encode (--workers): throughput, and the
+// latency and contention of each worker
+static nlohmann::ordered_json build_worker_run_json(const WorkerRun& run) {
+  using json = nlohmann::ordered_json;
+  json workers = json::array();
+  for (const WorkerResult& result : run.results) {
+    json worker = {
+      {"worker", result.worker},
+      {"frames", result.encode_time_us.size()},
+      {"encode_time_us", build_summary_json(result.encode_time_us)},
+      {"vol_ctx_switches", result.vol_ctx_switches},
+      {"invol_ctx_switches", result.invol_ctx_switches}
+    };
+    if (result.llc_read_misses >= 0) {
+      worker["llc_read_misses"] = result.llc_read_misses;
+    }
+    workers.push_back(worker);
+  }
+  return {
+    {"workers", run.workers},
+    {"throughput_fps", run.throughput_fps},
+    {"per_worker", workers}
+  };
+}
+
+// Build the allocations JSON object of a frame or phase (--alloc-tracker)
+static nlohmann::ordered_json build_alloc_json(
+    const anicet::alloc::AllocStats& allocs) {
+  return {
+    {"allocs", allocs.allocs},
+    {"bytes", allocs.bytes},
+    {"frees", allocs.frees},
+    {"mmaps", allocs.mmaps},
+    {"mmap_bytes", allocs.mmap_bytes},
+    {"peak_live_kb", allocs.peak_live_bytes / 1024}
+  };
+}
+
+// Build the per-thread sampler JSON members of fork mode (--sched-sampler):
+// "threads" (one entry per thread of the command and its descendants) and
+// "sched_timeline" (utilization per interval, times relative to t0_us)
+static nlohmann::ordered_json build_sched_json(
+    const anicet::sched::TaskSampler& sampler, int64_t t0_us) {
+  using json = nlohmann::ordered_json;
+  json threads = json::array();
+  for (const auto& thread : sampler.threads()) {
+    json cpus = json::object();
+    for (const auto& [cpu, samples] : thread.cpu_samples) {
+      cpus[std::to_string(cpu)] = samples;
+    }
+    json entry = {
+      {"pid", thread.pid},
+      {"tid", thread.tid},
+      {"comm", thread.comm},
+      {"cpu_time_ms", thread.cpu_time_ms()},
+      {"utime_ms", thread.utime_ms},
+      {"stime_ms", thread.stime_ms}
+    };
+    // Only recorded with schedstat
+    if (thread.run_delay_ns >= 0) {
+      entry["run_delay_ms"] = thread.run_delay_ns / 1e6;
+      entry["timeslices"] = thread.timeslices;
+    }
+    entry["last_cpu"] = thread.last_cpu;
+    entry["cpu_samples"] = cpus;
+    entry["lifetime_ms"] =
+        (thread.last_seen_us - thread.first_seen_us) / 1000.0;
+    threads.push_back(entry);
+  }
+  json samples = json::array();
+  for (const auto& sample : sampler.timeline()) {
+    samples.push_back({(sample.time_us - t0_us) / 1000.0, sample.threads,
+                       sample.busy_threads, sample.busy_cpus,
+                       sample.run_delay_ms});
+  }
+  return {
+    {"threads", threads},
+    {"sched_timeline", {
+      {"interval_ms", sampler.interval_ms()},
+      {"columns", {"time_ms", "threads", "busy_threads", "busy_cpus",
+                   "run_delay_ms"}},
+      {"samples", samples}
+    }}
+  };
+}
+
+// Print the per-thread sampler totals as CSV key=val fields (--sched-sampler)
+static void print_sched_csv(const anicet::sched::TaskSampler& sampler) {
+  double cpu_ms = 0.0;
+  double run_delay_ms = 0.0;
+  std::set<int> cpus;
+  for (const auto& thread : sampler.threads()) {
+    cpu_ms += thread.cpu_time_ms();
+    if (thread.run_delay_ns >= 0) {
+      run_delay_ms += thread.run_delay_ns / 1e6;
+    }
+    for (const auto& entry : thread.cpu_samples) {
+      cpus.insert(entry.first);
+    }
+  }
+  double sum_busy = 0.0;
+  double max_busy = 0.0;
+  for (const auto& sample : sampler.timeline()) {
+    sum_busy += sample.busy_cpus;
+    max_busy = std::max(max_busy, sample.busy_cpus);
+  }
+  double mean_busy = sampler.timeline().empty()
+                         ? 0.0
+                         : sum_busy / sampler.timeline().size();
+  // The CPU list is quoted (it contains commas)
+  printf(",sched_threads=%zu,sched_cpu_ms=%.1f,sched_run_delay_ms=%.1f"
+         ",sched_mean_busy_cpus=%.2f,sched_max_busy_cpus=%.2f"
+         ",sched_cpus=\"%s\"",
+         sampler.threads().size(), cpu_ms, run_delay_ms, mean_busy, max_busy,
+         anicet::cpu::format_cpulist(cpus).c_str());
+}
+
+// Build the "resources.global" JSON object (resource usage over the runner
+// calls)
+static nlohmann::ordered_json build_global_resources_json(
+    const CodecOutput& codec_output) {
+  using json = nlohmann::ordered_json;
+  json resources;
+
+  // Use resource_delta for detailed metrics
+  const ResourceDelta& delta = codec_output.resource_delta;
+  resources["global"]["wall_time_ms"] = delta.wall_time_ms;
+
+  // Codec library load time (dlopen + dlsym, not included in wall_time_ms)
+  resources["global"]["library_load_time_ms"] = codec_output.library_load_time_ms;
+
+  // SIMD level the codec ran with (runtime dispatch only)
+  if (!codec_output.simd_level.empty()) {
+    resources["global"]["simd_level"] = codec_output.simd_level;
+  }
+
+  // Codec instance startup of each runner call (cold or from the pool)
+  if (!codec_output.codec_startup.empty()) {
+    resources["global"]["codec_startup"] = json::array();
+    for (const CodecStartup& startup : codec_output.codec_startup) {
+      json startup_json;
+      startup_json["warm"] = startup.warm;
+      startup_json["create_us"] = startup.create_us;
+      startup_json["configure_us"] = startup.configure_us;
+      startup_json["start_us"] = startup.start_us;
+      startup_json["first_output_us"] = startup.first_output_us;
+      resources["global"]["codec_startup"].push_back(startup_json);
+    }
+  }
+
+  // Strip-parallel encodes against the single-threaded encode of the same
+  // frames
+  if (!codec_output.strip_comparison.empty()) {
+    resources["global"]["strips"] = json::array();
+    for (const StripComparison& comparison : codec_output.strip_comparison) {
+      json strips_json;
+      strips_json["strips"] = comparison.strips;
+      strips_json["frames"] = comparison.frames;
+      strips_json["strip_time_us"] = comparison.strip_time_us;
+      strips_json["single_time_us"] = comparison.single_time_us;
+      if (comparison.strip_time_us > 0) {
+        strips_json["speedup"] = (double)comparison.single_time_us /
+                                 comparison.strip_time_us;
+      }
+      strips_json["strip_bytes"] = comparison.strip_bytes;
+      strips_json["single_bytes"] = comparison.single_bytes;
+      if (comparison.single_bytes > 0) {
+        strips_json["size_overhead_percent"] =
+            ((double)comparison.strip_bytes / comparison.single_bytes - 1.0) *
+            100.0;
+      }
+      resources["global"]["strips"].push_back(strips_json);
+    }
+  }
+
+  // CPU time breakdown
+  resources["global"]["cpu_time"]["total_ms"] = delta.cpu_time_ms;
+  resources["global"]["cpu_time"]["user_time_ms"] = delta.user_time_ms;
+  resources["global"]["cpu_time"]["system_time_ms"] = delta.system_time_ms;
+
+  // CPU utilization percentage
+  if (delta.wall_time_ms > 0) {
+    resources["global"]["cpu_time"]["utilization_percent"] =
+      (delta.cpu_time_ms / delta.wall_time_ms * 100.0);
+  }
+
+  // Memory statistics
+  resources["global"]["memory_rss_kb"] = delta.vm_rss_delta_kb;
+  resources["global"]["memory_vss_kb"] = delta.vm_size_delta_kb;
+
+  // Heap allocations over the runner phases (--alloc-tracker)
+  anicet::alloc::AllocStats allocs;
+  for (const anicet::alloc::AllocStats& phase_allocs :
+       codec_output.phase_allocs) {
+    anicet::alloc::add_alloc_stats(&allocs, phase_allocs);
+  }
+  if (allocs.valid) {
+    resources["global"]["allocations"] = build_alloc_json(allocs);
+  }
+
+  // Page faults
+  resources["global"]["page_faults"]["minor"] = delta.minor_faults;
+  resources["global"]["page_faults"]["major"] = delta.major_faults;
+
+  // Context switches
+  resources["global"]["context_switches"]["voluntary"] = delta.vol_ctx_switches;
+  resources["global"]["context_switches"]["involuntary"] = delta.invol_ctx_switches;
+
+  // Resource usage of the (a)-(d) runner phases
+  for (int phase = 0; phase < NUM_CODEC_PHASES; phase++) {
+    const ResourceDelta& phase_delta = codec_output.phases[phase];
+    resources["global"]["phases"][codec_phase_name(phase)] = {
+      {"wall_time_ms", phase_delta.wall_time_ms},
+      {"cpu_time_ms", phase_delta.cpu_time_ms},
+      {"minor_faults", phase_delta.minor_faults},
+      {"major_faults", phase_delta.major_faults}
+    };
+    if (codec_output.phase_energy_mj[phase] >= 0.0) {
+      resources["global"]["phases"][codec_phase_name(phase)]["energy_mj"] =
+          codec_output.phase_energy_mj[phase];
+    }
+    if (codec_output.phase_allocs[phase].valid) {
+      resources["global"]["phases"][codec_phase_name(phase)]["allocations"] =
+          build_alloc_json(codec_output.phase_allocs[phase]);
+    }
+  }
+
+  // Energy over the runner calls (--energy-sampler)
+  if (codec_output.energy_mj >= 0.0) {
+    resources["global"]["energy"] = {
+      {"source", codec_output.energy_source},
+      {"total_mj", codec_output.energy_mj}
+    };
+    if (delta.wall_time_ms > 0) {
+      resources["global"]["energy"]["mean_power_mw"] =
+          codec_output.energy_mj / delta.wall_time_ms * 1000.0;
+    }
+  }
+
+  // Hardware counters summed over the encode calls (--perf-counters), with
+  // the mean running ratio
+  if (!codec_output.perf_counters.empty()) {
+    anicet::perf::CounterValues totals = {};
+    for (const auto& values : codec_output.perf_counters) {
+      for (int c = 0; c < anicet::perf::NUM_COUNTERS; c++) {
+        if (totals.values[c] >= 0) {
+          totals.values[c] = (values.values[c] >= 0)
+                                 ? totals.values[c] + values.values[c]
+                                 : -1;
+        }
+      }
+      totals.running_ratio += values.running_ratio;
+    }
+    totals.running_ratio /= codec_output.perf_counters.size();
+    resources["global"]["perf"] = build_perf_json(totals);
+  }
+
+  // Peak of the memory timeline (--memory-sampler)
+  if (!codec_output.memory_timeline.empty()) {
+    int64_t peak_rss_kb = 0;
+    for (const auto& sample : codec_output.memory_timeline) {
+      if (sample.rss_kb > peak_rss_kb) peak_rss_kb = sample.rss_kb;
+    }
+    resources["global"]["sampled_peak_rss_kb"] = peak_rss_kb;
+  }
+
+  // Cooldown waits before the runs (--cooldown-temp, --cooldown-ms)
+  if (codec_output.cooldown.waits > 0) {
+    resources["global"]["cooldown"] = {
+      {"waits", codec_output.cooldown.waits},
+      {"wait_ms", codec_output.cooldown.wait_ms},
+      {"timeouts", codec_output.cooldown.timeouts},
+      {"max_start_temp_mc", codec_output.cooldown.max_start_temp_mc}
+    };
+  }
+  return resources["global"];
+}
+
+// Build the "resources.summary" JSON object
+static nlohmann::ordered_json build_summary_resources_json(
+    const CodecOutput& codec_output) {
+  nlohmann::ordered_json resources;
+
+  // Summary over the measured (non warm-up) frames
+  int measured_runs = anicet::stats::num_measured_frames(codec_output);
+  resources["summary"]["runs"] = measured_runs;
+  resources["summary"]["warmup_runs"] =
+      (int)codec_output.num_frames() - measured_runs;
+  resources["summary"]["encode_time_us"] =
+      build_summary_json(anicet::stats::encode_times_us(codec_output));
+  resources["summary"]["cpu_time_ms"] =
+      build_summary_json(anicet::stats::cpu_times_ms(codec_output));
+  resources["summary"]["throughput_fps"] =
+      anicet::stats::throughput_fps(codec_output);
+  resources["summary"]["encode_cpu_per_frame_ms"] =
+      anicet::stats::encode_cpu_per_frame_ms(codec_output);
+  if (!codec_output.frame_energy.empty()) {
+    resources["summary"]["energy_mj"] =
+        build_summary_json(anicet::stats::energy_mj(codec_output));
+  }
+  std::vector<double> alloc_counts = anicet::stats::alloc_counts(codec_output);
+  if (!alloc_counts.empty()) {
+    resources["summary"]["allocs"] = build_summary_json(alloc_counts);
+    resources["summary"]["alloc_bytes"] =
+        build_summary_json(anicet::stats::alloc_bytes(codec_output));
+  }
+  return resources["summary"];
+}
+
+// Build the "resources.frames" JSON object of frame i
+static nlohmann::ordered_json build_frame_resources_json(
+    const CodecOutput& codec_output, size_t i) {
+  nlohmann::ordered_json frame;
+  frame["frame_index"] = i;
+  if (i < codec_output.warmup_frames.size() && codec_output.warmup_frames[i]) {
+    frame["warmup"] = true;
+  }
+
+  // Frame size
+  if (i < codec_output.frame_sizes.size()) {
+    frame["size_bytes"] = codec_output.frame_sizes[i];
+  }
+
+  // Frame timing
+  if (i < codec_output.timings.size()) {
+    frame["input_timestamp_us"] = codec_output.timings[i].input_timestamp_us;
+    frame["output_timestamp_us"] = codec_output.timings[i].output_timestamp_us;
+    int64_t encode_time_us = codec_output.timings[i].output_timestamp_us -
+                             codec_output.timings[i].input_timestamp_us;
+    frame["encode_time_us"] = encode_time_us;
+  }
+
+  // CPU time for this frame
+  if (i < codec_output.profile_encode_cpu_ms.size()) {
+    frame["cpu_time_ms"] = codec_output.profile_encode_cpu_ms[i];
+  }
+
+  // Energy for this frame (--energy-sampler)
+  if (i < codec_output.frame_energy.size() &&
+      codec_output.frame_energy[i].energy_mj >= 0.0) {
+    frame["energy_mj"] = codec_output.frame_energy[i].energy_mj;
+    frame["energy_mj_per_mp"] = codec_output.frame_energy[i].energy_mj_per_mp;
+  }
+
+  // Hardware counters for this frame (--perf-counters)
+  if (i < codec_output.perf_counters.size()) {
+    frame["perf"] = build_perf_json(codec_output.perf_counters[i]);
+  }
+
+  // Sampled peak memory for this frame (--memory-sampler)
+  if (i < codec_output.memory_frame_peaks.size() &&
+      codec_output.memory_frame_peaks[i].rss_kb >= 0) {
+    frame["peak_rss_kb"] = codec_output.memory_frame_peaks[i].rss_kb;
+    frame["peak_anon_kb"] = codec_output.memory_frame_peaks[i].anon_kb;
+  }
+
+  // Heap allocations during this frame (--alloc-tracker)
+  if (i < codec_output.frame_allocs.size() &&
+      codec_output.frame_allocs[i].valid) {
+    frame["allocations"] = build_alloc_json(codec_output.frame_allocs[i]);
+  }
+
+  // CPU frequency and temperature for this frame (--thermal-sampler)
+  if (i < codec_output.thermal_frames.size()) {
+    const anicet::thermal::FrameThermal& thermal =
+        codec_output.thermal_frames[i];
+    if (!thermal.freq_khz.empty()) {
+      frame["cpu_freq_khz"] = thermal.freq_khz;
+    }
+    if (thermal.max_temp_mc >= 0) {
+      frame["max_temp_mc"] = thermal.max_temp_mc;
+    }
+  }
+  return frame;
+}
+
+// Write the "resources" JSON section (global and per-frame resource usage,
+// and the sampler timelines), one frame and sample at a time
+static void write_resources_json(anicet::report::JsonWriter& writer,
+                                 const CodecOutput& codec_output) {
+  using json = nlohmann::ordered_json;
+  writer.begin_object("resources");
+  writer.member("global", build_global_resources_json(codec_output));
+  writer.member("summary", build_summary_resources_json(codec_output));
+
+  // Frames array
+  writer.begin_array("frames");
+  for (size_t i = 0; i < codec_output.num_frames(); i++) {
+    writer.element(build_frame_resources_json(codec_output, i));
+  }
+  writer.end_array();
+
+  // Memory timeline (--memory-sampler): one [time_us, frame, rss_kb,
+  // anon_kb, file_kb, pss_kb] row per sample (frame -1 outside the encode
+  // calls, pss_kb -1 when not sampled)
+  if (!codec_output.memory_timeline.empty()) {
+    writer.begin_object("memory_timeline");
+    writer.member("columns", {"time_us", "frame", "rss_kb", "anon_kb",
+                              "file_kb", "pss_kb"});
+    writer.begin_array("samples");
+    for (const auto& sample : codec_output.memory_timeline) {
+      writer.element({sample.time_us, sample.run, sample.rss_kb,
+                      sample.anon_kb, sample.file_kb, sample.pss_kb});
+    }
+    writer.end_array();
+    writer.end_object();
+  }
+
+  // Thermal timeline (--thermal-sampler): one [time_us, frame, freq_khz...,
+  // temp_mc...] row per sample (-1 for a failed read)
+  const anicet::thermal::ThermalTimeline& thermal =
+      codec_output.thermal_timeline;
+  if (!thermal.samples.empty()) {
+    writer.begin_object("thermal_timeline");
+    json columns = {"time_us", "frame"};
+    for (const std::string& domain : thermal.freq_domains) {
+      columns.push_back("freq_khz." + domain);
+    }
+    for (const std::string& zone : thermal.zones) {
+      columns.push_back("temp_mc." + zone);
+    }
+    writer.member("columns", columns);
+    writer.begin_array("samples");
+    for (const auto& sample : thermal.samples) {
+      json row = {sample.time_us, sample.run};
+      for (int64_t freq : sample.freq_khz) row.push_back(freq);
+      for (int64_t temp : sample.temp_mc) row.push_back(temp);
+      writer.element(row);
+    }
+    writer.end_array();
+    writer.end_object();
+  }
+  writer.end_object();
+}
+
 // Default debug level
 #define DEFAULT_DEBUG_LEVEL 0
 
+// Iterations of the resource profiler calibration
+#define PROFILER_CALIBRATION_ITERATIONS 200
+
+// Default --cooldown-temp time limit (milliseconds)
+#define DEFAULT_COOLDOWN_MS 120000
+
+// Default --input-cache size (input files kept loaded by --manifest)
+#define DEFAULT_INPUT_CACHE_SIZE 4
+
+// Default --profile-freq sampling frequency (Hz) and --profile-top table
+// length
+#define DEFAULT_PROFILE_FREQUENCY_HZ 1000
+#define DEFAULT_PROFILE_TOP 20
+
 // CLI parsing
 struct Options {
   std::vector<std::string> cmd;
@@ -340,6 +864,8 @@ struct Options {
   bool use_simpleperf = false;
   // comma-separated event list
   std::string simpleperf_events;
+  // per-thread sampler interval of the wrapped command (ms, 0 = disabled)
+  int sched_sample_interval_ms = 0;
   // Media input parameters for library API mode
   std::string image_file;
   int width = 0;
@@ -375,17 +901,224 @@ struct Options {
   std::vector<std::string> mediacodec_params;
   // parsed codec setup (populated after CLI parsing)
   CodecSetup codec_setup;
+  // input loading mode and mmap prefetch (--input-mode, --input-prefetch)
+  anicet::input::InputMode input_mode = anicet::input::InputMode::MMAP;
+  anicet::input::InputPrefetch input_prefetch =
+      anicet::input::InputPrefetch::POPULATE;
+  // stream a multi-frame clip, one distinct frame per run (--input-video)
+  bool input_video = false;
+  // --dump-output file writer mode and I/O (--dump-writer, --dump-io)
+  anicet::output::WriterMode dump_writer = anicet::output::WriterMode::ASYNC;
+  anicet::output::WriterIo dump_io = anicet::output::WriterIo::WRITE;
+  // experiment scheduling options (--parallel-codecs, --codec-cpus)
+  ExperimentOptions experiment_options;
+  // batch of library mode jobs (--manifest) and the number of input files
+  // kept loaded between jobs (--input-cache)
+  std::string manifest_file;
+  int input_cache_size = DEFAULT_INPUT_CACHE_SIZE;
+  // regression benchmark (--bench): the suite file and its loaded jobs and
+  // settings, the corpus directory, the baseline report to compare against
+  // and the file receiving the job result lines (empty = discarded)
+  std::string bench_file;
+  anicet::bench::Suite bench_suite;
+  std::string bench_corpus;
+  std::string bench_baseline;
+  std::string bench_jobs_file;
+  // library mode result format (--output-format)
+  anicet::report::ReportFormat output_format =
+      anicet::report::ReportFormat::JSON;
+  // sampling profiler of the encode phase (--profile-record), its
+  // frequency, the function table length and the folded stacks file prefix
+  // (empty = no file)
+  bool profile_record = false;
+  int profile_frequency_hz = DEFAULT_PROFILE_FREQUENCY_HZ;
+  int profile_top = DEFAULT_PROFILE_TOP;
+  std::string profile_folded_prefix;
 };
 
+// Validate a --codec list ("x265,webp")
+// Returns true on success, false on error (with error message printed)
+static bool validate_codec_list(const std::string& codec_list) {
+  size_t pos = 0;
+  while (pos < codec_list.length()) {
+    size_t comma = codec_list.find(',', pos);
+    if (comma == std::string::npos) {
+      comma = codec_list.length();
+    }
+    // Extract codec name (trim spaces)
+    size_t start = pos;
+    while (start < comma && codec_list[start] == ' ') start++;
+    size_t end = comma;
+    while (end > start && codec_list[end - 1] == ' ') end--;
+
+    std::string codec = codec_list.substr(start, end - start);
+    if (VALID_CODECS.find(codec) == VALID_CODECS.end()) {
+      fprintf(stderr, "Invalid codec: %s\n", codec.c_str());
+      return false;
+    }
+    pos = comma + 1;
+  }
+  return true;
+}
+
+// Get the accumulated parameter strings of a codec (--x265 etc.), nullptr
+// for an unknown codec
+static std::vector<std::string>* get_codec_param_strings(
+    Options& opt, const std::string& codec) {
+  if (codec == "x265") return &opt.x265_params;
+  if (codec == "webp") return &opt.webp_params;
+  if (codec == "libjpeg-turbo") return &opt.libjpegturbo_params;
+  if (codec == "svt-av1") return &opt.svtav1_params;
+  if (codec == "jpegli") return &opt.jpegli_params;
+  if (codec == "mediacodec") return &opt.mediacodec_params;
+  return nullptr;
+}
+
+// Whether any codec parameters were given (opt.codec_setup is used)
+static bool has_codec_params(const Options& opt) {
+  return !opt.x265_params.empty() || !opt.webp_params.empty() ||
+         !opt.libjpegturbo_params.empty() || !opt.svtav1_params.empty() ||
+         !opt.jpegli_params.empty() || !opt.mediacodec_params.empty();
+}
+
+// Parse the parameter strings of one codec into opt.codec_setup
+// Returns true on success, false on error (with error message printed)
+static bool parse_codec_param_strings(
+    const char* codec, const std::vector<std::string>& param_strings,
+    const std::map<std::string, anicet::parameter::ParameterDescriptor>&
+        descriptors,
+    Options& opt) {
+  if (param_strings.empty()) {
+    return true;
+  }
+  // Initialize codec_setup with default values from descriptors
+  opt.codec_setup.num_runs = opt.num_runs;
+
+  // Parse each parameter string (defaults will be applied only for
+  // explicitly set parameters)
+  for (const auto& param_str : param_strings) {
+    if (!anicet::parameter::parse_parameter_string(codec, param_str,
+                                                   descriptors,
+                                                   &opt.codec_setup)) {
+      return false;
+    }
+  }
+
+  // Validate parameter dependencies
+  return anicet::parameter::validate_parameter_dependencies(
+      codec, descriptors, opt.codec_setup);
+}
+
+// Parse the parameter strings of all codecs into opt.codec_setup
+// Returns true on success, false on error (with error message printed)
+static bool parse_codec_params(Options& opt) {
+  using namespace anicet::runner;
+  if (!parse_codec_param_strings("x265", opt.x265_params,
+                                 x265::X265_PARAMETERS, opt) ||
+      !parse_codec_param_strings("webp", opt.webp_params,
+                                 webp::WEBP_PARAMETERS, opt) ||
+      !parse_codec_param_strings("libjpeg-turbo", opt.libjpegturbo_params,
+                                 libjpegturbo::LIBJPEGTURBO_PARAMETERS,
+                                 opt) ||
+      !parse_codec_param_strings("svt-av1", opt.svtav1_params,
+                                 svtav1::SVTAV1_PARAMETERS, opt) ||
+      !parse_codec_param_strings("jpegli", opt.jpegli_params,
+                                 jpegli::JPEGLI_PARAMETERS, opt)) {
+    return false;
+  }
+  // Get parameters with dynamically populated codec list
+  if (!opt.mediacodec_params.empty() &&
+      !parse_codec_param_strings("mediacodec", opt.mediacodec_params,
+                                 mediacodec::get_mediacodec_parameters(),
+                                 opt)) {
+    return false;
+  }
+  return true;
+}
+
+// Parse --codec-cpus "codec=cpus,codec=cpus" (cpus may contain commas,
+// e.g. "x265=0,2,4-5,webp=1-3")
+static bool parse_codec_cpus(const std::string& arg,
+                             std::map<std::string, std::string>* codec_cpus) {
+  std::string codec;
+  size_t pos = 0;
+  while (pos <= arg.length()) {
+    size_t comma = arg.find(',', pos);
+    if (comma == std::string::npos) {
+      comma = arg.length();
+    }
+    std::string token = arg.substr(pos, comma - pos);
+    pos = comma + 1;
+    if (token.empty()) continue;
+
+    size_t eq = token.find('=');
+    if (eq != std::string::npos) {
+      codec = token.substr(0, eq);
+      if (VALID_CODECS.find(codec) == VALID_CODECS.end() || codec == "all") {
+        fprintf(stderr, "--codec-cpus: Invalid codec: %s\n", codec.c_str());
+        return false;
+      }
+      (*codec_cpus)[codec] = token.substr(eq + 1);
+    } else if (!codec.empty()) {
+      // Continuation of the previous codec's CPU list
+      (*codec_cpus)[codec] += "," + token;
+    } else {
+      fprintf(stderr, "--codec-cpus needs codec=cpus\n");
+      return false;
+    }
+  }
+
+  // Resolve cluster names and validate CPU lists
+  for (auto& [name, cpus] : *codec_cpus) {
+    if (!anicet::cpu::resolve_cpulist(cpus, &cpus)) {
+      return false;
+    }
+    std::set<int> cpu_set;
+    if (!anicet::cpu::parse_cpulist(cpus, &cpu_set)) {
+      fprintf(stderr, "--codec-cpus: Invalid CPU list for %s: '%s'\n",
+              name.c_str(), cpus.c_str());
+      return false;
+    }
+  }
+  return true;
+}
+
+// Parse --thread-scaling "1,2,4,8" (thread counts >= 1)
+static bool parse_thread_counts(const std::string& arg,
+                                std::vector<int>* thread_counts) {
+  thread_counts->clear();
+  size_t pos = 0;
+  while (pos <= arg.length()) {
+    size_t comma = arg.find(',', pos);
+    if (comma == std::string::npos) {
+      comma = arg.length();
+    }
+    std::string token = arg.substr(pos, comma - pos);
+    pos = comma + 1;
+    char* end = nullptr;
+    long threads = strtol(token.c_str(), &end, 10);
+    if (token.empty() || *end != '\0' || threads < 1 || threads > 1024) {
+      fprintf(stderr, "--thread-scaling: Invalid thread count: '%s'\n",
+              token.c_str());
+      return false;
+    }
+    thread_counts->push_back((int)threads);
+  }
+  return true;
+}
+
 static void print_help(const char* argv0) {
   fprintf(
       stderr,
       "Usage:\n"
       "  %s [options] -- <command> [args...]\n"
-      "  %s [options] --image FILE --width N --height N --color-format FORMAT\n\n"
+      "  %s [options] --image FILE --width N --height N --color-format FORMAT\n"
+      "  %s [options] --manifest FILE\n"
+      "  %s [options] --bench SUITE [--bench-baseline FILE]\n\n"
       "Options:\n"
       "  --tag key=val            Repeatable; attach metadata to output row\n"
-      "  --cpus LIST              CPU affinity, e.g. 0,2,4-5\n"
+      "  --cpus LIST              CPU affinity, e.g. 0,2,4-5, or a cluster: cluster:little,\n"
+      "                           cluster:mid, cluster:big (from the cpufreq topology)\n"
       "  --nice N                 Set niceness [-20..19]; requires privileges "
       "for negative\n"
       "  --timeout-ms N           Kill child if it runs longer than N ms\n"
@@ -393,10 +1126,35 @@ static void print_help(const char* argv0) {
       "  --simpleperf             Wrap with simpleperf (default: disabled)\n"
       "  --no-simpleperf          Disable simpleperf wrapping\n"
       "  --simpleperf-events LIST Comma-separated perf events\n"
+      "  --sched-sampler MS       Sample the threads of the command every MS milliseconds\n"
+      "                           (/proc/<pid>/task/*/stat, schedstat): per-thread CPU time,\n"
+      "                           last CPU, run-queue wait and a utilization timeline\n"
       "  --image FILE             Image file to encode (library API mode)\n"
       "  --width N                Image width in pixels\n"
       "  --height N               Image height in pixels\n"
-      "  --color-format FORMAT    Color format (e.g., yuv420p)\n"
+      "  --color-format FORMAT    Color format: yuv420p, nv12, nv21, p010, rgba (converted\n"
+      "                           per run for codecs that do not take it directly)\n"
+      "  --input-mode MODE        Input loading: mmap (zero-copy), read (default: mmap)\n"
+      "  --input-prefetch MODE    mmap prefetch: none, populate, willneed, hugepage\n"
+      "                           (default: populate)\n"
+      "  --input-video            Treat --image as a multi-frame clip (raw yuv420p frames\n"
+      "                           or y4m) and encode a distinct frame per run\n"
+      "  --frame-ring N           Frames kept resident per codec with --input-video\n"
+      "                           (default: 2)\n"
+      "  --manifest FILE          Run the jobs of a JSON manifest in one process: a list of\n"
+      "                           {image, width, height, color_format, codec, params,\n"
+      "                           num_runs, tags} (unset fields take the CLI values). Each\n"
+      "                           job result is written as one JSON line when it finishes\n"
+      "  --input-cache N          Input files kept loaded between --manifest jobs (default: 4)\n"
+      "  --bench SUITE            Run a versioned regression suite (a manifest with fixed\n"
+      "                           warmup_runs, num_runs, cpus, cooldown and thresholds) and\n"
+      "                           write its report (encode times, peak memory, bytes per\n"
+      "                           pixel) to --output\n"
+      "  --bench-baseline FILE    Compare the report with an earlier one of the same suite\n"
+      "                           version; exit 3 on a time, memory or size regression\n"
+      "  --bench-corpus DIR       Directory of the suite images (default: the suite's)\n"
+      "  --bench-jobs FILE        Write the full job results of --bench (one JSON line per\n"
+      "                           job) to FILE (default: discarded)\n"
       "  --codec CODEC            Codec to use: x265, svt-av1,\n"
       "                           libjpeg-turbo, jpegli, webp,\n"
       "                           mediacodec, all (default: all)\n"
@@ -418,19 +1176,70 @@ static void print_help(const char* argv0) {
       "  --mediacodec PARAMS      mediacodec encoder parameters (repeatable, colon/comma-separated)\n"
       "                           Format: param=value:param=value or param=value,param=value\n"
       "                           Use '--mediacodec help' for parameter list\n"
-      "  --num-runs N             Number of encoding runs for profiling (default: 1)\n"
+      "                           Sweep a grid in one process with param=min..max[:step]\n"
+      "                           or param=value1|value2 (e.g. --x265 crf=18..40:4,preset=fast|medium)\n"
+      "  --parallel-codecs        Run the selected codecs concurrently, one thread per codec\n"
+      "  --codec-cpus LIST        Per-codec CPU lists for --parallel-codecs (repeatable)\n"
+      "                           Format: codec=cpus,codec=cpus (e.g. x265=4-7,webp=0-3)\n"
+      "  --per-cluster            Run the selected codecs once per CPU cluster, pinned to it\n"
+      "  --workers N              Encode each grid point with N concurrent instances of the\n"
+      "                           codec, one thread each: images/s, per-worker latency and\n"
+      "                           contention (context switches, LLC misses)\n"
+      "  --thread-scaling LIST    Run each codec once per thread count (e.g. 1,2,4,8), pinned\n"
+      "                           to that many CPUs with the codec thread parameter set to\n"
+      "                           it: speedup, parallel efficiency and CPU utilization\n"
+      "  --num-runs N|auto        Number of encoding runs for profiling (default: 1)\n"
+      "                           auto: encode batches of 10 runs until the 95%% confidence\n"
+      "                           interval of the median encode time is within --target-ci\n"
+      "  --warmup-runs N          Runs encoded first and excluded from the summary (default: 0)\n"
+      "  --target-ci PCT          --num-runs auto target, +/-PCT of the median (default: 2)\n"
+      "  --max-runs N             --num-runs auto limit on measured runs (default: 200)\n"
       "  --dump-output            Write output files to disk (default: disabled)\n"
       "  --no-dump-output         Do not write output files to disk\n"
       "  --dump-output-dir DIR    Directory for output files (default: exe directory)\n"
       "  --dump-output-prefix PFX Prefix for output files (default: anicet.output)\n"
+      "  --dump-writer MODE       Output file writer: async (background thread), sync\n"
+      "                           (default: async)\n"
+      "  --dump-io MODE           Output file I/O: write, direct (O_DIRECT) (default: write)\n"
+      "  --perf-counters          Read hardware counters (cycles, instructions, cache and\n"
+      "                           branch misses, stalls) around each encode call\n"
+      "                           (library mode; --simpleperf implies it there)\n"
+      "  --memory-sampler MS      Sample RSS (anon/file, PSS when cheap) every MS milliseconds\n"
+      "                           on a background thread (e.g. 1-5): memory timeline and\n"
+      "                           per-frame peak memory (default: disabled)\n"
+      "  --alloc-tracker          Count heap allocations (malloc/free/mmap hooks) per frame\n"
+      "                           and per phase, bytes and live heap peak (library mode)\n"
+      "  --profile-record         Sample the call stacks of the encode phase (perf_event_open)\n"
+      "                           and report the hottest functions per codec (library mode)\n"
+      "  --profile-freq HZ        --profile-record sampling frequency (default: 1000)\n"
+      "  --profile-top N          Functions in the --profile-record table, 0 for all\n"
+      "                           (default: 20)\n"
+      "  --profile-folded PREFIX  Also write the folded stacks (flamegraph input) of each\n"
+      "                           codec to PREFIX.codec_<codec>[.point_<index>].folded\n"
+      "  --energy-sampler MS      Sample the power monitor rails (or the battery current and\n"
+      "                           voltage) every MS milliseconds (e.g. 5-20): energy per\n"
+      "                           frame, per megapixel and per phase (default: disabled)\n"
+      "  --thermal-sampler MS     Sample the CPU frequency of the pinned clusters and the\n"
+      "                           thermal zones every MS milliseconds (e.g. 10-50):\n"
+      "                           timeline and per-frame values (default: disabled)\n"
+      "  --thermal-zones LIST     Thermal zone type substrings to read, comma-separated\n"
+      "                           (default: zones whose type contains cpu or soc)\n"
+      "  --cooldown-temp C        Before the runs of each codec and grid point, wait until\n"
+      "                           the hottest zone is at or below C degrees Celsius\n"
+      "  --cooldown-ms MS         --cooldown-temp time limit (default: 120000), or a fixed\n"
+      "                           pause without --cooldown-temp\n"
       "  -o, --output FILE        Output file for JSON results (default: stdout, use '-' for stdout)\n"
+      "  --output-format FORMAT   Library mode results: json (indented), jsonl (one compact\n"
+      "                           line per experiment or manifest job), csv (one row per\n"
+      "                           frame) (default: json). Results are streamed, not built in\n"
+      "                           memory\n"
       "  -d, --debug              Increase debug verbosity (can be repeated: -d -d or -dd)\n"
       "  --quiet                  Disable all debug output (sets debug level to 0)\n"
       "  --version                Show version information\n"
       "  -h, --help               Show help\n\n"
       "Outputs fields:\n"
       "  wall_ms,user_ms,sys_ms,vmhwm_kb,exit[,simpleperf metrics...]\n",
-      argv0, argv0);
+      argv0, argv0, argv0, argv0);
 }
 
 static bool parse_cli(int argc, char** argv, Options& opt) {
@@ -457,6 +1266,40 @@ static bool parse_cli(int argc, char** argv, Options& opt) {
     {"svt-av1", required_argument, nullptr, 1003},
     {"jpegli", required_argument, nullptr, 1004},
     {"mediacodec", required_argument, nullptr, 1005},
+    {"parallel-codecs", no_argument, nullptr, 1006},
+    {"codec-cpus", required_argument, nullptr, 1007},
+    {"input-mode", required_argument, nullptr, 1008},
+    {"input-prefetch", required_argument, nullptr, 1009},
+    {"input-video", no_argument, nullptr, 1010},
+    {"frame-ring", required_argument, nullptr, 1011},
+    {"dump-writer", required_argument, nullptr, 1012},
+    {"dump-io", required_argument, nullptr, 1013},
+    {"perf-counters", no_argument, nullptr, 1014},
+    {"memory-sampler", required_argument, nullptr, 1015},
+    {"alloc-tracker", no_argument, nullptr, 1030},
+    {"sched-sampler", required_argument, nullptr, 1031},
+    {"profile-record", no_argument, nullptr, 1032},
+    {"profile-freq", required_argument, nullptr, 1033},
+    {"profile-top", required_argument, nullptr, 1034},
+    {"profile-folded", required_argument, nullptr, 1035},
+    {"thermal-sampler", required_argument, nullptr, 1021},
+    {"thermal-zones", required_argument, nullptr, 1022},
+    {"cooldown-temp", required_argument, nullptr, 1023},
+    {"cooldown-ms", required_argument, nullptr, 1024},
+    {"energy-sampler", required_argument, nullptr, 1025},
+    {"warmup-runs", required_argument, nullptr, 1016},
+    {"target-ci", required_argument, nullptr, 1017},
+    {"max-runs", required_argument, nullptr, 1018},
+    {"thread-scaling", required_argument, nullptr, 1019},
+    {"per-cluster", no_argument, nullptr, 1020},
+    {"manifest", required_argument, nullptr, 1026},
+    {"input-cache", required_argument, nullptr, 1027},
+    {"bench", required_argument, nullptr, 1036},
+    {"bench-baseline", required_argument, nullptr, 1037},
+    {"bench-corpus", required_argument, nullptr, 1038},
+    {"bench-jobs", required_argument, nullptr, 1039},
+    {"output-format", required_argument, nullptr, 1028},
+    {"workers", required_argument, nullptr, 1029},
     {"num-runs", required_argument, nullptr, 'N'},
     {"dump-output", no_argument, nullptr, 'D'},
     {"no-dump-output", no_argument, nullptr, 'O'},
@@ -560,7 +1403,10 @@ static bool parse_cli(int argc, char** argv, Options& opt) {
       }
 
       case 'c':
-        opt.cpus = optarg;
+        // Cluster names ("cluster:big") resolve to the cluster's CPUs
+        if (!anicet::cpu::resolve_cpulist(optarg, &opt.cpus)) {
+          return false;
+        }
         break;
 
       case 'n':
@@ -599,36 +1445,13 @@ static bool parse_cli(int argc, char** argv, Options& opt) {
         opt.color_format = optarg;
         break;
 
-      case 'C': {
+      case 'C':
         opt.codec = optarg;
         // Split by comma and validate each codec
-        std::string codec_list = opt.codec;
-        size_t pos = 0;
-        bool all_valid = true;
-        while (pos < codec_list.length()) {
-          size_t comma = codec_list.find(',', pos);
-          if (comma == std::string::npos) {
-            comma = codec_list.length();
-          }
-          // Extract codec name (trim spaces)
-          size_t start = pos;
-          while (start < comma && codec_list[start] == ' ') start++;
-          size_t end = comma;
-          while (end > start && codec_list[end - 1] == ' ') end--;
-
-          std::string codec = codec_list.substr(start, end - start);
-          if (VALID_CODECS.find(codec) == VALID_CODECS.end()) {
-            fprintf(stderr, "Invalid codec: %s\n", codec.c_str());
-            all_valid = false;
-            break;
-          }
-          pos = comma + 1;
-        }
-        if (!all_valid) {
+        if (!validate_codec_list(opt.codec)) {
           return false;
         }
         break;
-      }
 
       case 1000: {
         // Handle --x265 option
@@ -782,184 +1605,354 @@ static bool parse_cli(int argc, char** argv, Options& opt) {
         break;
       }
 
-      case 'N':
-        opt.num_runs = atoi(optarg);
-        if (opt.num_runs < 1) {
-          fprintf(stderr, "--num-runs must be >= 1\n");
+      case 1006:
+        opt.experiment_options.parallel_codecs = true;
+        break;
+
+      case 1007:
+        if (!parse_codec_cpus(optarg, &opt.experiment_options.codec_cpus)) {
           return false;
         }
         break;
 
-      case 'D':
-        opt.dump_output = true;
+      case 1008:
+        if (!anicet::input::parse_input_mode(optarg, &opt.input_mode)) {
+          fprintf(stderr, "Invalid --input-mode: %s (valid: read, mmap)\n", optarg);
+          return false;
+        }
         break;
 
-      case 'O':
-        opt.dump_output = false;
+      case 1009:
+        if (!anicet::input::parse_input_prefetch(optarg, &opt.input_prefetch)) {
+          fprintf(stderr,
+                  "Invalid --input-prefetch: %s (valid: none, populate, willneed, hugepage)\n",
+                  optarg);
+          return false;
+        }
         break;
 
-      case 'r':
-        opt.dump_output_dir = optarg;
+      case 1010:
+        opt.input_video = true;
         break;
 
-      case 'p':
-        opt.dump_output_prefix = optarg;
+      case 1011:
+        opt.experiment_options.frame_ring_size = atoi(optarg);
+        if (opt.experiment_options.frame_ring_size < 1) {
+          fprintf(stderr, "--frame-ring must be >= 1\n");
+          return false;
+        }
         break;
 
-      case 'o':
-        opt.output_file = optarg;
+      case 1012:
+        if (!anicet::output::parse_writer_mode(optarg, &opt.dump_writer)) {
+          fprintf(stderr, "Invalid --dump-writer: %s (valid: async, sync)\n", optarg);
+          return false;
+        }
         break;
 
-      case 'd':
-        opt.debug++;
+      case 1013:
+        if (!anicet::output::parse_writer_io(optarg, &opt.dump_io)) {
+          fprintf(stderr, "Invalid --dump-io: %s (valid: write, direct)\n", optarg);
+          return false;
+        }
         break;
 
-      case 'q':
-        opt.debug = 0;
+      case 1014:
+        opt.experiment_options.perf_counters = true;
         break;
 
-      case '?':
-        // getopt_long already printed an error message
-        return false;
+      case 1015:
+        opt.experiment_options.memory_sample_interval_ms = atoi(optarg);
+        if (opt.experiment_options.memory_sample_interval_ms < 1) {
+          fprintf(stderr, "--memory-sampler must be >= 1\n");
+          return false;
+        }
+        break;
 
-      default:
-        return false;
-    }
-  }
+      case 1030:
+        // Enabled right away, so that the live heap covers the input loading
+        if (!anicet::alloc::enable()) {
+          return false;
+        }
+        break;
 
-  // Parse x265 parameters if provided (do this BEFORE command validation)
-  if (!opt.x265_params.empty()) {
-    // Initialize codec_setup with default values from descriptors
-    opt.codec_setup.num_runs = opt.num_runs;  // Will be overridden by CLI if specified
+      case 1031:
+        opt.sched_sample_interval_ms = atoi(optarg);
+        if (opt.sched_sample_interval_ms < 1) {
+          fprintf(stderr, "--sched-sampler must be >= 1\n");
+          return false;
+        }
+        break;
 
-    // Parse each parameter string (defaults will be applied only for explicitly set parameters)
-    for (const auto& param_str : opt.x265_params) {
-      if (!anicet::parameter::parse_parameter_string(
-              "x265", param_str, anicet::runner::x265::X265_PARAMETERS,
-              &opt.codec_setup)) {
-        return false;
-      }
-    }
+      case 1032:
+        opt.profile_record = true;
+        break;
 
-    // Validate parameter dependencies
-    if (!anicet::parameter::validate_parameter_dependencies(
-            "x265", anicet::runner::x265::X265_PARAMETERS, opt.codec_setup)) {
-      return false;
-    }
-  }
+      case 1033:
+        opt.profile_frequency_hz = atoi(optarg);
+        break;
 
-  // Parse webp parameters if provided (do this BEFORE command validation)
-  if (!opt.webp_params.empty()) {
-    // Initialize codec_setup with default values from descriptors
-    opt.codec_setup.num_runs = opt.num_runs;
+      case 1034:
+        opt.profile_top = atoi(optarg);
+        if (opt.profile_top < 0) {
+          fprintf(stderr, "--profile-top must be >= 0\n");
+          return false;
+        }
+        break;
 
-    // Parse each parameter string
-    for (const auto& param_str : opt.webp_params) {
-      if (!anicet::parameter::parse_parameter_string(
-              "webp", param_str, anicet::runner::webp::WEBP_PARAMETERS,
-              &opt.codec_setup)) {
-        return false;
-      }
-    }
+      case 1035:
+        opt.profile_folded_prefix = optarg;
+        break;
 
-    // Validate parameter dependencies
-    if (!anicet::parameter::validate_parameter_dependencies(
-            "webp", anicet::runner::webp::WEBP_PARAMETERS, opt.codec_setup)) {
-      return false;
-    }
-  }
+      case 'N':
+        if (strcmp(optarg, "auto") == 0) {
+          // Batches until the median is stable (see --target-ci)
+          opt.experiment_options.run_policy.auto_runs = true;
+          opt.num_runs = opt.experiment_options.run_policy.batch_runs;
+          break;
+        }
+        opt.num_runs = atoi(optarg);
+        if (opt.num_runs < 1) {
+          fprintf(stderr, "--num-runs must be >= 1 or auto\n");
+          return false;
+        }
+        break;
 
-  // Parse libjpeg-turbo parameters if provided (do this BEFORE command validation)
-  if (!opt.libjpegturbo_params.empty()) {
-    // Initialize codec_setup with default values from descriptors
-    opt.codec_setup.num_runs = opt.num_runs;
+      case 1016:
+        opt.experiment_options.run_policy.warmup_runs = atoi(optarg);
+        if (opt.experiment_options.run_policy.warmup_runs < 0) {
+          fprintf(stderr, "--warmup-runs must be >= 0\n");
+          return false;
+        }
+        break;
 
-    // Parse each parameter string
-    for (const auto& param_str : opt.libjpegturbo_params) {
-      if (!anicet::parameter::parse_parameter_string(
-              "libjpeg-turbo", param_str, anicet::runner::libjpegturbo::LIBJPEGTURBO_PARAMETERS,
-              &opt.codec_setup)) {
-        return false;
-      }
-    }
+      case 1017:
+        opt.experiment_options.run_policy.target_ci_percent = atof(optarg);
+        if (opt.experiment_options.run_policy.target_ci_percent <= 0.0) {
+          fprintf(stderr, "--target-ci must be > 0\n");
+          return false;
+        }
+        break;
 
-    // Validate parameter dependencies
-    if (!anicet::parameter::validate_parameter_dependencies(
-            "libjpeg-turbo", anicet::runner::libjpegturbo::LIBJPEGTURBO_PARAMETERS, opt.codec_setup)) {
-      return false;
-    }
-  }
+      case 1018:
+        opt.experiment_options.run_policy.max_runs = atoi(optarg);
+        if (opt.experiment_options.run_policy.max_runs < 1) {
+          fprintf(stderr, "--max-runs must be >= 1\n");
+          return false;
+        }
+        break;
 
-  // Parse svt-av1 parameters if provided (do this BEFORE command validation)
-  if (!opt.svtav1_params.empty()) {
-    // Initialize codec_setup with default values from descriptors
-    opt.codec_setup.num_runs = opt.num_runs;
+      case 1019:
+        if (!parse_thread_counts(optarg,
+                                 &opt.experiment_options.thread_counts)) {
+          return false;
+        }
+        break;
 
-    // Parse each parameter string
-    for (const auto& param_str : opt.svtav1_params) {
-      if (!anicet::parameter::parse_parameter_string(
-              "svt-av1", param_str, anicet::runner::svtav1::SVTAV1_PARAMETERS,
-              &opt.codec_setup)) {
-        return false;
-      }
-    }
+      case 1020:
+        opt.experiment_options.per_cluster = true;
+        break;
 
-    // Validate parameter dependencies
-    if (!anicet::parameter::validate_parameter_dependencies(
-            "svt-av1", anicet::runner::svtav1::SVTAV1_PARAMETERS, opt.codec_setup)) {
-      return false;
-    }
-  }
+      case 1021:
+        opt.experiment_options.thermal_sample_interval_ms = atoi(optarg);
+        if (opt.experiment_options.thermal_sample_interval_ms < 1) {
+          fprintf(stderr, "--thermal-sampler must be >= 1\n");
+          return false;
+        }
+        break;
+
+      case 1022:
+        opt.experiment_options.thermal_zones = optarg;
+        break;
+
+      case 1023:
+        opt.experiment_options.run_policy.cooldown_temp_c = atof(optarg);
+        if (opt.experiment_options.run_policy.cooldown_temp_c <= 0.0) {
+          fprintf(stderr, "--cooldown-temp must be > 0\n");
+          return false;
+        }
+        break;
+
+      case 1024:
+        opt.experiment_options.run_policy.cooldown_ms = atoi(optarg);
+        if (opt.experiment_options.run_policy.cooldown_ms < 1) {
+          fprintf(stderr, "--cooldown-ms must be >= 1\n");
+          return false;
+        }
+        break;
+
+      case 1025:
+        opt.experiment_options.energy_sample_interval_ms = atoi(optarg);
+        if (opt.experiment_options.energy_sample_interval_ms < 1) {
+          fprintf(stderr, "--energy-sampler must be >= 1\n");
+          return false;
+        }
+        break;
+
+      case 1026:
+        opt.manifest_file = optarg;
+        break;
+
+      case 1036:
+        opt.bench_file = optarg;
+        break;
+
+      case 1037:
+        opt.bench_baseline = optarg;
+        break;
+
+      case 1038:
+        opt.bench_corpus = optarg;
+        break;
+
+      case 1039:
+        opt.bench_jobs_file = optarg;
+        break;
+
+      case 1027:
+        opt.input_cache_size = atoi(optarg);
+        if (opt.input_cache_size < 1) {
+          fprintf(stderr, "--input-cache must be >= 1\n");
+          return false;
+        }
+        break;
+
+      case 1028:
+        if (!anicet::report::parse_report_format(optarg,
+                                                 &opt.output_format)) {
+          fprintf(stderr, "Invalid --output-format: %s (valid: json, jsonl, csv)\n",
+                  optarg);
+          return false;
+        }
+        break;
+
+      case 1029:
+        opt.experiment_options.workers = atoi(optarg);
+        if (opt.experiment_options.workers < 1) {
+          fprintf(stderr, "--workers must be >= 1\n");
+          return false;
+        }
+        break;
+
+      case 'D':
+        opt.dump_output = true;
+        break;
+
+      case 'O':
+        opt.dump_output = false;
+        break;
+
+      case 'r':
+        opt.dump_output_dir = optarg;
+        break;
 
-  // Parse jpegli parameters if provided (do this BEFORE command validation)
-  if (!opt.jpegli_params.empty()) {
-    // Initialize codec_setup with default values from descriptors
-    opt.codec_setup.num_runs = opt.num_runs;
+      case 'p':
+        opt.dump_output_prefix = optarg;
+        break;
+
+      case 'o':
+        opt.output_file = optarg;
+        break;
+
+      case 'd':
+        opt.debug++;
+        break;
 
-    // Parse each parameter string
-    for (const auto& param_str : opt.jpegli_params) {
-      if (!anicet::parameter::parse_parameter_string(
-              "jpegli", param_str, anicet::runner::jpegli::JPEGLI_PARAMETERS,
-              &opt.codec_setup)) {
+      case 'q':
+        opt.debug = 0;
+        break;
+
+      case '?':
+        // getopt_long already printed an error message
         return false;
-      }
-    }
 
-    // Validate parameter dependencies
-    if (!anicet::parameter::validate_parameter_dependencies(
-            "jpegli", anicet::runner::jpegli::JPEGLI_PARAMETERS, opt.codec_setup)) {
-      return false;
+      default:
+        return false;
     }
   }
 
-  // Parse mediacodec parameters if provided (do this BEFORE command validation)
-  if (!opt.mediacodec_params.empty()) {
-    // Initialize codec_setup with default values from descriptors
-    opt.codec_setup.num_runs = opt.num_runs;
+  // Parse codec parameters if provided (do this BEFORE command validation)
+  if (!parse_codec_params(opt)) {
+    return false;
+  }
 
-    // Get parameters with dynamically populated codec list
-    auto mediacodec_params_dynamic =
-        anicet::runner::mediacodec::get_mediacodec_parameters();
+  // Per-codec CPU lists only apply to parallel codec execution
+  if (!opt.experiment_options.codec_cpus.empty() &&
+      !opt.experiment_options.parallel_codecs) {
+    fprintf(stderr, "Warning: --codec-cpus is ignored without --parallel-codecs\n");
+  }
 
-    // Parse each parameter string
-    for (const auto& param_str : opt.mediacodec_params) {
-      if (!anicet::parameter::parse_parameter_string(
-              "mediacodec", param_str, mediacodec_params_dynamic,
-              &opt.codec_setup)) {
-        return false;
-      }
-    }
+  // Thread scaling pins the codecs one after the other
+  if (!opt.experiment_options.thread_counts.empty() &&
+      opt.experiment_options.parallel_codecs) {
+    fprintf(stderr, "--thread-scaling cannot be used with --parallel-codecs\n");
+    return false;
+  }
+  if (opt.experiment_options.per_cluster &&
+      opt.experiment_options.parallel_codecs) {
+    fprintf(stderr, "--per-cluster cannot be used with --parallel-codecs\n");
+    return false;
+  }
+  if (opt.experiment_options.workers > 1 &&
+      (opt.experiment_options.parallel_codecs ||
+       !opt.experiment_options.thread_counts.empty())) {
+    fprintf(stderr,
+            "--workers cannot be used with --parallel-codecs or "
+            "--thread-scaling\n");
+    return false;
+  }
 
-    // Validate parameter dependencies
-    if (!anicet::parameter::validate_parameter_dependencies(
-            "mediacodec", mediacodec_params_dynamic, opt.codec_setup)) {
+  // The runners sample their encode phase once profiling is enabled
+  if (opt.profile_record &&
+      !anicet::profile::enable(opt.profile_frequency_hz)) {
+    return false;
+  }
+
+  // A benchmark suite fixes the run settings of its jobs, and runs them as
+  // a manifest
+  anicet::stats::RunPolicy& run_policy = opt.experiment_options.run_policy;
+  if (!opt.bench_file.empty()) {
+    if (!opt.manifest_file.empty()) {
+      fprintf(stderr, "Cannot specify both --bench and --manifest\n");
       return false;
     }
+    if (!anicet::bench::load_suite(opt.bench_file, opt.bench_corpus,
+                                   &opt.bench_suite)) {
+      return false;
+    }
+    const anicet::bench::Suite& suite = opt.bench_suite;
+    if (!suite.cpus.empty() &&
+        !anicet::cpu::resolve_cpulist(suite.cpus, &opt.cpus)) {
+      return false;
+    }
+    opt.num_runs = suite.num_runs;
+    run_policy.auto_runs = false;
+    run_policy.warmup_runs = suite.warmup_runs;
+    run_policy.cooldown_temp_c = suite.cooldown_temp_c;
+    run_policy.cooldown_ms = suite.cooldown_ms;
+    opt.manifest_file = opt.bench_file;
+  } else if (!opt.bench_baseline.empty() || !opt.bench_corpus.empty() ||
+             !opt.bench_jobs_file.empty()) {
+    fprintf(stderr,
+            "--bench-baseline, --bench-corpus and --bench-jobs need --bench\n");
+    return false;
   }
 
-  // Command is optional if media parameters are provided
+  // Cooldown to a temperature is limited in time
+  if (run_policy.cooldown_temp_c > 0.0 && run_policy.cooldown_ms == 0) {
+    run_policy.cooldown_ms = DEFAULT_COOLDOWN_MS;
+  }
+
+  // Command is optional if media parameters (or a manifest) are provided
   bool has_media_params = !opt.image_file.empty() && opt.width > 0 &&
                           opt.height > 0 && !opt.color_format.empty();
+  if (!opt.manifest_file.empty()) {
+    if (!opt.image_file.empty()) {
+      fprintf(stderr, "Cannot specify both --manifest and --image\n");
+      return false;
+    }
+    has_media_params = true;
+  }
 
   // Collect any remaining non-option arguments as command
   if (opt.debug >= 2) {
@@ -975,7 +1968,7 @@ static bool parse_cli(int argc, char** argv, Options& opt) {
   if (opt.cmd.empty()) {
     // No command provided - check if we have media parameters
     if (!has_media_params) {
-      fprintf(stderr, "Missing -- and command, or --image/--width/--height/--color-format\n");
+      fprintf(stderr, "Missing -- and command, --image/--width/--height/--color-format, or --manifest\n");
       return false;
     }
     return true;
@@ -991,6 +1984,743 @@ static bool parse_cli(int argc, char** argv, Options& opt) {
 }
 
 
+// JSON indentation of the results: 2 for --output-format json, compact
+// lines for jsonl and the --manifest jobs (one line per job)
+static int report_indent(const Options& opt) {
+  return (opt.output_format == anicet::report::ReportFormat::JSON &&
+          opt.manifest_file.empty())
+             ? 2
+             : -1;
+}
+
+// Build the "job" JSON object of a manifest job result
+static nlohmann::ordered_json build_job_json(const Options& opt,
+                                             int job_index) {
+  return {{"index", job_index}, {"manifest", opt.manifest_file}};
+}
+
+// Write the result line of a manifest job that could not run (the error is
+// also printed to stderr). Nothing is written for the --image experiment
+// and for CSV output.
+static void write_job_error(const Options& opt, int job_index,
+                            const char* error, FILE* output_fp) {
+  if (job_index < 0 ||
+      opt.output_format == anicet::report::ReportFormat::CSV) {
+    return;
+  }
+  anicet::report::JsonWriter writer(output_fp, -1);
+  writer.begin_object();
+  writer.member("job", build_job_json(opt, job_index));
+  writer.member("error", error);
+  writer.member("exit_code", 1);
+  writer.end_object();
+  writer.finish();
+}
+
+// Write the CSV header (--output-format csv)
+static void write_csv_header(FILE* output_fp) {
+  fprintf(output_fp,
+          "job,point,codec,params,frame_index,warmup,exit_code,size_bytes,"
+          "encode_time_us,cpu_time_ms,energy_mj,peak_rss_kb,allocs,"
+          "alloc_bytes,max_temp_mc");
+  for (int c = 0; c < anicet::perf::NUM_COUNTERS; c++) {
+    fprintf(output_fp, ",%s", anicet::perf::counter_name(c));
+  }
+  fprintf(output_fp, "\n");
+}
+
+// Write one CSV row per frame of a codec output (job is -1 for the --image
+// experiment, point the sweep/per-codec index). Values a run did not
+// measure are left empty.
+static void write_csv_frames(FILE* output_fp, int job, int point,
+                             const CodecOutput& codec_output, int exit_code) {
+  // Parameters as one "key=value:key=value" field
+  std::string params;
+  for (const auto& [key, value] :
+       get_sorted_params(codec_output.codec_params, codec_output.codec_name)) {
+    params += (params.empty() ? "" : ":") + key + "=" + value;
+  }
+  std::string prefix = (job >= 0 ? std::to_string(job) : std::string()) +
+                       "," + std::to_string(point) + "," +
+                       anicet::report::csv_field(codec_output.codec_name) +
+                       "," + anicet::report::csv_field(params);
+  for (size_t i = 0; i < codec_output.num_frames(); i++) {
+    bool warmup = i < codec_output.warmup_frames.size() &&
+                  codec_output.warmup_frames[i];
+    fprintf(output_fp, "%s,%zu,%d,%d,", prefix.c_str(), i, warmup ? 1 : 0,
+            exit_code);
+    if (i < codec_output.frame_sizes.size()) {
+      fprintf(output_fp, "%zu", codec_output.frame_sizes[i]);
+    }
+    fputc(',', output_fp);
+    if (i < codec_output.timings.size()) {
+      fprintf(output_fp, "%lld",
+              (long long)(codec_output.timings[i].output_timestamp_us -
+                          codec_output.timings[i].input_timestamp_us));
+    }
+    fputc(',', output_fp);
+    if (i < codec_output.profile_encode_cpu_ms.size()) {
+      fprintf(output_fp, "%.6g", codec_output.profile_encode_cpu_ms[i]);
+    }
+    fputc(',', output_fp);
+    if (i < codec_output.frame_energy.size() &&
+        codec_output.frame_energy[i].energy_mj >= 0.0) {
+      fprintf(output_fp, "%.6g", codec_output.frame_energy[i].energy_mj);
+    }
+    fputc(',', output_fp);
+    if (i < codec_output.memory_frame_peaks.size() &&
+        codec_output.memory_frame_peaks[i].rss_kb >= 0) {
+      fprintf(output_fp, "%lld",
+              (long long)codec_output.memory_frame_peaks[i].rss_kb);
+    }
+    fputc(',', output_fp);
+    if (i < codec_output.frame_allocs.size() &&
+        codec_output.frame_allocs[i].valid) {
+      fprintf(output_fp, "%lld,%lld",
+              (long long)codec_output.frame_allocs[i].allocs,
+              (long long)codec_output.frame_allocs[i].bytes);
+    } else {
+      fputc(',', output_fp);
+    }
+    fputc(',', output_fp);
+    if (i < codec_output.thermal_frames.size() &&
+        codec_output.thermal_frames[i].max_temp_mc >= 0) {
+      fprintf(output_fp, "%lld",
+              (long long)codec_output.thermal_frames[i].max_temp_mc);
+    }
+    for (int c = 0; c < anicet::perf::NUM_COUNTERS; c++) {
+      fputc(',', output_fp);
+      if (i < codec_output.perf_counters.size() &&
+          codec_output.perf_counters[i].values[c] >= 0) {
+        fprintf(output_fp, "%lld",
+                (long long)codec_output.perf_counters[i].values[c]);
+      }
+    }
+    fputc('\n', output_fp);
+  }
+}
+
+// Write the "profile" JSON section (--profile-record): the hottest
+// functions of each codec, and with --profile-folded the folded stacks
+// files (point is the sweep/codecs index in the file name, -1 for none)
+static void write_profile_json(anicet::report::JsonWriter& writer,
+                               const Options& opt,
+                               const CodecOutput& codec_output, int point) {
+  using json = nlohmann::ordered_json;
+  if (codec_output.profiles.empty()) {
+    return;
+  }
+  writer.begin_array("profile");
+  for (const anicet::profile::Profile& profile : codec_output.profiles) {
+    json entry = {
+      {"codec", profile.codec},
+      {"frequency_hz", anicet::profile::frequency_hz()},
+      {"samples", profile.samples},
+      {"lost", profile.lost}
+    };
+    if (!opt.profile_folded_prefix.empty()) {
+      std::string path =
+          opt.profile_folded_prefix + ".codec_" + profile.codec;
+      if (point >= 0) {
+        path += ".point_" + std::to_string(point);
+      }
+      path += ".folded";
+      // Only recorded when written
+      if (anicet::profile::write_folded(profile, path)) {
+        entry["folded_file"] = path;
+      }
+    }
+    json functions = json::array();
+    double samples = profile.samples > 0 ? (double)profile.samples : 1.0;
+    for (const anicet::profile::FunctionEntry& function :
+         anicet::profile::top_functions(profile, opt.profile_top)) {
+      functions.push_back({
+        {"function", function.function},
+        {"library", function.library},
+        {"self", function.samples.self},
+        {"self_percent", 100.0 * function.samples.self / samples},
+        {"total", function.samples.total},
+        {"total_percent", 100.0 * function.samples.total / samples}
+      });
+    }
+    entry["functions"] = functions;
+    writer.element(entry);
+  }
+  writer.end_array();
+}
+
+// Run the library mode experiment of opt (the --image when job_index is -1,
+// or a manifest job) and write its result to output_fp. The JSON document
+// is streamed frame by frame rather than built as one tree, so the result
+// size does not grow the process heap (and VmHWM) with the number of runs.
+// image_data is the loaded image (unused with --input-video, the clip is
+// opened here), input_cached tells whether it came from the --manifest
+// input cache. If job_outputs is set, it receives the output of each codec
+// and grid point (--bench).
+// Returns the anicet_experiment() result, or 1 if the clip cannot be opened.
+static int run_library_job(Options& opt,
+                           const anicet::input::InputFile* image_data,
+                           bool input_cached,
+                           const ResourceProfilerOverhead& profiler_overhead,
+                           anicet::output::FileWriter* dump_writer,
+                           int job_index, FILE* output_fp,
+                           std::vector<CodecOutput>* job_outputs = nullptr) {
+  // Open the image as a streamed multi-frame clip, or use the loaded file
+  anicet::input::FrameSource frame_source;
+  const uint8_t* input_buffer = nullptr;
+  size_t input_size = 0;
+  if (opt.input_video) {
+    anicet::color::ColorFormat clip_format;
+    size_t clip_frame_size = 0;
+    if (anicet::color::parse_color_format(opt.color_format.c_str(),
+                                          &clip_format)) {
+      clip_frame_size =
+          anicet::color::frame_size(clip_format, opt.width, opt.height);
+    }
+    if (!frame_source.open(opt.image_file, opt.width, opt.height,
+                           clip_frame_size)) {
+      fprintf(stderr, "Failed to open input video: %s\n", opt.image_file.c_str());
+      write_job_error(opt, job_index, "failed to open input video", output_fp);
+      return 1;
+    }
+    opt.experiment_options.frame_source = &frame_source;
+    input_buffer = frame_source.first_frame();
+    input_size = frame_source.frame_size();
+    if (frame_source.num_frames() < opt.num_runs) {
+      fprintf(stderr,
+              "Warning: input video has %d frames, looping for %d runs\n",
+              frame_source.num_frames(), opt.num_runs);
+    }
+  } else {
+    input_buffer = image_data->data();
+    input_size = image_data->size();
+  }
+  size_t input_file_size =
+      opt.input_video ? frame_source.file_size() : image_data->size();
+
+  // Create output structure to receive encoding results
+  CodecOutput codec_output;
+  // Per-codec/per-grid-point results (used by parameter sweeps and
+  // parallel codec runs)
+  std::vector<CodecOutput> sweep_outputs;
+  bool per_codec_results = job_outputs != nullptr ||
+                           !opt.codec_setup.sweep_map.empty() ||
+                           opt.experiment_options.parallel_codecs ||
+                           !opt.experiment_options.thread_counts.empty() ||
+                           opt.experiment_options.per_cluster ||
+                           opt.experiment_options.workers > 1;
+
+  // Writer for dumped files (shared by the manifest jobs, flushed below)
+  opt.experiment_options.writer = dump_writer;
+  anicet::output::WriterStats dump_start = dump_writer->stats();
+
+  // Call anicet_experiment()
+  int result = anicet_experiment(
+      input_buffer,
+      input_size,
+      opt.height,
+      opt.width,
+      opt.color_format.c_str(),
+      opt.codec.c_str(),
+      opt.num_runs,
+      opt.dump_output,
+      opt.dump_output_dir.c_str(),
+      opt.dump_output_prefix.c_str(),
+      opt.debug,
+      &codec_output,
+      has_codec_params(opt) ? &opt.codec_setup : nullptr,
+      per_codec_results ? &sweep_outputs : nullptr,
+      &opt.experiment_options
+  );
+
+  // Wait for the dumped files (the wait is reported in the JSON)
+  dump_writer->flush();
+
+  // Print simple debug output to stdout if debug level >= 1
+  if (opt.debug >= 1) {
+    printf("input: %s\n", opt.image_file.c_str());
+    printf("width: %d\n", opt.width);
+    printf("height: %d\n", opt.height);
+    printf("color_format: %s\n", opt.color_format.c_str());
+    printf("size_bytes: %zu\n", input_file_size);
+    printf("num_runs: %d\n", opt.num_runs);
+    for (size_t i = 0; i < codec_output.num_frames(); i++) {
+      printf("index: %zu\n", i);
+      if (opt.dump_output && i < codec_output.output_files.size()) {
+        printf("  file: %s\n", codec_output.output_files[i].c_str());
+      }
+      // Use codec name and parameters from CodecOutput
+      printf("  codec: %s\n", codec_output.codec_name.c_str());
+      // Print parameters in custom order for consistency
+      auto sorted_params = get_sorted_params(codec_output.codec_params,
+                                             codec_output.codec_name);
+      for (const auto& [key, value] : sorted_params) {
+        printf("  %s: %s\n", key.c_str(), value.c_str());
+      }
+      if (i < codec_output.frame_sizes.size()) {
+        printf("  size_bytes: %zu\n", codec_output.frame_sizes[i]);
+      }
+      printf("  exit_code: %d\n", result);
+    }
+  }
+
+  // CSV: one row per frame (no input/setup sections)
+  if (opt.output_format == anicet::report::ReportFormat::CSV) {
+    if (!per_codec_results) {
+      write_csv_frames(output_fp, job_index, 0, codec_output, result);
+    }
+    for (size_t p = 0; p < sweep_outputs.size(); p++) {
+      write_csv_frames(output_fp, job_index, (int)p, sweep_outputs[p],
+                       sweep_outputs[p].exit_code);
+    }
+    fflush(output_fp);
+    opt.experiment_options.frame_source = nullptr;
+    if (job_outputs != nullptr) {
+      *job_outputs = std::move(sweep_outputs);
+    }
+    return result;
+  }
+
+  // Stream the JSON document (one frame in memory at a time). The
+  // input/setup sections are small and built as nlohmann::ordered_json
+  // values (insertion order preserved).
+  using json = nlohmann::ordered_json;
+  anicet::report::JsonWriter writer(output_fp, report_indent(opt));
+  writer.begin_object();
+  if (job_index >= 0) {
+    writer.member("job", build_job_json(opt, job_index));
+  }
+
+  // Input section
+  json input = {
+    {"file", opt.image_file},
+    {"width", opt.width},
+    {"height", opt.height},
+    {"color_format", opt.color_format},
+    {"size_bytes", input_file_size}
+  };
+
+  // Input load cost (not included in the encoder resources). For a
+  // streamed clip this is the frame index scan, frame reads happen in the
+  // runners.
+  const ResourceDelta& load_delta =
+      opt.input_video ? frame_source.load_delta() : image_data->load_delta();
+  input["load"] = {
+    {"mode", opt.input_video ? "stream" : anicet::input::input_mode_name(image_data->mode())},
+    {"prefetch", opt.input_video ? "none" : anicet::input::input_prefetch_name(image_data->prefetch())},
+    {"wall_time_ms", load_delta.wall_time_ms},
+    {"cpu_time_ms", load_delta.cpu_time_ms},
+    {"memory_rss_kb", load_delta.vm_rss_delta_kb},
+    {"page_faults", {{"minor", load_delta.minor_faults},
+                     {"major", load_delta.major_faults}}}
+  };
+  if (!opt.manifest_file.empty()) {
+    input["load"]["cached"] = input_cached;
+  }
+  if (opt.input_video) {
+    input["frames"] = {
+      {"format", frame_source.is_y4m() ? "y4m" : "yuv"},
+      {"count", frame_source.num_frames()},
+      {"frame_size_bytes", frame_source.frame_size()},
+      {"ring_size", opt.experiment_options.frame_ring_size}
+    };
+  }
+  writer.member("input", input);
+
+  // Setup section
+  json setup;
+  setup["serial_number"] = opt.serial_number;
+  const anicet::stats::RunPolicy& run_policy =
+      opt.experiment_options.run_policy;
+  if (run_policy.auto_runs) {
+    setup["num_runs"] = "auto";
+    setup["target_ci_percent"] = run_policy.target_ci_percent;
+    setup["max_runs"] = run_policy.max_runs;
+  } else {
+    setup["num_runs"] = opt.num_runs;
+  }
+  setup["warmup_runs"] = run_policy.warmup_runs;
+  // Profiler overhead: per-frame encode_time_us/cpu_time_ms include
+  // frame_wall_us/frame_cpu_us of measurement bias
+  setup["profiler"] = {
+    {"capture_us", profiler_overhead.capture_us},
+    {"capture_lite_us", profiler_overhead.capture_lite_us},
+    {"frame_wall_us", profiler_overhead.frame_wall_us},
+    {"frame_cpu_us", profiler_overhead.frame_cpu_us}
+  };
+  // Add device and other tags to setup section if present
+  for (const auto& kv : opt.tags) {
+    setup[kv.first] = kv.second;
+  }
+
+  // CPU topology (clusters and HWCAP features)
+  anicet::cpu::CpuTopology topology = anicet::cpu::get_topology();
+  setup["cpu_topology"]["clusters"] = json::array();
+  for (const anicet::cpu::CpuCluster& cluster : topology.clusters) {
+    setup["cpu_topology"]["clusters"].push_back(build_cluster_json(cluster));
+  }
+  char hwcap[32];
+  snprintf(hwcap, sizeof(hwcap), "0x%llx", (unsigned long long)topology.hwcap);
+  setup["cpu_topology"]["hwcap"] = hwcap;
+  snprintf(hwcap, sizeof(hwcap), "0x%llx", (unsigned long long)topology.hwcap2);
+  setup["cpu_topology"]["hwcap2"] = hwcap;
+  setup["cpu_topology"]["features"] = topology.features;
+  if (!opt.cpus.empty()) {
+    setup["cpus"] = opt.cpus;
+  }
+  if (opt.experiment_options.per_cluster) {
+    setup["per_cluster"] = true;
+  }
+
+  // Memory sampler interval
+  if (opt.experiment_options.memory_sample_interval_ms > 0) {
+    setup["memory_sample_interval_ms"] =
+        opt.experiment_options.memory_sample_interval_ms;
+  }
+
+  // Allocation tracker
+  if (anicet::alloc::enabled()) {
+    setup["alloc_tracker"] = true;
+  }
+
+  // Sampling profiler
+  if (anicet::profile::enabled()) {
+    setup["profile_frequency_hz"] = anicet::profile::frequency_hz();
+  }
+
+  // Energy sampler interval
+  if (opt.experiment_options.energy_sample_interval_ms > 0) {
+    setup["energy_sample_interval_ms"] =
+        opt.experiment_options.energy_sample_interval_ms;
+  }
+
+  // Thermal sampler and cooldown settings
+  if (opt.experiment_options.thermal_sample_interval_ms > 0) {
+    setup["thermal_sample_interval_ms"] =
+        opt.experiment_options.thermal_sample_interval_ms;
+  }
+  if (!opt.experiment_options.thermal_zones.empty()) {
+    setup["thermal_zones"] = opt.experiment_options.thermal_zones;
+  }
+  if (run_policy.cooldown_temp_c > 0.0) {
+    setup["cooldown_temp_c"] = run_policy.cooldown_temp_c;
+  }
+  if (run_policy.cooldown_ms > 0) {
+    setup["cooldown_ms"] = run_policy.cooldown_ms;
+  }
+
+  // Parallel codec execution settings
+  if (opt.experiment_options.parallel_codecs) {
+    setup["parallel_codecs"] = true;
+    setup["codec_cpus"] = json::object();
+    for (const auto& [name, cpus] : opt.experiment_options.codec_cpus) {
+      setup["codec_cpus"][name] = cpus;
+    }
+  }
+
+  // Thread scaling counts
+  if (!opt.experiment_options.thread_counts.empty()) {
+    setup["thread_scaling"] = opt.experiment_options.thread_counts;
+  }
+
+  // Concurrent workers
+  if (opt.experiment_options.workers > 1) {
+    setup["workers"] = opt.experiment_options.workers;
+  }
+  if (per_codec_results && !opt.codec_setup.sweep_map.empty()) {
+    setup["sweep_points"] = sweep_outputs.size();
+  }
+  writer.member("setup", setup);
+
+  if (!per_codec_results) {
+    // Output section - frames array with codec, params, exit_code and size_bytes per frame
+    write_output_json(writer, codec_output, result, opt.dump_output);
+
+    // Resources section - global and per-frame
+    write_resources_json(writer, codec_output);
+
+    // Profile section (--profile-record)
+    write_profile_json(writer, opt, codec_output, -1);
+  } else {
+    // Sweep (or per-codec) section - one output/resources block per grid
+    // point and codec
+    writer.begin_array(opt.codec_setup.sweep_map.empty() ? "codecs"
+                                                         : "sweep");
+    for (size_t p = 0; p < sweep_outputs.size(); p++) {
+      const CodecOutput& point = sweep_outputs[p];
+      writer.begin_object();
+      writer.member("index", p);
+      writer.member("codec", point.codec_name);
+      json params = json::object();
+      auto sorted_params = get_sorted_params(point.codec_params, point.codec_name);
+      for (const auto& [key, value] : sorted_params) {
+        params[key] = value;
+      }
+      writer.member("params", params);
+      // A failed grid point has no frames (the error went to stderr)
+      writer.member("exit_code", point.exit_code);
+      if (!point.cluster.name.empty()) {
+        writer.member("cluster", build_cluster_json(point.cluster));
+      }
+      if (point.thread_scaling.threads > 0) {
+        const ThreadScalingPoint& scaling = point.thread_scaling;
+        writer.member("thread_scaling", {
+          {"threads", scaling.threads},
+          {"cpus", scaling.cpus},
+          {"median_encode_time_us", scaling.median_encode_time_us},
+          {"speedup", scaling.speedup},
+          {"efficiency", scaling.efficiency},
+          {"cpu_utilization_percent", scaling.cpu_utilization_percent}
+        });
+      }
+      if (point.worker_run.workers > 0) {
+        writer.member("workers", build_worker_run_json(point.worker_run));
+      }
+      write_output_json(writer, point, point.exit_code, opt.dump_output);
+      write_resources_json(writer, point);
+      write_profile_json(writer, opt, point, (int)p);
+      writer.end_object();
+    }
+    writer.end_array();
+  }
+
+  // Output file writer statistics (of this experiment)
+  if (opt.dump_output) {
+    anicet::output::WriterStats dump_stats = dump_writer->stats();
+    writer.member("dump", {
+      {"writer", anicet::output::writer_mode_name(dump_writer->mode())},
+      {"io", anicet::output::writer_io_name(dump_writer->io())},
+      {"files", dump_stats.files - dump_start.files},
+      {"bytes", dump_stats.bytes - dump_start.bytes},
+      {"errors", dump_stats.errors - dump_start.errors},
+      {"write_time_ms", dump_stats.write_time_ms - dump_start.write_time_ms},
+      {"flush_time_ms", dump_stats.flush_time_ms - dump_start.flush_time_ms}
+    });
+  }
+  if (job_index >= 0) {
+    writer.member("exit_code", result);
+  }
+  writer.end_object();
+  writer.finish();
+
+  opt.experiment_options.frame_source = nullptr;
+  if (job_outputs != nullptr) {
+    *job_outputs = std::move(sweep_outputs);
+  }
+  return result;
+}
+
+// Get the options of a manifest job: the CLI options with the job's fields
+// on top (its codec parameters are parsed after the CLI ones)
+// Returns true on success, false on error (with error message printed)
+static bool apply_manifest_job(const Options& opt,
+                               const anicet::manifest::ManifestJob& job,
+                               size_t index, Options* job_opt) {
+  *job_opt = opt;
+  job_opt->image_file = job.image;
+  if (job.width > 0) job_opt->width = job.width;
+  if (job.height > 0) job_opt->height = job.height;
+  if (!job.color_format.empty()) job_opt->color_format = job.color_format;
+  if (job_opt->width <= 0 || job_opt->height <= 0 ||
+      job_opt->color_format.empty()) {
+    fprintf(stderr, "manifest: Job %zu needs width, height and color_format\n",
+            index);
+    return false;
+  }
+  if (!job.codec.empty()) {
+    if (!validate_codec_list(job.codec)) {
+      return false;
+    }
+    job_opt->codec = job.codec;
+  }
+  anicet::stats::RunPolicy& run_policy =
+      job_opt->experiment_options.run_policy;
+  if (job.auto_runs) {
+    run_policy.auto_runs = true;
+    job_opt->num_runs = run_policy.batch_runs;
+  } else if (job.num_runs > 0) {
+    run_policy.auto_runs = false;
+    job_opt->num_runs = job.num_runs;
+  }
+  job_opt->tags.insert(job_opt->tags.end(), job.tags.begin(), job.tags.end());
+
+  // Codec parameters ("params": "..." is for the job's single codec)
+  for (const auto& [name, params] : job.params) {
+    std::string codec = name.empty() ? job_opt->codec : name;
+    std::vector<std::string>* param_strings =
+        get_codec_param_strings(*job_opt, codec);
+    if (param_strings == nullptr) {
+      fprintf(stderr, "manifest: Job %zu: Invalid params codec: %s\n", index,
+              codec.c_str());
+      return false;
+    }
+    param_strings->push_back(params);
+  }
+  job_opt->codec_setup = CodecSetup();
+  if (!parse_codec_params(*job_opt)) {
+    return false;
+  }
+
+  // Keep the dumped files of jobs with the same codec parameters apart
+  job_opt->dump_output_prefix += ".job" + std::to_string(index);
+  if (!job_opt->profile_folded_prefix.empty()) {
+    job_opt->profile_folded_prefix += ".job" + std::to_string(index);
+  }
+  return true;
+}
+
+// Key of a --bench result: the input file name and size, the codec and its
+// sorted parameters (e.g. "gradient_640x480.yuv:640x480:webp:quality=75")
+static std::string bench_key(const Options& job_opt,
+                             const CodecOutput& output) {
+  std::string file = job_opt.image_file;
+  size_t slash = file.rfind('/');
+  if (slash != std::string::npos) {
+    file = file.substr(slash + 1);
+  }
+  std::string key = file + ":" + std::to_string(job_opt.width) + "x" +
+                    std::to_string(job_opt.height) + ":" + output.codec_name;
+  const char* separator = ":";
+  for (const auto& [name, value] :
+       get_sorted_params(output.codec_params, output.codec_name)) {
+    key += separator + name + "=" + value;
+    separator = ",";
+  }
+  return key;
+}
+
+// Run the --manifest jobs one after the other in this process. The result
+// of each job is written as one JSON line (or its CSV rows) and flushed as
+// soon as it is done, so a crash
+// keeps the results of the completed jobs. Jobs that share an image load it
+// once (through an LRU cache of --input-cache files). A job that cannot run
+// gets a line with an "error". If bench_results is set, it receives the
+// --bench result of each codec and grid point.
+// Returns 0 if every job succeeded, 1 otherwise.
+static int run_manifest_jobs(
+    const Options& opt, const std::vector<anicet::manifest::ManifestJob>& jobs,
+    const ResourceProfilerOverhead& profiler_overhead,
+    anicet::output::FileWriter* dump_writer, FILE* output_fp,
+    std::vector<anicet::bench::Result>* bench_results = nullptr) {
+  anicet::input::InputCache input_cache(opt.input_cache_size, opt.input_mode,
+                                        opt.input_prefetch);
+  int status = 0;
+  for (size_t i = 0; i < jobs.size(); i++) {
+    Options job_opt;
+    int result = 1;
+    std::vector<CodecOutput> job_outputs;
+    std::vector<CodecOutput>* outputs =
+        bench_results != nullptr ? &job_outputs : nullptr;
+    if (!apply_manifest_job(opt, jobs[i], i, &job_opt)) {
+      write_job_error(opt, (int)i, "invalid job", output_fp);
+    } else if (job_opt.input_video) {
+      result = run_library_job(job_opt, nullptr, false, profiler_overhead,
+                               dump_writer, (int)i, output_fp, outputs);
+    } else {
+      bool cached = false;
+      std::shared_ptr<const anicet::input::InputFile> image =
+          input_cache.get(job_opt.image_file, &cached);
+      if (image == nullptr) {
+        write_job_error(opt, (int)i, "failed to read image file", output_fp);
+      } else {
+        result = run_library_job(job_opt, image.get(), cached,
+                                 profiler_overhead, dump_writer, (int)i,
+                                 output_fp, outputs);
+      }
+    }
+    if (result != 0) {
+      status = 1;
+    }
+    // Successful codecs only: the failed ones are missing from the report
+    for (const CodecOutput& output : job_outputs) {
+      if (output.exit_code != 0) continue;
+      bench_results->push_back(anicet::bench::make_result(
+          bench_key(job_opt, output), output, job_opt.width, job_opt.height));
+    }
+  }
+
+  if (opt.debug >= 1) {
+    fprintf(stderr,
+            "manifest: %zu jobs, input cache: %d hits, %d misses, %d "
+            "evictions\n",
+            jobs.size(), input_cache.hits(), input_cache.misses(),
+            input_cache.evictions());
+  }
+  return status;
+}
+
+// Run the --bench suite: its jobs as a manifest (the job lines go to
+// --bench-jobs), then write the report, compared with --bench-baseline when
+// set, to report_fp. Regressions are also printed to stderr.
+// Returns 0 on success, 1 if a job failed, 2 if the baseline cannot be used,
+// 3 on regressions.
+static int run_bench(const Options& opt,
+                     const ResourceProfilerOverhead& profiler_overhead,
+                     anicet::output::FileWriter* dump_writer,
+                     FILE* report_fp) {
+  const anicet::bench::Suite& suite = opt.bench_suite;
+  anicet::bench::Report baseline;
+  if (!opt.bench_baseline.empty()) {
+    if (!anicet::bench::load_report(opt.bench_baseline, &baseline)) {
+      return 2;
+    }
+    if (baseline.suite != suite.name || baseline.version != suite.version) {
+      fprintf(stderr,
+              "bench: Baseline %s is for suite %s version %d, not %s "
+              "version %d\n",
+              opt.bench_baseline.c_str(), baseline.suite.c_str(),
+              baseline.version, suite.name.c_str(), suite.version);
+      return 2;
+    }
+  }
+
+  const char* jobs_file =
+      opt.bench_jobs_file.empty() ? "/dev/null" : opt.bench_jobs_file.c_str();
+  FILE* jobs_fp = fopen(jobs_file, "w");
+  if (!jobs_fp) {
+    fprintf(stderr, "Failed to open output file: %s\n", jobs_file);
+    return 2;
+  }
+  if (opt.output_format == anicet::report::ReportFormat::CSV) {
+    write_csv_header(jobs_fp);
+  }
+  anicet::bench::Report report;
+  report.suite = suite.name;
+  report.version = suite.version;
+  report.anicet_version = ANICET_VERSION;
+  report.device = opt.serial_number;
+  int status = run_manifest_jobs(opt, suite.jobs, profiler_overhead,
+                                 dump_writer, jobs_fp, &report.results);
+  fclose(jobs_fp);
+
+  std::vector<anicet::bench::Comparison> comparisons;
+  std::vector<std::string> missing;
+  int regressions = 0;
+  if (!opt.bench_baseline.empty()) {
+    regressions = anicet::bench::compare(baseline, report,
+                                         suite.thresholds, &comparisons,
+                                         &missing);
+  }
+  anicet::bench::write_report(report_fp, report, opt.bench_baseline,
+                              comparisons, missing, regressions);
+
+  for (const anicet::bench::Comparison& comparison : comparisons) {
+    if (comparison.verdict == anicet::bench::Verdict::REGRESSED) {
+      fprintf(stderr, "bench: Regression: %s %s: %.6g -> %.6g (%+.1f%%)\n",
+              comparison.key.c_str(), comparison.metric.c_str(),
+              comparison.baseline, comparison.current,
+              comparison.change_percent);
+    }
+  }
+  for (const std::string& key : missing) {
+    fprintf(stderr, "bench: Missing result: %s\n", key.c_str());
+  }
+  if (regressions > 0) {
+    return 3;
+  }
+  return missing.empty() ? status : 1;
+}
+
 // global for signal forwarding
 static pid_t g_child = -1;
 static void relay_signal(int sig) {
@@ -1025,9 +2755,32 @@ int main(int argc, char** argv) {
 
   int64_t t0_us = anicet_get_timestamp();
 
-  // Check if we're in library API mode (media parameters provided)
-  bool library_mode = !opt.image_file.empty() && opt.width > 0 &&
-                      opt.height > 0 && !opt.color_format.empty();
+  // Check if we're in library API mode (media parameters or a manifest
+  // provided)
+  bool library_mode = (!opt.image_file.empty() && opt.width > 0 &&
+                       opt.height > 0 && !opt.color_format.empty()) ||
+                      !opt.manifest_file.empty();
+
+  // Library mode reads the counters in-process, per encode call, instead of
+  // re-executing itself under simpleperf stat
+  if (library_mode && opt.use_simpleperf) {
+    if (!opt.simpleperf_events.empty()) {
+      fprintf(stderr,
+              "Warning: --simpleperf-events is ignored in library mode "
+              "(using in-process counters)\n");
+    }
+    opt.use_simpleperf = false;
+    opt.experiment_options.perf_counters = true;
+  }
+  if (library_mode && opt.sched_sample_interval_ms > 0) {
+    fprintf(stderr,
+            "Warning: --sched-sampler is ignored in library mode (it samples "
+            "the wrapped command)\n");
+  }
+  if (!library_mode && opt.profile_record) {
+    fprintf(stderr,
+            "Warning: --profile-record is ignored outside library mode\n");
+  }
 
   // Create temp file for simpleperf output if needed
   std::string simpleperf_out_path;
@@ -1046,7 +2799,7 @@ int main(int argc, char** argv) {
   if (library_mode && !opt.use_simpleperf) {
     // Apply affinity and nice settings
     if (!opt.cpus.empty()) {
-      set_affinity_from_cpulist(opt.cpus);
+      anicet::cpu::set_affinity_from_cpulist(opt.cpus);
     }
     if (opt.nice != 0) {
       set_nice(opt.nice);
@@ -1062,61 +2815,33 @@ int main(int argc, char** argv) {
       opt.dump_output_prefix = "anicet.output";
     }
 
-    // Read image file
-    std::string image_data;
-    if (!read_file(opt.image_file, image_data)) {
-      fprintf(stderr, "Failed to read image file: %s\n", opt.image_file.c_str());
-      return 1;
-    }
-
-    // Create output structure to receive encoding results
-    CodecOutput codec_output;
-
-    // Call anicet_experiment()
-    int result = anicet_experiment(
-        reinterpret_cast<const uint8_t*>(image_data.data()),
-        image_data.size(),
-        opt.height,
-        opt.width,
-        opt.color_format.c_str(),
-        opt.codec.c_str(),
-        opt.num_runs,
-        opt.dump_output,
-        opt.dump_output_dir.c_str(),
-        opt.dump_output_prefix.c_str(),
-        opt.debug,
-        &codec_output,
-        (!opt.x265_params.empty() || !opt.webp_params.empty() || !opt.libjpegturbo_params.empty() || !opt.svtav1_params.empty() || !opt.jpegli_params.empty() || !opt.mediacodec_params.empty()) ? &opt.codec_setup : nullptr
-    );
-
-    // Print simple debug output to stdout if debug level >= 1
-    if (opt.debug >= 1) {
-      printf("input: %s\n", opt.image_file.c_str());
-      printf("width: %d\n", opt.width);
-      printf("height: %d\n", opt.height);
-      printf("color_format: %s\n", opt.color_format.c_str());
-      printf("size_bytes: %zu\n", image_data.size());
-      printf("num_runs: %d\n", opt.num_runs);
-      for (size_t i = 0; i < codec_output.num_frames(); i++) {
-        printf("index: %zu\n", i);
-        if (opt.dump_output && i < codec_output.output_files.size()) {
-          printf("  file: %s\n", codec_output.output_files[i].c_str());
-        }
-        // Use codec name and parameters from CodecOutput
-        printf("  codec: %s\n", codec_output.codec_name.c_str());
-        // Print parameters in custom order for consistency
-        auto sorted_params = get_sorted_params(codec_output.codec_params,
-                                               codec_output.codec_name);
-        for (const auto& [key, value] : sorted_params) {
-          printf("  %s: %s\n", key.c_str(), value.c_str());
-        }
-        if (i < codec_output.frame_sizes.size()) {
-          printf("  size_bytes: %zu\n", codec_output.frame_sizes[i]);
-        }
-        printf("  exit_code: %d\n", result);
+    // Load the manifest, or the image file (mmap by default, load cost
+    // measured separately). A multi-frame clip is opened by
+    // run_library_job(). A --bench suite is loaded by parse_cli(), as it
+    // sets CLI options.
+    std::vector<anicet::manifest::ManifestJob> jobs;
+    anicet::input::InputFile image_data;
+    if (!opt.manifest_file.empty() && opt.bench_file.empty()) {
+      if (!anicet::manifest::load_manifest(opt.manifest_file, &jobs)) {
+        return 2;
+      }
+    } else if (!opt.input_video) {
+      if (!image_data.open(opt.image_file, opt.input_mode, opt.input_prefetch)) {
+        fprintf(stderr, "Failed to read image file: %s\n", opt.image_file.c_str());
+        return 1;
       }
     }
 
+    // Writer for dumped files (runs in the background by default, flushed
+    // after each experiment)
+    anicet::output::FileWriter dump_writer(opt.dump_writer, opt.dump_io);
+
+    // Measure the cost of the resource snapshots (reported so that short
+    // per-frame times can be corrected)
+    ResourceProfilerOverhead profiler_overhead;
+    calibrate_resource_profiler(PROFILER_CALIBRATION_ITERATIONS,
+                                &profiler_overhead);
+
     // Determine output file - default to stdout ("-")
     FILE* output_fp = stdout;
     bool close_output = false;
@@ -1131,115 +2856,30 @@ int main(int argc, char** argv) {
       }
     }
 
-    // Build JSON output using nlohmann::json
-    // Use ordered_json to preserve insertion order (input, setup, output, resources)
-    using json = nlohmann::ordered_json;
-    json output_json;
-
-    // Input section
-    output_json["input"] = {
-      {"file", opt.image_file},
-      {"width", opt.width},
-      {"height", opt.height},
-      {"color_format", opt.color_format},
-      {"size_bytes", image_data.size()}
-    };
-
-    // Setup section
-    output_json["setup"]["serial_number"] = opt.serial_number;
-    output_json["setup"]["num_runs"] = opt.num_runs;
-    // Add device and other tags to setup section if present
-    for (const auto& kv : opt.tags) {
-      output_json["setup"][kv.first] = kv.second;
+    if (opt.output_format == anicet::report::ReportFormat::CSV &&
+        opt.bench_file.empty()) {
+      write_csv_header(output_fp);
     }
-
-    // Output section - frames array with codec, params, exit_code and size_bytes per frame
-    output_json["output"]["frames"] = json::array();
-    for (size_t i = 0; i < codec_output.num_frames(); i++) {
-      json output_frame;
-      if (opt.dump_output && i < codec_output.output_files.size()) {
-        output_frame["file"] = codec_output.output_files[i];
-      }
-
-      // Use codec name and parameters from CodecOutput
-      output_frame["codec"] = codec_output.codec_name;
-      // Add parameters to frame in custom order
-      auto sorted_params = get_sorted_params(codec_output.codec_params,
-                                             codec_output.codec_name);
-      for (const auto& [key, value] : sorted_params) {
-        output_frame[key] = value;
-      }
-
-      output_frame["exit_code"] = result;
-      if (i < codec_output.frame_sizes.size()) {
-        output_frame["size_bytes"] = codec_output.frame_sizes[i];
-      }
-      output_json["output"]["frames"].push_back(output_frame);
-    }
-
-    // Resources section - global
-    // Use resource_delta for detailed metrics
-    const ResourceDelta& delta = codec_output.resource_delta;
-    output_json["resources"]["global"]["wall_time_ms"] = delta.wall_time_ms;
-
-    // CPU time breakdown
-    output_json["resources"]["global"]["cpu_time"]["total_ms"] = delta.cpu_time_ms;
-    output_json["resources"]["global"]["cpu_time"]["user_time_ms"] = delta.user_time_ms;
-    output_json["resources"]["global"]["cpu_time"]["system_time_ms"] = delta.system_time_ms;
-
-    // CPU utilization percentage
-    if (delta.wall_time_ms > 0) {
-      output_json["resources"]["global"]["cpu_time"]["utilization_percent"] =
-        (delta.cpu_time_ms / delta.wall_time_ms * 100.0);
-    }
-
-    // Memory statistics
-    output_json["resources"]["global"]["memory_rss_kb"] = delta.vm_rss_delta_kb;
-    output_json["resources"]["global"]["memory_vss_kb"] = delta.vm_size_delta_kb;
-
-    // Page faults
-    output_json["resources"]["global"]["page_faults"]["minor"] = delta.minor_faults;
-    output_json["resources"]["global"]["page_faults"]["major"] = delta.major_faults;
-
-    // Context switches
-    output_json["resources"]["global"]["context_switches"]["voluntary"] = delta.vol_ctx_switches;
-    output_json["resources"]["global"]["context_switches"]["involuntary"] = delta.invol_ctx_switches;
-
-    // Frames array
-    output_json["resources"]["frames"] = json::array();
-    for (size_t i = 0; i < codec_output.num_frames(); i++) {
-      json frame;
-      frame["frame_index"] = i;
-
-      // Frame size
-      if (i < codec_output.frame_sizes.size()) {
-        frame["size_bytes"] = codec_output.frame_sizes[i];
-      }
-
-      // Frame timing
-      if (i < codec_output.timings.size()) {
-        frame["input_timestamp_us"] = codec_output.timings[i].input_timestamp_us;
-        frame["output_timestamp_us"] = codec_output.timings[i].output_timestamp_us;
-        int64_t encode_time_us = codec_output.timings[i].output_timestamp_us -
-                                 codec_output.timings[i].input_timestamp_us;
-        frame["encode_time_us"] = encode_time_us;
-      }
-
-      // CPU time for this frame
-      if (i < codec_output.profile_encode_cpu_ms.size()) {
-        frame["cpu_time_ms"] = codec_output.profile_encode_cpu_ms[i];
-      }
-
-      output_json["resources"]["frames"].push_back(frame);
+    int result = 0;
+    if (!opt.bench_file.empty()) {
+      // The report (the job lines go to --bench-jobs)
+      result = run_bench(opt, profiler_overhead, &dump_writer, output_fp);
+    } else if (!opt.manifest_file.empty()) {
+      // One JSON line per job
+      result = run_manifest_jobs(opt, jobs, profiler_overhead, &dump_writer,
+                                 output_fp);
+    } else {
+      result = run_library_job(opt, &image_data, false, profiler_overhead,
+                               &dump_writer, -1, output_fp);
     }
 
-    // Output JSON to file with pretty printing (2-space indent)
-    fprintf(output_fp, "%s\n", output_json.dump(2).c_str());
-
     if (close_output) {
       fclose(output_fp);
     }
 
+    // Release the warm codec pool (--mediacodec pool=1)
+    android_mediacodec_pool_clear(android_mediacodec_get_debug_level());
+
     // Flush pending binder commands to ensure clean shutdown
     // This ensures all MediaCodec cleanup commands are sent to the media server
     // before the process exits, reducing the chance of leaving the media server
@@ -1263,7 +2903,7 @@ int main(int argc, char** argv) {
   if (pid == 0) {
     // Child: apply affinity and nice, then exec
     if (!opt.cpus.empty()) {
-      set_affinity_from_cpulist(opt.cpus);
+      anicet::cpu::set_affinity_from_cpulist(opt.cpus);
     }
     if (opt.nice != 0) {
       set_nice(opt.nice);
@@ -1285,25 +2925,9 @@ int main(int argc, char** argv) {
       cmd_vec.push_back(simpleperf_out_path);
       cmd_vec.push_back("--");
 
-      if (library_mode) {
-        // Re-exec ourselves with --no-simpleperf and media parameters
-        cmd_vec.push_back(argv[0]);
-        cmd_vec.push_back("--no-simpleperf");
-        cmd_vec.push_back("--image");
-        cmd_vec.push_back(opt.image_file);
-        cmd_vec.push_back("--width");
-        cmd_vec.push_back(std::to_string(opt.width));
-        cmd_vec.push_back("--height");
-        cmd_vec.push_back(std::to_string(opt.height));
-        cmd_vec.push_back("--color-format");
-        cmd_vec.push_back(opt.color_format);
-        cmd_vec.push_back("--codec");
-        cmd_vec.push_back(opt.codec);
-      } else {
-        // Wrap original command
-        for (const auto& s : opt.cmd) {
-          cmd_vec.push_back(s);
-        }
+      // Wrap original command (library mode reads its counters in-process)
+      for (const auto& s : opt.cmd) {
+        cmd_vec.push_back(s);
       }
     } else {
       // No simpleperf wrapping
@@ -1323,6 +2947,13 @@ int main(int argc, char** argv) {
 
   g_child = pid;
 
+  // Per-thread sampler (--sched-sampler), stopped once the child has exited
+  std::unique_ptr<anicet::sched::TaskSampler> sched_sampler;
+  if (opt.sched_sample_interval_ms > 0) {
+    sched_sampler = std::make_unique<anicet::sched::TaskSampler>(
+        pid, opt.sched_sample_interval_ms);
+  }
+
   // Optional timeout
   bool timed_out = false;
 #ifdef __linux__
@@ -1356,6 +2987,11 @@ int main(int argc, char** argv) {
     break;
   }
 
+  // Last thread sample while the child still exists
+  if (sched_sampler) {
+    sched_sampler->finish();
+  }
+
   // Read VmHWM from /proc/<pid>/status while child still exists
   long vmhwm_kb = -1;
   {
@@ -1435,6 +3071,13 @@ int main(int argc, char** argv) {
     for (const auto& metric : simpleperf_metrics) {
       emit_ki(metric.first.c_str(), metric.second);
     }
+    // Per-thread sampler (--sched-sampler)
+    if (sched_sampler) {
+      nlohmann::ordered_json sched = build_sched_json(*sched_sampler, t0_us);
+      for (const auto& [key, value] : sched.items()) {
+        printf(",\"%s\":%s", key.c_str(), value.dump().c_str());
+      }
+    }
     printf("}\n");
   } else {
     // CSV header is not printed; print one row with tags then metrics as
@@ -1454,6 +3097,10 @@ int main(int argc, char** argv) {
     for (const auto& metric : simpleperf_metrics) {
       printf(",%s=%ld", metric.first.c_str(), metric.second);
     }
+    // Per-thread sampler totals (--sched-sampler)
+    if (sched_sampler) {
+      print_sched_csv(*sched_sampler);
+    }
     printf("\n");
   }
 
@@ -0,0 +1,407 @@
+// anicet_alloc.cc
+// Heap allocation tracking implementation
+//
+// With ANICET_ALLOC_HOOKS the executable defines malloc, free and the other
+// allocation entry points, which forward to the libc allocator (found with
+// dlsym(RTLD_NEXT)). They preempt the libc definitions in the dynamic symbol
+// table, so the dlopen'ed codec libraries and libc++ (operator new) call
+// them as well.
+// Until enable() each hook costs one extra call and a relaxed load.
+
+#include "anicet_alloc.h"
+
+#include <dlfcn.h>
+#include <errno.h>
+#include <stddef.h>
+#include <sched.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+
+namespace anicet {
+namespace alloc {
+
+void add_alloc_stats(AllocStats* total, const AllocStats& src) {
+  if (!src.valid) {
+    return;
+  }
+  total->valid = true;
+  total->allocs += src.allocs;
+  total->bytes += src.bytes;
+  total->frees += src.frees;
+  total->mmaps += src.mmaps;
+  total->mmap_bytes += src.mmap_bytes;
+  total->peak_live_bytes =
+      std::max(total->peak_live_bytes, src.peak_live_bytes);
+}
+
+// Process-wide counters (each on its own cache line, they are updated from
+// every allocating thread)
+struct alignas(64) Counter {
+  std::atomic<int64_t> value{0};
+};
+
+static std::atomic<bool> g_enabled{false};
+static Counter g_allocs;
+static Counter g_bytes;
+static Counter g_frees;
+static Counter g_mmaps;
+static Counter g_mmap_bytes;
+static Counter g_live_bytes;
+static Counter g_peaks[NUM_PEAK_SLOTS];
+
+// Helper: raise a peak to value
+static inline void raise_peak(std::atomic<int64_t>* peak, int64_t value) {
+  int64_t current = peak->load(std::memory_order_relaxed);
+  while (value > current &&
+         !peak->compare_exchange_weak(current, value,
+                                      std::memory_order_relaxed)) {
+  }
+}
+
+// Helper: count an allocation of size bytes (usable bytes in the heap)
+static inline void record_alloc(size_t size, size_t usable) {
+  g_allocs.value.fetch_add(1, std::memory_order_relaxed);
+  g_bytes.value.fetch_add((int64_t)size, std::memory_order_relaxed);
+  int64_t live =
+      g_live_bytes.value.fetch_add((int64_t)usable,
+                                   std::memory_order_relaxed) +
+      (int64_t)usable;
+  for (Counter& peak : g_peaks) {
+    raise_peak(&peak.value, live);
+  }
+}
+
+// Helper: count a free of usable bytes
+static inline void record_free(size_t usable) {
+  g_frees.value.fetch_add(1, std::memory_order_relaxed);
+  g_live_bytes.value.fetch_sub((int64_t)usable, std::memory_order_relaxed);
+}
+
+#ifdef ANICET_ALLOC_HOOKS
+
+// libc allocator (posix_memalign, memalign, aligned_alloc and mmap may be
+// missing, e.g. aligned_alloc before Android API 28)
+struct RealFunctions {
+  void* (*malloc)(size_t);
+  void (*free)(void*);
+  void* (*calloc)(size_t, size_t);
+  void* (*realloc)(void*, size_t);
+  int (*posix_memalign)(void**, size_t, size_t);
+  void* (*memalign)(size_t, size_t);
+  void* (*aligned_alloc)(size_t, size_t);
+  size_t (*malloc_usable_size)(void*);
+  void* (*mmap)(void*, size_t, int, int, int, off_t);
+};
+static RealFunctions g_real;
+// 0: not resolved, 1: resolving, 2: resolved, 3: failed
+static std::atomic<int> g_resolve_state{0};
+// Thread resolving (state 1): its allocations from inside dlsym() take the
+// bootstrap heap, the other threads wait for the result
+static std::atomic<pid_t> g_resolve_tid{0};
+
+// Bootstrap heap for the allocations made while dlsym() resolves the libc
+// allocator, or for all of them if it is missing (never freed). Each block
+// starts with its size.
+static constexpr size_t BOOTSTRAP_SIZE = 16384;
+static constexpr size_t BOOTSTRAP_HEADER = 16;
+alignas(16) static char g_bootstrap[BOOTSTRAP_SIZE];
+static std::atomic<size_t> g_bootstrap_used{0};
+
+static void* bootstrap_alloc(size_t size) {
+  size_t block = (BOOTSTRAP_HEADER + size + 15) & ~(size_t)15;
+  size_t offset = g_bootstrap_used.fetch_add(block);
+  if (offset + block > BOOTSTRAP_SIZE) {
+    return nullptr;
+  }
+  memcpy(g_bootstrap + offset, &size, sizeof(size));
+  return g_bootstrap + offset + BOOTSTRAP_HEADER;
+}
+
+static inline bool is_bootstrap(const void* ptr) {
+  return ptr >= (const void*)g_bootstrap &&
+         ptr < (const void*)(g_bootstrap + BOOTSTRAP_SIZE);
+}
+
+// Helper: resolve the libc allocator. Returns false while this thread is
+// resolving it (allocations from dlsym()) or if it is missing. Other
+// threads wait for the resolution to finish.
+static bool resolve_real() {
+  int state = g_resolve_state.load(std::memory_order_acquire);
+  if (state == 2) {
+    return true;
+  }
+  // syscall(), as gettid() and thread_local may allocate
+  pid_t tid = (pid_t)syscall(SYS_gettid);
+  while (state != 2 && state != 3) {
+    if (state == 0 &&
+        g_resolve_state.compare_exchange_weak(state, 1,
+                                              std::memory_order_acq_rel)) {
+      break;
+    }
+    if (state == 1) {
+      if (g_resolve_tid.load(std::memory_order_acquire) == tid) {
+        return false;
+      }
+      sched_yield();
+      state = g_resolve_state.load(std::memory_order_acquire);
+    }
+  }
+  if (state == 2 || state == 3) {
+    return state == 2;
+  }
+  g_resolve_tid.store(tid, std::memory_order_release);
+  RealFunctions real;
+  real.malloc = (decltype(real.malloc))dlsym(RTLD_NEXT, "malloc");
+  real.free = (decltype(real.free))dlsym(RTLD_NEXT, "free");
+  real.calloc = (decltype(real.calloc))dlsym(RTLD_NEXT, "calloc");
+  real.realloc = (decltype(real.realloc))dlsym(RTLD_NEXT, "realloc");
+  real.posix_memalign =
+      (decltype(real.posix_memalign))dlsym(RTLD_NEXT, "posix_memalign");
+  real.memalign = (decltype(real.memalign))dlsym(RTLD_NEXT, "memalign");
+  real.aligned_alloc =
+      (decltype(real.aligned_alloc))dlsym(RTLD_NEXT, "aligned_alloc");
+  real.malloc_usable_size = (decltype(real.malloc_usable_size))dlsym(
+      RTLD_NEXT, "malloc_usable_size");
+  real.mmap = (decltype(real.mmap))dlsym(RTLD_NEXT, "mmap");
+  bool ok = real.malloc && real.free && real.calloc && real.realloc &&
+            real.malloc_usable_size;
+  if (ok) {
+    g_real = real;
+  }
+  g_resolve_tid.store(0, std::memory_order_relaxed);
+  g_resolve_state.store(ok ? 2 : 3, std::memory_order_release);
+  return ok;
+}
+
+// Helper: aligned allocation with the libc functions found
+static void* real_aligned(size_t alignment, size_t size) {
+  if (g_real.aligned_alloc) {
+    return g_real.aligned_alloc(alignment, size);
+  }
+  if (g_real.posix_memalign) {
+    // posix_memalign() also needs a multiple of sizeof(void*)
+    void* ptr = nullptr;
+    alignment = std::max(alignment, sizeof(void*));
+    return g_real.posix_memalign(&ptr, alignment, size) == 0 ? ptr : nullptr;
+  }
+  if (g_real.memalign) {
+    return g_real.memalign(alignment, size);
+  }
+  errno = ENOMEM;
+  return nullptr;
+}
+
+// Helper: mmap system call (libc mmap not found)
+static void* real_mmap(void* addr, size_t length, int prot, int flags, int fd,
+                       off_t offset) {
+#ifdef SYS_mmap2
+  // 32-bit: the offset is in 4096-byte units
+  return (void*)syscall(SYS_mmap2, addr, length, prot, flags, fd,
+                        (long)(offset >> 12));
+#else
+  return (void*)syscall(SYS_mmap, addr, length, prot, flags, fd, offset);
+#endif
+}
+
+// Helper: count an allocation returned by the libc allocator
+static inline void* track_alloc(void* ptr, size_t size) {
+  if (ptr != nullptr && g_enabled.load(std::memory_order_relaxed)) {
+    record_alloc(size, g_real.malloc_usable_size(ptr));
+  }
+  return ptr;
+}
+
+bool available() { return resolve_real(); }
+
+#else  // !ANICET_ALLOC_HOOKS
+
+bool available() { return false; }
+
+#endif  // ANICET_ALLOC_HOOKS
+
+bool enable() {
+  if (!available()) {
+    fprintf(stderr,
+            "Allocation tracking is not available (built without "
+            "ANICET_ALLOC_HOOKS, or the libc allocator was not found)\n");
+    return false;
+  }
+  g_enabled.store(true, std::memory_order_relaxed);
+  return true;
+}
+
+bool enabled() { return g_enabled.load(std::memory_order_relaxed); }
+
+void AllocInterval::start() {
+  allocs_ = g_allocs.value.load(std::memory_order_relaxed);
+  bytes_ = g_bytes.value.load(std::memory_order_relaxed);
+  frees_ = g_frees.value.load(std::memory_order_relaxed);
+  mmaps_ = g_mmaps.value.load(std::memory_order_relaxed);
+  mmap_bytes_ = g_mmap_bytes.value.load(std::memory_order_relaxed);
+  live_bytes_ = g_live_bytes.value.load(std::memory_order_relaxed);
+  g_peaks[slot_].value.store(live_bytes_, std::memory_order_relaxed);
+  running_ = true;
+}
+
+void AllocInterval::stop(AllocStats* stats) {
+  if (!running_) {
+    return;
+  }
+  running_ = false;
+  stats->valid = true;
+  stats->allocs += g_allocs.value.load(std::memory_order_relaxed) - allocs_;
+  stats->bytes += g_bytes.value.load(std::memory_order_relaxed) - bytes_;
+  stats->frees += g_frees.value.load(std::memory_order_relaxed) - frees_;
+  stats->mmaps += g_mmaps.value.load(std::memory_order_relaxed) - mmaps_;
+  stats->mmap_bytes +=
+      g_mmap_bytes.value.load(std::memory_order_relaxed) - mmap_bytes_;
+  int64_t peak = g_peaks[slot_].value.load(std::memory_order_relaxed);
+  stats->peak_live_bytes =
+      std::max(stats->peak_live_bytes, peak - live_bytes_);
+}
+
+}  // namespace alloc
+}  // namespace anicet
+
+#ifdef ANICET_ALLOC_HOOKS
+
+// glibc declares the allocator noexcept in C++ (__THROW), bionic does not
+#ifdef __GLIBC__
+#define ANICET_ALLOC_NOEXCEPT noexcept
+#else
+#define ANICET_ALLOC_NOEXCEPT
+#endif
+
+using anicet::alloc::bootstrap_alloc;
+using anicet::alloc::g_enabled;
+using anicet::alloc::g_real;
+using anicet::alloc::is_bootstrap;
+using anicet::alloc::real_aligned;
+using anicet::alloc::real_mmap;
+using anicet::alloc::record_free;
+using anicet::alloc::resolve_real;
+using anicet::alloc::track_alloc;
+
+extern "C" {
+
+void* malloc(size_t size) ANICET_ALLOC_NOEXCEPT {
+  if (!resolve_real()) {
+    return bootstrap_alloc(size);
+  }
+  return track_alloc(g_real.malloc(size), size);
+}
+
+void free(void* ptr) ANICET_ALLOC_NOEXCEPT {
+  if (ptr == nullptr || is_bootstrap(ptr) || !resolve_real()) {
+    return;
+  }
+  if (g_enabled.load(std::memory_order_relaxed)) {
+    record_free(g_real.malloc_usable_size(ptr));
+  }
+  g_real.free(ptr);
+}
+
+void* calloc(size_t count, size_t size) ANICET_ALLOC_NOEXCEPT {
+  if (!resolve_real()) {
+    // The bootstrap heap is zero-initialized
+    if (size != 0 && count > (size_t)-1 / size) {
+      return nullptr;
+    }
+    return bootstrap_alloc(count * size);
+  }
+  return track_alloc(g_real.calloc(count, size), count * size);
+}
+
+void* realloc(void* ptr, size_t size) ANICET_ALLOC_NOEXCEPT {
+  if (!resolve_real() || is_bootstrap(ptr)) {
+    // Move a bootstrap block to the libc heap (or a new bootstrap block)
+    void* moved = malloc(size);
+    if (moved != nullptr && ptr != nullptr) {
+      size_t old_size;
+      memcpy(&old_size, (const char*)ptr - anicet::alloc::BOOTSTRAP_HEADER,
+             sizeof(old_size));
+      memcpy(moved, ptr, old_size < size ? old_size : size);
+    }
+    return moved;
+  }
+  if (!g_enabled.load(std::memory_order_relaxed)) {
+    return g_real.realloc(ptr, size);
+  }
+  size_t old_usable = (ptr != nullptr) ? g_real.malloc_usable_size(ptr) : 0;
+  void* result = g_real.realloc(ptr, size);
+  // A failed realloc keeps the old block, realloc(ptr, 0) may free it
+  if (ptr != nullptr && (result != nullptr || size == 0)) {
+    record_free(old_usable);
+  }
+  return track_alloc(result, size);
+}
+
+int posix_memalign(void** ptr, size_t alignment,
+                   size_t size) ANICET_ALLOC_NOEXCEPT {
+  if (!resolve_real()) {
+    return ENOMEM;
+  }
+  if (!g_real.posix_memalign) {
+    if (alignment < sizeof(void*) || (alignment & (alignment - 1)) != 0) {
+      return EINVAL;
+    }
+    void* result = real_aligned(alignment, size);
+    if (result == nullptr) {
+      return ENOMEM;
+    }
+    *ptr = track_alloc(result, size);
+    return 0;
+  }
+  int result = g_real.posix_memalign(ptr, alignment, size);
+  if (result == 0) {
+    track_alloc(*ptr, size);
+  }
+  return result;
+}
+
+void* memalign(size_t alignment, size_t size) ANICET_ALLOC_NOEXCEPT {
+  if (!resolve_real()) {
+    return nullptr;
+  }
+  if (!g_real.memalign) {
+    return track_alloc(real_aligned(alignment, size), size);
+  }
+  return track_alloc(g_real.memalign(alignment, size), size);
+}
+
+void* aligned_alloc(size_t alignment, size_t size) ANICET_ALLOC_NOEXCEPT {
+  if (!resolve_real()) {
+    return nullptr;
+  }
+  return track_alloc(real_aligned(alignment, size), size);
+}
+
+// Anonymous mappings are counted (not their munmap, mappings are not part
+// of the live heap). The allocator's own mappings stay inside libc.
+void* mmap(void* addr, size_t length, int prot, int flags, int fd,
+           off_t offset) ANICET_ALLOC_NOEXCEPT {
+  if (!resolve_real()) {
+    return real_mmap(addr, length, prot, flags, fd, offset);
+  }
+  void* result = g_real.mmap != nullptr
+                     ? g_real.mmap(addr, length, prot, flags, fd, offset)
+                     : real_mmap(addr, length, prot, flags, fd, offset);
+  if (result != MAP_FAILED && (flags & MAP_ANONYMOUS) != 0 &&
+      g_enabled.load(std::memory_order_relaxed)) {
+    anicet::alloc::g_mmaps.value.fetch_add(1, std::memory_order_relaxed);
+    anicet::alloc::g_mmap_bytes.value.fetch_add((int64_t)length,
+                                                std::memory_order_relaxed);
+  }
+  return result;
+}
+
+}  // extern "C"
+
+#endif  // ANICET_ALLOC_HOOKS
@@ -0,0 +1,340 @@
+// anicet_bench.cc
+// Regression benchmark implementation
+
+#include "anicet_bench.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+#include <nlohmann/json.hpp>
+
+#include "anicet_runner.h"
+#include "anicet_stats.h"
+
+namespace anicet {
+namespace bench {
+
+using json = nlohmann::ordered_json;
+
+// Helper: parse the "thresholds" object of a suite
+static bool parse_thresholds(const json& value, Thresholds* thresholds) {
+  if (!value.is_object()) {
+    fprintf(stderr, "bench: Invalid thresholds: %s\n", value.dump().c_str());
+    return false;
+  }
+  for (const auto& [key, entry] : value.items()) {
+    if (!entry.is_number() || entry.get<double>() < 0.0) {
+      fprintf(stderr, "bench: Invalid value for thresholds.%s: %s\n",
+              key.c_str(), entry.dump().c_str());
+      return false;
+    }
+    double number = entry.get<double>();
+    if (key == "alpha") {
+      thresholds->alpha = number;
+    } else if (key == "time_percent") {
+      thresholds->time_percent = number;
+    } else if (key == "memory_percent") {
+      thresholds->memory_percent = number;
+    } else if (key == "bytes_per_pixel_percent") {
+      thresholds->bytes_per_pixel_percent = number;
+    } else if (key == "memory_slack_kb") {
+      thresholds->memory_slack_kb = (int64_t)number;
+    } else {
+      fprintf(stderr, "bench: Unknown field 'thresholds.%s'\n", key.c_str());
+      return false;
+    }
+  }
+  return true;
+}
+
+bool load_suite(const std::string& path, const std::string& corpus_dir,
+                Suite* suite) {
+  std::ifstream file(path);
+  if (!file) {
+    fprintf(stderr, "bench: Failed to open %s\n", path.c_str());
+    return false;
+  }
+  std::stringstream text;
+  text << file.rdbuf();
+  json root = json::parse(text.str(), nullptr, false);
+  if (root.is_discarded() || !root.is_object()) {
+    fprintf(stderr, "bench: %s is not a JSON object\n", path.c_str());
+    return false;
+  }
+
+  *suite = Suite();
+  for (const auto& [key, value] : root.items()) {
+    bool valid = true;
+    if (key == "suite" || key == "cpus") {
+      valid = value.is_string();
+      if (valid) {
+        (key == "suite" ? suite->name : suite->cpus) =
+            value.get<std::string>();
+      }
+    } else if (key == "version" || key == "num_runs") {
+      valid = value.is_number_integer() && value.get<int>() >= 1;
+      if (valid) {
+        (key == "version" ? suite->version : suite->num_runs) =
+            value.get<int>();
+      }
+    } else if (key == "warmup_runs" || key == "cooldown_ms") {
+      valid = value.is_number_integer() && value.get<int>() >= 0;
+      if (valid) {
+        (key == "warmup_runs" ? suite->warmup_runs : suite->cooldown_ms) =
+            value.get<int>();
+      }
+    } else if (key == "cooldown_temp_c") {
+      valid = value.is_number() && value.get<double>() >= 0.0;
+      if (valid) suite->cooldown_temp_c = value.get<double>();
+    } else if (key == "thresholds") {
+      if (!parse_thresholds(value, &suite->thresholds)) {
+        return false;
+      }
+    } else if (key == "description" || key == "jobs") {
+      // Free text, and the jobs (loaded as a manifest below)
+    } else {
+      fprintf(stderr, "bench: Unknown field '%s'\n", key.c_str());
+      return false;
+    }
+    if (!valid) {
+      fprintf(stderr, "bench: Invalid value for '%s': %s\n", key.c_str(),
+              value.dump().c_str());
+      return false;
+    }
+  }
+  if (suite->name.empty() || suite->version == 0) {
+    fprintf(stderr, "bench: %s needs a suite name and version\n",
+            path.c_str());
+    return false;
+  }
+  if (!anicet::manifest::load_manifest(path, &suite->jobs)) {
+    return false;
+  }
+
+  // Corpus images are relative to the corpus directory
+  std::string dir = corpus_dir;
+  if (dir.empty()) {
+    size_t slash = path.rfind('/');
+    dir = slash == std::string::npos ? "." : path.substr(0, slash);
+  }
+  for (anicet::manifest::ManifestJob& job : suite->jobs) {
+    if (!job.image.empty() && job.image[0] != '/') {
+      job.image = dir + "/" + job.image;
+    }
+  }
+  return true;
+}
+
+Result make_result(const std::string& key, const CodecOutput& output,
+                   int width, int height) {
+  Result result;
+  result.key = key;
+  result.codec = output.codec_name;
+  result.encode_time_us = anicet::stats::encode_times_us(output);
+  result.peak_memory_kb = output.profile_encode_mem_kb;
+  // Measured frames only, like the encode times
+  double bytes = 0.0;
+  int frames = 0;
+  for (size_t i = 0; i < output.frame_sizes.size(); i++) {
+    if (i < output.warmup_frames.size() && output.warmup_frames[i]) {
+      continue;
+    }
+    bytes += output.frame_sizes[i];
+    frames++;
+  }
+  if (frames > 0 && width > 0 && height > 0) {
+    result.bytes_per_pixel = bytes / frames / ((double)width * height);
+  }
+  return result;
+}
+
+bool load_report(const std::string& path, Report* report) {
+  std::ifstream file(path);
+  if (!file) {
+    fprintf(stderr, "bench: Failed to open %s\n", path.c_str());
+    return false;
+  }
+  std::stringstream text;
+  text << file.rdbuf();
+  json root = json::parse(text.str(), nullptr, false);
+  if (root.is_discarded() || !root.is_object() || !root.contains("bench") ||
+      !root["bench"].is_object() || !root.contains("results") ||
+      !root["results"].is_array()) {
+    fprintf(stderr, "bench: %s is not a --bench report\n", path.c_str());
+    return false;
+  }
+  *report = Report();
+  const json& bench = root["bench"];
+  report->suite = bench.value("suite", "");
+  report->version = bench.value("version", 0);
+  report->anicet_version = bench.value("anicet_version", "");
+  report->device = bench.value("device", "");
+  for (const json& entry : root["results"]) {
+    if (!entry.is_object() || !entry.contains("key") ||
+        !entry["key"].is_string() || !entry.contains("encode_time_us") ||
+        !entry["encode_time_us"].is_array()) {
+      fprintf(stderr, "bench: %s: Invalid result: %s\n", path.c_str(),
+              entry.dump().c_str());
+      return false;
+    }
+    Result result;
+    result.key = entry["key"].get<std::string>();
+    result.codec = entry.value("codec", "");
+    for (const json& time : entry["encode_time_us"]) {
+      if (time.is_number()) {
+        result.encode_time_us.push_back(time.get<double>());
+      }
+    }
+    result.peak_memory_kb = entry.value("peak_memory_kb", (int64_t)0);
+    result.bytes_per_pixel = entry.value("bytes_per_pixel", 0.0);
+    report->results.push_back(result);
+  }
+  return true;
+}
+
+const char* verdict_name(Verdict verdict) {
+  switch (verdict) {
+    case Verdict::UNCHANGED:
+      return "unchanged";
+    case Verdict::IMPROVED:
+      return "improved";
+    case Verdict::REGRESSED:
+      return "regressed";
+  }
+  return "unknown";
+}
+
+// Helper: compare a single-value metric against a relative threshold and an
+// absolute slack
+static Comparison compare_value(const std::string& key,
+                                const std::string& metric, double baseline,
+                                double current, double threshold_percent,
+                                double slack) {
+  Comparison comparison;
+  comparison.key = key;
+  comparison.metric = metric;
+  comparison.baseline = baseline;
+  comparison.current = current;
+  if (baseline > 0.0) {
+    comparison.change_percent = (current - baseline) / baseline * 100.0;
+  }
+  double limit = std::max(baseline * threshold_percent / 100.0, slack);
+  if (current - baseline > limit) {
+    comparison.verdict = Verdict::REGRESSED;
+  } else if (baseline - current > limit) {
+    comparison.verdict = Verdict::IMPROVED;
+  }
+  return comparison;
+}
+
+int compare(const Report& baseline, const Report& current,
+            const Thresholds& thresholds, std::vector<Comparison>* comparisons,
+            std::vector<std::string>* missing) {
+  comparisons->clear();
+  missing->clear();
+  std::map<std::string, const Result*> current_results;
+  for (const Result& result : current.results) {
+    current_results[result.key] = &result;
+  }
+  int regressions = 0;
+  for (const Result& base : baseline.results) {
+    auto it = current_results.find(base.key);
+    if (it == current_results.end()) {
+      missing->push_back(base.key);
+      continue;
+    }
+    const Result& now = *it->second;
+
+    // Encode time: the medians must differ by more than the threshold, and
+    // the per-frame distributions significantly
+    anicet::stats::Summary base_summary;
+    anicet::stats::Summary now_summary;
+    if (anicet::stats::summarize(base.encode_time_us, &base_summary) &&
+        anicet::stats::summarize(now.encode_time_us, &now_summary)) {
+      Comparison time = compare_value(base.key, "encode_time_us",
+                                      base_summary.median, now_summary.median,
+                                      thresholds.time_percent, 0.0);
+      double slower_p = anicet::stats::mann_whitney_greater_p(
+          base.encode_time_us, now.encode_time_us);
+      double faster_p = anicet::stats::mann_whitney_greater_p(
+          now.encode_time_us, base.encode_time_us);
+      time.p_value = time.change_percent >= 0.0 ? slower_p : faster_p;
+      if (time.p_value >= thresholds.alpha) {
+        time.verdict = Verdict::UNCHANGED;
+      }
+      comparisons->push_back(time);
+    }
+
+    comparisons->push_back(compare_value(
+        base.key, "peak_memory_kb", (double)base.peak_memory_kb,
+        (double)now.peak_memory_kb, thresholds.memory_percent,
+        (double)thresholds.memory_slack_kb));
+    comparisons->push_back(compare_value(
+        base.key, "bytes_per_pixel", base.bytes_per_pixel,
+        now.bytes_per_pixel, thresholds.bytes_per_pixel_percent, 0.0));
+  }
+  for (const Comparison& comparison : *comparisons) {
+    if (comparison.verdict == Verdict::REGRESSED) regressions++;
+  }
+  return regressions;
+}
+
+void write_report(FILE* fp, const Report& report,
+                  const std::string& baseline_file,
+                  const std::vector<Comparison>& comparisons,
+                  const std::vector<std::string>& missing, int regressions) {
+  json root;
+  root["bench"] = {
+    {"suite", report.suite},
+    {"version", report.version},
+    {"anicet_version", report.anicet_version},
+    {"device", report.device}
+  };
+  json results = json::array();
+  for (const Result& result : report.results) {
+    anicet::stats::Summary summary;
+    anicet::stats::summarize(result.encode_time_us, &summary);
+    results.push_back({
+      {"key", result.key},
+      {"codec", result.codec},
+      {"median_encode_time_us", summary.median},
+      {"encode_time_us", result.encode_time_us},
+      {"peak_memory_kb", result.peak_memory_kb},
+      {"bytes_per_pixel", result.bytes_per_pixel}
+    });
+  }
+  root["results"] = results;
+
+  // Only recorded with a baseline
+  if (!baseline_file.empty()) {
+    json entries = json::array();
+    for (const Comparison& comparison : comparisons) {
+      json entry = {
+        {"key", comparison.key},
+        {"metric", comparison.metric},
+        {"baseline", comparison.baseline},
+        {"current", comparison.current},
+        {"change_percent", comparison.change_percent}
+      };
+      if (comparison.p_value >= 0.0) {
+        entry["p_value"] = comparison.p_value;
+      }
+      entry["verdict"] = verdict_name(comparison.verdict);
+      entries.push_back(entry);
+    }
+    root["comparison"] = {
+      {"baseline", baseline_file},
+      {"regressions", regressions},
+      {"missing", missing},
+      {"metrics", entries}
+    };
+  }
+  fprintf(fp, "%s\n", root.dump(2).c_str());
+  fflush(fp);
+}
+
+}  // namespace bench
+}  // namespace anicet
@@ -0,0 +1,233 @@
+// anicet_color.cc
+// Color format conversion implementation
+
+#include "anicet_color.h"
+
+#include <cstring>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace anicet {
+namespace color {
+
+bool parse_color_format(const char* name, ColorFormat* format) {
+  if (strcmp(name, "yuv420p") == 0) {
+    *format = ColorFormat::YUV420P;
+  } else if (strcmp(name, "nv12") == 0) {
+    *format = ColorFormat::NV12;
+  } else if (strcmp(name, "nv21") == 0) {
+    *format = ColorFormat::NV21;
+  } else if (strcmp(name, "p010") == 0) {
+    *format = ColorFormat::P010;
+  } else if (strcmp(name, "rgba") == 0) {
+    *format = ColorFormat::RGBA;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+const char* color_format_name(ColorFormat format) {
+  switch (format) {
+    case ColorFormat::YUV420P:
+      return "yuv420p";
+    case ColorFormat::NV12:
+      return "nv12";
+    case ColorFormat::NV21:
+      return "nv21";
+    case ColorFormat::P010:
+      return "p010";
+    case ColorFormat::RGBA:
+      return "rgba";
+  }
+  return "unknown";
+}
+
+size_t frame_size(ColorFormat format, int width, int height) {
+  size_t pixels = (size_t)width * height;
+  switch (format) {
+    case ColorFormat::YUV420P:
+    case ColorFormat::NV12:
+    case ColorFormat::NV21:
+      return pixels * 3 / 2;
+    case ColorFormat::P010:
+      return pixels * 3;
+    case ColorFormat::RGBA:
+      return pixels * 4;
+  }
+  return 0;
+}
+
+ColorFormat codec_format(ColorFormat input,
+                         std::initializer_list<ColorFormat> native) {
+  for (ColorFormat format : native) {
+    if (format == input) {
+      return input;
+    }
+  }
+  return ColorFormat::YUV420P;
+}
+
+// Helper: split interleaved 8-bit pairs into two planes
+static void split_pairs(const uint8_t* src, uint8_t* dst_a, uint8_t* dst_b,
+                        size_t count) {
+  size_t i = 0;
+#if defined(__ARM_NEON)
+  for (; i + 16 <= count; i += 16) {
+    uint8x16x2_t pairs = vld2q_u8(src + 2 * i);
+    vst1q_u8(dst_a + i, pairs.val[0]);
+    vst1q_u8(dst_b + i, pairs.val[1]);
+  }
+#endif
+  for (; i < count; i++) {
+    dst_a[i] = src[2 * i];
+    dst_b[i] = src[2 * i + 1];
+  }
+}
+
+// Helper: keep the 8 most significant bits of 16-bit samples
+static void narrow_samples(const uint16_t* src, uint8_t* dst, size_t count) {
+  size_t i = 0;
+#if defined(__ARM_NEON)
+  for (; i + 16 <= count; i += 16) {
+    uint8x8_t lo = vshrn_n_u16(vld1q_u16(src + i), 8);
+    uint8x8_t hi = vshrn_n_u16(vld1q_u16(src + i + 8), 8);
+    vst1q_u8(dst + i, vcombine_u8(lo, hi));
+  }
+#endif
+  for (; i < count; i++) {
+    dst[i] = (uint8_t)(src[i] >> 8);
+  }
+}
+
+// Helper: split interleaved 16-bit pairs into two 8-bit planes
+static void split_sample_pairs(const uint16_t* src, uint8_t* dst_a,
+                               uint8_t* dst_b, size_t count) {
+  size_t i = 0;
+#if defined(__ARM_NEON)
+  for (; i + 8 <= count; i += 8) {
+    uint16x8x2_t pairs = vld2q_u16(src + 2 * i);
+    vst1_u8(dst_a + i, vshrn_n_u16(pairs.val[0], 8));
+    vst1_u8(dst_b + i, vshrn_n_u16(pairs.val[1], 8));
+  }
+#endif
+  for (; i < count; i++) {
+    dst_a[i] = (uint8_t)(src[2 * i] >> 8);
+    dst_b[i] = (uint8_t)(src[2 * i + 1] >> 8);
+  }
+}
+
+// BT.601 limited range, 8-bit fixed point (no clamping needed: the results
+// stay within 16..235 / 16..240)
+static inline uint8_t rgb_to_y(int r, int g, int b) {
+  return (uint8_t)(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+}
+static inline uint8_t rgb_to_u(int r, int g, int b) {
+  return (uint8_t)(((112 * b - 38 * r - 74 * g + 128) >> 8) + 128);
+}
+static inline uint8_t rgb_to_v(int r, int g, int b) {
+  return (uint8_t)(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+}
+
+// Helper: luma of one RGBA row
+static void rgba_row_to_y(const uint8_t* src, uint8_t* dst, int width) {
+  int x = 0;
+#if defined(__ARM_NEON)
+  for (; x + 8 <= width; x += 8) {
+    uint8x8x4_t px = vld4_u8(src + 4 * x);
+    uint16x8_t y = vmull_u8(px.val[0], vdup_n_u8(66));
+    y = vmlal_u8(y, px.val[1], vdup_n_u8(129));
+    y = vmlal_u8(y, px.val[2], vdup_n_u8(25));
+    y = vaddq_u16(y, vdupq_n_u16(128));
+    vst1_u8(dst + x, vadd_u8(vshrn_n_u16(y, 8), vdup_n_u8(16)));
+  }
+#endif
+  for (; x < width; x++) {
+    dst[x] = rgb_to_y(src[4 * x], src[4 * x + 1], src[4 * x + 2]);
+  }
+}
+
+// Helper: chroma of two RGBA rows (rounded mean of each 2x2 block)
+static void rgba_rows_to_uv(const uint8_t* row0, const uint8_t* row1,
+                            uint8_t* dst_u, uint8_t* dst_v, int width) {
+  int x = 0;
+#if defined(__ARM_NEON)
+  for (; x + 16 <= width; x += 16) {
+    uint8x16x4_t a = vld4q_u8(row0 + 4 * x);
+    uint8x16x4_t b = vld4q_u8(row1 + 4 * x);
+    int16x8_t mean[3];
+    for (int c = 0; c < 3; c++) {
+      uint16x8_t sum =
+          vaddq_u16(vpaddlq_u8(a.val[c]), vpaddlq_u8(b.val[c]));
+      mean[c] = vreinterpretq_s16_u16(
+          vshrq_n_u16(vaddq_u16(sum, vdupq_n_u16(2)), 2));
+    }
+    int16x8_t u = vmulq_n_s16(mean[2], 112);
+    u = vmlsq_n_s16(u, mean[0], 38);
+    u = vmlsq_n_s16(u, mean[1], 74);
+    u = vshrq_n_s16(vaddq_s16(u, vdupq_n_s16(128)), 8);
+    int16x8_t v = vmulq_n_s16(mean[0], 112);
+    v = vmlsq_n_s16(v, mean[1], 94);
+    v = vmlsq_n_s16(v, mean[2], 18);
+    v = vshrq_n_s16(vaddq_s16(v, vdupq_n_s16(128)), 8);
+    vst1_u8(dst_u + x / 2, vqmovun_s16(vaddq_s16(u, vdupq_n_s16(128))));
+    vst1_u8(dst_v + x / 2, vqmovun_s16(vaddq_s16(v, vdupq_n_s16(128))));
+  }
+#endif
+  for (; x + 2 <= width; x += 2) {
+    int mean[3];
+    for (int c = 0; c < 3; c++) {
+      int sum = row0[4 * x + c] + row0[4 * x + 4 + c] + row1[4 * x + c] +
+                row1[4 * x + 4 + c];
+      mean[c] = (sum + 2) >> 2;
+    }
+    dst_u[x / 2] = rgb_to_u(mean[0], mean[1], mean[2]);
+    dst_v[x / 2] = rgb_to_v(mean[0], mean[1], mean[2]);
+  }
+}
+
+void convert_to_yuv420p(ColorFormat format, const uint8_t* src, int width,
+                        int height, uint8_t* dst) {
+  size_t luma_size = (size_t)width * height;
+  size_t chroma_size = (size_t)(width / 2) * (height / 2);
+  uint8_t* dst_y = dst;
+  uint8_t* dst_u = dst + luma_size;
+  uint8_t* dst_v = dst_u + chroma_size;
+  switch (format) {
+    case ColorFormat::YUV420P:
+      memcpy(dst, src, luma_size + 2 * chroma_size);
+      break;
+    case ColorFormat::NV12:
+    case ColorFormat::NV21: {
+      // The chroma rows are contiguous (even width)
+      memcpy(dst_y, src, luma_size);
+      bool nv12 = format == ColorFormat::NV12;
+      split_pairs(src + luma_size, nv12 ? dst_u : dst_v, nv12 ? dst_v : dst_u,
+                  chroma_size);
+      break;
+    }
+    case ColorFormat::P010: {
+      const uint16_t* samples = (const uint16_t*)src;
+      narrow_samples(samples, dst_y, luma_size);
+      split_sample_pairs(samples + luma_size, dst_u, dst_v, chroma_size);
+      break;
+    }
+    case ColorFormat::RGBA: {
+      size_t row_bytes = (size_t)width * 4;
+      for (int y = 0; y < height; y++) {
+        rgba_row_to_y(src + y * row_bytes, dst_y + (size_t)y * width, width);
+      }
+      for (int y = 0; y < height / 2; y++) {
+        rgba_rows_to_uv(src + 2 * y * row_bytes, src + (2 * y + 1) * row_bytes,
+                        dst_u + (size_t)y * (width / 2),
+                        dst_v + (size_t)y * (width / 2), width);
+      }
+      break;
+    }
+  }
+}
+
+}  // namespace color
+}  // namespace anicet
@@ -26,3 +26,33 @@ double anicet_get_timestamp_s() {
                    (now.tv_usec - start_time.tv_usec) / 1000000.0;
   return elapsed;
 }
+
+namespace anicet {
+
+void run_sampler_loop(int interval_us, const std::atomic<bool>& stop,
+                      const std::function<void()>& sample) {
+  struct timespec next;
+  clock_gettime(CLOCK_MONOTONIC, &next);
+  while (true) {
+    bool last = stop.load(std::memory_order_acquire);
+    sample();
+    if (last) {
+      return;
+    }
+    next.tv_nsec += (long)interval_us * 1000;
+    while (next.tv_nsec >= 1000000000L) {
+      next.tv_nsec -= 1000000000L;
+      next.tv_sec++;
+    }
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, nullptr);
+    // Fell behind (e.g. descheduled): restart the schedule from now
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if (now.tv_sec > next.tv_sec ||
+        (now.tv_sec == next.tv_sec && now.tv_nsec > next.tv_nsec)) {
+      next = now;
+    }
+  }
+}
+
+}  // namespace anicet
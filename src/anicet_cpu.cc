@@ -0,0 +1,350 @@
+// anicet_cpu.cc
+// CPU list parsing, affinity and topology helpers implementation
+
+#include "anicet_cpu.h"
+
+#include <sched.h>
+#ifdef __linux__
+#include <sys/auxv.h>
+#endif
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <map>
+
+namespace anicet {
+namespace cpu {
+
+// Parse CPU list
+bool parse_cpulist(const std::string& cpus, std::set<int>* cpu_set) {
+  cpu_set->clear();
+  // cpus format examples: "0", "1-3", "0,2,4-6"
+  size_t i = 0, n = cpus.size();
+  while (i < n) {
+    // parse number
+    char* endptr = nullptr;
+    long a = strtol(cpus.c_str() + i, &endptr, 10);
+    if (endptr == cpus.c_str() + i) return false;
+    i = endptr - cpus.c_str();
+    long b = a;
+    if (i < n && cpus[i] == '-') {
+      ++i;
+      long r = strtol(cpus.c_str() + i, &endptr, 10);
+      if (endptr == cpus.c_str() + i) {
+        return false;
+      }
+      i = endptr - cpus.c_str();
+      b = r;
+    }
+    if (a > b) {
+      std::swap(a, b);
+    }
+    if (a < 0) {
+      return false;
+    }
+    for (long c = a; c <= b; ++c) {
+      cpu_set->insert((int)c);
+    }
+    if (i < n && cpus[i] == ',') {
+      ++i;
+    }
+  }
+  return !cpu_set->empty();
+}
+
+// Format CPU list
+std::string format_cpulist(const std::set<int>& cpu_set) {
+  std::string out;
+  auto it = cpu_set.begin();
+  while (it != cpu_set.end()) {
+    int first = *it;
+    int last = first;
+    while (++it != cpu_set.end() && *it == last + 1) {
+      last = *it;
+    }
+    if (!out.empty()) out += ",";
+    out += std::to_string(first);
+    if (last != first) out += "-" + std::to_string(last);
+  }
+  return out;
+}
+
+// Set affinity of the calling thread
+bool set_affinity_from_cpulist(const std::string& cpus) {
+#ifdef __linux__
+  std::set<int> cpu_list;
+  if (!parse_cpulist(cpus, &cpu_list)) {
+    return false;
+  }
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int c : cpu_list) {
+    if (c >= CPU_SETSIZE) return false;
+    CPU_SET(c, &set);
+  }
+  // pid 0 is the calling thread
+  return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+  (void)cpus;
+  return false;
+#endif
+}
+
+// Get affinity of the calling thread
+std::set<int> get_affinity() {
+  std::set<int> cpu_list;
+#ifdef __linux__
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+    for (int c = 0; c < CPU_SETSIZE; c++) {
+      if (CPU_ISSET(c, &set)) cpu_list.insert(c);
+    }
+  }
+#endif
+  return cpu_list;
+}
+
+// Get the overlap between two CPU lists
+std::set<int> cpulist_overlap(const std::string& cpus_a,
+                              const std::string& cpus_b) {
+  std::set<int> a, b, common;
+  if (!parse_cpulist(cpus_a, &a) || !parse_cpulist(cpus_b, &b)) {
+    return common;
+  }
+  std::set_intersection(a.begin(), a.end(), b.begin(), b.end(),
+                        std::inserter(common, common.begin()));
+  return common;
+}
+
+// sysfs CPU directory
+static const char* SYSFS_CPU = "/sys/devices/system/cpu";
+
+// Helper: read the first line of a sysfs file (without the newline)
+static bool read_sysfs_line(const std::string& path, std::string* line) {
+  FILE* fp = fopen(path.c_str(), "r");
+  if (fp == nullptr) {
+    return false;
+  }
+  char buf[256];
+  bool ok = fgets(buf, sizeof(buf), fp) != nullptr;
+  fclose(fp);
+  if (!ok) {
+    return false;
+  }
+  buf[strcspn(buf, "\n")] = '\0';
+  *line = buf;
+  return true;
+}
+
+// Helper: read an integer sysfs file (0 if missing)
+static int64_t read_sysfs_int(const std::string& path) {
+  std::string line;
+  if (!read_sysfs_line(path, &line)) {
+    return 0;
+  }
+  return strtoll(line.c_str(), nullptr, 10);
+}
+
+#if defined(__aarch64__)
+// Decoded HWCAP bits (arch/arm64/include/uapi/asm/hwcap.h, same subset as
+// tools/auxv.print.py)
+static const std::map<int, const char*> HWCAP_NAMES = {
+    {0, "fp"},        {1, "asimd"},    {2, "evtstrm"},   {3, "aes"},
+    {4, "pmull"},     {5, "sha1"},     {6, "sha2"},      {7, "crc32"},
+    {8, "atomics"},   {9, "fphp"},     {10, "asimdhp"},  {11, "cpuid"},
+    {12, "asimdrdm"}, {13, "jscvt"},   {14, "fcma"},     {15, "lrcpc"},
+    {16, "dcpop"},    {17, "sha3"},    {18, "sm3"},      {19, "sm4"},
+    {20, "asimddp"},  {21, "sha512"},  {22, "sve"},      {23, "asimdfhm"},
+    {28, "ilrcpc"},   {29, "flagm"},   {30, "ssbs"},     {31, "sb"}};
+static const std::map<int, const char*> HWCAP2_NAMES = {
+    {0, "dcpodp"},    {1, "sve2"},      {2, "sveaes"},    {3, "svepmull"},
+    {4, "svebitperm"}, {5, "svesha3"},  {6, "svesm4"},    {7, "flagm2"},
+    {8, "frint"},     {9, "svei8mm"},   {10, "svef32mm"}, {11, "svef64mm"},
+    {12, "svebf16"},  {13, "i8mm"},     {14, "bf16"},     {15, "dgh"},
+    {16, "rng"},      {17, "bti"},      {20, "mte"},      {21, "ecv"},
+    {22, "afp"},      {23, "rprfm"},    {28, "mte3"}};
+#endif
+
+// Get the CPU topology
+CpuTopology get_topology() {
+  CpuTopology topology;
+  std::string online;
+  std::set<int> online_cpus;
+  if (!read_sysfs_line(std::string(SYSFS_CPU) + "/online", &online) ||
+      !parse_cpulist(online, &online_cpus)) {
+    online_cpus = get_affinity();
+  }
+
+  // Group the CPUs by cpufreq policy (or by capacity without cpufreq)
+  std::map<std::string, CpuCluster> groups;
+  for (int c : online_cpus) {
+    std::string dir = std::string(SYSFS_CPU) + "/cpu" + std::to_string(c);
+    int capacity = (int)read_sysfs_int(dir + "/cpu_capacity");
+    int64_t max_freq_khz = read_sysfs_int(dir + "/cpufreq/cpuinfo_max_freq");
+    std::string related;
+    std::set<int> related_cpus;
+    if (read_sysfs_line(dir + "/cpufreq/related_cpus", &related)) {
+      // related_cpus is space-separated
+      std::replace(related.begin(), related.end(), ' ', ',');
+      if (!related.empty() && related.back() == ',') related.pop_back();
+      parse_cpulist(related, &related_cpus);
+    }
+    std::string key = !related_cpus.empty()
+                          ? "policy:" + format_cpulist(related_cpus)
+                          : "capacity:" + std::to_string(capacity);
+    CpuCluster& cluster = groups[key];
+    cluster.cpus.insert(c);
+    cluster.max_freq_khz = std::max(cluster.max_freq_khz, max_freq_khz);
+    cluster.capacity = std::max(cluster.capacity, capacity);
+  }
+  for (auto& [key, cluster] : groups) {
+    topology.clusters.push_back(cluster);
+  }
+  std::sort(topology.clusters.begin(), topology.clusters.end(),
+            [](const CpuCluster& a, const CpuCluster& b) {
+              if (a.capacity != b.capacity) return a.capacity < b.capacity;
+              if (a.max_freq_khz != b.max_freq_khz) {
+                return a.max_freq_khz < b.max_freq_khz;
+              }
+              return *a.cpus.begin() < *b.cpus.begin();
+            });
+  size_t n = topology.clusters.size();
+  for (size_t i = 0; i < n; i++) {
+    CpuCluster& cluster = topology.clusters[i];
+    if (i == n - 1) {
+      cluster.name = "big";
+    } else if (i == 0) {
+      cluster.name = "little";
+    } else if (n == 3) {
+      cluster.name = "mid";
+    } else {
+      cluster.name = "mid" + std::to_string(i);
+    }
+  }
+
+#ifdef __linux__
+  topology.hwcap = getauxval(AT_HWCAP);
+#ifdef AT_HWCAP2
+  topology.hwcap2 = getauxval(AT_HWCAP2);
+#endif
+#endif
+#if defined(__aarch64__)
+  for (const auto& [bit, name] : HWCAP_NAMES) {
+    if (topology.hwcap & (1ULL << bit)) topology.features.push_back(name);
+  }
+  for (const auto& [bit, name] : HWCAP2_NAMES) {
+    if (topology.hwcap2 & (1ULL << bit)) topology.features.push_back(name);
+  }
+#endif
+  return topology;
+}
+
+bool parse_simd_level(const std::string& name, SimdLevel* level) {
+  static const std::map<std::string, SimdLevel> LEVELS = {
+      {"c", SimdLevel::C},
+      {"neon", SimdLevel::NEON},
+      {"dotprod", SimdLevel::DOTPROD},
+      {"i8mm", SimdLevel::I8MM},
+      {"sve", SimdLevel::SVE},
+      {"sve2", SimdLevel::SVE2}};
+  if (name == "auto") {
+    *level = max_simd_level();
+    return true;
+  }
+  auto it = LEVELS.find(name);
+  if (it == LEVELS.end()) {
+    return false;
+  }
+  *level = it->second;
+  return true;
+}
+
+const char* simd_level_name(SimdLevel level) {
+  switch (level) {
+    case SimdLevel::C:
+      return "c";
+    case SimdLevel::NEON:
+      return "neon";
+    case SimdLevel::DOTPROD:
+      return "dotprod";
+    case SimdLevel::I8MM:
+      return "i8mm";
+    case SimdLevel::SVE:
+      return "sve";
+    case SimdLevel::SVE2:
+      return "sve2";
+  }
+  return "unknown";
+}
+
+bool cpu_has_simd_level(SimdLevel level) {
+  if (level == SimdLevel::C) {
+    return true;
+  }
+#if defined(__aarch64__) && defined(__linux__)
+  // Bits of arch/arm64/include/uapi/asm/hwcap.h (see HWCAP_NAMES)
+  static const uint64_t hwcap = getauxval(AT_HWCAP);
+  static const uint64_t hwcap2 = getauxval(AT_HWCAP2);
+  switch (level) {
+    case SimdLevel::NEON:
+      return hwcap & (1ULL << 1);
+    case SimdLevel::DOTPROD:
+      return hwcap & (1ULL << 20);
+    case SimdLevel::I8MM:
+      return hwcap2 & (1ULL << 13);
+    case SimdLevel::SVE:
+      return hwcap & (1ULL << 22);
+    case SimdLevel::SVE2:
+      return hwcap2 & (1ULL << 1);
+    default:
+      break;
+  }
+#endif
+  return false;
+}
+
+SimdLevel max_simd_level() {
+  SimdLevel max = SimdLevel::C;
+  for (SimdLevel level : {SimdLevel::NEON, SimdLevel::DOTPROD,
+                          SimdLevel::I8MM, SimdLevel::SVE, SimdLevel::SVE2}) {
+    if (cpu_has_simd_level(level)) max = level;
+  }
+  return max;
+}
+
+bool simd_level_supported(const std::string& name) {
+  SimdLevel level;
+  return name == "auto" ||
+         (parse_simd_level(name, &level) && cpu_has_simd_level(level));
+}
+
+// Resolve a cluster name into a CPU list
+bool resolve_cpulist(const std::string& spec, std::string* cpus) {
+  static const std::string prefix = "cluster:";
+  if (spec.compare(0, prefix.length(), prefix) != 0) {
+    *cpus = spec;
+    return true;
+  }
+  std::string name = spec.substr(prefix.length());
+  CpuTopology topology = get_topology();
+  for (const CpuCluster& cluster : topology.clusters) {
+    if (cluster.name == name) {
+      *cpus = format_cpulist(cluster.cpus);
+      return true;
+    }
+  }
+  fprintf(stderr, "Unknown CPU cluster '%s' (available:", name.c_str());
+  for (const CpuCluster& cluster : topology.clusters) {
+    fprintf(stderr, " %s=%s", cluster.name.c_str(),
+            format_cpulist(cluster.cpus).c_str());
+  }
+  fprintf(stderr, ")\n");
+  return false;
+}
+
+}  // namespace cpu
+}  // namespace anicet
@@ -0,0 +1,258 @@
+// anicet_energy.cc
+// Energy sampler implementation
+
+#include "anicet_energy.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "anicet_common.h"
+#include "anicet_runner.h"
+
+namespace anicet {
+namespace energy {
+
+// Power monitor and power supply directories
+static const char* SYSFS_IIO = "/sys/bus/iio/devices";
+static const char* SYSFS_POWER_SUPPLY = "/sys/class/power_supply";
+// Initial timeline capacity (grows if needed)
+static constexpr size_t INITIAL_SAMPLES = 4096;
+
+const char* energy_source_name(EnergySource source) {
+  switch (source) {
+    case EnergySource::NONE:
+      return "none";
+    case EnergySource::RAILS:
+      return "rails";
+    case EnergySource::BATTERY:
+      return "battery";
+  }
+  return "unknown";
+}
+
+// Helper: pread a sysfs fd into buf (NUL-terminated)
+static bool read_fd(int fd, char* buf, size_t size) {
+  ssize_t n = pread(fd, buf, size - 1, 0);
+  if (n <= 0) {
+    return false;
+  }
+  buf[n] = '\0';
+  return true;
+}
+
+// Helper: sum of the rail values of an energy_value file
+// Format: "t=<ms>" then one "CH<n>(T=<ms>)[<rail>], <energy uWs>" per rail
+static bool parse_rails(const char* buf, double* energy_uj) {
+  *energy_uj = 0.0;
+  int rails = 0;
+  for (const char* line = buf; line != nullptr && *line != '\0';) {
+    const char* end = strchr(line, '\n');
+    const char* bracket = strchr(line, ']');
+    if (bracket != nullptr && (end == nullptr || bracket < end)) {
+      const char* comma = strchr(bracket, ',');
+      if (comma != nullptr && (end == nullptr || comma < end)) {
+        *energy_uj += strtod(comma + 1, nullptr);
+        rails++;
+      }
+    }
+    line = (end != nullptr) ? end + 1 : nullptr;
+  }
+  return rails > 0;
+}
+
+// Helper: open a file read-only (-1 on error)
+static int open_file(const std::string& path) {
+  return open(path.c_str(), O_RDONLY | O_CLOEXEC);
+}
+
+EnergySampler::EnergySampler(const CodecInput* input) {
+  if (input->energy_sample_interval_ms <= 0) {
+    return;
+  }
+  megapixels_ = (double)input->width * input->height / 1e6;
+
+  // Prefer the power monitor rails
+  DIR* dir = opendir(SYSFS_IIO);
+  if (dir != nullptr) {
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != nullptr) {
+      if (strncmp(entry->d_name, "iio:device", 10) != 0) continue;
+      int fd = open_file(std::string(SYSFS_IIO) + "/" + entry->d_name +
+                         "/energy_value");
+      if (fd >= 0) {
+        fds_.push_back(fd);
+      }
+    }
+    closedir(dir);
+  }
+  if (!fds_.empty()) {
+    source_ = EnergySource::RAILS;
+  } else {
+    // Otherwise the battery
+    dir = opendir(SYSFS_POWER_SUPPLY);
+    if (dir != nullptr) {
+      struct dirent* entry;
+      while (source_ == EnergySource::NONE &&
+             (entry = readdir(dir)) != nullptr) {
+        if (entry->d_name[0] == '.') continue;
+        std::string supply =
+            std::string(SYSFS_POWER_SUPPLY) + "/" + entry->d_name;
+        char type[32] = "";
+        int type_fd = open_file(supply + "/type");
+        bool battery = type_fd >= 0 && read_fd(type_fd, type, sizeof(type)) &&
+                       strncmp(type, "Battery", 7) == 0;
+        if (type_fd >= 0) close(type_fd);
+        if (!battery) continue;
+        int current_fd = open_file(supply + "/current_now");
+        int voltage_fd = open_file(supply + "/voltage_now");
+        if (current_fd >= 0 && voltage_fd >= 0) {
+          fds_ = {current_fd, voltage_fd};
+          source_ = EnergySource::BATTERY;
+        } else {
+          if (current_fd >= 0) close(current_fd);
+          if (voltage_fd >= 0) close(voltage_fd);
+        }
+      }
+      closedir(dir);
+    }
+  }
+  if (source_ == EnergySource::NONE) {
+    fprintf(stderr, "Warning: no power monitor rails or battery to sample\n");
+    return;
+  }
+  interval_us_ = input->energy_sample_interval_ms * 1000;
+  samples_.reserve(INITIAL_SAMPLES);
+  thread_ = std::thread(&EnergySampler::thread_main, this);
+}
+
+EnergySampler::~EnergySampler() {
+  if (thread_.joinable()) {
+    stop_.store(true, std::memory_order_release);
+    thread_.join();
+  }
+  for (int fd : fds_) close(fd);
+}
+
+bool EnergySampler::read_source(double* value) const {
+  char buf[4096];
+  if (source_ == EnergySource::RAILS) {
+    *value = 0.0;
+    for (int fd : fds_) {
+      double energy_uj;
+      if (!read_fd(fd, buf, sizeof(buf)) || !parse_rails(buf, &energy_uj)) {
+        return false;
+      }
+      *value += energy_uj;
+    }
+    return true;
+  }
+  // Battery: current (uA, sign depends on the driver) * voltage (uV)
+  if (!read_fd(fds_[0], buf, sizeof(buf))) {
+    return false;
+  }
+  double current_ua = std::fabs(strtod(buf, nullptr));
+  if (!read_fd(fds_[1], buf, sizeof(buf))) {
+    return false;
+  }
+  double voltage_uv = strtod(buf, nullptr);
+  *value = current_ua * voltage_uv / 1e6;
+  return true;
+}
+
+void EnergySampler::thread_main() {
+  // Rails are cumulative (offset by the first read), battery power is
+  // integrated with the trapezoidal rule
+  double first_value = 0.0;
+  double last_power_uw = 0.0;
+  anicet::run_sampler_loop(interval_us_, stop_, [&]() {
+    double value;
+    if (read_source(&value)) {
+      EnergySample sample;
+      sample.time_us = anicet_get_timestamp();
+      if (source_ == EnergySource::RAILS) {
+        if (samples_.empty()) first_value = value;
+        sample.energy_uj = value - first_value;
+      } else if (samples_.empty()) {
+        sample.energy_uj = 0.0;
+      } else {
+        const EnergySample& prev = samples_.back();
+        double dt_s = (sample.time_us - prev.time_us) / 1e6;
+        sample.energy_uj = prev.energy_uj + (last_power_uw + value) / 2 * dt_s;
+      }
+      last_power_uw = value;
+      samples_.push_back(sample);
+    }
+  });
+}
+
+double EnergySampler::energy_between(int64_t start_us, int64_t end_us) const {
+  if (samples_.size() < 2 || end_us < start_us || end_us <= 0) {
+    return -1.0;
+  }
+  // Clamp to the sampled time (the first sample may be taken just after the
+  // runner started)
+  start_us = std::max(start_us, samples_.front().time_us);
+  end_us = std::min(end_us, samples_.back().time_us);
+  if (end_us < start_us) {
+    return -1.0;
+  }
+  // Cumulative energy at t (linear interpolation between samples)
+  auto energy_at = [this](int64_t t) -> double {
+    auto it = std::lower_bound(
+        samples_.begin() + 1, samples_.end() - 1, t,
+        [](const EnergySample& s, int64_t time) { return s.time_us < time; });
+    const EnergySample& a = *(it - 1);
+    const EnergySample& b = *it;
+    if (b.time_us == a.time_us) {
+      return b.energy_uj;
+    }
+    return a.energy_uj + (b.energy_uj - a.energy_uj) * (t - a.time_us) /
+                             (b.time_us - a.time_us);
+  };
+  return energy_at(end_us) - energy_at(start_us);
+}
+
+void EnergySampler::finish(CodecOutput* output) {
+  output->frame_energy.clear();
+  for (double& energy_mj : output->phase_energy_mj) energy_mj = -1.0;
+  output->energy_mj = -1.0;
+  if (!thread_.joinable()) {
+    return;
+  }
+  stop_.store(true, std::memory_order_release);
+  thread_.join();
+
+  output->energy_source = energy_source_name(source_);
+  output->frame_energy.resize(output->timings.size());
+  for (size_t i = 0; i < output->timings.size(); i++) {
+    double energy_uj = energy_between(output->timings[i].input_timestamp_us,
+                                      output->timings[i].output_timestamp_us);
+    if (energy_uj < 0.0) continue;
+    output->frame_energy[i].energy_mj = energy_uj / 1000.0;
+    if (megapixels_ > 0.0) {
+      output->frame_energy[i].energy_mj_per_mp =
+          energy_uj / 1000.0 / megapixels_;
+    }
+  }
+  for (int phase = 0; phase < NUM_CODEC_PHASES; phase++) {
+    double energy_uj = energy_between(output->phase_start_us[phase],
+                                      output->phase_end_us[phase]);
+    if (energy_uj >= 0.0) {
+      output->phase_energy_mj[phase] = energy_uj / 1000.0;
+    }
+  }
+  if (!samples_.empty()) {
+    output->energy_mj = samples_.back().energy_uj / 1000.0;
+  }
+  samples_.clear();
+}
+
+}  // namespace energy
+}  // namespace anicet
@@ -0,0 +1,498 @@
+// anicet_input.cc
+// Input file loading and multi-frame source implementation
+
+#include "anicet_input.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "anicet_common.h"
+
+namespace anicet {
+namespace input {
+
+// Transparent huge page size used to align HUGEPAGE mappings
+static constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+bool parse_input_mode(const std::string& name, InputMode* mode) {
+  if (name == "read") {
+    *mode = InputMode::READ;
+  } else if (name == "mmap") {
+    *mode = InputMode::MMAP;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+bool parse_input_prefetch(const std::string& name, InputPrefetch* prefetch) {
+  if (name == "none") {
+    *prefetch = InputPrefetch::NONE;
+  } else if (name == "populate") {
+    *prefetch = InputPrefetch::POPULATE;
+  } else if (name == "willneed") {
+    *prefetch = InputPrefetch::WILLNEED;
+  } else if (name == "hugepage") {
+    *prefetch = InputPrefetch::HUGEPAGE;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+const char* input_mode_name(InputMode mode) {
+  return (mode == InputMode::READ) ? "read" : "mmap";
+}
+
+const char* input_prefetch_name(InputPrefetch prefetch) {
+  switch (prefetch) {
+    case InputPrefetch::NONE:
+      return "none";
+    case InputPrefetch::POPULATE:
+      return "populate";
+    case InputPrefetch::WILLNEED:
+      return "willneed";
+    case InputPrefetch::HUGEPAGE:
+      return "hugepage";
+  }
+  return "unknown";
+}
+
+// Helper: read the whole file into dst (size bytes)
+static bool read_all(int fd, uint8_t* dst, size_t size) {
+  size_t done = 0;
+  while (done < size) {
+    ssize_t n = read(fd, dst + done, size - done);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      return false;
+    }
+    if (n == 0) break;
+    done += n;
+  }
+  return done == size;
+}
+
+InputFile::~InputFile() { close(); }
+
+bool InputFile::open(const std::string& path, InputMode mode,
+                     InputPrefetch prefetch) {
+  close();
+  mode_ = mode;
+  prefetch_ = prefetch;
+
+  ResourceSnapshot load_start;
+  capture_resources(&load_start);
+
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    fprintf(stderr, "Failed to open input file %s: %s\n", path.c_str(),
+            strerror(errno));
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+    fprintf(stderr, "Input file %s is empty or cannot be stat'ed\n",
+            path.c_str());
+    ::close(fd);
+    return false;
+  }
+  size_t size = (size_t)st.st_size;
+
+  bool ok = true;
+  if (mode == InputMode::READ) {
+    // Heap copy (the old behavior)
+    buffer_.resize(size);
+    ok = read_all(fd, buffer_.data(), size);
+    data_ = buffer_.data();
+  } else if (prefetch == InputPrefetch::HUGEPAGE) {
+    // Anonymous THP-backed buffer, filled once at load time
+    map_size_ = (size + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+    map_addr_ = mmap(nullptr, map_size_, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (map_addr_ == MAP_FAILED) {
+      map_addr_ = nullptr;
+      ok = false;
+    } else {
+#ifdef MADV_HUGEPAGE
+      madvise(map_addr_, map_size_, MADV_HUGEPAGE);
+#endif
+      ok = read_all(fd, static_cast<uint8_t*>(map_addr_), size);
+      data_ = static_cast<const uint8_t*>(map_addr_);
+    }
+  } else {
+    // Zero-copy file mapping. Read-only on purpose: MAP_POPULATE on a
+    // writable private mapping would break COW and copy the whole file.
+    int flags = MAP_PRIVATE;
+    if (prefetch == InputPrefetch::POPULATE) {
+      flags |= MAP_POPULATE;
+    }
+    map_size_ = size;
+    map_addr_ = mmap(nullptr, map_size_, PROT_READ, flags, fd, 0);
+    if (map_addr_ == MAP_FAILED) {
+      map_addr_ = nullptr;
+      ok = false;
+    } else {
+      if (prefetch == InputPrefetch::WILLNEED) {
+        madvise(map_addr_, map_size_, MADV_WILLNEED);
+      }
+      data_ = static_cast<const uint8_t*>(map_addr_);
+    }
+  }
+  ::close(fd);
+
+  if (!ok) {
+    fprintf(stderr, "Failed to load input file %s (%s/%s): %s\n", path.c_str(),
+            input_mode_name(mode), input_prefetch_name(prefetch),
+            strerror(errno));
+    close();
+    return false;
+  }
+  size_ = size;
+
+  ResourceSnapshot load_end;
+  capture_resources(&load_end);
+  compute_delta(&load_start, &load_end, &load_delta_);
+  return true;
+}
+
+void InputFile::close() {
+  if (map_addr_ != nullptr) {
+    munmap(map_addr_, map_size_);
+    map_addr_ = nullptr;
+  }
+  map_size_ = 0;
+  buffer_.clear();
+  buffer_.shrink_to_fit();
+  data_ = nullptr;
+  size_ = 0;
+}
+
+InputCache::InputCache(size_t capacity, InputMode mode, InputPrefetch prefetch)
+    : capacity_(capacity < 1 ? 1 : capacity),
+      mode_(mode),
+      prefetch_(prefetch) {}
+
+std::shared_ptr<const InputFile> InputCache::get(const std::string& path,
+                                                 bool* hit) {
+  for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+    if (it->path == path) {
+      entries_.splice(entries_.begin(), entries_, it);
+      hits_++;
+      *hit = true;
+      return entries_.front().file;
+    }
+  }
+  *hit = false;
+  misses_++;
+
+  // Evict first, so that the cache never holds more than capacity files
+  while (entries_.size() >= capacity_) {
+    entries_.pop_back();
+    evictions_++;
+  }
+  auto file = std::make_shared<InputFile>();
+  if (!file->open(path, mode_, prefetch_)) {
+    return nullptr;
+  }
+  entries_.push_front({path, file});
+  return file;
+}
+
+// Helper: read size bytes at offset into dst
+static bool pread_all(int fd, uint8_t* dst, size_t size, off_t offset) {
+  size_t done = 0;
+  while (done < size) {
+    ssize_t n = pread(fd, dst + done, size - done, offset + done);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      return false;
+    }
+    if (n == 0) break;
+    done += n;
+  }
+  return done == size;
+}
+
+// Helper: read the text line at offset (without the trailing '\n')
+static bool pread_line(int fd, off_t offset, std::string* line) {
+  // y4m header lines are short, anything longer is not a y4m file
+  static constexpr size_t MAX_LINE = 4096;
+  char buf[256];
+  line->clear();
+  while (line->size() < MAX_LINE) {
+    ssize_t n = pread(fd, buf, sizeof(buf), offset);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      return false;
+    }
+    if (n == 0) return false;
+    const char* eol = static_cast<const char*>(memchr(buf, '\n', n));
+    if (eol != nullptr) {
+      line->append(buf, eol - buf);
+      return true;
+    }
+    line->append(buf, n);
+    offset += n;
+  }
+  return false;
+}
+
+// Helper: check a y4m stream header against the expected frame geometry
+static bool check_y4m_header(const std::string& path,
+                             const std::string& header, int width,
+                             int height) {
+  int y4m_width = 0;
+  int y4m_height = 0;
+  std::string colorspace = "420";
+  size_t pos = 0;
+  while (pos < header.size()) {
+    size_t end = header.find(' ', pos);
+    if (end == std::string::npos) end = header.size();
+    std::string token = header.substr(pos, end - pos);
+    if (!token.empty()) {
+      if (token[0] == 'W') {
+        y4m_width = atoi(token.c_str() + 1);
+      } else if (token[0] == 'H') {
+        y4m_height = atoi(token.c_str() + 1);
+      } else if (token[0] == 'C') {
+        colorspace = token.substr(1);
+      }
+    }
+    pos = end + 1;
+  }
+  if (y4m_width != width || y4m_height != height) {
+    fprintf(stderr, "y4m file %s is %dx%d, expected %dx%d\n", path.c_str(),
+            y4m_width, y4m_height, width, height);
+    return false;
+  }
+  // Only 8-bit 4:2:0 (the chroma siting variants share the same layout)
+  if (colorspace != "420" && colorspace != "420jpeg" &&
+      colorspace != "420paldv" && colorspace != "420mpeg2") {
+    fprintf(stderr,
+            "y4m file %s: unsupported colorspace C%s (need 8-bit 420)\n",
+            path.c_str(), colorspace.c_str());
+    return false;
+  }
+  return true;
+}
+
+FrameSource::~FrameSource() { close(); }
+
+bool FrameSource::open(const std::string& path, int width, int height,
+                       size_t frame_size) {
+  close();
+
+  ResourceSnapshot load_start;
+  capture_resources(&load_start);
+
+  fd_ = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd_ < 0) {
+    fprintf(stderr, "Failed to open input file %s: %s\n", path.c_str(),
+            strerror(errno));
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd_, &st) != 0 || st.st_size <= 0) {
+    fprintf(stderr, "Input file %s is empty or cannot be stat'ed\n",
+            path.c_str());
+    close();
+    return false;
+  }
+  file_size_ = (size_t)st.st_size;
+  size_t yuv420_frame_size = (size_t)width * height * 3 / 2;
+  frame_size_ = (frame_size > 0) ? frame_size : yuv420_frame_size;
+
+  // Build the frame index
+  std::string header;
+  y4m_ = pread_line(fd_, 0, &header) &&
+         header.compare(0, 10, "YUV4MPEG2 ") == 0;
+  if (y4m_) {
+    if (frame_size_ != yuv420_frame_size) {
+      fprintf(stderr, "y4m file %s: only yuv420p input is supported\n",
+              path.c_str());
+      close();
+      return false;
+    }
+    if (!check_y4m_header(path, header, width, height)) {
+      close();
+      return false;
+    }
+    // Each frame is a "FRAME[ params]\n" line followed by the pixel data
+    off_t offset = header.size() + 1;
+    std::string frame_header;
+    while ((size_t)offset < file_size_) {
+      if (!pread_line(fd_, offset, &frame_header) ||
+          frame_header.compare(0, 5, "FRAME") != 0) {
+        fprintf(stderr, "y4m file %s: bad frame header at offset %lld\n",
+                path.c_str(), (long long)offset);
+        close();
+        return false;
+      }
+      off_t data_offset = offset + frame_header.size() + 1;
+      if ((size_t)data_offset + frame_size_ > file_size_) {
+        fprintf(stderr, "y4m file %s: ignoring truncated frame %zu\n",
+                path.c_str(), frame_offsets_.size());
+        break;
+      }
+      frame_offsets_.push_back(data_offset);
+      offset = data_offset + frame_size_;
+    }
+  } else {
+    size_t num_frames = file_size_ / frame_size_;
+    if (file_size_ % frame_size_ != 0) {
+      fprintf(stderr, "Input file %s: ignoring %zu trailing bytes\n",
+              path.c_str(), file_size_ % frame_size_);
+    }
+    for (size_t i = 0; i < num_frames; i++) {
+      frame_offsets_.push_back((off_t)(i * frame_size_));
+    }
+  }
+  if (frame_offsets_.empty()) {
+    fprintf(stderr, "Input file %s has no complete %dx%d frame\n",
+            path.c_str(), width, height);
+    close();
+    return false;
+  }
+
+  // Frames are consumed in order
+  posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+  first_frame_.resize(frame_size_);
+  if (!pread_all(fd_, first_frame_.data(), frame_size_, frame_offsets_[0])) {
+    fprintf(stderr, "Failed to read first frame of %s: %s\n", path.c_str(),
+            strerror(errno));
+    close();
+    return false;
+  }
+
+  ResourceSnapshot load_end;
+  capture_resources(&load_end);
+  compute_delta(&load_start, &load_end, &load_delta_);
+  return true;
+}
+
+void FrameSource::close() {
+  if (fd_ >= 0) {
+    ::close(fd_);
+    fd_ = -1;
+  }
+  frame_offsets_.clear();
+  frame_offsets_.shrink_to_fit();
+  first_frame_.clear();
+  first_frame_.shrink_to_fit();
+  frame_size_ = 0;
+  file_size_ = 0;
+  y4m_ = false;
+}
+
+bool FrameSource::read_frame(int index, uint8_t* dst) const {
+  if (fd_ < 0 || frame_offsets_.empty() || index < 0) {
+    return false;
+  }
+  off_t offset = frame_offsets_[index % frame_offsets_.size()];
+  if (!pread_all(fd_, dst, frame_size_, offset)) {
+    fprintf(stderr, "Failed to read input frame %d: %s\n", index,
+            strerror(errno));
+    return false;
+  }
+  // Drop the frame from the page cache so long clips do not fill it up
+  posix_fadvise(fd_, offset, frame_size_, POSIX_FADV_DONTNEED);
+  return true;
+}
+
+FrameRing::FrameRing(const CodecInput* input,
+                     std::initializer_list<anicet::color::ColorFormat> native)
+    : input_(input) {
+  int ring_size = input_->frame_ring_size < 1 ? 1 : input_->frame_ring_size;
+  const FrameSource* source = input_->frame_source;
+  if (source != nullptr) {
+    if (ring_size > source->num_frames()) {
+      ring_size = source->num_frames();
+    }
+    slots_.resize(ring_size * source->frame_size());
+    slot_frame_.assign(ring_size, -1);
+  }
+
+  // Unknown formats are rejected by anicet_experiment()
+  if (input_->color_format != nullptr &&
+      anicet::color::parse_color_format(input_->color_format,
+                                        &input_format_)) {
+    format_ = anicet::color::codec_format(input_format_, native);
+  }
+  if (format_ != input_format_) {
+    converted_slots_ = (source != nullptr) ? ring_size : 1;
+    converted_.resize(converted_slots_ *
+                      anicet::color::frame_size(format_, input_->width,
+                                                input_->height));
+  }
+}
+
+const uint8_t* FrameRing::source_frame(int run) {
+  const FrameSource* source = input_->frame_source;
+  if (source == nullptr) {
+    return input_->input_buffer;
+  }
+  // Slots rotate with the run (not the frame index) so that wrapping around
+  // the clip never overwrites the previous frame
+  int index = (input_->run_offset + run) % source->num_frames();
+  size_t slot = run % slot_frame_.size();
+  uint8_t* dst = slots_.data() + slot * source->frame_size();
+  if (slot_frame_[slot] != index) {
+    slot_frame_[slot] = -1;
+    if (!source->read_frame(index, dst)) {
+      return nullptr;
+    }
+    slot_frame_[slot] = index;
+  }
+  return dst;
+}
+
+// Helper: calling thread CPU time in milliseconds
+static double thread_cpu_ms() {
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+const uint8_t* FrameRing::frame(int run) {
+  const uint8_t* src = source_frame(run);
+  if (src == nullptr || converted_.empty()) {
+    return src;
+  }
+  uint8_t* dst = converted_.data() + (size_t)(run % converted_slots_) *
+                                         frame_size();
+  int64_t start_us = anicet_get_timestamp();
+  double start_cpu_ms = thread_cpu_ms();
+  anicet::color::convert_to_yuv420p(input_format_, src, input_->width,
+                                    input_->height, dst);
+  conversion_wall_ms_ += (anicet_get_timestamp() - start_us) / 1000.0;
+  conversion_cpu_ms_ += thread_cpu_ms() - start_cpu_ms;
+  return dst;
+}
+
+size_t FrameRing::frame_size() const {
+  if (!converted_.empty()) {
+    return converted_.size() / converted_slots_;
+  }
+  const FrameSource* source = input_->frame_source;
+  return (source == nullptr) ? input_->input_size : source->frame_size();
+}
+
+void FrameRing::take_conversion_time(double* wall_ms, double* cpu_ms) {
+  *wall_ms = conversion_wall_ms_;
+  *cpu_ms = conversion_cpu_ms_;
+  conversion_wall_ms_ = 0.0;
+  conversion_cpu_ms_ = 0.0;
+}
+
+}  // namespace input
+}  // namespace anicet
@@ -0,0 +1,138 @@
+// anicet_manifest.cc
+// Batch manifest loading
+
+#include "anicet_manifest.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#include <nlohmann/json.hpp>
+
+namespace anicet {
+namespace manifest {
+
+using json = nlohmann::ordered_json;
+
+// Helper: tag and parameter values may be written as JSON numbers/booleans
+static std::string value_string(const json& value) {
+  return value.is_string() ? value.get<std::string>() : value.dump();
+}
+
+// Helper: parse one job object
+static bool parse_job(const json& entry, size_t index, ManifestJob* job) {
+  if (!entry.is_object()) {
+    fprintf(stderr, "manifest: Job %zu is not an object\n", index);
+    return false;
+  }
+  for (const auto& [key, value] : entry.items()) {
+    bool valid = true;
+    if (key == "image" || key == "color_format" || key == "codec") {
+      valid = value.is_string();
+      if (valid) {
+        std::string text = value.get<std::string>();
+        if (key == "image") {
+          job->image = text;
+        } else if (key == "color_format") {
+          job->color_format = text;
+        } else {
+          job->codec = text;
+        }
+      }
+    } else if (key == "width" || key == "height") {
+      valid = value.is_number_integer() && value.get<int>() > 0;
+      if (valid) {
+        (key == "width" ? job->width : job->height) = value.get<int>();
+      }
+    } else if (key == "num_runs") {
+      if (value.is_string() && value.get<std::string>() == "auto") {
+        job->auto_runs = true;
+      } else {
+        valid = value.is_number_integer() && value.get<int>() >= 1;
+        if (valid) job->num_runs = value.get<int>();
+      }
+    } else if (key == "params") {
+      if (value.is_string()) {
+        // Parameters of the job's single codec (empty for the CLI one)
+        std::string codec;
+        if (entry.contains("codec") && entry["codec"].is_string()) {
+          codec = entry["codec"].get<std::string>();
+        }
+        valid = codec.find(',') == std::string::npos && codec != "all";
+        if (valid) {
+          job->params.emplace_back(codec, value.get<std::string>());
+        }
+      } else if (value.is_object()) {
+        for (const auto& [codec, params] : value.items()) {
+          if (params.is_string()) {
+            job->params.emplace_back(codec, params.get<std::string>());
+          } else if (params.is_array()) {
+            for (const json& param : params) {
+              job->params.emplace_back(codec, value_string(param));
+            }
+          } else {
+            valid = false;
+          }
+        }
+      } else {
+        valid = false;
+      }
+    } else if (key == "tags") {
+      valid = value.is_object();
+      if (valid) {
+        for (const auto& [tag, tag_value] : value.items()) {
+          job->tags.emplace_back(tag, value_string(tag_value));
+        }
+      }
+    } else {
+      fprintf(stderr, "manifest: Job %zu: Unknown field '%s'\n", index,
+              key.c_str());
+      return false;
+    }
+    if (!valid) {
+      fprintf(stderr, "manifest: Job %zu: Invalid value for '%s': %s\n",
+              index, key.c_str(), value.dump().c_str());
+      return false;
+    }
+  }
+  if (job->image.empty()) {
+    fprintf(stderr, "manifest: Job %zu: Missing image\n", index);
+    return false;
+  }
+  return true;
+}
+
+bool load_manifest(const std::string& path, std::vector<ManifestJob>* jobs) {
+  std::ifstream file(path);
+  if (!file) {
+    fprintf(stderr, "manifest: Failed to open %s\n", path.c_str());
+    return false;
+  }
+  std::stringstream text;
+  text << file.rdbuf();
+  json manifest = json::parse(text.str(), nullptr, false);
+  if (manifest.is_discarded()) {
+    fprintf(stderr, "manifest: %s is not valid JSON\n", path.c_str());
+    return false;
+  }
+  if (manifest.is_object() && manifest.contains("jobs")) {
+    manifest = manifest["jobs"];
+  }
+  if (!manifest.is_array()) {
+    fprintf(stderr, "manifest: %s must be an array of jobs\n", path.c_str());
+    return false;
+  }
+
+  jobs->clear();
+  for (size_t i = 0; i < manifest.size(); i++) {
+    ManifestJob job;
+    if (!parse_job(manifest[i], i, &job)) {
+      return false;
+    }
+    jobs->push_back(job);
+  }
+  return true;
+}
+
+}  // namespace manifest
+}  // namespace anicet
@@ -0,0 +1,180 @@
+// anicet_memory.cc
+// Background memory sampler and per-frame allocations implementation
+
+#include "anicet_memory.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "anicet_common.h"
+#include "anicet_runner.h"
+
+namespace anicet {
+namespace memory {
+
+// Initial timeline capacity (grows if needed, between frames when the
+// allocations are tracked)
+static constexpr size_t INITIAL_SAMPLES = 4096;
+
+// Helper: pread a /proc file into buf (NUL-terminated)
+static bool read_proc_fd(int fd, char* buf, size_t size) {
+  if (fd < 0) {
+    return false;
+  }
+  ssize_t n = pread(fd, buf, size - 1, 0);
+  if (n <= 0) {
+    return false;
+  }
+  buf[n] = '\0';
+  return true;
+}
+
+MemorySampler::MemorySampler(const CodecInput* input, CodecOutput* output,
+                             int num_runs)
+    : output_(output), num_runs_(num_runs) {
+  output_->memory_timeline.clear();
+  output_->memory_frame_peaks.clear();
+  output_->frame_allocs.clear();
+  if (anicet::alloc::enabled() && num_runs > 0) {
+    track_allocs_ = true;
+    frame_allocs_.assign(num_runs, anicet::alloc::AllocStats());
+  }
+  if (input->memory_sample_interval_ms <= 0) {
+    return;
+  }
+  statm_fd_ = open("/proc/self/statm", O_RDONLY | O_CLOEXEC);
+  if (statm_fd_ < 0) {
+    fprintf(stderr, "Warning: cannot open /proc/self/statm: %s\n",
+            strerror(errno));
+    return;
+  }
+  // smaps_rollup needs Linux 4.14
+  smaps_fd_ = open("/proc/self/smaps_rollup", O_RDONLY | O_CLOEXEC);
+  interval_us_ = input->memory_sample_interval_ms * 1000;
+  grow_between_frames_ = track_allocs_;
+  samples_.reserve(INITIAL_SAMPLES);
+  thread_ = std::thread(&MemorySampler::thread_main, this);
+}
+
+MemorySampler::~MemorySampler() {
+  finish();
+  if (statm_fd_ >= 0) close(statm_fd_);
+  if (smaps_fd_ >= 0) close(smaps_fd_);
+}
+
+bool MemorySampler::read_sample(MemorySample* sample, bool with_pss) const {
+  static const long page_kb = sysconf(_SC_PAGESIZE) / 1024;
+  char buf[256];
+  if (!read_proc_fd(statm_fd_, buf, sizeof(buf))) {
+    return false;
+  }
+  // statm: size resident shared text lib data dt (in pages)
+  long size = 0, resident = 0, shared = 0;
+  if (sscanf(buf, "%ld %ld %ld", &size, &resident, &shared) != 3) {
+    return false;
+  }
+  sample->time_us = anicet_get_timestamp();
+  sample->rss_kb = resident * page_kb;
+  sample->file_kb = shared * page_kb;
+  sample->anon_kb = sample->rss_kb - sample->file_kb;
+  sample->pss_kb = -1;
+  if (with_pss) {
+    char rollup[4096];
+    if (read_proc_fd(smaps_fd_, rollup, sizeof(rollup))) {
+      const char* pss = strstr(rollup, "\nPss:");
+      if (pss != nullptr) {
+        sample->pss_kb = strtol(pss + 5, nullptr, 10);
+      }
+    }
+  }
+  return true;
+}
+
+void MemorySampler::thread_main() {
+  // PSS walks all mappings: only sample it when it is cheap compared to the
+  // interval
+  if (smaps_fd_ >= 0) {
+    MemorySample probe;
+    int64_t start_us = anicet_get_timestamp();
+    read_sample(&probe, true);
+    int64_t cost_us = anicet_get_timestamp() - start_us;
+    with_pss_ = probe.pss_kb >= 0 && cost_us * 4 <= interval_us_;
+  }
+
+  anicet::run_sampler_loop(interval_us_, stop_, [&]() {
+    MemorySample sample;
+    if (read_sample(&sample, with_pss_)) {
+      sample.run = current_run_.load(std::memory_order_relaxed);
+      // The timeline growth would count as an allocation of the frame:
+      // grow it ahead of time between frames, and drop the samples of a
+      // frame that fills it
+      if (grow_between_frames_ && sample.run >= 0 &&
+          samples_.size() == samples_.capacity()) {
+        dropped_samples_++;
+      } else {
+        samples_.push_back(sample);
+      }
+      if (grow_between_frames_ && sample.run < 0 &&
+          samples_.size() * 2 > samples_.capacity()) {
+        samples_.reserve(samples_.capacity() * 2);
+      }
+    }
+  });
+}
+
+void MemorySampler::begin_allocs(int run) {
+  if (alloc_run_ >= 0) {
+    alloc_interval_.stop(&frame_allocs_[alloc_run_]);
+  }
+  alloc_run_ = (run >= 0 && run < num_runs_) ? run : -1;
+  if (alloc_run_ >= 0) {
+    alloc_interval_.start();
+  }
+}
+
+void MemorySampler::end_allocs(int run) {
+  if (run == alloc_run_) {
+    begin_allocs(-1);
+  }
+}
+
+void MemorySampler::finish() {
+  if (track_allocs_) {
+    begin_allocs(-1);
+    output_->frame_allocs = std::move(frame_allocs_);
+    frame_allocs_.clear();
+    track_allocs_ = false;
+  }
+  if (!thread_.joinable()) {
+    return;
+  }
+  stop_.store(true, std::memory_order_release);
+  thread_.join();
+  if (dropped_samples_ > 0) {
+    fprintf(stderr,
+            "Warning: memory sampler dropped %d samples inside frames (the "
+            "timeline only grows between frames with --alloc-tracker)\n",
+            dropped_samples_);
+  }
+
+  // Per-frame peaks
+  output_->memory_frame_peaks.assign(num_runs_, FramePeak{-1, -1});
+  for (const MemorySample& sample : samples_) {
+    if (sample.run < 0 || sample.run >= num_runs_) {
+      continue;
+    }
+    FramePeak& peak = output_->memory_frame_peaks[sample.run];
+    if (sample.rss_kb > peak.rss_kb) peak.rss_kb = sample.rss_kb;
+    if (sample.anon_kb > peak.anon_kb) peak.anon_kb = sample.anon_kb;
+  }
+  output_->memory_timeline = std::move(samples_);
+  samples_.clear();
+}
+
+}  // namespace memory
+}  // namespace anicet
@@ -0,0 +1,314 @@
+// anicet_output.cc
+// Encoded frame storage and file writer implementation
+
+#include "anicet_output.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "anicet_common.h"
+
+namespace anicet {
+namespace output {
+
+FrameArena::Slab* FrameArena::open_slab() {
+  return open_ ? slabs_.back().get() : nullptr;
+}
+
+void FrameArena::clear() {
+  frames_.clear();
+  open_used_ = 0;
+  // Keep our own slab (and its touched pages) for the next use
+  if (open_ && slabs_.back().use_count() == 1) {
+    std::shared_ptr<Slab> slab = std::move(slabs_.back());
+    slabs_.clear();
+    slabs_.push_back(std::move(slab));
+    return;
+  }
+  slabs_.clear();
+  open_ = false;
+}
+
+void FrameArena::reserve(size_t bytes) {
+  Slab* slab = open_slab();
+  if (slab == nullptr) {
+    slabs_.push_back(std::make_shared<Slab>());
+    open_ = true;
+    open_used_ = 0;
+    slab = slabs_.back().get();
+  }
+  // resize() (not reserve()) so that the pages are written once here
+  if (slab->size() < open_used_ + bytes) {
+    slab->resize(open_used_ + bytes);
+  }
+}
+
+void FrameArena::reserve_frames(size_t num_frames) {
+  if (frames_.empty() || num_frames == 0) {
+    return;
+  }
+  size_t total = 0;
+  for (const FrameRef& frame : frames_) {
+    total += frame.size;
+  }
+  // 25% headroom for frame size variation
+  size_t average = total / frames_.size();
+  reserve(num_frames * (average + average / 4));
+}
+
+void FrameArena::add_frame() {
+  if (open_slab() == nullptr) {
+    reserve(0);
+  }
+  frames_.push_back({slabs_.size() - 1, open_used_, 0});
+}
+
+void FrameArena::append(const uint8_t* data, size_t size) {
+  Slab* slab = open_slab();
+  if (size == 0 || slab == nullptr) {
+    return;
+  }
+  // Grow geometrically if the reserved space is exhausted
+  if (slab->size() < open_used_ + size) {
+    slab->resize(std::max(open_used_ + size, 2 * slab->size()));
+  }
+  memcpy(slab->data() + open_used_, data, size);
+  open_used_ += size;
+  frames_.back().size += size;
+}
+
+void FrameArena::splice(const FrameArena& other) {
+  size_t slab_base = slabs_.size();
+  slabs_.insert(slabs_.end(), other.slabs_.begin(), other.slabs_.end());
+  for (const FrameRef& frame : other.frames_) {
+    frames_.push_back({slab_base + frame.slab, frame.offset, frame.size});
+  }
+  // The last slab now belongs to other, new frames go to a new slab
+  if (!other.slabs_.empty()) {
+    open_ = false;
+    open_used_ = 0;
+  }
+}
+
+const uint8_t* FrameArena::frame_data(size_t index) const {
+  const FrameRef& frame = frames_[index];
+  return slabs_[frame.slab]->data() + frame.offset;
+}
+
+// Alignment (buffer address, length, file offset) required by O_DIRECT
+static constexpr size_t DIRECT_IO_ALIGNMENT = 4096;
+
+bool parse_writer_mode(const std::string& name, WriterMode* mode) {
+  if (name == "sync") {
+    *mode = WriterMode::SYNC;
+  } else if (name == "async") {
+    *mode = WriterMode::ASYNC;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+bool parse_writer_io(const std::string& name, WriterIo* io) {
+  if (name == "write") {
+    *io = WriterIo::WRITE;
+  } else if (name == "direct") {
+    *io = WriterIo::DIRECT;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+const char* writer_mode_name(WriterMode mode) {
+  return (mode == WriterMode::SYNC) ? "sync" : "async";
+}
+
+const char* writer_io_name(WriterIo io) {
+  return (io == WriterIo::WRITE) ? "write" : "direct";
+}
+
+// Helper: write size bytes from data to fd
+static bool write_all(int fd, const uint8_t* data, size_t size) {
+  size_t done = 0;
+  while (done < size) {
+    ssize_t n = write(fd, data + done, size - done);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      return false;
+    }
+    done += n;
+  }
+  return true;
+}
+
+FileWriter::FileWriter(WriterMode mode, WriterIo io, size_t queue_depth)
+    : mode_(mode), io_(io), queue_depth_(queue_depth < 1 ? 1 : queue_depth) {
+  if (mode_ == WriterMode::ASYNC) {
+    thread_ = std::thread(&FileWriter::thread_main, this);
+  }
+}
+
+FileWriter::~FileWriter() {
+  flush();
+  if (thread_.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    queue_cv_.notify_all();
+    thread_.join();
+  }
+  free(direct_buffer_);
+}
+
+void FileWriter::submit(std::vector<std::string> filenames,
+                        const FrameArena& frames) {
+  Batch batch;
+  batch.filenames = std::move(filenames);
+  batch.frames.splice(frames);
+  if (mode_ == WriterMode::SYNC) {
+    write_batch(batch);
+    return;
+  }
+  std::unique_lock<std::mutex> lock(mutex_);
+  queue_cv_.wait(lock, [this] { return queue_.size() < queue_depth_; });
+  queue_.push_back(std::move(batch));
+  queue_cv_.notify_all();
+}
+
+void FileWriter::flush() {
+  if (mode_ == WriterMode::SYNC) {
+    return;
+  }
+  int64_t start_us = anicet_get_timestamp();
+  std::unique_lock<std::mutex> lock(mutex_);
+  queue_cv_.wait(lock, [this] { return queue_.empty() && !busy_; });
+  stats_.flush_time_ms += (anicet_get_timestamp() - start_us) / 1000.0;
+}
+
+WriterStats FileWriter::stats() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+void FileWriter::thread_main() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    queue_cv_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+    if (queue_.empty()) {
+      // stop_ with nothing left to write
+      return;
+    }
+    Batch batch = std::move(queue_.front());
+    queue_.pop_front();
+    busy_ = true;
+    // Room in the queue
+    queue_cv_.notify_all();
+    lock.unlock();
+    write_batch(batch);
+    lock.lock();
+    busy_ = false;
+    queue_cv_.notify_all();
+  }
+}
+
+void FileWriter::write_batch(const Batch& batch) {
+  std::lock_guard<std::mutex> io_lock(io_mutex_);
+  int64_t start_us = anicet_get_timestamp();
+  size_t num_files =
+      std::min(batch.filenames.size(), batch.frames.num_frames());
+  int files = 0;
+  size_t bytes = 0;
+  int errors = 0;
+  for (size_t i = 0; i < num_files; i++) {
+    size_t size = batch.frames.frame_size(i);
+    if (write_file(batch.filenames[i], batch.frames.frame_data(i), size)) {
+      files++;
+      bytes += size;
+    } else {
+      errors++;
+    }
+  }
+  double write_time_ms = (anicet_get_timestamp() - start_us) / 1000.0;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  stats_.files += files;
+  stats_.bytes += bytes;
+  stats_.errors += errors;
+  stats_.write_time_ms += write_time_ms;
+}
+
+bool FileWriter::write_file(const std::string& filename, const uint8_t* data,
+                            size_t size) {
+  int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+  int fd = -1;
+#ifdef O_DIRECT
+  if (io_.load(std::memory_order_relaxed) == WriterIo::DIRECT) {
+    fd = open(filename.c_str(), flags | O_DIRECT, 0644);
+    int error = errno;
+    if (fd >= 0) {
+      if (write_file_direct(fd, data, size)) {
+        close(fd);
+        return true;
+      }
+      // close() may overwrite errno
+      error = errno;
+      close(fd);
+    }
+    if (error != EINVAL) {
+      fprintf(stderr, "Failed to write %s: %s\n", filename.c_str(),
+              strerror(error));
+      return false;
+    }
+    // Filesystem without O_DIRECT support: use plain writes from now on
+    fprintf(stderr, "O_DIRECT not supported for %s, using write()\n",
+            filename.c_str());
+    io_.store(WriterIo::WRITE, std::memory_order_relaxed);
+  }
+#endif
+  fd = open(filename.c_str(), flags, 0644);
+  if (fd < 0 || !write_all(fd, data, size)) {
+    fprintf(stderr, "Failed to write %s: %s\n", filename.c_str(),
+            strerror(errno));
+    if (fd >= 0) close(fd);
+    return false;
+  }
+  close(fd);
+  return true;
+}
+
+bool FileWriter::write_file_direct(int fd, const uint8_t* data, size_t size) {
+  // O_DIRECT needs an aligned buffer and a block-multiple length; the block
+  // padding is cut off with ftruncate() afterwards
+  if (size == 0) {
+    return true;
+  }
+  size_t aligned_size = (size + DIRECT_IO_ALIGNMENT - 1) &
+                        ~(DIRECT_IO_ALIGNMENT - 1);
+  if (aligned_size > direct_buffer_size_) {
+    free(direct_buffer_);
+    direct_buffer_ = nullptr;
+    direct_buffer_size_ = 0;
+    if (posix_memalign(&direct_buffer_, DIRECT_IO_ALIGNMENT, aligned_size) !=
+        0) {
+      direct_buffer_ = nullptr;
+      errno = ENOMEM;
+      return false;
+    }
+    direct_buffer_size_ = aligned_size;
+  }
+  uint8_t* buffer = static_cast<uint8_t*>(direct_buffer_);
+  memcpy(buffer, data, size);
+  memset(buffer + size, 0, aligned_size - size);
+  return write_all(fd, buffer, aligned_size) && ftruncate(fd, size) == 0;
+}
+
+}  // namespace output
+}  // namespace anicet
@@ -3,6 +3,8 @@
 
 #include "anicet_parameter.h"
 
+#include <stdint.h>
+
 #include <algorithm>
 #include <cstdio>
 #include <sstream>
@@ -44,6 +46,13 @@ bool validate_and_set_parameter(const std::string& codec_name,
                                    descriptor.valid_values)) {
         return false;
       }
+      if (descriptor.value_supported &&
+          !descriptor.value_supported(param_value)) {
+        fprintf(stderr, "%s: Value '%s' for parameter '%s' is not supported "
+                "on this device\n",
+                codec_name.c_str(), param_value.c_str(), param_name.c_str());
+        return false;
+      }
       setup->parameter_map[param_name] = param_value;
       break;
     }
@@ -92,16 +101,165 @@ bool validate_and_set_parameter(const std::string& codec_name,
   return true;
 }
 
+// Helper: Validate a single value and return it as a CodecSetupValue
+static bool validate_single_value(const std::string& codec_name,
+                                  const std::string& param_name,
+                                  const std::string& param_value,
+                                  const ParameterDescriptor& descriptor,
+                                  CodecSetupValue* value) {
+  CodecSetup tmp;
+  if (!validate_and_set_parameter(codec_name, param_name, param_value,
+                                  descriptor, &tmp)) {
+    return false;
+  }
+  *value = tmp.parameter_map[param_name];
+  return true;
+}
+
+// Largest number of values of a swept range (e.g. a step of 1 over a full
+// int range is a typo, not a sweep)
+static constexpr int64_t MAX_SWEEP_VALUES = 10000;
+
+// Parse a sweep value ("a..b[:step]" or "v1|v2|v3") into a list of values
+// Returns true on success, false on error (with error message printed)
+static bool parse_sweep_values(const std::string& codec_name,
+                               const std::string& param_name,
+                               const std::string& param_value,
+                               const ParameterDescriptor& descriptor,
+                               std::vector<CodecSetupValue>* values) {
+  values->clear();
+
+  // Explicit list of values: "v1|v2|v3"
+  if (param_value.find('|') != std::string::npos) {
+    for (const auto& item : split(param_value, '|')) {
+      // Prune the valid values this device cannot run (e.g. SIMD levels)
+      std::string name = trim(item);
+      if (descriptor.value_supported &&
+          std::find(descriptor.valid_values.begin(),
+                    descriptor.valid_values.end(),
+                    name) != descriptor.valid_values.end() &&
+          !descriptor.value_supported(name)) {
+        fprintf(stderr, "%s: Skipping %s=%s (not supported on this device)\n",
+                codec_name.c_str(), param_name.c_str(), name.c_str());
+        continue;
+      }
+      CodecSetupValue value;
+      if (!validate_single_value(codec_name, param_name, trim(item),
+                                 descriptor, &value)) {
+        return false;
+      }
+      values->push_back(value);
+    }
+    if (values->empty()) {
+      fprintf(stderr, "%s: No value of the '%s' sweep is supported\n",
+              codec_name.c_str(), param_name.c_str());
+      return false;
+    }
+    return true;
+  }
+
+  // Numeric range: "a..b" or "a..b:step"
+  size_t range_pos = param_value.find("..");
+  if (descriptor.type == ParameterType::STRING_LIST) {
+    fprintf(stderr, "%s: Ranges are not supported for parameter '%s'\n",
+            codec_name.c_str(), param_name.c_str());
+    fprintf(stderr, "Use a list instead: %s=value1|value2\n",
+            param_name.c_str());
+    return false;
+  }
+  std::string first = trim(param_value.substr(0, range_pos));
+  std::string rest = param_value.substr(range_pos + 2);
+  std::string last = rest;
+  std::string step;
+  size_t step_pos = rest.find(':');
+  if (step_pos != std::string::npos) {
+    last = rest.substr(0, step_pos);
+    step = trim(rest.substr(step_pos + 1));
+  }
+  last = trim(last);
+
+  CodecSetupValue first_value;
+  CodecSetupValue last_value;
+  if (!validate_single_value(codec_name, param_name, first, descriptor,
+                             &first_value) ||
+      !validate_single_value(codec_name, param_name, last, descriptor,
+                             &last_value)) {
+    return false;
+  }
+
+  // Number of values of the range (checked before expanding it)
+  int64_t count = 0;
+  try {
+    if (descriptor.type == ParameterType::INTEGER_RANGE) {
+      // 64-bit arithmetic: the values near INT_MAX must not wrap around
+      int64_t a = std::get<int>(first_value);
+      int64_t b = std::get<int>(last_value);
+      int64_t s = step.empty() ? 1 : std::stoll(step);
+      if (s <= 0 || a > b) {
+        throw std::invalid_argument("bad range");
+      }
+      count = (b - a) / s + 1;
+      if (count <= MAX_SWEEP_VALUES) {
+        for (int64_t i = 0; i < count; i++) {
+          values->push_back((int)(a + i * s));
+        }
+      }
+    } else {
+      double a = std::get<double>(first_value);
+      double b = std::get<double>(last_value);
+      double s = step.empty() ? 1.0 : std::stod(step);
+      if (!(s > 0) || a > b) {
+        throw std::invalid_argument("bad range");
+      }
+      double points = (b - a) / s + 1e-9;
+      count = points < (double)MAX_SWEEP_VALUES ? (int64_t)points + 1
+                                                : MAX_SWEEP_VALUES + 1;
+      if (count <= MAX_SWEEP_VALUES) {
+        // Compute each point from the start to avoid accumulating error
+        for (int64_t i = 0; i < count; i++) {
+          values->push_back(a + i * s);
+        }
+      }
+    }
+  } catch (const std::exception&) {
+    fprintf(stderr, "%s: Invalid range for parameter '%s': '%s'\n",
+            codec_name.c_str(), param_name.c_str(), param_value.c_str());
+    fprintf(stderr,
+            "Expected format: %s=min..max[:step] (min <= max, step > 0)\n",
+            param_name.c_str());
+    return false;
+  }
+  if (count > MAX_SWEEP_VALUES) {
+    fprintf(stderr,
+            "%s: Range for parameter '%s' has more than %lld values: '%s'\n",
+            codec_name.c_str(), param_name.c_str(),
+            (long long)MAX_SWEEP_VALUES, param_value.c_str());
+    return false;
+  }
+  return true;
+}
+
 // Parse parameter string
 bool parse_parameter_string(
     const std::string& codec_name, const std::string& param_string,
     const std::map<std::string, ParameterDescriptor>& descriptors,
     CodecSetup* setup) {
   // Split by both colon and comma for compatibility
-  // Try colon first, fall back to comma
+  // Try colon first, fall back to comma. With colons, a token without '='
+  // following a range (e.g. the "4" in "crf=18..40:4") is the range step.
   std::vector<std::string> pairs;
   if (param_string.find(':') != std::string::npos) {
-    pairs = split(param_string, ':');
+    for (const auto& token : split(param_string, ':')) {
+      std::string trimmed = trim(token);
+      if (!pairs.empty() && !trimmed.empty() &&
+          trimmed.find('=') == std::string::npos &&
+          pairs.back().find("..") != std::string::npos &&
+          pairs.back().find(':') == std::string::npos) {
+        pairs.back() += ":" + trimmed;
+        continue;
+      }
+      pairs.push_back(trimmed);
+    }
   } else {
     pairs = split(param_string, ',');
   }
@@ -132,23 +290,54 @@ bool parse_parameter_string(
       return false;
     }
 
+    // Sweep values ("a..b[:step]" or "v1|v2") go into sweep_map
+    if (value.find("..") != std::string::npos ||
+        value.find('|') != std::string::npos) {
+      std::vector<CodecSetupValue> values;
+      if (!parse_sweep_values(codec_name, key, value, it->second, &values)) {
+        return false;
+      }
+      setup->parameter_map.erase(key);
+      if (values.size() == 1) {
+        setup->parameter_map[key] = values[0];
+        setup->sweep_map.erase(key);
+      } else {
+        setup->sweep_map[key] = values;
+      }
+      continue;
+    }
+
     // Validate and set
     if (!validate_and_set_parameter(codec_name, key, value, it->second,
                                     setup)) {
       return false;
     }
+    setup->sweep_map.erase(key);
   }
 
   return true;
 }
 
+// Helper: Check whether a parameter value satisfies a required string value
+static bool value_matches(const CodecSetupValue& value,
+                          const std::string& required) {
+  // Required param is not a string, skip check
+  if (!std::holds_alternative<std::string>(value)) return true;
+  return std::get<std::string>(value) == required;
+}
+
 // Validate parameter dependencies
 bool validate_parameter_dependencies(
     const std::string& codec_name,
     const std::map<std::string, ParameterDescriptor>& descriptors,
     const CodecSetup& setup) {
+  // Collect both fixed and swept parameter names
+  std::vector<std::string> param_names;
+  for (const auto& kv : setup.parameter_map) param_names.push_back(kv.first);
+  for (const auto& kv : setup.sweep_map) param_names.push_back(kv.first);
+
   // Check each set parameter has its dependencies satisfied
-  for (const auto& [param_name, param_value] : setup.parameter_map) {
+  for (const auto& param_name : param_names) {
     auto desc_it = descriptors.find(param_name);
     if (desc_it == descriptors.end())
       continue;  // Skip unknown (shouldn't happen)
@@ -160,6 +349,26 @@ bool validate_parameter_dependencies(
       const std::string& req_param = descriptor.requires_param.value();
       const std::string& req_value = descriptor.requires_value.value();
 
+      // A swept required parameter only needs one matching value: the grid
+      // expansion skips the points where the dependency does not hold
+      auto sweep_it = setup.sweep_map.find(req_param);
+      if (sweep_it != setup.sweep_map.end()) {
+        bool any_match =
+            std::any_of(sweep_it->second.begin(), sweep_it->second.end(),
+                        [&](const CodecSetupValue& v) {
+                          return value_matches(v, req_value);
+                        });
+        if (!any_match) {
+          fprintf(stderr, "%s: Parameter '%s' requires: %s=%s\n",
+                  codec_name.c_str(), param_name.c_str(), req_param.c_str(),
+                  req_value.c_str());
+          fprintf(stderr, "No value in the '%s' sweep satisfies it\n",
+                  req_param.c_str());
+          return false;
+        }
+        continue;
+      }
+
       // Check if required parameter is set with required value
       auto req_it = setup.parameter_map.find(req_param);
       if (req_it == setup.parameter_map.end()) {
@@ -169,19 +378,13 @@ bool validate_parameter_dependencies(
       }
 
       // Check if the value matches
-      try {
+      if (!value_matches(req_it->second, req_value)) {
         const std::string& actual_value = std::get<std::string>(req_it->second);
-        if (actual_value != req_value) {
-          fprintf(stderr, "%s: Cannot use '%s' when %s=%s\n",
-                  codec_name.c_str(), param_name.c_str(), req_param.c_str(),
-                  actual_value.c_str());
-          fprintf(stderr, "Parameter '%s' requires: %s=%s\n",
-                  param_name.c_str(), req_param.c_str(), req_value.c_str());
-          return false;
-        }
-      } catch (const std::bad_variant_access&) {
-        // Required param is not a string, skip check
-        continue;
+        fprintf(stderr, "%s: Cannot use '%s' when %s=%s\n", codec_name.c_str(),
+                param_name.c_str(), req_param.c_str(), actual_value.c_str());
+        fprintf(stderr, "Parameter '%s' requires: %s=%s\n", param_name.c_str(),
+                req_param.c_str(), req_value.c_str());
+        return false;
       }
     }
   }
@@ -189,6 +392,89 @@ bool validate_parameter_dependencies(
   return true;
 }
 
+// Helper: Check dependencies of a fully expanded parameter map (silent)
+static bool dependencies_satisfied(
+    const std::map<std::string, ParameterDescriptor>& descriptors,
+    const CodecSetupParameterMap& parameter_map) {
+  for (const auto& kv : parameter_map) {
+    auto desc_it = descriptors.find(kv.first);
+    if (desc_it == descriptors.end() ||
+        !desc_it->second.requires_param.has_value()) {
+      continue;
+    }
+    auto req_it = parameter_map.find(desc_it->second.requires_param.value());
+    if (req_it == parameter_map.end() ||
+        !value_matches(req_it->second,
+                       desc_it->second.requires_value.value())) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Expand sweep axes into one CodecSetup per grid point
+std::vector<CodecSetup> expand_parameter_grid(
+    const std::string& codec_name, const CodecSetup& setup,
+    const std::map<std::string, ParameterDescriptor>& descriptors) {
+  CodecSetup base = setup;
+  base.sweep_map.clear();
+
+  // Only expand the axes this codec knows about, outermost axis first
+  // (descriptor display order, so e.g. preset varies slower than crf)
+  std::vector<std::pair<std::string, const std::vector<CodecSetupValue>*>>
+      axes;
+  for (const auto& [name, values] : setup.sweep_map) {
+    if (descriptors.find(name) != descriptors.end() && !values.empty()) {
+      axes.emplace_back(name, &values);
+    }
+  }
+  std::sort(axes.begin(), axes.end(), [&](const auto& a, const auto& b) {
+    int order_a = descriptors.at(a.first).order;
+    int order_b = descriptors.at(b.first).order;
+    if (order_a != order_b) {
+      return order_a < order_b;
+    }
+    return a.first < b.first;  // Alphabetical for same order
+  });
+
+  std::vector<CodecSetup> points;
+  if (axes.empty()) {
+    points.push_back(base);
+    return points;
+  }
+
+  // Odometer-style walk over the cartesian product (last axis fastest)
+  std::vector<size_t> index(axes.size(), 0);
+  int skipped = 0;
+  for (;;) {
+    CodecSetup point = base;
+    for (size_t i = 0; i < axes.size(); i++) {
+      point.parameter_map[axes[i].first] = (*axes[i].second)[index[i]];
+    }
+    if (dependencies_satisfied(descriptors, point.parameter_map)) {
+      points.push_back(point);
+    } else {
+      skipped++;
+    }
+
+    // Advance to the next point, stop once the first axis wraps around
+    size_t axis = axes.size();
+    while (axis > 0 && ++index[axis - 1] == axes[axis - 1].second->size()) {
+      index[axis - 1] = 0;
+      axis--;
+    }
+    if (axis == 0) break;
+  }
+
+  if (skipped > 0) {
+    fprintf(stderr,
+            "%s: Skipping %d sweep point(s) with unsatisfied parameter "
+            "dependencies\n",
+            codec_name.c_str(), skipped);
+  }
+  return points;
+}
+
 // Helper: Format value for display
 static std::string format_value(const CodecSetupValue& value) {
   if (std::holds_alternative<int>(value)) {
@@ -307,6 +593,8 @@ static void print_help_concise(
   printf("Usage: --%s param=value:param=value:...\n", codec_name.c_str());
   printf("   or: --%s param=value --%s param=value ...\n", codec_name.c_str(),
          codec_name.c_str());
+  printf("Sweep: --%s param=min..max[:step],param=value1|value2\n",
+         codec_name.c_str());
 
   // Codec-specific examples
   if (codec_name == "x265") {
@@ -380,7 +668,9 @@ static void print_help_verbose(
   printf("USAGE\n");
   printf("-----\n");
   printf("--%s param=value:param=value:...\n", codec_name.c_str());
-  printf("--%s param=value --%s param=value ...\n\n", codec_name.c_str(),
+  printf("--%s param=value --%s param=value ...\n", codec_name.c_str(),
+         codec_name.c_str());
+  printf("--%s param=min..max[:step],param=value1|value2 (sweep)\n\n",
          codec_name.c_str());
 
   printf("EXAMPLE\n");
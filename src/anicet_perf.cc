@@ -0,0 +1,228 @@
+// anicet_perf.cc
+// In-process hardware performance counters implementation
+
+#include "anicet_perf.h"
+
+#include <errno.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+
+#include "anicet_runner.h"
+
+namespace anicet {
+namespace perf {
+
+const char* counter_name(int counter) {
+  switch (counter) {
+    case CYCLES:
+      return "cycles";
+    case INSTRUCTIONS:
+      return "instructions";
+    case L1D_READ_MISSES:
+      return "l1d_read_misses";
+    case LLC_READ_MISSES:
+      return "llc_read_misses";
+    case BRANCH_MISSES:
+      return "branch_misses";
+    case STALLED_CYCLES_FRONTEND:
+      return "stalled_cycles_frontend";
+    case STALLED_CYCLES_BACKEND:
+      return "stalled_cycles_backend";
+  }
+  return "unknown";
+}
+
+#ifdef __linux__
+// perf_event type/config of each counter (in Counter order)
+struct CounterConfig {
+  uint32_t type;
+  uint64_t config;
+};
+
+static constexpr uint64_t cache_config(uint64_t cache, uint64_t op,
+                                       uint64_t result) {
+  return cache | (op << 8) | (result << 16);
+}
+
+static const CounterConfig COUNTER_CONFIGS[NUM_COUNTERS] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HW_CACHE,
+     cache_config(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ,
+                  PERF_COUNT_HW_CACHE_RESULT_MISS)},
+    {PERF_TYPE_HW_CACHE,
+     cache_config(PERF_COUNT_HW_CACHE_LL, PERF_COUNT_HW_CACHE_OP_READ,
+                  PERF_COUNT_HW_CACHE_RESULT_MISS)},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_STALLED_CYCLES_FRONTEND},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_STALLED_CYCLES_BACKEND},
+};
+
+// Helper: open one counter of the group (group_fd -1 for the leader)
+static int open_counter(int counter, int group_fd, bool inherit) {
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = COUNTER_CONFIGS[counter].type;
+  attr.config = COUNTER_CONFIGS[counter].config;
+  attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                     PERF_FORMAT_TOTAL_TIME_RUNNING;
+  // Count user space only (allowed with perf_event_paranoid <= 2)
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.inherit = inherit ? 1 : 0;
+  // pid 0, cpu -1: the calling thread, on any CPU
+  return (int)syscall(__NR_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+#endif
+
+CounterGroup::~CounterGroup() { close(); }
+
+bool CounterGroup::open(bool inherit) {
+  close();
+#ifdef __linux__
+  inherited_ = inherit;
+  leader_fd_ = open_counter(CYCLES, -1, inherited_);
+  if (leader_fd_ < 0 && inherited_ && errno == EINVAL) {
+    // Kernel does not support inherit with group reads
+    inherited_ = false;
+    leader_fd_ = open_counter(CYCLES, -1, inherited_);
+  }
+  if (leader_fd_ < 0) {
+    inherited_ = false;
+    return false;
+  }
+  fds_[CYCLES] = leader_fd_;
+  group_index_[CYCLES] = num_open_++;
+  for (int counter = CYCLES + 1; counter < NUM_COUNTERS; counter++) {
+    // Unsupported events (e.g. no LLC event on this PMU) are skipped
+    int fd = open_counter(counter, leader_fd_, inherited_);
+    if (fd >= 0) {
+      fds_[counter] = fd;
+      group_index_[counter] = num_open_++;
+    }
+  }
+  return true;
+#else
+  (void)inherit;
+  return false;
+#endif
+}
+
+void CounterGroup::close() {
+  for (int counter = 0; counter < NUM_COUNTERS; counter++) {
+    if (fds_[counter] >= 0) {
+      ::close(fds_[counter]);
+    }
+    fds_[counter] = -1;
+    group_index_[counter] = -1;
+  }
+  leader_fd_ = -1;
+  num_open_ = 0;
+  inherited_ = false;
+}
+
+bool CounterGroup::read(CounterSample* sample) const {
+  // PERF_FORMAT_GROUP layout: nr, time_enabled, time_running, values[nr]
+  uint64_t buffer[3 + NUM_COUNTERS];
+  memset(sample, 0, sizeof(*sample));
+  if (leader_fd_ < 0) {
+    return false;
+  }
+  ssize_t n = ::read(leader_fd_, buffer, sizeof(buffer));
+  if (n < (ssize_t)(3 * sizeof(uint64_t)) ||
+      buffer[0] != (uint64_t)num_open_) {
+    return false;
+  }
+  sample->time_enabled = buffer[1];
+  sample->time_running = buffer[2];
+  for (int counter = 0; counter < NUM_COUNTERS; counter++) {
+    if (group_index_[counter] >= 0) {
+      sample->values[counter] = buffer[3 + group_index_[counter]];
+    }
+  }
+  return true;
+}
+
+void CounterGroup::compute_delta(const CounterSample& start,
+                                 const CounterSample& end,
+                                 CounterValues* delta) const {
+  uint64_t enabled = end.time_enabled - start.time_enabled;
+  uint64_t running = end.time_running - start.time_running;
+  delta->running_ratio = (enabled > 0) ? (double)running / enabled : 0.0;
+  for (int counter = 0; counter < NUM_COUNTERS; counter++) {
+    if (group_index_[counter] < 0 || running == 0) {
+      delta->values[counter] = -1;
+      continue;
+    }
+    // Scale up when the group was multiplexed with other events
+    double count = (double)(end.values[counter] - start.values[counter]);
+    delta->values[counter] = (int64_t)(count * enabled / running);
+  }
+}
+
+FrameCounters::FrameCounters(const CodecInput* input, CodecOutput* output,
+                             int num_runs)
+    : output_(output) {
+  output_->perf_counters.clear();
+  if (!input->perf_counters) {
+    return;
+  }
+  // Inherit, so that encoder threads created during the setup are counted
+  if (!group_.open(true)) {
+    // Report once per process, not once per codec run
+    static std::atomic<bool> warned(false);
+    if (!warned.exchange(true)) {
+      fprintf(stderr,
+              "Warning: perf_event_open failed (%s), no hardware counters. "
+              "Check /proc/sys/kernel/perf_event_paranoid (Android: "
+              "setprop security.perf_harden 0)\n",
+              strerror(errno));
+    }
+    return;
+  }
+  if (!group_.inherited()) {
+    static std::atomic<bool> warned(false);
+    if (!warned.exchange(true)) {
+      fprintf(stderr,
+              "Warning: hardware counters only cover the calling thread "
+              "(encoder worker threads are not counted)\n");
+    }
+  }
+  starts_.resize(num_runs);
+  started_.assign(num_runs, false);
+  output_->perf_counters.resize(num_runs);
+  for (CounterValues& values : output_->perf_counters) {
+    for (int counter = 0; counter < NUM_COUNTERS; counter++) {
+      values.values[counter] = -1;
+    }
+    values.running_ratio = 0.0;
+  }
+}
+
+void FrameCounters::start(int run) {
+  if (group_.is_open()) {
+    started_[run] = group_.read(&starts_[run]);
+  }
+}
+
+void FrameCounters::stop(int run) {
+  if (!group_.is_open() || !started_[run]) {
+    return;
+  }
+  CounterSample end;
+  if (group_.read(&end)) {
+    group_.compute_delta(starts_[run], end, &output_->perf_counters[run]);
+  }
+}
+
+}  // namespace perf
+}  // namespace anicet
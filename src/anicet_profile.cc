@@ -0,0 +1,547 @@
+// anicet_profile.cc
+// Sampling profiler implementation
+
+#include "anicet_profile.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <elf.h>
+#include <link.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+#include <cxxabi.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <unordered_map>
+
+namespace anicet {
+namespace profile {
+
+// Data pages of each ring buffer (power of 2): 256 KB with 4 KB pages, a
+// few hundred samples of deep stacks per CPU between two drains
+static constexpr size_t RING_PAGES = 64;
+// Ring buffer drain interval (microseconds)
+static constexpr int DRAIN_INTERVAL_US = 10000;
+// Deepest call stack recorded (frames)
+static constexpr int MAX_STACK = 64;
+
+static std::atomic<int> g_frequency_hz{0};
+
+bool enable(int frequency_hz) {
+  if (frequency_hz < 1 || frequency_hz > 100000) {
+    fprintf(stderr, "Invalid profiling frequency: %d Hz (valid: 1-100000)\n",
+            frequency_hz);
+    return false;
+  }
+  g_frequency_hz.store(frequency_hz, std::memory_order_relaxed);
+  return true;
+}
+
+bool enabled() { return g_frequency_hz.load(std::memory_order_relaxed) > 0; }
+
+int frequency_hz() { return g_frequency_hz.load(std::memory_order_relaxed); }
+
+void merge_profiles(std::vector<Profile>* profiles,
+                    const std::vector<Profile>& src) {
+  for (const Profile& profile : src) {
+    auto it = std::find_if(
+        profiles->begin(), profiles->end(),
+        [&](const Profile& other) { return other.codec == profile.codec; });
+    if (it == profiles->end()) {
+      profiles->push_back(profile);
+      continue;
+    }
+    it->samples += profile.samples;
+    it->lost += profile.lost;
+    for (const auto& [stack, samples] : profile.folded) {
+      it->folded[stack] += samples;
+    }
+    for (const auto& [key, samples] : profile.functions) {
+      FunctionSamples& total = it->functions[key];
+      total.self += samples.self;
+      total.total += samples.total;
+    }
+  }
+}
+
+std::vector<FunctionEntry> top_functions(const Profile& profile,
+                                         size_t max_functions) {
+  std::vector<FunctionEntry> entries;
+  entries.reserve(profile.functions.size());
+  for (const auto& [key, samples] : profile.functions) {
+    entries.push_back({key.first, key.second, samples});
+  }
+  // Ties by total samples, then by name (stable output)
+  std::sort(entries.begin(), entries.end(),
+            [](const FunctionEntry& a, const FunctionEntry& b) {
+              if (a.samples.self != b.samples.self) {
+                return a.samples.self > b.samples.self;
+              }
+              if (a.samples.total != b.samples.total) {
+                return a.samples.total > b.samples.total;
+              }
+              return a.function < b.function;
+            });
+  if (max_functions > 0 && entries.size() > max_functions) {
+    entries.resize(max_functions);
+  }
+  return entries;
+}
+
+bool write_folded(const Profile& profile, const std::string& path) {
+  FILE* fp = fopen(path.c_str(), "w");
+  if (fp == nullptr) {
+    fprintf(stderr, "Failed to open %s: %s\n", path.c_str(), strerror(errno));
+    return false;
+  }
+  for (const auto& [stack, samples] : profile.folded) {
+    fprintf(fp, "%s %lld\n", stack.c_str(), (long long)samples);
+  }
+  if (fclose(fp) != 0) {
+    fprintf(stderr, "Failed to write %s: %s\n", path.c_str(),
+            strerror(errno));
+    return false;
+  }
+  return true;
+}
+
+#ifdef __linux__
+// Function symbol of an ELF object (address relative to the load bias)
+struct Symbol {
+  uint64_t addr;
+  uint64_t size;
+  std::string name;
+};
+
+// Helper: read the function symbols of an ELF file (.symtab and .dynsym,
+// sorted by address). Files that cannot be read give no symbols.
+static void read_elf_symbols(const std::string& path,
+                             std::vector<Symbol>* symbols) {
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(ElfW(Ehdr))) {
+    close(fd);
+    return;
+  }
+  size_t size = (size_t)st.st_size;
+  void* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    return;
+  }
+  const uint8_t* base = (const uint8_t*)map;
+  const ElfW(Ehdr)* ehdr = (const ElfW(Ehdr)*)base;
+#ifdef __LP64__
+  const int native_class = ELFCLASS64;
+#else
+  const int native_class = ELFCLASS32;
+#endif
+  // Section headers of the native ELF class, within the file
+  if (memcmp(ehdr->e_ident, ELFMAG, SELFMAG) != 0 ||
+      ehdr->e_ident[EI_CLASS] != native_class ||
+      ehdr->e_shentsize != sizeof(ElfW(Shdr)) ||
+      ehdr->e_shoff + (uint64_t)ehdr->e_shnum * sizeof(ElfW(Shdr)) > size) {
+    munmap(map, size);
+    return;
+  }
+  const ElfW(Shdr)* sections = (const ElfW(Shdr)*)(base + ehdr->e_shoff);
+  for (int i = 0; i < ehdr->e_shnum; i++) {
+    const ElfW(Shdr)& section = sections[i];
+    if ((section.sh_type != SHT_SYMTAB && section.sh_type != SHT_DYNSYM) ||
+        section.sh_link >= ehdr->e_shnum ||
+        section.sh_offset + section.sh_size > size) {
+      continue;
+    }
+    const ElfW(Shdr)& strtab = sections[section.sh_link];
+    if (strtab.sh_offset + strtab.sh_size > size) {
+      continue;
+    }
+    const ElfW(Sym)* syms = (const ElfW(Sym)*)(base + section.sh_offset);
+    const char* names = (const char*)(base + strtab.sh_offset);
+    size_t num_syms = section.sh_size / sizeof(ElfW(Sym));
+    for (size_t s = 0; s < num_syms; s++) {
+      const ElfW(Sym)& sym = syms[s];
+      // ELF32_ST_TYPE and ELF64_ST_TYPE are the same (low 4 bits)
+      if ((sym.st_info & 0xf) != STT_FUNC || sym.st_shndx == SHN_UNDEF ||
+          sym.st_value == 0 || sym.st_name >= strtab.sh_size) {
+        continue;
+      }
+      uint64_t addr = sym.st_value;
+#ifdef __arm__
+      // Thumb functions have bit 0 set
+      addr &= ~(uint64_t)1;
+#endif
+      symbols->push_back({addr, (uint64_t)sym.st_size,
+                          std::string(names + sym.st_name,
+                                      strnlen(names + sym.st_name,
+                                              strtab.sh_size - sym.st_name))});
+    }
+  }
+  munmap(map, size);
+  // Symbols in both tables are kept once
+  std::stable_sort(symbols->begin(), symbols->end(),
+                   [](const Symbol& a, const Symbol& b) {
+                     return a.addr < b.addr;
+                   });
+  symbols->erase(std::unique(symbols->begin(), symbols->end(),
+                             [](const Symbol& a, const Symbol& b) {
+                               return a.addr == b.addr;
+                             }),
+                 symbols->end());
+}
+
+// Symbols of the ELF files read so far (the codec libraries stay loaded, so
+// they are read once per process)
+static std::mutex g_symbols_mutex;
+static std::map<std::string, std::unique_ptr<std::vector<Symbol>>> g_symbols;
+
+static const std::vector<Symbol>* elf_symbols(const std::string& path) {
+  std::lock_guard<std::mutex> lock(g_symbols_mutex);
+  std::unique_ptr<std::vector<Symbol>>& symbols = g_symbols[path];
+  if (!symbols) {
+    symbols = std::make_unique<std::vector<Symbol>>();
+    read_elf_symbols(path, symbols.get());
+  }
+  return symbols.get();
+}
+
+// Loaded segment of an ELF object
+struct Segment {
+  uint64_t start;
+  uint64_t end;
+  uint64_t bias;
+  std::string path;
+};
+
+static int collect_segments(struct dl_phdr_info* info, size_t, void* data) {
+  std::vector<Segment>* segments = (std::vector<Segment>*)data;
+  // The main program has no name
+  std::string path = (info->dlpi_name != nullptr && info->dlpi_name[0])
+                         ? info->dlpi_name
+                         : "/proc/self/exe";
+  for (int i = 0; i < info->dlpi_phnum; i++) {
+    const ElfW(Phdr)& phdr = info->dlpi_phdr[i];
+    if (phdr.p_type != PT_LOAD) {
+      continue;
+    }
+    uint64_t start = info->dlpi_addr + phdr.p_vaddr;
+    segments->push_back(
+        {start, start + phdr.p_memsz, (uint64_t)info->dlpi_addr, path});
+  }
+  return 0;
+}
+
+// Helper: library name of an ELF path (the executable name for the main
+// program)
+static std::string library_name(const std::string& path) {
+  std::string name = path;
+  if (path == "/proc/self/exe") {
+    char buf[4096];
+    ssize_t n = readlink(path.c_str(), buf, sizeof(buf) - 1);
+    if (n > 0) {
+      name.assign(buf, n);
+    }
+  }
+  size_t slash = name.rfind('/');
+  return slash == std::string::npos ? name : name.substr(slash + 1);
+}
+
+// Helper: demangled C++ name (the name itself otherwise)
+static std::string demangle(const std::string& name) {
+  int status = 0;
+  char* demangled =
+      abi::__cxa_demangle(name.c_str(), nullptr, nullptr, &status);
+  if (demangled == nullptr) {
+    return name;
+  }
+  std::string result = demangled;
+  free(demangled);
+  return result;
+}
+
+// Symbolizer over the objects loaded at construction
+class Symbolizer {
+ public:
+  Symbolizer() {
+    dl_iterate_phdr(collect_segments, &segments_);
+    std::sort(segments_.begin(), segments_.end(),
+              [](const Segment& a, const Segment& b) {
+                return a.start < b.start;
+              });
+  }
+
+  // Library and function of a code address
+  const std::pair<std::string, std::string>& lookup(uint64_t addr) {
+    auto cached = cache_.find(addr);
+    if (cached != cache_.end()) {
+      return cached->second;
+    }
+    std::pair<std::string, std::string> frame("[unknown]", "[unknown]");
+    auto it = std::upper_bound(
+        segments_.begin(), segments_.end(), addr,
+        [](uint64_t value, const Segment& s) { return value < s.start; });
+    if (it != segments_.begin() && addr < (it - 1)->end) {
+      const Segment& segment = *(it - 1);
+      frame.first = library_name(segment.path);
+      // Code without a symbol is reported as its library
+      frame.second = "[" + frame.first + "]";
+      const std::vector<Symbol>* symbols = elf_symbols(segment.path);
+      uint64_t vaddr = addr - segment.bias;
+      auto sym = std::upper_bound(
+          symbols->begin(), symbols->end(), vaddr,
+          [](uint64_t value, const Symbol& s) { return value < s.addr; });
+      if (sym != symbols->begin()) {
+        const Symbol& symbol = *(sym - 1);
+        // Symbols without a size extend to the next one
+        if (symbol.size == 0 || vaddr < symbol.addr + symbol.size) {
+          frame.second = demangle(symbol.name);
+        }
+      }
+    }
+    return cache_.emplace(addr, std::move(frame)).first->second;
+  }
+
+ private:
+  std::vector<Segment> segments_;
+  std::unordered_map<uint64_t, std::pair<std::string, std::string>> cache_;
+};
+
+// Helper: open the sampling event of the calling thread (and the threads it
+// creates later) on one CPU, cycles or (without a PMU) CPU clock
+static int open_sampling_event(int cpu, bool hardware, bool max_stack) {
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = hardware ? PERF_TYPE_HARDWARE : PERF_TYPE_SOFTWARE;
+  attr.config = hardware ? (uint64_t)PERF_COUNT_HW_CPU_CYCLES
+                         : (uint64_t)PERF_COUNT_SW_CPU_CLOCK;
+  attr.freq = 1;
+  attr.sample_freq = (uint64_t)frequency_hz();
+  attr.sample_type = PERF_SAMPLE_IP | PERF_SAMPLE_CALLCHAIN;
+  attr.disabled = 1;
+  attr.inherit = 1;
+  // User space only (allowed with perf_event_paranoid <= 2)
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.exclude_callchain_kernel = 1;
+  // Older kernels (before 4.8) reject sample_max_stack
+  if (max_stack) {
+    attr.sample_max_stack = MAX_STACK;
+  }
+  // inherit needs per-CPU events to be mmap'ed
+  return (int)syscall(__NR_perf_event_open, &attr, 0, cpu, -1,
+                      PERF_FLAG_FD_CLOEXEC);
+}
+
+// Helper: copy len bytes at ring position pos (wrapping around)
+static void copy_from_ring(const uint8_t* data, size_t data_size,
+                           uint64_t pos, void* dst, size_t len) {
+  size_t offset = pos & (data_size - 1);
+  size_t first = std::min(len, data_size - offset);
+  memcpy(dst, data + offset, first);
+  memcpy((uint8_t*)dst + first, data, len - first);
+}
+#endif
+
+StackSampler::~StackSampler() { close(); }
+
+bool StackSampler::open() {
+  close();
+#ifdef __linux__
+  if (!enabled()) {
+    return false;
+  }
+  // Started before the events are opened, so that it does not inherit them
+  stop_.store(false, std::memory_order_relaxed);
+  thread_ = std::thread(&StackSampler::thread_main, this);
+
+  size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+  long num_cpus = sysconf(_SC_NPROCESSORS_CONF);
+  int error = 0;
+  for (int cpu = 0; cpu < num_cpus; cpu++) {
+    int fd = -1;
+    for (int attempt = 0; attempt < 4 && fd < 0; attempt++) {
+      // Cycles then CPU clock, with then without sample_max_stack
+      fd = open_sampling_event(cpu, attempt < 2, attempt % 2 == 0);
+    }
+    if (fd < 0) {
+      // Offline CPUs fail with ENODEV
+      if (errno != ENODEV) error = errno;
+      continue;
+    }
+    size_t map_size = page_size * (1 + RING_PAGES);
+    void* base =
+        mmap(nullptr, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+      error = errno;
+      ::close(fd);
+      continue;
+    }
+    rings_.push_back({fd, (uint8_t*)base, page_size * RING_PAGES});
+  }
+  if (rings_.empty()) {
+    close();
+    // Report once per process, not once per codec run
+    static std::atomic<bool> warned(false);
+    if (!warned.exchange(true)) {
+      fprintf(stderr,
+              "Warning: perf_event_open failed (%s), no profile. Check "
+              "/proc/sys/kernel/perf_event_paranoid (Android: setprop "
+              "security.perf_harden 0)\n",
+              strerror(error));
+    }
+    return false;
+  }
+  ready_.store(true, std::memory_order_release);
+  return true;
+#else
+  return false;
+#endif
+}
+
+void StackSampler::resume() {
+#ifdef __linux__
+  // Also enables the events inherited by the encoder threads
+  for (const Ring& ring : rings_) {
+    ioctl(ring.fd, PERF_EVENT_IOC_ENABLE, 0);
+  }
+#endif
+}
+
+void StackSampler::pause() {
+#ifdef __linux__
+  for (const Ring& ring : rings_) {
+    ioctl(ring.fd, PERF_EVENT_IOC_DISABLE, 0);
+  }
+#endif
+}
+
+void StackSampler::finish(Profile* profile) {
+  if (!is_open()) {
+    return;
+  }
+  pause();
+  stop_.store(true, std::memory_order_release);
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+  drain();
+#ifdef __linux__
+  Symbolizer symbolizer;
+  for (const auto& [stack, samples] : stacks_) {
+    profile->samples += samples;
+    std::string folded;
+    std::set<std::pair<std::string, std::string>> seen;
+    // Root first (the folded stack order)
+    for (size_t i = stack.size(); i-- > 0;) {
+      // Return addresses point after the call instruction
+      uint64_t addr = i > 0 ? stack[i] - 1 : stack[i];
+      const std::pair<std::string, std::string>& frame =
+          symbolizer.lookup(addr);
+      if (!folded.empty()) {
+        folded += ';';
+      }
+      folded += frame.second;
+      if (seen.insert(frame).second) {
+        profile->functions[frame].total += samples;
+      }
+      if (i == 0) {
+        profile->functions[frame].self += samples;
+      }
+    }
+    profile->folded[folded] += samples;
+  }
+#endif
+  profile->lost += lost_;
+  close();
+}
+
+void StackSampler::thread_main() {
+  while (!stop_.load(std::memory_order_acquire)) {
+    if (ready_.load(std::memory_order_acquire)) {
+      drain();
+    }
+    usleep(DRAIN_INTERVAL_US);
+  }
+}
+
+void StackSampler::drain() {
+#ifdef __linux__
+  size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+  for (const Ring& ring : rings_) {
+    struct perf_event_mmap_page* meta =
+        (struct perf_event_mmap_page*)ring.base;
+    const uint8_t* data = ring.base + page_size;
+    uint64_t head = __atomic_load_n(&meta->data_head, __ATOMIC_ACQUIRE);
+    uint64_t tail = meta->data_tail;
+    while (head - tail >= sizeof(struct perf_event_header)) {
+      struct perf_event_header header;
+      copy_from_ring(data, ring.data_size, tail, &header, sizeof(header));
+      if (header.size < sizeof(header) || header.size > head - tail) {
+        break;
+      }
+      record_.resize(header.size);
+      copy_from_ring(data, ring.data_size, tail, record_.data(), header.size);
+      tail += header.size;
+      const uint64_t* words =
+          (const uint64_t*)(record_.data() + sizeof(header));
+      size_t num_words = (header.size - sizeof(header)) / sizeof(uint64_t);
+      if (header.type == PERF_RECORD_LOST && num_words >= 2) {
+        // id, lost
+        lost_ += (int64_t)words[1];
+      } else if (header.type == PERF_RECORD_SAMPLE && num_words >= 2) {
+        // ip, nr, ips[nr] (the first entry is the ip itself, context markers
+        // such as PERF_CONTEXT_USER are skipped)
+        size_t nr = std::min((size_t)words[1], num_words - 2);
+        std::vector<uint64_t> stack;
+        stack.reserve(nr);
+        for (size_t i = 0; i < nr; i++) {
+          if (words[2 + i] < (uint64_t)PERF_CONTEXT_MAX) {
+            stack.push_back(words[2 + i]);
+          }
+        }
+        if (stack.empty()) {
+          stack.push_back(words[0]);
+        }
+        stacks_[stack]++;
+      }
+    }
+    __atomic_store_n(&meta->data_tail, tail, __ATOMIC_RELEASE);
+  }
+#endif
+}
+
+void StackSampler::close() {
+  stop_.store(true, std::memory_order_release);
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+  ready_.store(false, std::memory_order_relaxed);
+  for (const Ring& ring : rings_) {
+    munmap(ring.base, ring.data_size + (size_t)sysconf(_SC_PAGESIZE));
+    ::close(ring.fd);
+  }
+  rings_.clear();
+  stacks_.clear();
+  lost_ = 0;
+}
+
+}  // namespace profile
+}  // namespace anicet
@@ -0,0 +1,145 @@
+// anicet_report.cc
+// Streaming result writers implementation
+
+#include "anicet_report.h"
+
+namespace anicet {
+namespace report {
+
+bool parse_report_format(const std::string& name, ReportFormat* format) {
+  if (name == "json") {
+    *format = ReportFormat::JSON;
+  } else if (name == "jsonl") {
+    *format = ReportFormat::JSONL;
+  } else if (name == "csv") {
+    *format = ReportFormat::CSV;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+const char* report_format_name(ReportFormat format) {
+  switch (format) {
+    case ReportFormat::JSON:
+      return "json";
+    case ReportFormat::JSONL:
+      return "jsonl";
+    case ReportFormat::CSV:
+      return "csv";
+  }
+  return "unknown";
+}
+
+JsonWriter::JsonWriter(FILE* fp, int indent) : fp_(fp), indent_(indent) {}
+
+void JsonWriter::begin_object() {
+  start_item(nullptr);
+  fputc('{', fp_);
+  empty_.push_back(true);
+}
+
+void JsonWriter::begin_object(const std::string& key) {
+  start_item(&key);
+  fputc('{', fp_);
+  empty_.push_back(true);
+}
+
+void JsonWriter::begin_array() {
+  start_item(nullptr);
+  fputc('[', fp_);
+  empty_.push_back(true);
+}
+
+void JsonWriter::begin_array(const std::string& key) {
+  start_item(&key);
+  fputc('[', fp_);
+  empty_.push_back(true);
+}
+
+void JsonWriter::member(const std::string& key,
+                        const nlohmann::ordered_json& value) {
+  start_item(&key);
+  write_value(value);
+}
+
+void JsonWriter::element(const nlohmann::ordered_json& value) {
+  start_item(nullptr);
+  write_value(value);
+}
+
+void JsonWriter::finish() {
+  fputc('\n', fp_);
+  fflush(fp_);
+}
+
+void JsonWriter::start_item(const std::string* key) {
+  if (!empty_.empty()) {
+    if (!empty_.back()) {
+      fputc(',', fp_);
+    }
+    empty_.back() = false;
+    newline(empty_.size());
+  }
+  if (key != nullptr) {
+    // Same escaping as the values
+    fputs(nlohmann::ordered_json(*key).dump().c_str(), fp_);
+    fputs(indent_ >= 0 ? ": " : ":", fp_);
+  }
+}
+
+void JsonWriter::end_container(char close) {
+  bool empty = empty_.back();
+  empty_.pop_back();
+  // Empty containers stay on one line ("[]", "{}")
+  if (!empty) {
+    newline(empty_.size());
+  }
+  fputc(close, fp_);
+}
+
+void JsonWriter::newline(size_t depth) {
+  if (indent_ < 0) {
+    return;
+  }
+  fputc('\n', fp_);
+  for (size_t i = 0; i < depth * indent_; i++) {
+    fputc(' ', fp_);
+  }
+}
+
+void JsonWriter::write_value(const nlohmann::ordered_json& value) {
+  std::string text = value.dump(indent_);
+  if (indent_ < 0 || empty_.empty()) {
+    fputs(text.c_str(), fp_);
+    return;
+  }
+  // Shift the lines of a multi-line value to the current depth
+  std::string pad(empty_.size() * indent_, ' ');
+  size_t start = 0;
+  size_t eol;
+  while ((eol = text.find('\n', start)) != std::string::npos) {
+    fwrite(text.data() + start, 1, eol + 1 - start, fp_);
+    fputs(pad.c_str(), fp_);
+    start = eol + 1;
+  }
+  fputs(text.c_str() + start, fp_);
+}
+
+std::string csv_field(const std::string& value) {
+  if (value.find_first_of(",\"\r\n") == std::string::npos) {
+    return value;
+  }
+  std::string quoted = "\"";
+  for (char c : value) {
+    if (c == '"') {
+      quoted += '"';
+    }
+    quoted += c;
+  }
+  quoted += '"';
+  return quoted;
+}
+
+}  // namespace report
+}  // namespace anicet
@@ -4,11 +4,23 @@
 #include "anicet_runner.h"
 
 #include <algorithm>
+#include <condition_variable>
 #include <cstdio>
 #include <cstring>
 #include <functional>
+#include <mutex>
 #include <sstream>
+#include <set>
 #include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "anicet_common.h"
+#include "anicet_color.h"
+#include "anicet_cpu.h"
+#include "anicet_input.h"
+#include "anicet_parameter.h"
 
 // Individual codec runners
 #include "anicet_runner_jpegli.h"
@@ -20,18 +32,127 @@
 // MediaCodec library for debug level setting
 #include "android_mediacodec_lib.h"
 
+void add_resource_delta(ResourceDelta* total, const ResourceDelta& delta) {
+  total->wall_time_ms += delta.wall_time_ms;
+  total->cpu_time_ms += delta.cpu_time_ms;
+  total->user_time_ms += delta.user_time_ms;
+  total->system_time_ms += delta.system_time_ms;
+  total->vm_rss_delta_kb += delta.vm_rss_delta_kb;
+  total->vm_size_delta_kb += delta.vm_size_delta_kb;
+  total->minor_faults += delta.minor_faults;
+  total->major_faults += delta.major_faults;
+  total->vol_ctx_switches += delta.vol_ctx_switches;
+  total->invol_ctx_switches += delta.invol_ctx_switches;
+}
+
+const char* codec_phase_name(int phase) {
+  switch (phase) {
+    case CODEC_PHASE_SETUP:
+      return "setup";
+    case CODEC_PHASE_CONVERSION:
+      return "conversion";
+    case CODEC_PHASE_ENCODE:
+      return "encode";
+    case CODEC_PHASE_CLEANUP:
+      return "cleanup";
+  }
+  return "unknown";
+}
+
+CodecPhaseTimer::CodecPhaseTimer(CodecOutput* output) : output_(output) {
+  memset(output_->phases, 0, sizeof(output_->phases));
+  memset(output_->phase_start_us, 0, sizeof(output_->phase_start_us));
+  memset(output_->phase_end_us, 0, sizeof(output_->phase_end_us));
+  for (anicet::alloc::AllocStats& allocs : output_->phase_allocs) {
+    allocs = anicet::alloc::AllocStats();
+  }
+  output_->profiles.clear();
+  if (anicet::profile::enabled()) {
+    stacks_.open();
+  }
+}
+
+CodecPhaseTimer::~CodecPhaseTimer() {
+  stop();
+  if (stacks_.is_open()) {
+    anicet::profile::Profile profile;
+    stacks_.finish(&profile);
+    output_->profiles.push_back(std::move(profile));
+  }
+}
+
+void CodecPhaseTimer::start(CodecPhase phase) {
+  stop();
+  phase_ = phase;
+  if (phase == CODEC_PHASE_ENCODE) {
+    stacks_.resume();
+  }
+  capture_resources(&start_);
+  if (anicet::alloc::enabled()) {
+    allocs_.start();
+  }
+  if (output_->phase_start_us[phase] == 0) {
+    output_->phase_start_us[phase] = anicet_get_timestamp();
+  }
+}
+
+void CodecPhaseTimer::stop() {
+  if (phase_ < 0) {
+    return;
+  }
+  if (phase_ == CODEC_PHASE_ENCODE) {
+    stacks_.pause();
+  }
+  ResourceSnapshot end;
+  capture_resources(&end);
+  ResourceDelta delta;
+  compute_delta(&start_, &end, &delta);
+  delta.wall_time_ms -= moved_wall_ms_;
+  delta.cpu_time_ms -= moved_cpu_ms_;
+  moved_wall_ms_ = 0.0;
+  moved_cpu_ms_ = 0.0;
+  add_resource_delta(&output_->phases[phase_], delta);
+  allocs_.stop(&output_->phase_allocs[phase_]);
+  output_->phase_end_us[phase_] = anicet_get_timestamp();
+  phase_ = -1;
+}
+
+void CodecPhaseTimer::add_conversion(anicet::input::FrameRing* frames) {
+  double wall_ms;
+  double cpu_ms;
+  frames->take_conversion_time(&wall_ms, &cpu_ms);
+  add_conversion(wall_ms, cpu_ms);
+}
+
+void CodecPhaseTimer::add_conversion(double wall_ms, double cpu_ms) {
+  // Conversions done in the conversion phase are already counted there
+  if (phase_ < 0 || phase_ == CODEC_PHASE_CONVERSION) {
+    return;
+  }
+  output_->phases[CODEC_PHASE_CONVERSION].wall_time_ms += wall_ms;
+  output_->phases[CODEC_PHASE_CONVERSION].cpu_time_ms += cpu_ms;
+  moved_wall_ms_ += wall_ms;
+  moved_cpu_ms_ += cpu_ms;
+}
+
 // Helper function to append one CodecOutput to another
 static void append_codec_output(CodecOutput* dest, const CodecOutput& src) {
-  // Append frame buffers
-  dest->frame_buffers.insert(dest->frame_buffers.end(),
-                             src.frame_buffers.begin(),
-                             src.frame_buffers.end());
+  // Frame index of the first appended frame
+  size_t frame_base = dest->num_frames();
+  // Append frame data (shares the encoded frames, no copy)
+  dest->frame_arena.splice(src.frame_arena);
   // Append frame sizes
   dest->frame_sizes.insert(dest->frame_sizes.end(), src.frame_sizes.begin(),
                            src.frame_sizes.end());
   // Append timings
   dest->timings.insert(dest->timings.end(), src.timings.begin(),
                        src.timings.end());
+  // Append warm-up flags
+  dest->warmup_frames.resize(frame_base, false);
+  dest->warmup_frames.insert(dest->warmup_frames.end(),
+                             src.warmup_frames.begin(),
+                             src.warmup_frames.end());
+  dest->warmup_frames.resize(dest->num_frames(), false);
   // Append output files
   dest->output_files.insert(dest->output_files.end(), src.output_files.begin(),
                             src.output_files.end());
@@ -39,6 +160,91 @@ static void append_codec_output(CodecOutput* dest, const CodecOutput& src) {
   dest->profile_encode_cpu_ms.insert(dest->profile_encode_cpu_ms.end(),
                                      src.profile_encode_cpu_ms.begin(),
                                      src.profile_encode_cpu_ms.end());
+  // Append hardware counters, memory peaks and allocations. Codecs without
+  // them (e.g. MediaCodec has no CPU counters) are padded so that the
+  // per-frame vectors stay indexed by frame.
+  if (!src.perf_counters.empty() || !dest->perf_counters.empty()) {
+    anicet::perf::CounterValues none;
+    for (int64_t& value : none.values) value = -1;
+    none.running_ratio = 0.0;
+    dest->perf_counters.resize(frame_base, none);
+    dest->perf_counters.insert(dest->perf_counters.end(),
+                               src.perf_counters.begin(),
+                               src.perf_counters.end());
+    dest->perf_counters.resize(dest->num_frames(), none);
+  }
+  if (!src.memory_frame_peaks.empty() || !dest->memory_frame_peaks.empty()) {
+    anicet::memory::FramePeak none = {-1, -1};
+    dest->memory_frame_peaks.resize(frame_base, none);
+    dest->memory_frame_peaks.insert(dest->memory_frame_peaks.end(),
+                                    src.memory_frame_peaks.begin(),
+                                    src.memory_frame_peaks.end());
+    dest->memory_frame_peaks.resize(dest->num_frames(), none);
+  }
+  if (!src.frame_allocs.empty() || !dest->frame_allocs.empty()) {
+    dest->frame_allocs.resize(frame_base);
+    dest->frame_allocs.insert(dest->frame_allocs.end(),
+                              src.frame_allocs.begin(),
+                              src.frame_allocs.end());
+    dest->frame_allocs.resize(dest->num_frames());
+  }
+  // Append the memory timeline (run tags become frame indices)
+  for (anicet::memory::MemorySample sample : src.memory_timeline) {
+    if (sample.run >= 0) {
+      sample.run += (int)frame_base;
+    }
+    dest->memory_timeline.push_back(sample);
+  }
+  // Append the thermal values (padded like the memory peaks). The timeline
+  // is only appended while the columns match (same pinned clusters).
+  if (!src.thermal_frames.empty() || !dest->thermal_frames.empty()) {
+    dest->thermal_frames.resize(frame_base);
+    dest->thermal_frames.insert(dest->thermal_frames.end(),
+                                src.thermal_frames.begin(),
+                                src.thermal_frames.end());
+    dest->thermal_frames.resize(dest->num_frames());
+  }
+  if (dest->thermal_timeline.samples.empty()) {
+    dest->thermal_timeline.freq_domains = src.thermal_timeline.freq_domains;
+    dest->thermal_timeline.zones = src.thermal_timeline.zones;
+  }
+  if (dest->thermal_timeline.freq_domains ==
+          src.thermal_timeline.freq_domains &&
+      dest->thermal_timeline.zones == src.thermal_timeline.zones) {
+    for (anicet::thermal::ThermalSample sample :
+         src.thermal_timeline.samples) {
+      if (sample.run >= 0) {
+        sample.run += (int)frame_base;
+      }
+      dest->thermal_timeline.samples.push_back(std::move(sample));
+    }
+  }
+  // Append the frame energy (padded) and accumulate the phase and total
+  // energy
+  if (!src.frame_energy.empty() || !dest->frame_energy.empty()) {
+    dest->frame_energy.resize(frame_base);
+    dest->frame_energy.insert(dest->frame_energy.end(),
+                              src.frame_energy.begin(),
+                              src.frame_energy.end());
+    dest->frame_energy.resize(dest->num_frames());
+  }
+  for (int phase = 0; phase < NUM_CODEC_PHASES; phase++) {
+    if (src.phase_energy_mj[phase] >= 0.0) {
+      dest->phase_energy_mj[phase] =
+          std::max(dest->phase_energy_mj[phase], 0.0) +
+          src.phase_energy_mj[phase];
+    }
+  }
+  if (src.energy_mj >= 0.0) {
+    dest->energy_mj = std::max(dest->energy_mj, 0.0) + src.energy_mj;
+    dest->energy_source = src.energy_source;
+  }
+  // Accumulate cooldown waits
+  dest->cooldown.waits += src.cooldown.waits;
+  dest->cooldown.wait_ms += src.cooldown.wait_ms;
+  dest->cooldown.timeouts += src.cooldown.timeouts;
+  dest->cooldown.max_start_temp_mc = std::max(
+      dest->cooldown.max_start_temp_mc, src.cooldown.max_start_temp_mc);
   // Keep dump_output setting
   if (!dest->dump_output) {
     dest->dump_output = src.dump_output;
@@ -47,18 +253,28 @@ static void append_codec_output(CodecOutput* dest, const CodecOutput& src) {
   if (src.profile_encode_mem_kb > dest->profile_encode_mem_kb) {
     dest->profile_encode_mem_kb = src.profile_encode_mem_kb;
   }
-  // Accumulate resource delta
-  dest->resource_delta.wall_time_ms += src.resource_delta.wall_time_ms;
-  dest->resource_delta.cpu_time_ms += src.resource_delta.cpu_time_ms;
-  dest->resource_delta.user_time_ms += src.resource_delta.user_time_ms;
-  dest->resource_delta.system_time_ms += src.resource_delta.system_time_ms;
-  dest->resource_delta.vm_rss_delta_kb += src.resource_delta.vm_rss_delta_kb;
-  dest->resource_delta.vm_size_delta_kb += src.resource_delta.vm_size_delta_kb;
-  dest->resource_delta.minor_faults += src.resource_delta.minor_faults;
-  dest->resource_delta.major_faults += src.resource_delta.major_faults;
-  dest->resource_delta.vol_ctx_switches += src.resource_delta.vol_ctx_switches;
-  dest->resource_delta.invol_ctx_switches +=
-      src.resource_delta.invol_ctx_switches;
+  // Accumulate library load time and append the codec startups
+  dest->library_load_time_ms += src.library_load_time_ms;
+  dest->codec_startup.insert(dest->codec_startup.end(),
+                             src.codec_startup.begin(),
+                             src.codec_startup.end());
+  if (dest->simd_level.empty()) {
+    dest->simd_level = src.simd_level;
+  }
+  dest->strip_comparison.insert(dest->strip_comparison.end(),
+                                src.strip_comparison.begin(),
+                                src.strip_comparison.end());
+  if (dest->worker_run.workers == 0) {
+    dest->worker_run = src.worker_run;
+  }
+  anicet::profile::merge_profiles(&dest->profiles, src.profiles);
+  // Accumulate resource delta (total and per phase)
+  add_resource_delta(&dest->resource_delta, src.resource_delta);
+  for (int phase = 0; phase < NUM_CODEC_PHASES; phase++) {
+    add_resource_delta(&dest->phases[phase], src.phases[phase]);
+    anicet::alloc::add_alloc_stats(&dest->phase_allocs[phase],
+                                   src.phase_allocs[phase]);
+  }
   // Copy codec name and params if dest is empty (first codec)
   if (dest->codec_name.empty() && !src.codec_name.empty()) {
     dest->codec_name = src.codec_name;
@@ -68,6 +284,41 @@ static void append_codec_output(CodecOutput* dest, const CodecOutput& src) {
   // from the first codec. Individual frames still have correct filenames.
 }
 
+// Helper function to reset a CodecOutput to an empty state
+static void reset_codec_output(CodecOutput* output, bool dump_output) {
+  output->frame_arena.clear();
+  output->frame_sizes.clear();
+  output->timings.clear();
+  output->output_files.clear();
+  output->profile_encode_cpu_ms.clear();
+  output->warmup_frames.clear();
+  output->perf_counters.clear();
+  output->memory_timeline.clear();
+  output->memory_frame_peaks.clear();
+  output->frame_allocs.clear();
+  for (anicet::alloc::AllocStats& allocs : output->phase_allocs) {
+    allocs = anicet::alloc::AllocStats();
+  }
+  output->thermal_timeline = anicet::thermal::ThermalTimeline();
+  output->thermal_frames.clear();
+  output->cooldown = anicet::thermal::CooldownStats();
+  output->frame_energy.clear();
+  for (double& energy_mj : output->phase_energy_mj) energy_mj = -1.0;
+  output->energy_mj = -1.0;
+  output->energy_source.clear();
+  output->profile_encode_mem_kb = 0;
+  output->library_load_time_ms = 0.0;
+  output->codec_startup.clear();
+  output->strip_comparison.clear();
+  output->simd_level.clear();
+  output->worker_run = WorkerRun();
+  output->exit_code = 0;
+  output->profiles.clear();
+  output->dump_output = dump_output;
+  memset(&output->resource_delta, 0, sizeof(output->resource_delta));
+  memset(output->phases, 0, sizeof(output->phases));
+}
+
 // Helper function to validate parameter against a list of valid values
 bool validate_parameter_list(const std::string& label,
                              const std::string& param_name,
@@ -166,36 +417,109 @@ struct CodecConfig {
   std::map<std::string, std::string> default_params;  // Optional defaults
   // Optional function to dynamically determine file extension from parameters
   std::function<std::string(const CodecSetup*)> get_extension;
+  // Thread-count parameter used by --thread-scaling (nullptr for
+  // single-threaded codecs)
+  const char* thread_param = nullptr;
 };
 
-// Helper function to run a single codec with common logic
-static int run_codec(const CodecInput& input, const CodecConfig& config,
-                     int num_runs, bool dump_output,
-                     const char* dump_output_dir,
-                     const char* dump_output_prefix,
-                     const CodecSetup* codec_setup, CodecOutput* output,
-                     int& errors) {
-  CodecOutput local_output;
-  local_output.dump_output = dump_output;
-  CodecSetup setup;
+// Helper function to encode one grid point: policy.warmup_runs warm-up runs
+// followed by setup.num_runs measured runs or, with policy.auto_runs,
+// batches of runs until the median encode time is stable
+// Each batch is a complete runner call (setup, encode, cleanup), so every
+// batch starts with its own warm-up runs.
+static int run_codec_batches(const CodecInput& input,
+                             const CodecConfig& config,
+                             const anicet::stats::RunPolicy& policy,
+                             CodecSetup& setup, CodecOutput* output) {
+  int num_runs = setup.num_runs;
+  int batch_runs = policy.auto_runs ? policy.batch_runs : num_runs;
+  CodecInput batch_input = input;
+  int measured = 0;
+  int result = 0;
+  for (int batch = 0;; batch++) {
+    CodecOutput batch_output;
+    batch_output.dump_output = output->dump_output;
+    setup.num_runs = policy.warmup_runs + batch_runs;
+    anicet::thermal::cooldown(input.thermal_zones, policy.cooldown_temp_c,
+                              policy.cooldown_ms, &batch_output.cooldown);
+    anicet::thermal::ThermalSampler thermal(&batch_input);
+    anicet::energy::EnergySampler energy(&batch_input);
+    result = config.run_func(&batch_input, &setup, &batch_output);
+    thermal.finish(&batch_output);
+    energy.finish(&batch_output);
+    if (result != 0 || batch_output.num_frames() == 0) {
+      // Keep the runner result (a runner without frames failed too)
+      if (result == 0) result = -1;
+      break;
+    }
+    batch_output.warmup_frames.assign(batch_output.num_frames(), false);
+    for (size_t i = 0; i < (size_t)policy.warmup_runs &&
+                       i < batch_output.num_frames();
+         i++) {
+      batch_output.warmup_frames[i] = true;
+    }
+    if (batch == 0) {
+      *output = std::move(batch_output);
+    } else {
+      append_codec_output(output, batch_output);
+    }
+    batch_input.run_offset += setup.num_runs;
+    measured = anicet::stats::num_measured_frames(*output);
+    if (!policy.auto_runs || measured >= policy.max_runs) {
+      break;
+    }
+    anicet::stats::Summary summary;
+    if (measured >= policy.min_runs &&
+        anicet::stats::summarize(anicet::stats::encode_times_us(*output),
+                                 &summary) &&
+        summary.median_ci_percent <= policy.target_ci_percent) {
+      break;
+    }
+    ANICET_DEBUG(input.debug_level, 1,
+                 "%s: %d runs, median CI +/-%.2f%% above target, encoding "
+                 "another batch",
+                 config.name, measured, summary.median_ci_percent);
+  }
   setup.num_runs = num_runs;
+  return result;
+}
 
-  // Use codec_setup if provided, otherwise use defaults
-  if (codec_setup) {
-    setup = *codec_setup;
-  } else {
-    // Set default parameters from config
-    for (const auto& [key, value] : config.default_params) {
-      setup.parameter_map[key] = value;
-    }
+// Helper: record a failed grid point (codec, parameters and runner result,
+// no frames) in the per-point results
+static void record_failed_point(const CodecConfig& config,
+                                const CodecSetup& setup, int exit_code,
+                                bool dump_output,
+                                std::vector<CodecOutput>* results) {
+  if (results == nullptr) {
+    return;
   }
+  CodecOutput failed;
+  reset_codec_output(&failed, dump_output);
+  populate_codec_info(failed, config.name, setup);
+  failed.exit_code = exit_code;
+  results->push_back(std::move(failed));
+}
 
-  if (config.run_func(&input, &setup, &local_output) == 0 &&
-      local_output.num_frames() > 0) {
+// Helper function to run a single codec configuration (one grid point)
+static int run_codec_point(const CodecInput& input, const CodecConfig& config,
+                           bool dump_output, const char* dump_output_dir,
+                           const char* dump_output_prefix,
+                           anicet::output::FileWriter* writer,
+                           const anicet::stats::RunPolicy& policy,
+                           CodecSetup& setup, CodecOutput* output,
+                           std::vector<CodecOutput>* results, int& errors) {
+  CodecOutput local_output;
+  local_output.dump_output = dump_output;
+
+  int result = run_codec_batches(input, config, policy, setup, &local_output);
+  if (result == 0 && local_output.num_frames() > 0) {
     // Store codec name and parameters in output
     populate_codec_info(local_output, config.name, setup);
+    for (anicet::profile::Profile& profile : local_output.profiles) {
+      profile.codec = config.name;
+    }
 
-    // Generate filenames and optionally write files
+    // Generate filenames
     for (size_t i = 0; i < local_output.num_frames(); i++) {
       char filename[1024];
 
@@ -234,37 +558,460 @@ static int run_codec(const CodecInput& input, const CodecConfig& config,
 
       snprintf(filename, sizeof(filename), "%s", ss.str().c_str());
       local_output.output_files.push_back(filename);
+    }
 
-      // Write output file if requested
-      if (dump_output) {
-        FILE* f = fopen(filename, "wb");
-        if (f) {
-          fwrite(local_output.frame_buffers[i].data(), 1,
-                 local_output.frame_sizes[i], f);
-          fclose(f);
-        }
-      }
+    // Write output files if requested (handed off to the writer, which may
+    // write them in the background while the next codec runs)
+    if (dump_output) {
+      writer->submit(local_output.output_files, local_output.frame_arena);
     }
 
     // Append results to output parameter if provided
     if (output != nullptr) {
       append_codec_output(output, local_output);
     }
+    if (results != nullptr) {
+      results->push_back(std::move(local_output));
+    }
     return 0;
   } else {
     fprintf(stderr, "%s: Encoding failed\n", config.name);
     errors++;
+    record_failed_point(config, setup, result != 0 ? result : -1,
+                        dump_output, results);
     return -1;
   }
 }
 
+// Helper function to run a single codec with common logic
+// Expands any parameter sweep into grid points and runs each of them in turn
+static int run_codec(const CodecInput& input, const CodecConfig& config,
+                     int num_runs, bool dump_output,
+                     const char* dump_output_dir,
+                     const char* dump_output_prefix,
+                     anicet::output::FileWriter* writer,
+                     const anicet::stats::RunPolicy& policy,
+                     const CodecSetup* codec_setup, CodecOutput* output,
+                     std::vector<CodecOutput>* results, int& errors) {
+  CodecSetup setup;
+  setup.num_runs = num_runs;
+
+  // Use codec_setup if provided, otherwise use defaults
+  if (codec_setup) {
+    setup = *codec_setup;
+  } else {
+    // Set default parameters from config
+    for (const auto& [key, value] : config.default_params) {
+      setup.parameter_map[key] = value;
+    }
+  }
+
+  std::vector<CodecSetup> points = anicet::parameter::expand_parameter_grid(
+      config.name, setup, *config.param_descriptors);
+  if (points.size() > 1) {
+    ANICET_DEBUG(input.debug_level, 1, "%s: Sweeping %zu parameter points",
+                 config.name, points.size());
+  }
+
+  int ret = 0;
+  for (size_t i = 0; i < points.size(); i++) {
+    if (run_codec_point(input, config, dump_output, dump_output_dir,
+                        dump_output_prefix, writer, policy, points[i], output,
+                        results, errors) != 0) {
+      ret = -1;
+    }
+  }
+  return ret;
+}
+
+// Per-codec worker state for parallel codec execution
+struct CodecWorker {
+  CodecOutput output;
+  std::vector<CodecOutput> results;
+  int errors = 0;
+};
+
+// Helper function to run several codecs concurrently, one thread per codec
+// Each worker thread is pinned to its codec's CPU list (if any) and accounts
+// CPU time and faults for itself only (ResourceScope::THREAD). Outputs are
+// merged in codec order once all workers are done.
+static void run_codecs_parallel(const CodecInput& input,
+                                const std::vector<const CodecConfig*>& configs,
+                                const ExperimentOptions& options, int num_runs,
+                                bool dump_output, const char* dump_output_dir,
+                                const char* dump_output_prefix,
+                                anicet::output::FileWriter* writer,
+                                const CodecSetup* codec_setup,
+                                CodecOutput* output,
+                                std::vector<CodecOutput>* results,
+                                int& errors) {
+  // Warn about codecs that will compete for the same CPUs
+  for (size_t i = 0; i < configs.size(); i++) {
+    auto it_a = options.codec_cpus.find(configs[i]->name);
+    if (it_a == options.codec_cpus.end()) {
+      if (configs.size() > 1) {
+        fprintf(stderr,
+                "Warning: %s has no CPU list, it will share CPUs with the "
+                "other codecs\n",
+                configs[i]->name);
+      }
+      continue;
+    }
+    for (size_t j = i + 1; j < configs.size(); j++) {
+      auto it_b = options.codec_cpus.find(configs[j]->name);
+      if (it_b == options.codec_cpus.end()) continue;
+      std::set<int> common =
+          anicet::cpu::cpulist_overlap(it_a->second, it_b->second);
+      if (!common.empty()) {
+        fprintf(stderr,
+                "Warning: CPU lists of %s (%s) and %s (%s) overlap on CPUs "
+                "%s\n",
+                configs[i]->name, it_a->second.c_str(), configs[j]->name,
+                it_b->second.c_str(),
+                anicet::cpu::format_cpulist(common).c_str());
+      }
+    }
+  }
+
+  std::vector<CodecWorker> workers(configs.size());
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < configs.size(); i++) {
+    CodecWorker* worker = &workers[i];
+    const CodecConfig* config = configs[i];
+    reset_codec_output(&worker->output, dump_output);
+    threads.emplace_back([&, worker, config]() {
+      auto cpus_it = options.codec_cpus.find(config->name);
+      if (cpus_it != options.codec_cpus.end()) {
+        if (!anicet::cpu::set_affinity_from_cpulist(cpus_it->second)) {
+          fprintf(stderr, "%s: Failed to set CPU affinity to %s\n",
+                  config->name, cpus_it->second.c_str());
+        }
+        ANICET_DEBUG(input.debug_level, 1, "%s: Worker pinned to CPUs %s",
+                     config->name, cpus_it->second.c_str());
+      }
+      resource_scope() = ResourceScope::THREAD;
+      run_codec(input, *config, num_runs, dump_output, dump_output_dir,
+                dump_output_prefix, writer, options.run_policy, codec_setup,
+                &worker->output,
+                results != nullptr ? &worker->results : nullptr,
+                worker->errors);
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  // Merge outputs in codec order
+  for (auto& worker : workers) {
+    if (output != nullptr) {
+      append_codec_output(output, worker.output);
+    }
+    if (results != nullptr) {
+      for (auto& result : worker.results) {
+        results->push_back(std::move(result));
+      }
+    }
+    errors += worker.errors;
+  }
+}
+
+// Helper: codec parameters without the thread parameter (to find the
+// baseline of a thread-scaling point)
+static std::map<std::string, std::string> params_without(
+    const std::map<std::string, std::string>& params, const char* key) {
+  std::map<std::string, std::string> rest = params;
+  rest.erase(key);
+  return rest;
+}
+
+// Helper function to run each codec once per thread count (--thread-scaling)
+// Count N pins the calling thread (and so the encoder threads it creates) to
+// the first N CPUs of its affinity and sets the codec's thread parameter to
+// N (clamped to the parameter range; single-threaded codecs only get the
+// CPUs). Speedup and efficiency are relative to the first count.
+static void run_thread_scaling(const CodecInput& input,
+                               const std::vector<const CodecConfig*>& configs,
+                               const ExperimentOptions& options, int num_runs,
+                               bool dump_output, const char* dump_output_dir,
+                               const char* dump_output_prefix,
+                               anicet::output::FileWriter* writer,
+                               const CodecSetup* codec_setup,
+                               CodecOutput* output,
+                               std::vector<CodecOutput>* results,
+                               int& errors) {
+  std::set<int> base_cpus = anicet::cpu::get_affinity();
+  std::string base_cpulist = anicet::cpu::format_cpulist(base_cpus);
+
+  for (const CodecConfig* config : configs) {
+    // Results of this codec for all thread counts
+    std::vector<CodecOutput> points;
+    for (int threads : options.thread_counts) {
+      if (threads > (int)base_cpus.size()) {
+        fprintf(stderr, "%s: Skipping %d threads (only %zu CPUs available)\n",
+                config->name, threads, base_cpus.size());
+        continue;
+      }
+      std::set<int> cpus(base_cpus.begin(),
+                         std::next(base_cpus.begin(), threads));
+      std::string cpulist = anicet::cpu::format_cpulist(cpus);
+      if (!anicet::cpu::set_affinity_from_cpulist(cpulist)) {
+        fprintf(stderr, "%s: Failed to set CPU affinity to %s\n",
+                config->name, cpulist.c_str());
+        errors++;
+        continue;
+      }
+
+      CodecSetup setup;
+      if (codec_setup != nullptr) {
+        setup = *codec_setup;
+      } else {
+        setup.num_runs = num_runs;
+        for (const auto& [key, value] : config->default_params) {
+          setup.parameter_map[key] = value;
+        }
+      }
+      if (config->thread_param != nullptr) {
+        const auto& descriptor =
+            config->param_descriptors->at(config->thread_param);
+        setup.parameter_map[config->thread_param] =
+            std::min(threads, std::get<int>(descriptor.max_value));
+        setup.sweep_map.erase(config->thread_param);
+      }
+      ANICET_DEBUG(input.debug_level, 1, "%s: %d threads on CPUs %s",
+                   config->name, threads, cpulist.c_str());
+
+      std::vector<CodecOutput> count_results;
+      run_codec(input, *config, num_runs, dump_output, dump_output_dir,
+                dump_output_prefix, writer, options.run_policy, &setup,
+                output, &count_results, errors);
+      for (CodecOutput& point : count_results) {
+        point.thread_scaling.threads = threads;
+        point.thread_scaling.cpus = cpulist;
+        points.push_back(std::move(point));
+      }
+    }
+    anicet::cpu::set_affinity_from_cpulist(base_cpulist);
+
+    // Scaling metrics (baseline: first point with the same other parameters)
+    const char* thread_param =
+        config->thread_param != nullptr ? config->thread_param : "";
+    for (CodecOutput& point : points) {
+      ThreadScalingPoint& scaling = point.thread_scaling;
+      if (point.exit_code != 0) continue;
+      anicet::stats::Summary summary;
+      std::vector<double> encode_times = anicet::stats::encode_times_us(point);
+      if (!anicet::stats::summarize(encode_times, &summary)) continue;
+      scaling.median_encode_time_us = summary.median;
+      double wall_ms = 0.0;
+      for (double time_us : encode_times) wall_ms += time_us / 1000.0;
+      double cpu_ms = 0.0;
+      for (double time_ms : anicet::stats::cpu_times_ms(point)) {
+        cpu_ms += time_ms;
+      }
+      if (wall_ms > 0.0) {
+        scaling.cpu_utilization_percent =
+            cpu_ms / (wall_ms * scaling.threads) * 100.0;
+      }
+      for (const CodecOutput& base : points) {
+        if (base.exit_code != 0 ||
+            params_without(base.codec_params, thread_param) !=
+            params_without(point.codec_params, thread_param)) {
+          continue;
+        }
+        if (scaling.median_encode_time_us > 0.0) {
+          scaling.speedup = base.thread_scaling.median_encode_time_us /
+                            scaling.median_encode_time_us;
+          scaling.efficiency = scaling.speedup * base.thread_scaling.threads /
+                               scaling.threads;
+        }
+        break;
+      }
+    }
+    if (results != nullptr) {
+      for (CodecOutput& point : points) {
+        results->push_back(std::move(point));
+      }
+    }
+  }
+}
+
+// Helper: contention and latency of one worker over its measured frames
+static WorkerResult summarize_worker(int worker, const CodecOutput& output) {
+  WorkerResult result;
+  result.worker = worker;
+  result.encode_time_us = anicet::stats::encode_times_us(output);
+  result.vol_ctx_switches = output.resource_delta.vol_ctx_switches;
+  result.invol_ctx_switches = output.resource_delta.invol_ctx_switches;
+  for (size_t i = 0; i < output.num_frames(); i++) {
+    if (i < output.warmup_frames.size() && output.warmup_frames[i]) {
+      continue;
+    }
+    const CodecFrameTiming& timing = output.timings[i];
+    if (result.start_us == 0 || timing.input_timestamp_us < result.start_us) {
+      result.start_us = timing.input_timestamp_us;
+    }
+    result.end_us = std::max(result.end_us, timing.output_timestamp_us);
+    if (i < output.perf_counters.size()) {
+      int64_t misses =
+          output.perf_counters[i].values[anicet::perf::LLC_READ_MISSES];
+      if (misses >= 0) {
+        result.llc_read_misses =
+            std::max<int64_t>(result.llc_read_misses, 0) + misses;
+      }
+    }
+  }
+  return result;
+}
+
+// Helper function to encode each grid point with several concurrent
+// instances of a codec (--workers)
+// All workers of a point start together (and the point ends when the last
+// one is done), each on its own thread with ResourceScope::THREAD accounting,
+// its own copy of the input (or its own slice of the clip) and its own dump
+// file prefix. Only worker 0 runs the memory, thermal and energy samplers
+// (they are process-wide), and a single cooldown runs before each point.
+// The point's output holds the frames of all workers in worker order.
+static void run_codec_workers(const CodecInput& input,
+                              const CodecConfig& config,
+                              const ExperimentOptions& options, int num_runs,
+                              bool dump_output, const char* dump_output_dir,
+                              const char* dump_output_prefix,
+                              anicet::output::FileWriter* writer,
+                              const CodecSetup* codec_setup,
+                              CodecOutput* output,
+                              std::vector<CodecOutput>* results, int& errors) {
+  int num_workers = options.workers;
+  CodecSetup setup;
+  setup.num_runs = num_runs;
+  if (codec_setup) {
+    setup = *codec_setup;
+  } else {
+    for (const auto& [key, value] : config.default_params) {
+      setup.parameter_map[key] = value;
+    }
+  }
+  std::vector<CodecSetup> points = anicet::parameter::expand_parameter_grid(
+      config.name, setup, *config.param_descriptors);
+
+  // Per-worker inputs: a private copy of the frame (no shared cache lines),
+  // or the clip split into num_workers slices
+  std::vector<std::vector<uint8_t>> buffers(num_workers);
+  std::vector<CodecInput> inputs(num_workers, input);
+  std::vector<std::string> prefixes(num_workers);
+  for (int w = 0; w < num_workers; w++) {
+    if (input.frame_source != nullptr) {
+      inputs[w].run_offset =
+          input.run_offset + w * input.frame_source->num_frames() / num_workers;
+    } else {
+      buffers[w].assign(input.input_buffer,
+                        input.input_buffer + input.input_size);
+      inputs[w].input_buffer = buffers[w].data();
+    }
+    if (w > 0) {
+      inputs[w].memory_sample_interval_ms = 0;
+      inputs[w].thermal_sample_interval_ms = 0;
+      inputs[w].energy_sample_interval_ms = 0;
+    }
+    prefixes[w] =
+        std::string(dump_output_prefix) + ".worker_" + std::to_string(w);
+  }
+  anicet::stats::RunPolicy policy = options.run_policy;
+  policy.cooldown_temp_c = 0.0;
+  policy.cooldown_ms = 0;
+
+  for (CodecSetup& point : points) {
+    anicet::thermal::CooldownStats cooldown;
+    anicet::thermal::cooldown(input.thermal_zones,
+                              options.run_policy.cooldown_temp_c,
+                              options.run_policy.cooldown_ms, &cooldown);
+
+    std::vector<std::vector<CodecOutput>> worker_results(num_workers);
+    std::vector<int> worker_errors(num_workers, 0);
+    std::mutex mutex;
+    std::condition_variable ready_cv;
+    int ready = 0;
+    std::vector<std::thread> threads;
+    for (int w = 0; w < num_workers; w++) {
+      threads.emplace_back([&, w]() {
+        resource_scope() = ResourceScope::THREAD;
+        CodecSetup worker_setup = point;
+        // Start barrier: no worker encodes before all of them are up
+        {
+          std::unique_lock<std::mutex> lock(mutex);
+          if (++ready == num_workers) {
+            ready_cv.notify_all();
+          } else {
+            ready_cv.wait(lock, [&] { return ready == num_workers; });
+          }
+        }
+        run_codec_point(inputs[w], config, dump_output, dump_output_dir,
+                        prefixes[w].c_str(), writer, policy, worker_setup,
+                        nullptr, &worker_results[w], worker_errors[w]);
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+
+    // Merge the workers in worker order
+    CodecOutput merged;
+    reset_codec_output(&merged, dump_output);
+    WorkerRun run;
+    run.workers = num_workers;
+    int failed = 0;
+    for (int w = 0; w < num_workers; w++) {
+      failed += worker_errors[w];
+      if (worker_results[w].empty() || worker_results[w][0].exit_code != 0) {
+        continue;
+      }
+      const CodecOutput& worker_output = worker_results[w][0];
+      run.results.push_back(summarize_worker(w, worker_output));
+      append_codec_output(&merged, worker_output);
+    }
+    if (failed > 0) {
+      // One error per point, like a single instance
+      fprintf(stderr, "%s: %d of %d workers failed\n", config.name, failed,
+              num_workers);
+      errors++;
+      record_failed_point(config, point, -1, dump_output, results);
+      continue;
+    }
+    int64_t start_us = 0;
+    int64_t end_us = 0;
+    for (const WorkerResult& result : run.results) {
+      if (start_us == 0 || result.start_us < start_us) {
+        start_us = result.start_us;
+      }
+      end_us = std::max(end_us, result.end_us);
+    }
+    int measured = anicet::stats::num_measured_frames(merged);
+    if (end_us > start_us) {
+      run.throughput_fps = measured * 1e6 / (end_us - start_us);
+    }
+    merged.worker_run = std::move(run);
+    merged.cooldown = cooldown;
+    ANICET_DEBUG(input.debug_level, 1,
+                 "%s: %d workers, %d frames at %.2f frames/s", config.name,
+                 num_workers, measured, merged.worker_run.throughput_fps);
+
+    if (output != nullptr) {
+      append_codec_output(output, merged);
+    }
+    if (results != nullptr) {
+      results->push_back(std::move(merged));
+    }
+  }
+}
+
 // Main experiment function - uses all sub-runners
 int anicet_experiment(const uint8_t* buffer, size_t buf_size, int height,
                       int width, const char* color_format,
                       const char* codec_name, int num_runs, bool dump_output,
                       const char* dump_output_dir,
                       const char* dump_output_prefix, int debug_level,
-                      CodecOutput* output, CodecSetup* codec_setup) {
+                      CodecOutput* output, CodecSetup* codec_setup,
+                      std::vector<CodecOutput>* results,
+                      const ExperimentOptions* options) {
   // Local DEBUG macro for cleaner debug statements
 #define DEBUG(level, ...) ANICET_DEBUG(debug_level, level, __VA_ARGS__)
   // Validate inputs
@@ -279,19 +1026,30 @@ int anicet_experiment(const uint8_t* buffer, size_t buf_size, int height,
 
   // Initialize output to empty state if provided
   if (output != nullptr) {
-    output->frame_buffers.clear();
-    output->frame_sizes.clear();
-    output->timings.clear();
-    output->output_files.clear();
-    output->profile_encode_cpu_ms.clear();
-    output->profile_encode_mem_kb = 0;
-    output->dump_output = dump_output;
-    memset(&output->resource_delta, 0, sizeof(output->resource_delta));
-  }
-
-  // Only support yuv420p for now
-  if (strcmp(color_format, "yuv420p") != 0) {
-    fprintf(stderr, "Only yuv420p format supported currently\n");
+    reset_codec_output(output, dump_output);
+  }
+  if (results != nullptr) {
+    results->clear();
+  }
+
+  // Input color format (converted per run to what each codec takes, see
+  // anicet::input::FrameRing)
+  anicet::color::ColorFormat input_format;
+  if (!anicet::color::parse_color_format(color_format, &input_format)) {
+    fprintf(stderr,
+            "Unsupported color format %s (yuv420p, nv12, nv21, p010, rgba)\n",
+            color_format);
+    return -1;
+  }
+  if (input_format != anicet::color::ColorFormat::YUV420P &&
+      (width % 2 != 0 || height % 2 != 0)) {
+    fprintf(stderr, "Color format %s needs an even width and height\n",
+            color_format);
+    return -1;
+  }
+  if (buf_size < anicet::color::frame_size(input_format, width, height)) {
+    fprintf(stderr, "Input (%zu bytes) is smaller than one %dx%d %s frame\n",
+            buf_size, width, height, color_format);
     return -1;
   }
 
@@ -342,6 +1100,17 @@ int anicet_experiment(const uint8_t* buffer, size_t buf_size, int height,
   input.width = width;
   input.color_format = color_format;
   input.debug_level = debug_level;
+  if (options != nullptr && options->frame_source != nullptr) {
+    input.frame_source = options->frame_source;
+    input.frame_ring_size = options->frame_ring_size;
+  }
+  if (options != nullptr) {
+    input.perf_counters = options->perf_counters;
+    input.memory_sample_interval_ms = options->memory_sample_interval_ms;
+    input.thermal_sample_interval_ms = options->thermal_sample_interval_ms;
+    input.thermal_zones = options->thermal_zones.c_str();
+    input.energy_sample_interval_ms = options->energy_sample_interval_ms;
+  }
 
   int errors = 0;
 
@@ -352,7 +1121,8 @@ int anicet_experiment(const uint8_t* buffer, size_t buf_size, int height,
       .run_func = anicet::runner::webp::anicet_run,
       .param_descriptors = &anicet::runner::webp::WEBP_PARAMETERS,
       .default_params = {{"optimization", "opt"}},
-      .get_extension = nullptr};
+      .get_extension = nullptr,
+      .thread_param = "thread_level"};
 
   CodecConfig libjpeg_turbo_config = {
       .name = "libjpeg-turbo",
@@ -361,7 +1131,8 @@ int anicet_experiment(const uint8_t* buffer, size_t buf_size, int height,
       .param_descriptors =
           &anicet::runner::libjpegturbo::LIBJPEGTURBO_PARAMETERS,
       .default_params = {{"optimization", "opt"}},
-      .get_extension = nullptr};
+      .get_extension = nullptr,
+      .thread_param = "strips"};
 
   CodecConfig jpegli_config = {
       .name = "jpegli",
@@ -369,7 +1140,8 @@ int anicet_experiment(const uint8_t* buffer, size_t buf_size, int height,
       .run_func = anicet::runner::jpegli::anicet_run,
       .param_descriptors = &anicet::runner::jpegli::JPEGLI_PARAMETERS,
       .default_params = {},
-      .get_extension = nullptr};
+      .get_extension = nullptr,
+      .thread_param = "strips"};
 
   CodecConfig x265_config = {
       .name = "x265",
@@ -380,7 +1152,8 @@ int anicet_experiment(const uint8_t* buffer, size_t buf_size, int height,
                          {"preset", "medium"},
                          {"tune", "zerolatency"},
                          {"rate-control", "crf"}},
-      .get_extension = nullptr};
+      .get_extension = nullptr,
+      .thread_param = "pools"};
 
   CodecConfig svtav1_config = {
       .name = "svt-av1",
@@ -388,7 +1161,8 @@ int anicet_experiment(const uint8_t* buffer, size_t buf_size, int height,
       .run_func = anicet::runner::svtav1::anicet_run,
       .param_descriptors = &anicet::runner::svtav1::SVTAV1_PARAMETERS,
       .default_params = {},
-      .get_extension = nullptr};
+      .get_extension = nullptr,
+      .thread_param = "lp"};
 
   CodecConfig mediacodec_config = {
       .name = "mediacodec",
@@ -407,43 +1181,93 @@ int anicet_experiment(const uint8_t* buffer, size_t buf_size, int height,
         return "bin";  // Fallback
       }};
 
+  // Collect the selected codecs in run order
+  std::vector<const CodecConfig*> configs;
   // 1. WebP encoding
-  if (run_webp) {
-    run_codec(input, webp_config, num_runs, dump_output, dump_output_dir,
-              dump_output_prefix, codec_setup, output, errors);
-  }
-
+  if (run_webp) configs.push_back(&webp_config);
   // 2. libjpeg-turbo encoding
-  if (run_libjpeg_turbo) {
-    run_codec(input, libjpeg_turbo_config, num_runs, dump_output,
-              dump_output_dir, dump_output_prefix, codec_setup, output, errors);
-  }
-
+  if (run_libjpeg_turbo) configs.push_back(&libjpeg_turbo_config);
   // 3. jpegli encoding
-  if (run_jpegli) {
-    run_codec(input, jpegli_config, num_runs, dump_output, dump_output_dir,
-              dump_output_prefix, codec_setup, output, errors);
-  }
-
+  if (run_jpegli) configs.push_back(&jpegli_config);
   // 4. x265 (H.265/HEVC) 8-bit encoding
-  if (run_x265) {
-    run_codec(input, x265_config, num_runs, dump_output, dump_output_dir,
-              dump_output_prefix, codec_setup, output, errors);
-  }
-
+  if (run_x265) configs.push_back(&x265_config);
   // 5. SVT-AV1 encoding
-  if (run_svtav1) {
-    run_codec(input, svtav1_config, num_runs, dump_output, dump_output_dir,
-              dump_output_prefix, codec_setup, output, errors);
-  }
-
+  if (run_svtav1) configs.push_back(&svtav1_config);
   // 6. Android MediaCodec encoding (only on Android)
-  if (run_mediacodec) {
 #ifdef __ANDROID__
-    run_codec(input, mediacodec_config, num_runs, dump_output, dump_output_dir,
-              dump_output_prefix, codec_setup, output, errors);
+  if (run_mediacodec) configs.push_back(&mediacodec_config);
 #else
+  (void)run_mediacodec;
+  (void)mediacodec_config;
 #endif
+
+  // Output file writer (synchronous unless the caller provides one)
+  anicet::output::FileWriter sync_writer(anicet::output::WriterMode::SYNC,
+                                         anicet::output::WriterIo::WRITE);
+  anicet::output::FileWriter* writer =
+      (options != nullptr && options->writer != nullptr) ? options->writer
+                                                         : &sync_writer;
+
+  // Warm-up runs and --num-runs auto
+  anicet::stats::RunPolicy default_policy;
+  const anicet::stats::RunPolicy& policy =
+      (options != nullptr) ? options->run_policy : default_policy;
+
+  // One pass per CPU cluster (--per-cluster), otherwise a single pass with
+  // the current affinity
+  std::vector<anicet::cpu::CpuCluster> clusters;
+  if (options != nullptr && options->per_cluster) {
+    clusters = anicet::cpu::get_topology().clusters;
+  }
+  std::string base_cpulist =
+      anicet::cpu::format_cpulist(anicet::cpu::get_affinity());
+  size_t num_passes = clusters.empty() ? 1 : clusters.size();
+  for (size_t pass = 0; pass < num_passes; pass++) {
+    size_t first_result = (results != nullptr) ? results->size() : 0;
+    if (!clusters.empty()) {
+      std::string cpulist = anicet::cpu::format_cpulist(clusters[pass].cpus);
+      if (!anicet::cpu::set_affinity_from_cpulist(cpulist)) {
+        fprintf(stderr, "Failed to set CPU affinity to cluster %s (%s)\n",
+                clusters[pass].name.c_str(), cpulist.c_str());
+        errors++;
+        continue;
+      }
+      DEBUG(1, "Cluster %s: CPUs %s, max %lld kHz, capacity %d",
+            clusters[pass].name.c_str(), cpulist.c_str(),
+            (long long)clusters[pass].max_freq_khz, clusters[pass].capacity);
+    }
+
+    if (options != nullptr && !options->thread_counts.empty()) {
+      run_thread_scaling(input, configs, *options, num_runs, dump_output,
+                         dump_output_dir, dump_output_prefix, writer,
+                         codec_setup, output, results, errors);
+    } else if (options != nullptr && options->workers > 1) {
+      for (const CodecConfig* config : configs) {
+        run_codec_workers(input, *config, *options, num_runs, dump_output,
+                          dump_output_dir, dump_output_prefix, writer,
+                          codec_setup, output, results, errors);
+      }
+    } else if (options == nullptr || !options->parallel_codecs) {
+      for (const CodecConfig* config : configs) {
+        run_codec(input, *config, num_runs, dump_output, dump_output_dir,
+                  dump_output_prefix, writer, policy, codec_setup, output,
+                  results, errors);
+      }
+    } else {
+      run_codecs_parallel(input, configs, *options, num_runs, dump_output,
+                          dump_output_dir, dump_output_prefix, writer,
+                          codec_setup, output, results, errors);
+    }
+
+    // Tag this pass's results with the cluster
+    if (!clusters.empty() && results != nullptr) {
+      for (size_t r = first_result; r < results->size(); r++) {
+        (*results)[r].cluster = clusters[pass];
+      }
+    }
+  }
+  if (!clusters.empty()) {
+    anicet::cpu::set_affinity_from_cpulist(base_cpulist);
   }
 
 #undef DEBUG
@@ -3,11 +3,16 @@
 
 #include "anicet_runner_jpegli.h"
 
+#include <algorithm>
 #include <cstdio>
 #include <cstring>
+#include <memory>
+#include <mutex>
 #include <vector>
 
 #include "anicet_common.h"
+#include "anicet_input.h"
+#include "anicet_strips.h"
 #include "hwy/targets.h"
 #include "jpeglib.h"
 #include "resource_profiler.h"
@@ -16,6 +21,201 @@ namespace anicet {
 namespace runner {
 namespace jpegli {
 
+// Helper: Highway targets of a SIMD level, the targets of that level and of
+// the levels below it that the CPU has. SetSupportedTargetsForTest() trusts
+// the mask, so every target must run on this CPU. Highway has no dot product
+// target (dotprod runs NEON), and its NEON_BF16 target stands for i8mm.
+static int64_t highway_targets_for_level(anicet::cpu::SimdLevel level) {
+  using anicet::cpu::SimdLevel;
+  static const std::pair<SimdLevel, int64_t> LEVEL_TARGETS[] = {
+      {SimdLevel::NEON, HWY_NEON_WITHOUT_AES | HWY_NEON},
+      {SimdLevel::I8MM, HWY_NEON_BF16},
+      {SimdLevel::SVE, HWY_SVE},
+      {SimdLevel::SVE2, HWY_SVE2}};
+  int64_t targets = HWY_SCALAR;
+  for (const auto& [target_level, target] : LEVEL_TARGETS) {
+    if (target_level <= level &&
+        anicet::cpu::cpu_has_simd_level(target_level)) {
+      targets |= target;
+    }
+  }
+  return targets;
+}
+
+// Highway target restriction of the running calls. The mask set by
+// SetSupportedTargetsForTest() is process-wide, so concurrent calls
+// (--parallel-codecs, --workers) must agree on it: a call with other targets
+// (0 = auto-dispatch) fails, and the last call to finish resets the mask.
+static std::mutex g_targets_mutex;
+static int g_targets_users = 0;
+static int64_t g_targets = 0;
+
+// Helper: start using a target mask (0 = auto-dispatch). Returns false if
+// concurrent calls use another one.
+static bool acquire_targets(int64_t targets) {
+  std::lock_guard<std::mutex> lock(g_targets_mutex);
+  if (g_targets_users > 0 && g_targets != targets) {
+    return false;
+  }
+  if (g_targets_users == 0 && targets != 0) {
+    hwy::SetSupportedTargetsForTest(targets);
+  }
+  g_targets = targets;
+  g_targets_users++;
+  return true;
+}
+
+// Helper: stop using the target mask, reset to auto-dispatch by the last
+// user. Returns true if the mask was reset.
+static bool release_targets() {
+  std::lock_guard<std::mutex> lock(g_targets_mutex);
+  if (--g_targets_users > 0 || g_targets == 0) {
+    return false;
+  }
+  hwy::SetSupportedTargetsForTest(0);  // 0 disables the mock
+  g_targets = 0;
+  return true;
+}
+
+// Frames re-encoded single-threaded to compare with the strip encodes
+constexpr int STRIP_COMPARISON_FRAMES = 4;
+
+// Helper: configure a compressor for raw yuv420p input
+// baseline selects what strips need to be stitched: one sequential scan and
+// the standard Huffman tables (jpegli defaults to progressive, optimized
+// coding).
+static void configure_compress(struct jpeg_compress_struct* cinfo, int width,
+                               int height, int quality, bool baseline) {
+  cinfo->image_width = width;
+  cinfo->image_height = height;
+  cinfo->input_components = 3;
+  // Use YCbCr color space to avoid unnecessary conversion
+  cinfo->in_color_space = JCS_YCbCr;
+
+  jpeg_set_defaults(cinfo);
+  jpeg_set_quality(cinfo, quality, TRUE);
+
+  // Enable raw data mode for direct YUV420p input
+  cinfo->raw_data_in = TRUE;
+
+  // Configure sampling factors for YUV420p (4:2:0 subsampling)
+  // Y component: 2x2 sampling (full resolution)
+  cinfo->comp_info[0].h_samp_factor = 2;
+  cinfo->comp_info[0].v_samp_factor = 2;
+  // U component: 1x1 sampling (half resolution)
+  cinfo->comp_info[1].h_samp_factor = 1;
+  cinfo->comp_info[1].v_samp_factor = 1;
+  // V component: 1x1 sampling (half resolution)
+  cinfo->comp_info[2].h_samp_factor = 1;
+  cinfo->comp_info[2].v_samp_factor = 1;
+
+  if (baseline) {
+    static const jpeg_scan_info kSequentialScan = {3, {0, 1, 2, 0}, 0, 63, 0,
+                                                   0};
+    cinfo->scan_info = &kSequentialScan;
+    cinfo->num_scans = 1;
+    cinfo->optimize_coding = FALSE;
+  }
+}
+
+// Helper: encode one yuv420p image (plane strides width and width / 2,
+// cinfo->image_height rows) into a newly allocated JPEG buffer
+static void encode_yuv420p(struct jpeg_compress_struct* cinfo,
+                           const uint8_t* y_plane, const uint8_t* u_plane,
+                           const uint8_t* v_plane, int width,
+                           unsigned char** jpeg_buf,
+                           unsigned long* jpeg_size) {
+  // MCU rows: max_v_sample * DCTSIZE = 2 * 8 = 16 for Y plane
+  // DCTSIZE is defined in jpeglib.h as 8
+  const int max_lines = 2 * DCTSIZE;
+
+  // Set up row pointers for raw data
+  // We need 3 arrays of row pointers, one for each component (Y, U, V)
+  JSAMPROW y_rows[2 * DCTSIZE];
+  JSAMPROW u_rows[DCTSIZE];
+  JSAMPROW v_rows[DCTSIZE];
+  JSAMPARRAY plane_pointers[3] = {y_rows, u_rows, v_rows};
+
+  jpeg_mem_dest(cinfo, jpeg_buf, jpeg_size);
+  jpeg_start_compress(cinfo, TRUE);
+
+  // Write raw YUV data in MCU-sized blocks
+  JDIMENSION image_height = cinfo->image_height;
+  JDIMENSION uv_height = (image_height + 1) / 2;
+  while (cinfo->next_scanline < image_height) {
+    // Current Y row (Y plane processes 16 rows at a time)
+    JDIMENSION y_row = cinfo->next_scanline;
+    // Current U/V row (U/V planes process 8 rows at a time, half of Y)
+    JDIMENSION uv_row = y_row / 2;
+
+    // Set up row pointers for Y plane (16 rows)
+    for (int i = 0; i < max_lines; i++) {
+      JDIMENSION row = y_row + i;
+      if (row < image_height) {
+        y_rows[i] = const_cast<JSAMPROW>(y_plane + row * width);
+      } else {
+        // Padding for incomplete MCU
+        y_rows[i] = const_cast<JSAMPROW>(y_plane + (image_height - 1) * width);
+      }
+    }
+
+    // Set up row pointers for U and V planes (8 rows)
+    for (int i = 0; i < DCTSIZE; i++) {
+      JDIMENSION row = uv_row + i;
+      if (row >= uv_height) {
+        // Padding for incomplete MCU
+        row = uv_height - 1;
+      }
+      u_rows[i] = const_cast<JSAMPROW>(u_plane + row * (width / 2));
+      v_rows[i] = const_cast<JSAMPROW>(v_plane + row * (width / 2));
+    }
+
+    // Write one MCU worth of data
+    jpeg_write_raw_data(cinfo, plane_pointers, max_lines);
+  }
+
+  jpeg_finish_compress(cinfo);
+}
+
+// Helper: re-encode the frames of the last runs with the single-threaded
+// path, to compare them with their strip encodes (after the profiled window)
+static void compare_strips(const CodecInput* input, int quality,
+                           int num_strips, anicet::input::FrameRing* frames,
+                           CodecOutput* output) {
+  struct jpeg_compress_struct cinfo;
+  struct jpeg_error_mgr jerr;
+  cinfo.err = jpeg_std_error(&jerr);
+  jpeg_create_compress(&cinfo);
+  configure_compress(&cinfo, input->width, input->height, quality, false);
+
+  StripComparison comparison;
+  comparison.strips = num_strips;
+  int num_runs = (int)output->frame_sizes.size();
+  for (int run = std::max(0, num_runs - STRIP_COMPARISON_FRAMES);
+       run < num_runs; run++) {
+    const uint8_t* frame = frames->frame(run);
+    if (!frame) {
+      break;
+    }
+    const uint8_t* u_plane = frame + (input->width * input->height);
+    const uint8_t* v_plane = u_plane + (input->width * input->height / 4);
+    unsigned char* jpeg_buf = nullptr;
+    unsigned long jpeg_size = 0;
+    int64_t start_us = anicet_get_timestamp();
+    encode_yuv420p(&cinfo, frame, u_plane, v_plane, input->width, &jpeg_buf,
+                   &jpeg_size);
+    comparison.single_time_us += anicet_get_timestamp() - start_us;
+    comparison.single_bytes += jpeg_size;
+    free(jpeg_buf);
+    comparison.strip_time_us += output->timings[run].output_timestamp_us -
+                                output->timings[run].input_timestamp_us;
+    comparison.strip_bytes += output->frame_sizes[run];
+    comparison.frames++;
+  }
+  jpeg_destroy_compress(&cinfo);
+  output->strip_comparison.push_back(comparison);
+}
+
 // jpegli encoder - writes to caller-provided memory buffer only
 int anicet_run(const CodecInput* input, CodecSetup* setup,
                CodecOutput* output) {
@@ -27,8 +227,7 @@ int anicet_run(const CodecInput* input, CodecSetup* setup,
   int num_runs = setup->num_runs;
 
   // Initialize output
-  output->frame_buffers.clear();
-  output->frame_buffers.resize(num_runs);
+  output->frame_arena.clear();
   output->frame_sizes.clear();
   output->frame_sizes.resize(num_runs);
   output->timings.clear();
@@ -36,23 +235,20 @@ int anicet_run(const CodecInput* input, CodecSetup* setup,
   output->profile_encode_cpu_ms.clear();
   output->profile_encode_cpu_ms.resize(num_runs);
 
+  // Hardware counters (opened before the setup so that encoder threads
+  // inherit them)
+  anicet::perf::FrameCounters counters(input, output, num_runs);
+  // Memory sampler thread (tags samples with the run being encoded)
+  anicet::memory::MemorySampler memory(input, output, num_runs);
+
   // Profile total memory (all 4 steps: setup + conversion + encode + cleanup)
   PROFILE_RESOURCES_START(profile_encode_mem);
 
-  // (a) Codec setup
-  struct jpeg_compress_struct cinfo;
-  struct jpeg_error_mgr jerr;
-
-  cinfo.err = jpeg_std_error(&jerr);
-  jpeg_create_compress(&cinfo);
+  // Wall/CPU time and faults of the (a)-(d) steps
+  CodecPhaseTimer phases(output);
 
-  cinfo.image_width = input->width;
-  cinfo.image_height = input->height;
-  cinfo.input_components = 3;
-  // Use YCbCr color space to avoid unnecessary conversion
-  cinfo.in_color_space = JCS_YCbCr;
-
-  jpeg_set_defaults(&cinfo);
+  // (a) Codec setup
+  phases.start(CODEC_PHASE_SETUP);
 
   // Get quality parameter
   int quality = anicet::runner::jpegli::DEFAULT_QUALITY;
@@ -63,84 +259,116 @@ int anicet_run(const CodecInput* input, CodecSetup* setup,
     setup->parameter_map["quality"] = quality;
   }
 
-  // Get highway_target parameter and configure Highway dispatch
-  std::string highway_target = std::get<std::string>(
-      anicet::runner::jpegli::JPEGLI_PARAMETERS.at("highway_target")
-          .default_value);
-  auto highway_target_it = setup->parameter_map.find("highway_target");
-  if (highway_target_it != setup->parameter_map.end()) {
-    highway_target = std::get<std::string>(highway_target_it->second);
-  } else {
-    setup->parameter_map["highway_target"] = highway_target;
+  // Get strips parameter (only recorded when set, so that the default
+  // single-threaded runs keep their output names)
+  int num_strips = 1;
+  auto strips_it = setup->parameter_map.find("strips");
+  if (strips_it != setup->parameter_map.end()) {
+    num_strips = std::get<int>(strips_it->second);
   }
 
-  // TODO(chemag): reconsider jpegli highway SIMD options
-  // highway provides finer-grained control over SIMD optimizations.
-  // * support no targets
-  // * support all targets
-  // * `HWY_NEON`: ARM NEON (baseline)
-  // * `HWY_NEON_BF16`: NEON with BFloat16
-  // * `HWY_SVE`: ARM SVE (Scalable Vector Extension)
-  // * `HWY_SVE2`: ARM SVE2
-  // * `HWY_SVE_256`: SVE with 256-bit vectors
-  // * `HWY_SVE2_128`: SVE2 with 128-bit vectors
-
-  // Configure Highway target selection
-  if (highway_target == "none") {
-    // Disable all SIMD targets, leaving only scalar
-    hwy::SetSupportedTargetsForTest(HWY_SCALAR);
-
+  // Get optimization parameter (SIMD level) and configure Highway dispatch:
+  // "auto" is the auto-dispatch, the other levels restrict the Highway
+  // targets (see highway_targets_for_level())
+  std::string optimization = "auto";
+  auto optimization_it = setup->parameter_map.find("optimization");
+  if (optimization_it != setup->parameter_map.end()) {
+    optimization = std::get<std::string>(optimization_it->second);
+  } else {
+    setup->parameter_map["optimization"] = optimization;
+  }
+  anicet::cpu::SimdLevel simd_level = anicet::cpu::max_simd_level();
+  anicet::cpu::parse_simd_level(optimization, &simd_level);
+  bool restrict_targets = (optimization != "auto");
+
+  // Configure Highway target selection (keep the targets of the level, only
+  // scalar for "c")
+  int64_t restricted =
+      restrict_targets ? highway_targets_for_level(simd_level) : 0;
+  if (!acquire_targets(restricted)) {
+    fprintf(stderr,
+            "jpegli: Concurrent calls restrict the Highway targets to "
+            "another level\n");
+    return -1;
+  }
+  if (restrict_targets) {
     if (input->debug_level >= 2) {
-      fprintf(stderr, "jpegli: Setting Highway target to none (scalar-only)\n");
+      fprintf(stderr, "jpegli: Restricting Highway targets to level %s\n",
+              anicet::cpu::simd_level_name(simd_level));
     }
   }
-  // "all" means use auto-dispatch (default), no action needed
-
-  jpeg_set_quality(&cinfo, quality, TRUE);
-
-  // Enable raw data mode for direct YUV420p input
-  cinfo.raw_data_in = TRUE;
-
-  // Configure sampling factors for YUV420p (4:2:0 subsampling)
-  // Y component: 2x2 sampling (full resolution)
-  cinfo.comp_info[0].h_samp_factor = 2;
-  cinfo.comp_info[0].v_samp_factor = 2;
-  // U component: 1x1 sampling (half resolution)
-  cinfo.comp_info[1].h_samp_factor = 1;
-  cinfo.comp_info[1].v_samp_factor = 1;
-  // V component: 1x1 sampling (half resolution)
-  cinfo.comp_info[2].h_samp_factor = 1;
-  cinfo.comp_info[2].v_samp_factor = 1;
+  // "auto" means use auto-dispatch (default), no action needed
+
+  // Report the level with the best Highway target it dispatches to
+  int64_t targets = hwy::SupportedTargets();
+#ifdef HWY_TARGETS
+  targets &= HWY_TARGETS;
+#endif
+  output->simd_level = anicet::cpu::simd_level_name(simd_level);
+  if (targets != 0) {
+    output->simd_level += std::string(" (") +
+                          hwy::TargetName(targets & -targets) + ")";
+  }
 
-  // (b) Input conversion: Extract YUV420p plane pointers (no conversion needed)
-  const uint8_t* y_plane = input->input_buffer;
-  const uint8_t* u_plane = input->input_buffer + (input->width * input->height);
-  const uint8_t* v_plane = input->input_buffer +
-                           (input->width * input->height) +
-                           (input->width * input->height / 4);
+  struct jpeg_compress_struct cinfo;
+  struct jpeg_error_mgr jerr;
 
-  // MCU rows: max_v_sample * DCTSIZE = 2 * 8 = 16 for Y plane
-  // DCTSIZE is defined in jpeglib.h as 8
-  const int max_lines = 2 * DCTSIZE;
+  cinfo.err = jpeg_std_error(&jerr);
+  jpeg_create_compress(&cinfo);
+  configure_compress(&cinfo, input->width, input->height, quality, false);
+
+  // Strip mode: one baseline compressor per MCU-aligned band, run
+  // concurrently by the strip pool
+  std::vector<anicet::strips::Strip> strips;
+  if (num_strips > 1) {
+    strips = anicet::strips::split_strips(input->height, num_strips,
+                                          anicet::strips::MCU_HEIGHT_420);
+  }
+  std::vector<struct jpeg_compress_struct> strip_cinfo(strips.size());
+  std::vector<struct jpeg_error_mgr> strip_jerr(strips.size());
+  for (size_t i = 0; i < strips.size(); i++) {
+    strip_cinfo[i].err = jpeg_std_error(&strip_jerr[i]);
+    jpeg_create_compress(&strip_cinfo[i]);
+    configure_compress(&strip_cinfo[i], input->width, strips[i].height,
+                       quality, true);
+  }
+  std::unique_ptr<anicet::strips::StripPool> pool;
+  if (!strips.empty()) {
+    pool = std::make_unique<anicet::strips::StripPool>((int)strips.size());
+  }
+  std::vector<anicet::strips::EncodedStrip> encoded(strips.size());
+  std::vector<uint8_t> stitched;
 
-  // Set up row pointers for raw data
-  // We need 3 arrays of row pointers, one for each component (Y, U, V)
-  std::vector<JSAMPROW> y_rows(max_lines);
-  std::vector<JSAMPROW> u_rows(DCTSIZE);
-  std::vector<JSAMPROW> v_rows(DCTSIZE);
-  JSAMPARRAY plane_pointers[3] = {y_rows.data(), u_rows.data(), v_rows.data()};
+  // (b) Input conversion: Extract YUV420p plane pointers (no conversion
+  // needed). The planes are taken per run from the input frame ring.
+  phases.start(CODEC_PHASE_CONVERSION);
+  anicet::input::FrameRing frames(input);
 
   // (c) Actual encoding - run num_runs times
+  phases.start(CODEC_PHASE_ENCODE);
   unsigned char* jpeg_buf = nullptr;
   unsigned long jpeg_size = 0;
   int result = 0;
 
   for (int run = 0; run < num_runs; run++) {
+    const uint8_t* frame = frames.frame(run);
+    if (!frame) {
+      fprintf(stderr, "jpegli: Failed to read input frame (run %d)\n", run);
+      result = -1;
+      break;
+    }
+    const uint8_t* y_plane = frame;
+    const uint8_t* u_plane = frame + (input->width * input->height);
+    const uint8_t* v_plane = frame + (input->width * input->height) +
+                             (input->width * input->height / 4);
+
     // Capture start timestamp
     output->timings[run].input_timestamp_us = anicet_get_timestamp();
 
     ResourceSnapshot frame_start;
-    capture_resources(&frame_start);
+    capture_resources_lite(&frame_start);
+    counters.start(run);
+    memory.begin(run);
 
     // Free previous run's buffer if exists
     if (jpeg_buf) {
@@ -148,77 +376,63 @@ int anicet_run(const CodecInput* input, CodecSetup* setup,
       jpeg_buf = nullptr;
     }
 
-    jpeg_mem_dest(&cinfo, &jpeg_buf, &jpeg_size);
-    jpeg_start_compress(&cinfo, TRUE);
-
-    // Write raw YUV data in MCU-sized blocks
-    while (cinfo.next_scanline < cinfo.image_height) {
-      // Current Y row (Y plane processes 16 rows at a time)
-      JDIMENSION y_row = cinfo.next_scanline;
-      // Current U/V row (U/V planes process 8 rows at a time, half of Y)
-      JDIMENSION uv_row = y_row / 2;
-
-      // Set up row pointers for Y plane (16 rows)
-      for (int i = 0; i < max_lines; i++) {
-        JDIMENSION row = y_row + i;
-        if (row < cinfo.image_height) {
-          y_rows[i] = const_cast<JSAMPROW>(y_plane + row * input->width);
-        } else {
-          // Padding for incomplete MCU
-          y_rows[i] = const_cast<JSAMPROW>(y_plane + (cinfo.image_height - 1) *
-                                                         input->width);
-        }
-      }
-
-      // Set up row pointers for U plane (8 rows)
-      for (int i = 0; i < DCTSIZE; i++) {
-        JDIMENSION row = uv_row + i;
-        JDIMENSION uv_height = (cinfo.image_height + 1) / 2;
-        if (row < uv_height) {
-          u_rows[i] = const_cast<JSAMPROW>(u_plane + row * (input->width / 2));
-        } else {
-          // Padding for incomplete MCU
-          u_rows[i] = const_cast<JSAMPROW>(u_plane + (uv_height - 1) *
-                                                         (input->width / 2));
-        }
+    const uint8_t* out_data = nullptr;
+    size_t out_size = 0;
+    if (strips.empty()) {
+      encode_yuv420p(&cinfo, y_plane, u_plane, v_plane, input->width,
+                     &jpeg_buf, &jpeg_size);
+      out_data = jpeg_buf;
+      out_size = jpeg_size;
+    } else {
+      // Encode the strips concurrently, then stitch them
+      pool->run((int)strips.size(), [&](int i) {
+        const anicet::strips::Strip& strip = strips[i];
+        size_t y_offset = (size_t)strip.y * input->width;
+        size_t uv_offset = (size_t)(strip.y / 2) * (input->width / 2);
+        encoded[i] = anicet::strips::EncodedStrip();
+        encode_yuv420p(&strip_cinfo[i], y_plane + y_offset,
+                       u_plane + uv_offset, v_plane + uv_offset, input->width,
+                       &encoded[i].data, &encoded[i].size);
+      });
+      bool stitched_ok =
+          anicet::strips::stitch_strips(encoded, input->height, &stitched);
+      for (anicet::strips::EncodedStrip& strip : encoded) {
+        free(strip.data);
+        strip.data = nullptr;
       }
-
-      // Set up row pointers for V plane (8 rows)
-      for (int i = 0; i < DCTSIZE; i++) {
-        JDIMENSION row = uv_row + i;
-        JDIMENSION uv_height = (cinfo.image_height + 1) / 2;
-        if (row < uv_height) {
-          v_rows[i] = const_cast<JSAMPROW>(v_plane + row * (input->width / 2));
-        } else {
-          // Padding for incomplete MCU
-          v_rows[i] = const_cast<JSAMPROW>(v_plane + (uv_height - 1) *
-                                                         (input->width / 2));
-        }
+      if (!stitched_ok) {
+        fprintf(stderr, "jpegli: Failed to stitch the strips (run %d)\n", run);
+        result = -1;
+        break;
       }
-
-      // Write one MCU worth of data
-      jpeg_write_raw_data(&cinfo, plane_pointers, max_lines);
+      out_data = stitched.data();
+      out_size = stitched.size();
     }
 
-    jpeg_finish_compress(&cinfo);
-
     // Capture end timestamp
+    counters.stop(run);
+    memory.end(run);
     output->timings[run].output_timestamp_us = anicet_get_timestamp();
 
     ResourceSnapshot frame_end;
-    capture_resources(&frame_end);
+    capture_resources_lite(&frame_end);
     ResourceDelta frame_delta;
     compute_delta(&frame_start, &frame_end, &frame_delta);
     output->profile_encode_cpu_ms[run] = frame_delta.cpu_time_ms;
 
-    // Store output in vector (only copy buffer if dump_output is true)
+    // Store output in the arena (only copy buffer if dump_output is true)
     if (output->dump_output) {
-      output->frame_buffers[run].assign(jpeg_buf, jpeg_buf + jpeg_size);
+      output->frame_arena.push_frame(out_data, out_size);
+    }
+    output->frame_sizes[run] = out_size;
+
+    // Size the output arena for the remaining runs from the first frame
+    if (output->dump_output && run == 0) {
+      output->frame_arena.reserve_frames(num_runs - 1);
     }
-    output->frame_sizes[run] = jpeg_size;
 
     // For next iteration, need to reset scanline counter
-    if (run < num_runs - 1) {
+    if (strips.empty() && run < num_runs - 1) {
       jpeg_abort_compress(&cinfo);
     }
   }
@@ -228,17 +442,19 @@ int anicet_run(const CodecInput* input, CodecSetup* setup,
     free(jpeg_buf);
   }
 
+  // Frames converted while encoding count in the conversion step
+  phases.add_conversion(&frames);
+
   // (d) Codec cleanup
+  phases.start(CODEC_PHASE_CLEANUP);
   jpeg_destroy_compress(&cinfo);
-
-  // Reset Highway target selection to auto-dispatch
-  if (highway_target == "none") {
-    hwy::SetSupportedTargetsForTest(0);  // 0 disables the mock
-    if (input->debug_level >= 2) {
-      fprintf(stderr, "jpegli: Resetting Highway target to auto-dispatch\n");
-    }
+  pool.reset();
+  for (struct jpeg_compress_struct& strip : strip_cinfo) {
+    jpeg_destroy_compress(&strip);
   }
 
+  phases.stop();
+
   ResourceSnapshot __profile_mem_end;
   capture_resources(&__profile_mem_end);
   output->profile_encode_mem_kb = __profile_mem_end.rss_peak_kb;
@@ -247,6 +463,18 @@ int anicet_run(const CodecInput* input, CodecSetup* setup,
   compute_delta(&__profile_start_profile_encode_mem, &__profile_mem_end,
                 &output->resource_delta);
 
+  // Speedup and size overhead of the strips
+  if (result == 0 && !strips.empty()) {
+    compare_strips(input, quality, (int)strips.size(), &frames, output);
+  }
+
+  // Reset Highway target selection to auto-dispatch
+  if (release_targets()) {
+    if (input->debug_level >= 2) {
+      fprintf(stderr, "jpegli: Resetting Highway target to auto-dispatch\n");
+    }
+  }
+
   return result;
 }
 
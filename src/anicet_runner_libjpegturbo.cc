@@ -5,10 +5,16 @@
 
 #include <dlfcn.h>
 
+#include <algorithm>
 #include <cstdio>
 #include <cstring>
+#include <memory>
+#include <vector>
 
 #include "anicet_common.h"
+#include "anicet_input.h"
+#include "anicet_library.h"
+#include "anicet_strips.h"
 #include "resource_profiler.h"
 #include "turbojpeg.h"
 
@@ -18,6 +24,81 @@ namespace libjpegturbo {
 
 using anicet::runner::libjpegturbo::DEFAULT_QUALITY;
 
+// libturbojpeg function table (resolved once per library)
+struct TurboJpegApi {
+  void* (*initCompress)();
+  int (*compressFromYUV)(void*, const unsigned char*, int, int, int, int,
+                         unsigned char**, unsigned long*, int, int);
+  int (*compressFromYUVPlanes)(void*, const unsigned char**, int, const int*,
+                               int, int, unsigned char**, unsigned long*, int,
+                               int);
+  char* (*getErrorStr2)(void*);
+  void (*tjFree)(unsigned char*);
+  int (*tjDestroy)(void*);
+};
+
+// Resolve libturbojpeg symbols from a dlopen'ed library handle
+static bool resolve_turbojpeg_api(void* handle, TurboJpegApi* api) {
+  api->initCompress =
+      (decltype(api->initCompress))dlsym(handle, "tjInitCompress");
+  api->compressFromYUV =
+      (decltype(api->compressFromYUV))dlsym(handle, "tjCompressFromYUV");
+  api->compressFromYUVPlanes = (decltype(api->compressFromYUVPlanes))dlsym(
+      handle, "tjCompressFromYUVPlanes");
+  api->getErrorStr2 =
+      (decltype(api->getErrorStr2))dlsym(handle, "tjGetErrorStr2");
+  api->tjFree = (decltype(api->tjFree))dlsym(handle, "tjFree");
+  api->tjDestroy = (decltype(api->tjDestroy))dlsym(handle, "tjDestroy");
+  return api->initCompress && api->compressFromYUV &&
+         api->compressFromYUVPlanes && api->getErrorStr2 && api->tjFree &&
+         api->tjDestroy;
+}
+
+// Frames re-encoded single-threaded to compare with the strip encodes
+constexpr int STRIP_COMPARISON_FRAMES = 4;
+
+// Helper: re-encode the frames of the last runs with the single-threaded
+// path, to compare them with their strip encodes (after the profiled window)
+static void compare_strips(const TurboJpegApi* api, const CodecInput* input,
+                           int quality, int dct_flag, int num_strips,
+                           anicet::input::FrameRing* frames,
+                           CodecOutput* output) {
+  void* tj_handle = api->initCompress();
+  if (!tj_handle) {
+    fprintf(stderr, "libjpeg-turbo: Failed to initialize compressor\n");
+    return;
+  }
+  StripComparison comparison;
+  comparison.strips = num_strips;
+  int num_runs = (int)output->frame_sizes.size();
+  for (int run = std::max(0, num_runs - STRIP_COMPARISON_FRAMES);
+       run < num_runs; run++) {
+    const uint8_t* frame = frames->frame(run);
+    if (!frame) {
+      break;
+    }
+    unsigned char* jpeg_buf = nullptr;
+    unsigned long jpeg_size = 0;
+    int64_t start_us = anicet_get_timestamp();
+    int ret = api->compressFromYUV(tj_handle, frame, input->width, 1,
+                                   input->height, TJSAMP_420, &jpeg_buf,
+                                   &jpeg_size, quality, dct_flag);
+    int64_t end_us = anicet_get_timestamp();
+    if (ret != 0) {
+      break;
+    }
+    comparison.single_time_us += end_us - start_us;
+    comparison.single_bytes += jpeg_size;
+    api->tjFree(jpeg_buf);
+    comparison.strip_time_us += output->timings[run].output_timestamp_us -
+                                output->timings[run].input_timestamp_us;
+    comparison.strip_bytes += output->frame_sizes[run];
+    comparison.frames++;
+  }
+  api->tjDestroy(tj_handle);
+  output->strip_comparison.push_back(comparison);
+}
+
 // libjpeg-turbo encoder - uses dlopen to load library based on optimization
 // parameter
 int anicet_run(const CodecInput* input, CodecSetup* setup,
@@ -30,8 +111,7 @@ int anicet_run(const CodecInput* input, CodecSetup* setup,
   int num_runs = setup->num_runs;
 
   // Initialize output
-  output->frame_buffers.clear();
-  output->frame_buffers.resize(num_runs);
+  output->frame_arena.clear();
   output->frame_sizes.clear();
   output->frame_sizes.resize(num_runs);
   output->timings.clear();
@@ -39,9 +119,6 @@ int anicet_run(const CodecInput* input, CodecSetup* setup,
   output->profile_encode_cpu_ms.clear();
   output->profile_encode_cpu_ms.resize(num_runs);
 
-  // Profile total memory (all 4 steps: setup + conversion + encode + cleanup)
-  PROFILE_RESOURCES_START(profile_encode_mem);
-
   // Determine library name from optimization parameter
   std::string optimization = "opt";
   auto opt_it = setup->parameter_map.find("optimization");
@@ -56,45 +133,38 @@ int anicet_run(const CodecInput* input, CodecSetup* setup,
                                  ? "libturbojpeg-nonopt.so"
                                  : "libturbojpeg-opt.so";
 
-  // (a) Codec setup - Load libturbojpeg library with RTLD_LOCAL to isolate
-  // symbols
-  void* handle = dlopen(library_name, RTLD_NOW | RTLD_LOCAL);
-  if (!handle) {
-    fprintf(stderr, "libjpeg-turbo: Failed to load library %s: %s\n",
-            library_name, dlerror());
-    PROFILE_RESOURCES_END(profile_encode_mem);
+  // Load libturbojpeg library (cached per process, outside the profiled
+  // window)
+  const TurboJpegApi* api = anicet::library::get_library_api(
+      "libjpeg-turbo", library_name, resolve_turbojpeg_api,
+      &output->library_load_time_ms);
+  if (!api) {
     return -1;
   }
+  auto initCompress = api->initCompress;
+  auto compressFromYUV = api->compressFromYUV;
+  auto compressFromYUVPlanes = api->compressFromYUVPlanes;
+  auto getErrorStr2 = api->getErrorStr2;
+  auto tjFreeFunc = api->tjFree;
+  auto tjDestroyFunc = api->tjDestroy;
+
+  // Hardware counters (opened before the setup so that encoder threads
+  // inherit them)
+  anicet::perf::FrameCounters counters(input, output, num_runs);
+  // Memory sampler thread (tags samples with the run being encoded)
+  anicet::memory::MemorySampler memory(input, output, num_runs);
 
-  // Get function pointers
-  typedef void* (*tjInitCompress_t)();
-  typedef int (*tjCompressFromYUV_t)(void*, const unsigned char*, int, int, int,
-                                     int, unsigned char**, unsigned long*, int,
-                                     int);
-  typedef char* (*tjGetErrorStr2_t)(void*);
-  typedef void (*tjFree_t)(unsigned char*);
-  typedef int (*tjDestroy_t)(void*);
-
-  auto initCompress = (tjInitCompress_t)dlsym(handle, "tjInitCompress");
-  auto compressFromYUV =
-      (tjCompressFromYUV_t)dlsym(handle, "tjCompressFromYUV");
-  auto getErrorStr2 = (tjGetErrorStr2_t)dlsym(handle, "tjGetErrorStr2");
-  auto tjFreeFunc = (tjFree_t)dlsym(handle, "tjFree");
-  auto tjDestroyFunc = (tjDestroy_t)dlsym(handle, "tjDestroy");
-
-  if (!initCompress || !compressFromYUV || !getErrorStr2 || !tjFreeFunc ||
-      !tjDestroyFunc) {
-    fprintf(stderr, "libjpeg-turbo: Failed to load symbols: %s\n", dlerror());
-    dlclose(handle);
-    PROFILE_RESOURCES_END(profile_encode_mem);
-    return -1;
-  }
+  // Profile total memory (all 4 steps: setup + conversion + encode + cleanup)
+  PROFILE_RESOURCES_START(profile_encode_mem);
+
+  // Wall/CPU time and faults of the (a)-(d) steps
+  CodecPhaseTimer phases(output);
 
-  // Now use the library
+  // (a) Codec setup - Initialize compressor
+  phases.start(CODEC_PHASE_SETUP);
   void* tj_handle = initCompress();
   if (!tj_handle) {
     fprintf(stderr, "libjpeg-turbo: Failed to initialize compressor\n");
-    dlclose(handle);
     PROFILE_RESOURCES_END(profile_encode_mem);
     return -1;
   }
@@ -120,50 +190,164 @@ int anicet_run(const CodecInput* input, CodecSetup* setup,
   // Determine DCT flag
   int dct_flag = (dct == "accuratedct") ? TJFLAG_ACCURATEDCT : TJFLAG_FASTDCT;
 
+  // Get strips parameter (only recorded when set, so that the default
+  // single-threaded runs keep their output names)
+  int num_strips = 1;
+  auto strips_it = setup->parameter_map.find("strips");
+  if (strips_it != setup->parameter_map.end()) {
+    num_strips = std::get<int>(strips_it->second);
+  }
+
+  // Strip mode: one compressor per MCU-aligned band (TurboJPEG handles are
+  // not thread-safe), run concurrently by the strip pool
+  std::vector<anicet::strips::Strip> strips;
+  if (num_strips > 1) {
+    strips = anicet::strips::split_strips(input->height, num_strips,
+                                          anicet::strips::MCU_HEIGHT_420);
+  }
+  std::vector<void*> strip_handles(strips.size(), nullptr);
+  for (size_t i = 0; i < strips.size(); i++) {
+    strip_handles[i] = initCompress();
+    if (!strip_handles[i]) {
+      fprintf(stderr, "libjpeg-turbo: Failed to initialize compressor\n");
+      for (void* handle : strip_handles) {
+        if (handle) tjDestroyFunc(handle);
+      }
+      tjDestroyFunc(tj_handle);
+      PROFILE_RESOURCES_END(profile_encode_mem);
+      return -1;
+    }
+  }
+  std::unique_ptr<anicet::strips::StripPool> pool;
+  if (!strips.empty()) {
+    pool = std::make_unique<anicet::strips::StripPool>((int)strips.size());
+  }
+  std::vector<anicet::strips::EncodedStrip> encoded(strips.size());
+  std::vector<int> strip_errors(strips.size(), 0);
+  std::vector<uint8_t> stitched;
+
   // (b) Input conversion: None needed - TurboJPEG takes YUV420 directly
+  // (other input formats are converted to it per run by the frame ring)
+  phases.start(CODEC_PHASE_CONVERSION);
+  anicet::input::FrameRing frames(input);
 
   // (c) Actual encoding - run num_runs times
+  phases.start(CODEC_PHASE_ENCODE);
   int result = 0;
   for (int run = 0; run < num_runs; run++) {
+    const uint8_t* frame = frames.frame(run);
+    if (!frame) {
+      fprintf(stderr, "libjpeg-turbo: Failed to read input frame (run %d)\n",
+              run);
+      result = -1;
+      break;
+    }
+
     // Capture start timestamp
     output->timings[run].input_timestamp_us = anicet_get_timestamp();
     ResourceSnapshot frame_start;
-    capture_resources(&frame_start);
+    capture_resources_lite(&frame_start);
+    counters.start(run);
+    memory.begin(run);
 
     unsigned char* jpeg_buf = nullptr;
     unsigned long jpeg_size = 0;
 
-    // Compress YUV to JPEG - tjCompressFromYUV allocates output buffer
-    int ret = compressFromYUV(tj_handle, input->input_buffer, input->width, 1,
-                              input->height, TJSAMP_420, &jpeg_buf, &jpeg_size,
-                              quality, dct_flag);
-    if (ret != 0) {
-      fprintf(stderr, "libjpeg-turbo: Encoding failed: %s\n",
-              getErrorStr2(tj_handle));
-      result = -1;
-      break;
+    if (strips.empty()) {
+      // Compress YUV to JPEG - tjCompressFromYUV allocates output buffer
+      int ret = compressFromYUV(tj_handle, frame, input->width, 1,
+                                input->height, TJSAMP_420, &jpeg_buf,
+                                &jpeg_size, quality, dct_flag);
+      if (ret != 0) {
+        fprintf(stderr, "libjpeg-turbo: Encoding failed: %s\n",
+                getErrorStr2(tj_handle));
+        result = -1;
+        break;
+      }
+    } else {
+      // Compress the strips concurrently (plane pointers into the frame),
+      // then stitch them. The chroma planes are the ones of
+      // tjCompressFromYUV() with pad 1 (rounded up for odd sizes).
+      const int chroma_width = (input->width + 1) / 2;
+      const int chroma_height = (input->height + 1) / 2;
+      const uint8_t* u_plane = frame + (size_t)input->width * input->height;
+      const uint8_t* v_plane =
+          u_plane + (size_t)chroma_width * chroma_height;
+      pool->run((int)strips.size(), [&](int i) {
+        const anicet::strips::Strip& strip = strips[i];
+        size_t uv_offset = (size_t)(strip.y / 2) * chroma_width;
+        const unsigned char* planes[3] = {
+            frame + (size_t)strip.y * input->width, u_plane + uv_offset,
+            v_plane + uv_offset};
+        const int strides[3] = {input->width, chroma_width, chroma_width};
+        encoded[i] = anicet::strips::EncodedStrip();
+        strip_errors[i] = compressFromYUVPlanes(
+            strip_handles[i], planes, input->width, strides, strip.height,
+            TJSAMP_420, &encoded[i].data, &encoded[i].size, quality,
+            dct_flag);
+      });
+      bool stitched_ok = true;
+      for (size_t i = 0; i < strips.size(); i++) {
+        if (strip_errors[i] != 0) {
+          fprintf(stderr, "libjpeg-turbo: Encoding strip %zu failed: %s\n",
+                  i, getErrorStr2(strip_handles[i]));
+          stitched_ok = false;
+        }
+      }
+      if (stitched_ok) {
+        stitched_ok =
+            anicet::strips::stitch_strips(encoded, input->height, &stitched);
+      }
+      for (anicet::strips::EncodedStrip& strip : encoded) {
+        tjFreeFunc(strip.data);
+        strip.data = nullptr;
+      }
+      if (!stitched_ok) {
+        fprintf(stderr, "libjpeg-turbo: Failed to stitch the strips (run %d)\n",
+                run);
+        result = -1;
+        break;
+      }
     }
+    const unsigned char* out_data = strips.empty() ? jpeg_buf : stitched.data();
+    size_t out_size = strips.empty() ? jpeg_size : stitched.size();
 
     // Capture end timestamp
+    counters.stop(run);
+    memory.end(run);
     output->timings[run].output_timestamp_us = anicet_get_timestamp();
     ResourceSnapshot frame_end;
-    capture_resources(&frame_end);
+    capture_resources_lite(&frame_end);
     ResourceDelta frame_delta;
     compute_delta(&frame_start, &frame_end, &frame_delta);
     output->profile_encode_cpu_ms[run] = frame_delta.cpu_time_ms;
 
-    // Store output in vector (only copy buffer if dump_output is true)
+    // Store output in the arena (only copy buffer if dump_output is true)
     if (output->dump_output) {
-      output->frame_buffers[run].assign(jpeg_buf, jpeg_buf + jpeg_size);
+      output->frame_arena.push_frame(out_data, out_size);
+    }
+    output->frame_sizes[run] = out_size;
+
+    // Size the output arena for the remaining runs from the first frame
+    if (output->dump_output && run == 0) {
+      output->frame_arena.reserve_frames(num_runs - 1);
     }
-    output->frame_sizes[run] = jpeg_size;
 
     tjFreeFunc(jpeg_buf);
   }
 
+  // Frames converted while encoding count in the conversion step
+  phases.add_conversion(&frames);
+
   // (d) Codec cleanup
+  phases.start(CODEC_PHASE_CLEANUP);
   tjDestroyFunc(tj_handle);
-  dlclose(handle);
+  pool.reset();
+  for (void* handle : strip_handles) {
+    tjDestroyFunc(handle);
+  }
+
+  phases.stop();
 
   ResourceSnapshot __profile_mem_end;
   capture_resources(&__profile_mem_end);
@@ -173,6 +357,12 @@ int anicet_run(const CodecInput* input, CodecSetup* setup,
   compute_delta(&__profile_start_profile_encode_mem, &__profile_mem_end,
                 &output->resource_delta);
 
+  // Speedup and size overhead of the strips
+  if (result == 0 && !strips.empty()) {
+    compare_strips(api, input, quality, dct_flag, (int)strips.size(), &frames,
+                   output);
+  }
+
   return result;
 }
 
@@ -3,16 +3,24 @@
 
 #include "anicet_runner_mediacodec.h"
 
+#include <algorithm>
 #include <cstdio>
 
 #include "android_mediacodec_lib.h"
+#include "anicet_color.h"
 #include "anicet_common.h"
+#include "anicet_input.h"
 #include "resource_profiler.h"
 
 namespace anicet {
 namespace runner {
 namespace mediacodec {
 
+// Formats the codec input buffers take directly
+#define MEDIACODEC_NATIVE_FORMATS                                         \
+  {anicet::color::ColorFormat::YUV420P, anicet::color::ColorFormat::NV12, \
+   anicet::color::ColorFormat::NV21}
+
 // Global debug level (set in encode function)
 static int g_debug_level __attribute__((unused)) = 0;
 
@@ -134,36 +142,105 @@ int anicet_run(const CodecInput* input, CodecSetup* setup,
     setup->parameter_map["bitrate_mode"] = bitrate_mode;
   }
 
+  // Extract async_frames parameter (only recorded when set, so that the
+  // default synchronous runs keep their output names)
+  int async_frames __attribute__((unused)) = 0;
+  auto async_frames_it = setup->parameter_map.find("async_frames");
+  if (async_frames_it != setup->parameter_map.end()) {
+    async_frames = std::get<int>(async_frames_it->second);
+  }
+
+  // Extract surface_input parameter (only recorded when set)
+  int surface_input __attribute__((unused)) = 0;
+  auto surface_input_it = setup->parameter_map.find("surface_input");
+  if (surface_input_it != setup->parameter_map.end()) {
+    surface_input = std::get<int>(surface_input_it->second);
+  }
+
+  // Extract pool parameter (only recorded when set)
+  int pool __attribute__((unused)) = 0;
+  auto pool_it = setup->parameter_map.find("pool");
+  if (pool_it != setup->parameter_map.end()) {
+    pool = std::get<int>(pool_it->second);
+  }
+
 #ifdef __ANDROID__
+  // Memory sampler thread (timeline only: the frame loop runs inside
+  // android_mediacodec_encode_frames(), so samples are not tagged by run)
+  anicet::memory::MemorySampler memory(input, output, num_runs);
+
   // Profile total memory (all 4 steps: setup + conversion + encode + cleanup)
   PROFILE_RESOURCES_START(profile_encode_mem);
 
+  // Wall/CPU time and faults of the (a)-(d) steps
+  CodecPhaseTimer phases(output);
+
   // (a) Codec setup - setup ONCE for all frames
+  phases.start(CODEC_PHASE_SETUP);
   MediaCodecFormat format;
   format.width = input->width;
   format.height = input->height;
   format.codec_name = codec_name_str.c_str();
-  format.color_format = input->color_format;
+  // Formats MediaCodec takes directly are passed through, others are
+  // converted to yuv420p by the frame ring
+  std::string color_format = input->color_format;
+  anicet::color::ColorFormat input_format;
+  if (anicet::color::parse_color_format(input->color_format, &input_format)) {
+    color_format = anicet::color::color_format_name(
+        anicet::color::codec_format(input_format, MEDIACODEC_NATIVE_FORMATS));
+  }
+  format.color_format = color_format.c_str();
   format.quality = quality;
   format.bitrate = bitrate;
   format.bitrate_mode = bitrate_mode;
+  format.async_frames = async_frames;
+  format.surface_input = surface_input;
+  format.pool = pool;
   // Use global debug level
   format.debug_level = android_mediacodec_get_debug_level();
 
+  // Create/configure/start times (or a warm codec from the pool)
   AMediaCodec* codec = nullptr;
-  int setup_result = android_mediacodec_encode_setup(&format, &codec);
+  CodecStartup startup;
+  int setup_result =
+      android_mediacodec_encode_setup_timed(&format, &codec, &startup);
   if (setup_result != 0) {
     PROFILE_RESOURCES_END(profile_encode_mem);
     return setup_result;
   }
 
   // (b) Input conversion - none needed for MediaCodec, it accepts YUV420p
-  // directly
+  // directly (frames are copied into the codec input buffers). With
+  // surface_input, the frames are uploaded once into hardware buffers here
+  // (as many as the frame ring holds), so the encode step copies nothing.
+  phases.start(CODEC_PHASE_CONVERSION);
+  anicet::input::FrameRing frames(input, MEDIACODEC_NATIVE_FORMATS);
+  int prefill_frames = 1;
+  if (input->frame_source != nullptr) {
+    prefill_frames = std::min(input->frame_source->num_frames(),
+                              std::max(input->frame_ring_size, 1));
+  }
+  prefill_frames = std::min(prefill_frames, std::max(num_runs, 1));
+  int prefill_result = android_mediacodec_surface_prefill(
+      codec, &frames, &format, prefill_frames);
+  if (prefill_result != 0) {
+    android_mediacodec_encode_cleanup(codec, format.debug_level);
+    PROFILE_RESOURCES_END(profile_encode_mem);
+    return prefill_result;
+  }
+  phases.add_conversion(&frames);
 
   // (c) Actual encoding - encode all frames in one call with new API
-  // CPU profiling is now done inside android_mediacodec_encode_frame()
-  int result = android_mediacodec_encode_frame(
-      codec, input->input_buffer, input->input_size, &format, num_runs, output);
+  // CPU profiling is now done inside android_mediacodec_encode_frames()
+  phases.start(CODEC_PHASE_ENCODE);
+  int result = android_mediacodec_encode_frames(codec, &frames, &format,
+                                                num_runs, output);
+
+  if (output->num_frames() > 0) {
+    startup.first_output_us = output->timings[0].output_timestamp_us -
+                              output->timings[0].input_timestamp_us;
+  }
+  output->codec_startup.push_back(startup);
 
   if (result == 0) {
     // Optionally print timing information
@@ -179,9 +256,15 @@ int anicet_run(const CodecInput* input, CodecSetup* setup,
     fprintf(stderr, "MediaCodec: Encoding failed\n");
   }
 
+  // Frames converted while encoding count in the conversion step
+  phases.add_conversion(&frames);
+
   // (d) Codec cleanup - cleanup ONCE at the end
+  phases.start(CODEC_PHASE_CLEANUP);
   android_mediacodec_encode_cleanup(codec, format.debug_level);
 
+  phases.stop();
+
   // Capture memory profiling data and store in output
   ResourceSnapshot __profile_mem_end;
   capture_resources(&__profile_mem_end);
@@ -8,8 +8,10 @@
 
 #include <cstdio>
 #include <cstring>
+#include <vector>
 
 #include "anicet_common.h"
+#include "anicet_input.h"
 #include "resource_profiler.h"
 
 // Undefine DEFAULT from x265 to avoid conflict with SVT-AV1
@@ -26,6 +28,25 @@ namespace svtav1 {
 using anicet::runner::svtav1::DEFAULT_PRESET;
 using anicet::runner::svtav1::DEFAULT_QP;
 
+// Helper: use_cpu_flags of a SIMD level, the flags of that level and of the
+// levels below it that the CPU has
+static uint64_t cpu_flags_for_level(anicet::cpu::SimdLevel level) {
+  using anicet::cpu::SimdLevel;
+  static const std::pair<SimdLevel, uint64_t> LEVEL_FLAGS[] = {
+      {SimdLevel::NEON, EB_CPU_FLAGS_NEON | EB_CPU_FLAGS_ARM_CRC32},
+      {SimdLevel::DOTPROD, EB_CPU_FLAGS_NEON_DOTPROD},
+      {SimdLevel::I8MM, EB_CPU_FLAGS_NEON_I8MM},
+      {SimdLevel::SVE, EB_CPU_FLAGS_SVE},
+      {SimdLevel::SVE2, EB_CPU_FLAGS_SVE2}};
+  uint64_t flags = 0;
+  for (const auto& [flag_level, flag] : LEVEL_FLAGS) {
+    if (flag_level <= level && anicet::cpu::cpu_has_simd_level(flag_level)) {
+      flags |= flag;
+    }
+  }
+  return flags;
+}
+
 // SVT-AV1 encoder - writes to caller-provided memory buffer only
 int anicet_run(const CodecInput* input, CodecSetup* setup,
                CodecOutput* output) {
@@ -37,8 +58,7 @@ int anicet_run(const CodecInput* input, CodecSetup* setup,
   int num_runs = setup->num_runs;
 
   // Initialize output
-  output->frame_buffers.clear();
-  output->frame_buffers.resize(num_runs);
+  output->frame_arena.clear();
   output->frame_sizes.clear();
   output->frame_sizes.resize(num_runs);
   output->timings.clear();
@@ -46,10 +66,20 @@ int anicet_run(const CodecInput* input, CodecSetup* setup,
   output->profile_encode_cpu_ms.clear();
   output->profile_encode_cpu_ms.resize(num_runs);
 
+  // Hardware counters (opened before the setup so that encoder threads
+  // inherit them)
+  anicet::perf::FrameCounters counters(input, output, num_runs);
+  // Memory sampler thread (tags samples with the run being encoded)
+  anicet::memory::MemorySampler memory(input, output, num_runs);
+
   // Profile total memory (all 4 steps: setup + conversion + encode + cleanup)
   PROFILE_RESOURCES_START(profile_encode_mem);
 
+  // Wall/CPU time and faults of the (a)-(d) steps
+  CodecPhaseTimer phases(output);
+
   // (a) Codec setup
+  phases.start(CODEC_PHASE_SETUP);
   EbComponentType* handle = nullptr;
   EbSvtAv1EncConfiguration config;
 
@@ -129,16 +159,32 @@ int anicet_run(const CodecInput* input, CodecSetup* setup,
   // (`rate_control_mode=2`) modes.
   config.rate_control_mode = 0;  // CQP mode
 
-  // Get use_cpu_flags parameter
-  std::string use_cpu_flags = "all";
-  auto cpu_flags_it = setup->parameter_map.find("use_cpu_flags");
-  if (cpu_flags_it != setup->parameter_map.end()) {
-    use_cpu_flags = std::get<std::string>(cpu_flags_it->second);
-  } else {
-    setup->parameter_map["use_cpu_flags"] = use_cpu_flags;
+  // Get lp parameter (left at the SVT-AV1 default, and not reported, unless
+  // set)
+  auto lp_it = setup->parameter_map.find("lp");
+  if (lp_it != setup->parameter_map.end()) {
+    config.level_of_parallelism = std::get<int>(lp_it->second);
+  }
+
+  // Get mode parameter (only recorded when set, so that the default latency
+  // runs keep their output names)
+  std::string mode = "latency";
+  auto mode_it = setup->parameter_map.find("mode");
+  if (mode_it != setup->parameter_map.end()) {
+    mode = std::get<std::string>(mode_it->second);
+  }
+  bool throughput = (mode == "throughput");
+
+  // Latency mode: low-delay prediction structure without lookahead, so that
+  // each picture's packet comes out before the next picture is sent.
+  // Throughput mode keeps the default (pictures in flight across the
+  // pipeline stages).
+  if (!throughput) {
+    config.pred_structure = SVT_AV1_PRED_LOW_DELAY_B;
+    config.look_ahead_distance = 0;
   }
 
-  // TODO(chemag): reconsider svt-av1 SIMD options
+  // Get optimization parameter (SIMD level) and set use_cpu_flags.
   // svt-av1 provides finer-grained control over SIMD optimizations.
   // * 0: C-only, no SIMD optimizations
   // * EB_CPU_FLAGS_NEON (bit 0 = 1 << 0)
@@ -165,12 +211,21 @@ int anicet_run(const CodecInput* input, CodecSetup* setup,
   //   - Armv9.0-A
   //   - Enhanced SVE with more operations
   //   - Very new ARM cores
-  if (use_cpu_flags == "none") {
-    config.use_cpu_flags = 0;  // C-only, no SIMD
+  // A level uses its flags and the flags of the levels below it (pruned to
+  // the extensions the CPU has), "auto" all the flags (auto-detect).
+  std::string optimization = "auto";
+  auto optimization_it = setup->parameter_map.find("optimization");
+  if (optimization_it != setup->parameter_map.end()) {
+    optimization = std::get<std::string>(optimization_it->second);
   } else {
-    config.use_cpu_flags =
-        EB_CPU_FLAGS_ALL;  // Auto-detect and use all available
+    setup->parameter_map["optimization"] = optimization;
   }
+  anicet::cpu::SimdLevel simd_level = anicet::cpu::max_simd_level();
+  anicet::cpu::parse_simd_level(optimization, &simd_level);
+  config.use_cpu_flags = (optimization == "auto")
+                             ? EB_CPU_FLAGS_ALL
+                             : cpu_flags_for_level(simd_level);
+  output->simd_level = anicet::cpu::simd_level_name(simd_level);
 
   res = svt_av1_enc_set_parameter(handle, &config);
   if (res != EB_ErrorNone) {
@@ -190,16 +245,17 @@ int anicet_run(const CodecInput* input, CodecSetup* setup,
 
   // (b) Input conversion: SVT-AV1 requires EbSvtIOFormat with separate Y/Cb/Cr
   // pointers
+  phases.start(CODEC_PHASE_CONVERSION);
   EbSvtIOFormat input_picture;
   memset(&input_picture, 0, sizeof(input_picture));
 
-  // YUV420p layout: Y plane, then U (Cb), then V (Cr)
+  // YUV420p layout: Y plane, then U (Cb), then V (Cr). The plane pointers
+  // are set per run from the input frame ring (SVT-AV1 copies the picture
+  // in svt_av1_enc_send_picture(), so ring slots can be reused).
+  anicet::input::FrameRing frames(input);
   size_t y_size = input->width * input->height;
   size_t uv_size = y_size / 4;
 
-  input_picture.luma = (uint8_t*)input->input_buffer;
-  input_picture.cb = (uint8_t*)input->input_buffer + y_size;
-  input_picture.cr = (uint8_t*)input->input_buffer + y_size + uv_size;
   input_picture.y_stride = input->width;
   input_picture.cb_stride = input->width / 2;
   input_picture.cr_stride = input->width / 2;
@@ -209,22 +265,97 @@ int anicet_run(const CodecInput* input, CodecSetup* setup,
   // Required for version check
   input_buf.size = sizeof(EbBufferHeaderType);
   input_buf.p_buffer = (uint8_t*)&input_picture;
-  input_buf.n_filled_len = input->input_size;
-  input_buf.n_alloc_len = input->input_size;
+  input_buf.n_filled_len = frames.frame_size();
+  input_buf.n_alloc_len = frames.frame_size();
   input_buf.pic_type = EB_AV1_KEY_PICTURE;
 
   // (c) Actual encoding - run num_runs times
+  phases.start(CODEC_PHASE_ENCODE);
   int result = 0;
 
   // Store frame start snapshots for per-frame CPU tracking
   std::vector<ResourceSnapshot> frame_starts(num_runs);
+  // Runs sent to the encoder, and the next run expected out of it (packets
+  // come in input order: intra only)
+  int sent = 0;
+  int next_output = 0;
+
+  // Helper: receive the packet of the next pending run (blocking waits for
+  // it). Returns 1 if received, 0 if none is ready yet, -1 on error. In
+  // throughput mode the counters and CPU time of a frame include the work on
+  // the frames sent after it, and memory samples are tagged with the oldest
+  // frame not received yet.
+  auto receive = [&](bool blocking) -> int {
+    EbBufferHeaderType* output_buf = nullptr;
+    res = svt_av1_enc_get_packet(handle, &output_buf, blocking ? 1 : 0);
+    if (res == EB_NoErrorEmptyQueue && !blocking) {
+      return 0;
+    }
+    int run = next_output;
+    if (res != EB_ErrorNone || !output_buf || output_buf->n_filled_len == 0 ||
+        run >= sent || output_buf->pts != run) {
+      fprintf(stderr, "SVT-AV1: Failed to get output packet (run %d)\n", run);
+      if (output_buf) {
+        svt_av1_enc_release_out_buffer(&output_buf);
+      }
+      return -1;
+    }
+    next_output++;
+
+    counters.stop(run);
+    if (throughput) {
+      memory.begin(next_output < sent ? next_output : -1);
+    } else {
+      memory.end(run);
+    }
+    // Capture end timestamp when receiving output
+    output->timings[run].output_timestamp_us = anicet_get_timestamp();
+
+    ResourceSnapshot frame_end;
+    capture_resources_lite(&frame_end);
+    ResourceDelta frame_delta;
+    compute_delta(&frame_starts[run], &frame_end, &frame_delta);
+    output->profile_encode_cpu_ms[run] = frame_delta.cpu_time_ms;
+
+    // Store output in the arena (only copy buffer if dump_output is true)
+    if (output->dump_output) {
+      output->frame_arena.push_frame(output_buf->p_buffer,
+                                     output_buf->n_filled_len);
+    }
+    output->frame_sizes[run] = output_buf->n_filled_len;
+
+    // Size the output arena for the remaining runs from the first frame
+    if (output->dump_output && run == 0) {
+      output->frame_arena.reserve_frames(num_runs - 1);
+    }
+
+    svt_av1_enc_release_out_buffer(&output_buf);
+    return 1;
+  };
 
-  // Step 1: Send all input pictures (I-frame only, no EOS between them)
+  // Step 1: Send the input pictures (I-frame only, no EOS between them).
+  // Latency mode waits for each picture's packet before sending the next
+  // one, throughput mode collects the packets that are ready between sends.
   for (int run = 0; run < num_runs; run++) {
+    uint8_t* frame = (uint8_t*)frames.frame(run);
+    if (!frame) {
+      fprintf(stderr, "SVT-AV1: Failed to read input frame (run %d)\n", run);
+      result = -1;
+      break;
+    }
+    input_picture.luma = frame;
+    input_picture.cb = frame + y_size;
+    input_picture.cr = frame + y_size + uv_size;
+    input_buf.pts = run;
+
     // Capture start timestamp when sending input
     output->timings[run].input_timestamp_us = anicet_get_timestamp();
 
-    capture_resources(&frame_starts[run]);
+    capture_resources_lite(&frame_starts[run]);
+    counters.start(run);
+    if (!throughput || next_output == run) {
+      memory.begin(run);
+    }
 
     res = svt_av1_enc_send_picture(handle, &input_buf);
     if (res != EB_ErrorNone) {
@@ -232,6 +363,16 @@ int anicet_run(const CodecInput* input, CodecSetup* setup,
       result = -1;
       break;
     }
+    sent++;
+
+    int received;
+    do {
+      received = receive(!throughput);
+    } while (throughput && received == 1);
+    if (received < 0) {
+      result = -1;
+      break;
+    }
   }
 
   // Step 2: Send EOS once at the end to flush all frames
@@ -247,42 +388,23 @@ int anicet_run(const CodecInput* input, CodecSetup* setup,
     }
   }
 
-  // Step 3: Collect all output packets
-  if (result == 0) {
-    for (int run = 0; run < num_runs; run++) {
-      EbBufferHeaderType* output_buf = nullptr;
-      res = svt_av1_enc_get_packet(handle, &output_buf, 1);
-      if (res == EB_ErrorNone && output_buf && output_buf->n_filled_len > 0) {
-        // Capture end timestamp when receiving output
-        output->timings[run].output_timestamp_us = anicet_get_timestamp();
-
-        ResourceSnapshot frame_end;
-        capture_resources(&frame_end);
-        ResourceDelta frame_delta;
-        compute_delta(&frame_starts[run], &frame_end, &frame_delta);
-        output->profile_encode_cpu_ms[run] = frame_delta.cpu_time_ms;
-
-        // Store output in vector (only copy buffer if dump_output is true)
-        if (output->dump_output) {
-          output->frame_buffers[run].assign(
-              output_buf->p_buffer,
-              output_buf->p_buffer + output_buf->n_filled_len);
-        }
-        output->frame_sizes[run] = output_buf->n_filled_len;
-
-        svt_av1_enc_release_out_buffer(&output_buf);
-      } else {
-        fprintf(stderr, "SVT-AV1: Failed to get output packet (run %d)\n", run);
-        result = -1;
-        break;
-      }
+  // Step 3: Collect the output packets still in flight
+  while (result == 0 && next_output < sent) {
+    if (receive(true) < 0) {
+      result = -1;
     }
   }
 
+  // Frames converted while encoding count in the conversion step
+  phases.add_conversion(&frames);
+
   // (d) Codec cleanup
+  phases.start(CODEC_PHASE_CLEANUP);
   svt_av1_enc_deinit(handle);
   svt_av1_enc_deinit_handle(handle);
 
+  phases.stop();
+
   ResourceSnapshot __profile_mem_end;
   capture_resources(&__profile_mem_end);
   output->profile_encode_mem_kb = __profile_mem_end.rss_peak_kb;
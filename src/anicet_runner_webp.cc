@@ -9,6 +9,8 @@
 #include <cstring>
 
 #include "anicet_common.h"
+#include "anicet_input.h"
+#include "anicet_library.h"
 #include "resource_profiler.h"
 #include "webp/encode.h"
 
@@ -19,6 +21,67 @@ namespace webp {
 using anicet::runner::webp::DEFAULT_METHOD;
 using anicet::runner::webp::DEFAULT_QUALITY;
 
+// WebP library function table (resolved once per library)
+// Note: WebPConfigInit and WebPPictureInit are macros that call *Internal
+// functions
+struct WebPApi {
+  int (*configInitInternal)(WebPConfig*, int, int);
+  int (*pictureInitInternal)(WebPPicture*, int);
+  int (*pictureAlloc)(WebPPicture*);
+  void (*pictureFree)(WebPPicture*);
+  void (*memoryWriterInit)(WebPMemoryWriter*);
+  int (*memoryWrite)(const uint8_t*, size_t, const WebPPicture*);
+  void (*memoryWriterClear)(WebPMemoryWriter*);
+  int (*encode)(const WebPConfig*, WebPPicture*);
+};
+
+// Resolve WebP symbols from a dlopen'ed library handle
+static bool resolve_webp_api(void* handle, WebPApi* api) {
+  api->configInitInternal = (decltype(api->configInitInternal))dlsym(
+      handle, "WebPConfigInitInternal");
+  api->pictureInitInternal = (decltype(api->pictureInitInternal))dlsym(
+      handle, "WebPPictureInitInternal");
+  api->pictureAlloc =
+      (decltype(api->pictureAlloc))dlsym(handle, "WebPPictureAlloc");
+  api->pictureFree =
+      (decltype(api->pictureFree))dlsym(handle, "WebPPictureFree");
+  api->memoryWriterInit =
+      (decltype(api->memoryWriterInit))dlsym(handle, "WebPMemoryWriterInit");
+  api->memoryWrite =
+      (decltype(api->memoryWrite))dlsym(handle, "WebPMemoryWrite");
+  api->memoryWriterClear = (decltype(api->memoryWriterClear))dlsym(
+      handle, "WebPMemoryWriterClear");
+  api->encode = (decltype(api->encode))dlsym(handle, "WebPEncode");
+  return api->configInitInternal && api->pictureInitInternal &&
+         api->pictureAlloc && api->pictureFree && api->memoryWriterInit &&
+         api->memoryWrite && api->memoryWriterClear && api->encode;
+}
+
+// Helper: import a yuv420p frame into the picture planes
+static void import_picture(const CodecInput* input, const uint8_t* frame,
+                           WebPPicture* picture) {
+  const uint8_t* y_plane = frame;
+  const uint8_t* u_plane = frame + (input->width * input->height);
+  const uint8_t* v_plane = frame + (input->width * input->height) +
+                           (input->width * input->height / 4);
+
+  // Copy Y plane
+  for (int y = 0; y < input->height; y++) {
+    memcpy(picture->y + y * picture->y_stride, y_plane + y * input->width,
+           input->width);
+  }
+  // Copy U plane
+  for (int y = 0; y < input->height / 2; y++) {
+    memcpy(picture->u + y * picture->uv_stride,
+           u_plane + y * (input->width / 2), input->width / 2);
+  }
+  // Copy V plane
+  for (int y = 0; y < input->height / 2; y++) {
+    memcpy(picture->v + y * picture->uv_stride,
+           v_plane + y * (input->width / 2), input->width / 2);
+  }
+}
+
 // Runner - uses dlopen to load WebP library based on optimization parameter
 int anicet_run(const CodecInput* input, CodecSetup* setup,
                CodecOutput* output) {
@@ -43,8 +106,7 @@ int anicet_run(const CodecInput* input, CodecSetup* setup,
   int num_runs = setup->num_runs;
 
   // Initialize output
-  output->frame_buffers.clear();
-  output->frame_buffers.resize(num_runs);
+  output->frame_arena.clear();
   output->frame_sizes.clear();
   output->frame_sizes.resize(num_runs);
   output->timings.clear();
@@ -52,59 +114,40 @@ int anicet_run(const CodecInput* input, CodecSetup* setup,
   output->profile_encode_cpu_ms.clear();
   output->profile_encode_cpu_ms.resize(num_runs);
 
-  // Profile total memory (all 4 steps: setup + conversion + encode + cleanup)
-  PROFILE_RESOURCES_START(profile_encode_mem);
-
-  // (a) Codec setup - Load WebP library with RTLD_LOCAL to isolate symbols
-  void* handle = dlopen(library_name, RTLD_NOW | RTLD_LOCAL);
-  if (!handle) {
-    fprintf(stderr, "webp: Failed to load library %s: %s\n", library_name,
-            dlerror());
-    PROFILE_RESOURCES_END(profile_encode_mem);
+  // Load WebP library (cached per process, outside the profiled window)
+  const WebPApi* api = anicet::library::get_library_api(
+      "webp", library_name, resolve_webp_api, &output->library_load_time_ms);
+  if (!api) {
     return -1;
   }
+  auto configInitInternal = api->configInitInternal;
+  auto pictureInitInternal = api->pictureInitInternal;
+  auto pictureAlloc = api->pictureAlloc;
+  auto pictureFree = api->pictureFree;
+  auto memoryWriterInit = api->memoryWriterInit;
+  auto memoryWrite = api->memoryWrite;
+  auto memoryWriterClear = api->memoryWriterClear;
+  auto encode = api->encode;
+
+  // Hardware counters (opened before the setup so that encoder threads
+  // inherit them)
+  anicet::perf::FrameCounters counters(input, output, num_runs);
+  // Memory sampler thread (tags samples with the run being encoded)
+  anicet::memory::MemorySampler memory(input, output, num_runs);
 
-  // Get function pointers
-  // Note: WebPConfigInit and WebPPictureInit are macros that call *Internal
-  // functions
-  typedef int (*WebPConfigInitInternal_t)(WebPConfig*, int, int);
-  typedef int (*WebPPictureInitInternal_t)(WebPPicture*, int);
-  typedef int (*WebPPictureAlloc_t)(WebPPicture*);
-  typedef void (*WebPPictureFree_t)(WebPPicture*);
-  typedef void (*WebPMemoryWriterInit_t)(WebPMemoryWriter*);
-  typedef int (*WebPMemoryWrite_t)(const uint8_t*, size_t, const WebPPicture*);
-  typedef void (*WebPMemoryWriterClear_t)(WebPMemoryWriter*);
-  typedef int (*WebPEncode_t)(const WebPConfig*, WebPPicture*);
-
-  auto configInitInternal =
-      (WebPConfigInitInternal_t)dlsym(handle, "WebPConfigInitInternal");
-  auto pictureInitInternal =
-      (WebPPictureInitInternal_t)dlsym(handle, "WebPPictureInitInternal");
-  auto pictureAlloc = (WebPPictureAlloc_t)dlsym(handle, "WebPPictureAlloc");
-  auto pictureFree = (WebPPictureFree_t)dlsym(handle, "WebPPictureFree");
-  auto memoryWriterInit =
-      (WebPMemoryWriterInit_t)dlsym(handle, "WebPMemoryWriterInit");
-  auto memoryWrite = (WebPMemoryWrite_t)dlsym(handle, "WebPMemoryWrite");
-  auto memoryWriterClear =
-      (WebPMemoryWriterClear_t)dlsym(handle, "WebPMemoryWriterClear");
-  auto encode = (WebPEncode_t)dlsym(handle, "WebPEncode");
-
-  if (!configInitInternal || !pictureInitInternal || !pictureAlloc ||
-      !pictureFree || !memoryWriterInit || !memoryWrite || !memoryWriterClear ||
-      !encode) {
-    fprintf(stderr, "webp: Failed to load symbols: %s\n", dlerror());
-    dlclose(handle);
-    PROFILE_RESOURCES_END(profile_encode_mem);
-    return -1;
-  }
+  // Profile total memory (all 4 steps: setup + conversion + encode + cleanup)
+  PROFILE_RESOURCES_START(profile_encode_mem);
+
+  // Wall/CPU time and faults of the (a)-(d) steps
+  CodecPhaseTimer phases(output);
 
-  // Now use the library exactly like before
+  // (a) Codec setup - Initialize config and picture
+  phases.start(CODEC_PHASE_SETUP);
   WebPConfig config;
   // Call the internal function directly with version parameters
   if (!configInitInternal(&config, WEBP_ENCODER_ABI_VERSION,
                           WEBP_ENCODER_ABI_VERSION)) {
     fprintf(stderr, "webp: Failed to initialize config\n");
-    dlclose(handle);
     PROFILE_RESOURCES_END(profile_encode_mem);
     return -1;
   }
@@ -127,11 +170,17 @@ int anicet_run(const CodecInput* input, CodecSetup* setup,
     setup->parameter_map["method"] = config.method;
   }
 
+  // Get thread_level parameter (left at the libwebp default, and not
+  // reported, unless set)
+  auto thread_level_it = setup->parameter_map.find("thread_level");
+  if (thread_level_it != setup->parameter_map.end()) {
+    config.thread_level = std::get<int>(thread_level_it->second);
+  }
+
   WebPPicture picture;
   // Call the internal function directly with version parameter
   if (!pictureInitInternal(&picture, WEBP_ENCODER_ABI_VERSION)) {
     fprintf(stderr, "webp: Failed to initialize picture\n");
-    dlclose(handle);
     PROFILE_RESOURCES_END(profile_encode_mem);
     return -1;
   }
@@ -146,41 +195,54 @@ int anicet_run(const CodecInput* input, CodecSetup* setup,
   if (!pictureAlloc(&picture)) {
     fprintf(stderr, "webp: Failed to allocate picture\n");
     pictureFree(&picture);
-    dlclose(handle);
     PROFILE_RESOURCES_END(profile_encode_mem);
     return -1;
   }
 
-  // (b) Input conversion: Import YUV420 data manually
-  const uint8_t* y_plane = input->input_buffer;
-  const uint8_t* u_plane = input->input_buffer + (input->width * input->height);
-  const uint8_t* v_plane = input->input_buffer +
-                           (input->width * input->height) +
-                           (input->width * input->height / 4);
-
-  // Copy Y plane
-  for (int y = 0; y < input->height; y++) {
-    memcpy(picture.y + y * picture.y_stride, y_plane + y * input->width,
-           input->width);
-  }
-  // Copy U plane
-  for (int y = 0; y < input->height / 2; y++) {
-    memcpy(picture.u + y * picture.uv_stride, u_plane + y * (input->width / 2),
-           input->width / 2);
-  }
-  // Copy V plane
-  for (int y = 0; y < input->height / 2; y++) {
-    memcpy(picture.v + y * picture.uv_stride, v_plane + y * (input->width / 2),
-           input->width / 2);
+  // (b) Input conversion: Import YUV420 data manually (the first frame here,
+  // and each later frame of a multi-frame input before it is encoded)
+  phases.start(CODEC_PHASE_CONVERSION);
+  anicet::input::FrameRing frames(input);
+  const uint8_t* first_frame = frames.frame(0);
+  if (!first_frame) {
+    fprintf(stderr, "webp: Failed to read input frame (run 0)\n");
+    pictureFree(&picture);
+    PROFILE_RESOURCES_END(profile_encode_mem);
+    return -1;
   }
+  import_picture(input, first_frame, &picture);
+  phases.add_conversion(&frames);
 
   // (c) Actual encoding - run num_runs times
+  phases.start(CODEC_PHASE_ENCODE);
   int result = 0;
   for (int run = 0; run < num_runs; run++) {
+    const uint8_t* frame = (run == 0) ? first_frame : frames.frame(run);
+    if (!frame) {
+      fprintf(stderr, "webp: Failed to read input frame (run %d)\n", run);
+      result = -1;
+      break;
+    }
+    // A single input buffer only needs to be imported once. Later imports
+    // count in the conversion step.
+    if (run > 0 && input->frame_source != nullptr) {
+      ResourceSnapshot import_start;
+      capture_resources_lite(&import_start);
+      import_picture(input, frame, &picture);
+      ResourceSnapshot import_end;
+      capture_resources_lite(&import_end);
+      ResourceDelta import_delta;
+      compute_delta(&import_start, &import_end, &import_delta);
+      phases.add_conversion(import_delta.wall_time_ms,
+                            import_delta.cpu_time_ms);
+    }
+
     // Capture start timestamp and resources
     output->timings[run].input_timestamp_us = anicet_get_timestamp();
     ResourceSnapshot frame_start;
-    capture_resources(&frame_start);
+    capture_resources_lite(&frame_start);
+    counters.start(run);
+    memory.begin(run);
 
     WebPMemoryWriter writer;
     memoryWriterInit(&writer);
@@ -195,25 +257,37 @@ int anicet_run(const CodecInput* input, CodecSetup* setup,
     }
 
     // Capture end timestamp and resources
+    counters.stop(run);
+    memory.end(run);
     output->timings[run].output_timestamp_us = anicet_get_timestamp();
     ResourceSnapshot frame_end;
-    capture_resources(&frame_end);
+    capture_resources_lite(&frame_end);
     ResourceDelta frame_delta;
     compute_delta(&frame_start, &frame_end, &frame_delta);
     output->profile_encode_cpu_ms[run] = frame_delta.cpu_time_ms;
 
-    // Store output in vector (only copy buffer if dump_output is true)
+    // Store output in the arena (only copy buffer if dump_output is true)
     if (output->dump_output) {
-      output->frame_buffers[run].assign(writer.mem, writer.mem + writer.size);
+      output->frame_arena.push_frame(writer.mem, writer.size);
     }
     output->frame_sizes[run] = writer.size;
 
+    // Size the output arena for the remaining runs from the first frame
+    if (output->dump_output && run == 0) {
+      output->frame_arena.reserve_frames(num_runs - 1);
+    }
+
     memoryWriterClear(&writer);
   }
 
+  // Frames converted while encoding count in the conversion step
+  phases.add_conversion(&frames);
+
   // (d) Codec cleanup
+  phases.start(CODEC_PHASE_CLEANUP);
   pictureFree(&picture);
-  dlclose(handle);
+
+  phases.stop();
 
   // Capture memory profiling data and store in output
   ResourceSnapshot __profile_mem_end;
@@ -7,8 +7,11 @@
 
 #include <cstdio>
 #include <cstring>
+#include <vector>
 
 #include "anicet_common.h"
+#include "anicet_input.h"
+#include "anicet_library.h"
 #include "resource_profiler.h"
 #include "x265.h"
 
@@ -16,6 +19,45 @@ namespace anicet {
 namespace runner {
 namespace x265 {
 
+// x265 library function table (resolved once per library)
+struct X265Api {
+  x265_param* (*param_alloc)();
+  int (*param_default_preset)(x265_param*, const char*, const char*);
+  x265_encoder* (*encoder_open)(x265_param*);
+  x265_picture* (*picture_alloc)();
+  void (*picture_init)(x265_param*, x265_picture*);
+  int (*encoder_encode)(x265_encoder*, x265_nal**, uint32_t*, x265_picture*,
+                        x265_picture*);
+  void (*picture_free)(x265_picture*);
+  void (*encoder_close)(x265_encoder*);
+  void (*param_free)(x265_param*);
+};
+
+// Resolve x265 symbols from a dlopen'ed library handle
+static bool resolve_x265_api(void* handle, X265Api* api) {
+  api->param_alloc =
+      (decltype(api->param_alloc))dlsym(handle, "x265_param_alloc");
+  api->param_default_preset = (decltype(api->param_default_preset))dlsym(
+      handle, "x265_param_default_preset");
+  api->encoder_open =
+      (decltype(api->encoder_open))dlsym(handle, "x265_encoder_open_215");
+  api->picture_alloc =
+      (decltype(api->picture_alloc))dlsym(handle, "x265_picture_alloc");
+  api->picture_init =
+      (decltype(api->picture_init))dlsym(handle, "x265_picture_init");
+  api->encoder_encode =
+      (decltype(api->encoder_encode))dlsym(handle, "x265_encoder_encode");
+  api->picture_free =
+      (decltype(api->picture_free))dlsym(handle, "x265_picture_free");
+  api->encoder_close =
+      (decltype(api->encoder_close))dlsym(handle, "x265_encoder_close");
+  api->param_free =
+      (decltype(api->param_free))dlsym(handle, "x265_param_free");
+  return api->param_alloc && api->param_default_preset && api->encoder_open &&
+         api->picture_alloc && api->picture_init && api->encoder_encode &&
+         api->picture_free && api->encoder_close && api->param_free;
+}
+
 // x265 encoder (8-bit) - uses dlopen to load library based on optimization
 // parameter
 int anicet_run(const CodecInput* input, CodecSetup* setup,
@@ -30,8 +72,7 @@ int anicet_run(const CodecInput* input, CodecSetup* setup,
   int num_runs = setup->num_runs;
 
   // Initialize output
-  output->frame_buffers.clear();
-  output->frame_buffers.resize(num_runs);
+  output->frame_arena.clear();
   output->frame_sizes.clear();
   output->frame_sizes.resize(num_runs);
   output->timings.clear();
@@ -39,9 +80,6 @@ int anicet_run(const CodecInput* input, CodecSetup* setup,
   output->profile_encode_cpu_ms.clear();
   output->profile_encode_cpu_ms.resize(num_runs);
 
-  // Profile total memory (all 4 steps: setup + conversion + encode + cleanup)
-  PROFILE_RESOURCES_START(profile_encode_mem);
-
   // Determine library name from optimization parameter
   std::string optimization = "opt";
   auto opt_it = setup->parameter_map.find("optimization");
@@ -56,57 +94,39 @@ int anicet_run(const CodecInput* input, CodecSetup* setup,
   DEBUG(2, "x265: Loading library %s (optimization=%s)", library_name,
         optimization.c_str());
 
-  // (a) Codec setup - Load x265 library with RTLD_LOCAL to isolate symbols
-  void* handle = dlopen(library_name, RTLD_NOW | RTLD_LOCAL);
-  if (!handle) {
-    fprintf(stderr, "x265: Failed to load library %s: %s\n", library_name,
-            dlerror());
-    PROFILE_RESOURCES_END(profile_encode_mem);
+  // Load x265 library (cached per process, outside the profiled window)
+  const X265Api* api = anicet::library::get_library_api(
+      "x265", library_name, resolve_x265_api, &output->library_load_time_ms);
+  if (!api) {
     return -1;
   }
+  auto param_alloc = api->param_alloc;
+  auto param_default_preset = api->param_default_preset;
+  auto encoder_open = api->encoder_open;
+  auto picture_alloc = api->picture_alloc;
+  auto picture_init = api->picture_init;
+  auto encoder_encode = api->encoder_encode;
+  auto picture_free = api->picture_free;
+  auto encoder_close = api->encoder_close;
+  auto param_free = api->param_free;
+
+  // Hardware counters (opened before the setup so that encoder threads
+  // inherit them)
+  anicet::perf::FrameCounters counters(input, output, num_runs);
+  // Memory sampler thread (tags samples with the run being encoded)
+  anicet::memory::MemorySampler memory(input, output, num_runs);
 
-  // Get function pointers
-  typedef x265_param* (*x265_param_alloc_t)();
-  typedef int (*x265_param_default_preset_t)(x265_param*, const char*,
-                                             const char*);
-  typedef x265_encoder* (*x265_encoder_open_t)(x265_param*);
-  typedef x265_picture* (*x265_picture_alloc_t)();
-  typedef void (*x265_picture_init_t)(x265_param*, x265_picture*);
-  typedef int (*x265_encoder_encode_t)(x265_encoder*, x265_nal**, uint32_t*,
-                                       x265_picture*, x265_picture*);
-  typedef void (*x265_picture_free_t)(x265_picture*);
-  typedef void (*x265_encoder_close_t)(x265_encoder*);
-  typedef void (*x265_param_free_t)(x265_param*);
-
-  auto param_alloc = (x265_param_alloc_t)dlsym(handle, "x265_param_alloc");
-  auto param_default_preset =
-      (x265_param_default_preset_t)dlsym(handle, "x265_param_default_preset");
-  auto encoder_open =
-      (x265_encoder_open_t)dlsym(handle, "x265_encoder_open_215");
-  auto picture_alloc =
-      (x265_picture_alloc_t)dlsym(handle, "x265_picture_alloc");
-  auto picture_init = (x265_picture_init_t)dlsym(handle, "x265_picture_init");
-  auto encoder_encode =
-      (x265_encoder_encode_t)dlsym(handle, "x265_encoder_encode");
-  auto picture_free = (x265_picture_free_t)dlsym(handle, "x265_picture_free");
-  auto encoder_close =
-      (x265_encoder_close_t)dlsym(handle, "x265_encoder_close");
-  auto param_free = (x265_param_free_t)dlsym(handle, "x265_param_free");
-
-  if (!param_alloc || !param_default_preset || !encoder_open ||
-      !picture_alloc || !picture_init || !encoder_encode || !picture_free ||
-      !encoder_close || !param_free) {
-    fprintf(stderr, "x265: Failed to load symbols: %s\n", dlerror());
-    dlclose(handle);
-    PROFILE_RESOURCES_END(profile_encode_mem);
-    return -1;
-  }
+  // Profile total memory (all 4 steps: setup + conversion + encode + cleanup)
+  PROFILE_RESOURCES_START(profile_encode_mem);
+
+  // Wall/CPU time and faults of the (a)-(d) steps
+  CodecPhaseTimer phases(output);
 
-  // Now use the library
+  // (a) Codec setup - Allocate and configure encoder parameters
+  phases.start(CODEC_PHASE_SETUP);
   x265_param* param = param_alloc();
   if (!param) {
     fprintf(stderr, "x265: Failed to allocate parameters\n");
-    dlclose(handle);
     PROFILE_RESOURCES_END(profile_encode_mem);
     return -1;
   }
@@ -123,7 +143,6 @@ int anicet_run(const CodecInput* input, CodecSetup* setup,
     if (!validate_parameter_list("x265", "preset", preset,
                                  DEFAULT_CODEC_SETUP_PRESET_VALUES)) {
       param_free(param);
-      dlclose(handle);
       PROFILE_RESOURCES_END(profile_encode_mem);
       return -1;
     }
@@ -140,7 +159,6 @@ int anicet_run(const CodecInput* input, CodecSetup* setup,
     if (!validate_parameter_list("x265", "tune", tune,
                                  DEFAULT_CODEC_SETUP_TUNE_VALUES)) {
       param_free(param);
-      dlclose(handle);
       PROFILE_RESOURCES_END(profile_encode_mem);
       return -1;
     }
@@ -159,7 +177,6 @@ int anicet_run(const CodecInput* input, CodecSetup* setup,
         "x265: Failed to apply preset '%s' with tune '%s' (error code %d)\n",
         preset.c_str(), tune.c_str(), preset_ret);
     param_free(param);
-    dlclose(handle);
     PROFILE_RESOURCES_END(profile_encode_mem);
     return -1;
   }
@@ -176,7 +193,6 @@ int anicet_run(const CodecInput* input, CodecSetup* setup,
     if (!validate_parameter_list("x265", "rate-control", rate_control,
                                  DEFAULT_CODEC_SETUP_RATE_CONTROL_VALUES)) {
       param_free(param);
-      dlclose(handle);
       PROFILE_RESOURCES_END(profile_encode_mem);
       return -1;
     }
@@ -220,7 +236,6 @@ int anicet_run(const CodecInput* input, CodecSetup* setup,
       fprintf(stderr, "x265: bitrate parameter required for %s mode\n",
               rate_control.c_str());
       param_free(param);
-      dlclose(handle);
       PROFILE_RESOURCES_END(profile_encode_mem);
       return -1;
     }
@@ -256,17 +271,57 @@ int anicet_run(const CodecInput* input, CodecSetup* setup,
   // Set log level based on debug_level (only show messages if debug_level > 1)
   param->logLevel = (input->debug_level > 1) ? X265_LOG_INFO : X265_LOG_NONE;
 
+  // Threading (left at the x265 defaults, and not reported, unless set).
+  // numaPools must stay valid until encoder_open().
+  std::string pools;
+  auto pools_it = setup->parameter_map.find("pools");
+  if (pools_it != setup->parameter_map.end() &&
+      std::get<int>(pools_it->second) > 0) {
+    pools = std::to_string(std::get<int>(pools_it->second));
+    param->numaPools = pools.c_str();
+  }
+  auto frame_threads_it = setup->parameter_map.find("frame-threads");
+
+  // Get mode parameter (only recorded when set, so that the default latency
+  // runs keep their output names)
+  std::string mode = "latency";
+  auto mode_it = setup->parameter_map.find("mode");
+  if (mode_it != setup->parameter_map.end()) {
+    mode = std::get<std::string>(mode_it->second);
+  }
+  bool throughput = (mode == "throughput");
+
+  // Latency mode: one picture in the encoder at a time (no frame threads,
+  // no lookahead), so that each encoder_encode() returns the picture it was
+  // given. Throughput mode: frame threads keep several pictures in flight
+  // (frame-threads, or auto from the pool size), and outputs come back
+  // from later calls.
+  if (throughput) {
+    param->frameNumThreads = (frame_threads_it != setup->parameter_map.end())
+                                 ? std::get<int>(frame_threads_it->second)
+                                 : 0;
+  } else {
+    if (frame_threads_it != setup->parameter_map.end() &&
+        std::get<int>(frame_threads_it->second) > 1) {
+      fprintf(stderr,
+              "x265: frame-threads=%d ignored in latency mode (use "
+              "mode=throughput)\n",
+              std::get<int>(frame_threads_it->second));
+    }
+    param->frameNumThreads = 1;
+    param->lookaheadDepth = 0;
+  }
+
   DEBUG(2,
         "x265: Opening encoder (width=%d, height=%d, csp=I420, "
-        "keyframeMax=%d, bframes=%d)",
+        "keyframeMax=%d, bframes=%d, mode=%s)",
         param->sourceWidth, param->sourceHeight, param->keyframeMax,
-        param->bframes);
+        param->bframes, mode.c_str());
 
   x265_encoder* encoder = encoder_open(param);
   if (!encoder) {
     fprintf(stderr, "x265: Failed to open encoder\n");
     param_free(param);
-    dlclose(handle);
     PROFILE_RESOURCES_END(profile_encode_mem);
     return -1;
   }
@@ -276,52 +331,56 @@ int anicet_run(const CodecInput* input, CodecSetup* setup,
   x265_picture* pic_in = picture_alloc();
   DEBUG(2, "x265: Initializing picture");
   picture_init(param, pic_in);
+  // Output picture (its pts identifies the run of each output)
+  x265_picture* pic_out = picture_alloc();
+  picture_init(param, pic_out);
   DEBUG(2, "x265: Picture initialized");
 
-  // (b) Input conversion - Set up picture planes for YUV420 (8-bit)
+  // (b) Input conversion - Set up picture planes for YUV420 (8-bit). The
+  // plane pointers are set per run from the input frame ring.
+  phases.start(CODEC_PHASE_CONVERSION);
+  anicet::input::FrameRing frames(input);
   pic_in->bitDepth = 8;
-  pic_in->planes[0] = (void*)input->input_buffer;
-  pic_in->planes[1] =
-      (void*)(input->input_buffer + input->width * input->height);
-  pic_in->planes[2] =
-      (void*)(input->input_buffer + input->width * input->height +
-              input->width * input->height / 4);
   pic_in->stride[0] = input->width;
   pic_in->stride[1] = input->width / 2;
   pic_in->stride[2] = input->width / 2;
 
   // (c) Actual encoding - run num_runs times through same encoder
+  phases.start(CODEC_PHASE_ENCODE);
   int result = 0;
 
-  DEBUG(2, "x265: Starting encoding loop (num_runs=%d)", num_runs);
-
-  for (int run = 0; run < num_runs; run++) {
-    DEBUG(2, "x265: Encoding run %d/%d", run + 1, num_runs);
-
-    // Capture start timestamp
-    output->timings[run].input_timestamp_us = anicet_get_timestamp();
-    ResourceSnapshot frame_start;
-    capture_resources(&frame_start);
-
-    // Force this frame to be IDR
-    pic_in->sliceType = X265_TYPE_IDR;
-
-    x265_nal* nals = nullptr;
-    uint32_t num_nals = 0;
-    int frame_size = encoder_encode(encoder, &nals, &num_nals, pic_in, nullptr);
-
-    if (frame_size <= 0) {
-      fprintf(stderr, "x265: Encoding failed (run %d)\n", run);
-      result = -1;
-      break;
+  // Store frame start snapshots for per-frame CPU tracking
+  std::vector<ResourceSnapshot> frame_starts(num_runs);
+  // Runs sent to the encoder, and the next run expected out of it (outputs
+  // come in input order: no B-frames)
+  int sent = 0;
+  int next_output = 0;
+
+  // Helper: record the output of the next pending run. In throughput mode
+  // the counters and CPU time of a frame include the work on the frames
+  // sent after it, and memory samples are tagged with the oldest frame not
+  // received yet.
+  auto receive = [&](x265_nal* nals, uint32_t num_nals) -> bool {
+    int run = next_output;
+    if (run >= sent || pic_out->pts != run) {
+      fprintf(stderr, "x265: Unexpected output picture (pts %lld, run %d)\n",
+              (long long)pic_out->pts, run);
+      return false;
     }
+    next_output++;
 
     // Capture end timestamp
+    counters.stop(run);
+    if (throughput) {
+      memory.begin(next_output < sent ? next_output : -1);
+    } else {
+      memory.end(run);
+    }
     output->timings[run].output_timestamp_us = anicet_get_timestamp();
     ResourceSnapshot frame_end;
-    capture_resources(&frame_end);
+    capture_resources_lite(&frame_end);
     ResourceDelta frame_delta;
-    compute_delta(&frame_start, &frame_end, &frame_delta);
+    compute_delta(&frame_starts[run], &frame_end, &frame_delta);
     output->profile_encode_cpu_ms[run] = frame_delta.cpu_time_ms;
 
     // Calculate total size for this frame
@@ -330,29 +389,98 @@ int anicet_run(const CodecInput* input, CodecSetup* setup,
       total_size += nals[i].sizeBytes;
     }
 
-    // Copy all NAL units directly to output vector (only if dump_output is
-    // true)
+    // Append all NAL units directly to the output arena (only if dump_output
+    // is true)
     if (output->dump_output) {
-      output->frame_buffers[run].resize(total_size);
-      size_t offset = 0;
+      output->frame_arena.add_frame();
       for (uint32_t i = 0; i < num_nals; i++) {
-        memcpy(output->frame_buffers[run].data() + offset, nals[i].payload,
-               nals[i].sizeBytes);
-        offset += nals[i].sizeBytes;
+        output->frame_arena.append(nals[i].payload, nals[i].sizeBytes);
       }
     }
     output->frame_sizes[run] = total_size;
+
+    // Size the output arena for the remaining runs from the first frame
+    if (output->dump_output && run == 0) {
+      output->frame_arena.reserve_frames(num_runs - 1);
+    }
     DEBUG(2, "x265: Run %d complete (output size=%zu bytes)", run + 1,
           total_size);
+    return true;
+  };
+
+  DEBUG(2, "x265: Starting encoding loop (num_runs=%d)", num_runs);
+
+  for (int run = 0; run < num_runs; run++) {
+    DEBUG(2, "x265: Encoding run %d/%d", run + 1, num_runs);
+
+    const uint8_t* frame = frames.frame(run);
+    if (!frame) {
+      fprintf(stderr, "x265: Failed to read input frame (run %d)\n", run);
+      result = -1;
+      break;
+    }
+    pic_in->planes[0] = (void*)frame;
+    pic_in->planes[1] = (void*)(frame + input->width * input->height);
+    pic_in->planes[2] = (void*)(frame + input->width * input->height +
+                                input->width * input->height / 4);
+    pic_in->pts = run;
+
+    // Capture start timestamp
+    output->timings[run].input_timestamp_us = anicet_get_timestamp();
+    capture_resources_lite(&frame_starts[run]);
+    counters.start(run);
+    if (!throughput || next_output == run) {
+      memory.begin(run);
+    }
+
+    // Force this frame to be IDR
+    pic_in->sliceType = X265_TYPE_IDR;
+
+    x265_nal* nals = nullptr;
+    uint32_t num_nals = 0;
+    int ret = encoder_encode(encoder, &nals, &num_nals, pic_in, pic_out);
+    sent++;
+
+    if (ret < 0 || (ret == 0 && !throughput)) {
+      fprintf(stderr, "x265: Encoding failed (run %d)\n", run);
+      result = -1;
+      break;
+    }
+    if (ret > 0 && !receive(nals, num_nals)) {
+      result = -1;
+      break;
+    }
+  }
+
+  // Throughput mode: flush the pictures still in flight
+  while (result == 0 && next_output < sent) {
+    x265_nal* nals = nullptr;
+    uint32_t num_nals = 0;
+    int ret = encoder_encode(encoder, &nals, &num_nals, nullptr, pic_out);
+    if (ret <= 0) {
+      fprintf(stderr, "x265: Failed to flush the encoder (run %d)\n",
+              next_output);
+      result = -1;
+      break;
+    }
+    if (!receive(nals, num_nals)) {
+      result = -1;
+    }
   }
 
   DEBUG(2, "x265: All encoding runs complete, cleaning up");
 
+  // Frames converted while encoding count in the conversion step
+  phases.add_conversion(&frames);
+
   // (d) Codec cleanup - cleanup ONCE at the end
+  phases.start(CODEC_PHASE_CLEANUP);
   picture_free(pic_in);
+  picture_free(pic_out);
   encoder_close(encoder);
   param_free(param);
-  dlclose(handle);
+
+  phases.stop();
 
   ResourceSnapshot __profile_mem_end;
   capture_resources(&__profile_mem_end);
@@ -0,0 +1,222 @@
+// anicet_sched.cc
+// Per-thread CPU and scheduling sampler implementation
+
+#include "anicet_sched.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "anicet_common.h"
+
+namespace anicet {
+namespace sched {
+
+// Descendant levels followed below the child (e.g. simpleperf -> encoder)
+static constexpr int MAX_DEPTH = 4;
+
+// Helper: read a small /proc file (NUL-terminated)
+static bool read_proc_file(const char* path, char* buf, size_t size) {
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return false;
+  }
+  ssize_t n = read(fd, buf, size - 1);
+  close(fd);
+  if (n <= 0) {
+    return false;
+  }
+  buf[n] = '\0';
+  return true;
+}
+
+// Helper: parse a task stat line ("tid (comm) state ppid ..."): the comm,
+// utime and stime (fields 14-15, clock ticks) and processor (field 39)
+static bool parse_task_stat(const char* buf, std::string* comm, long* utime,
+                            long* stime, int* cpu) {
+  const char* open_paren = strchr(buf, '(');
+  // The comm may itself contain parentheses
+  const char* close_paren = strrchr(buf, ')');
+  if (open_paren == nullptr || close_paren == nullptr ||
+      close_paren < open_paren) {
+    return false;
+  }
+  comm->assign(open_paren + 1, close_paren - open_paren - 1);
+  // Field 3 (state) follows the comm
+  const char* p = close_paren + 1;
+  int field = 2;
+  *utime = 0;
+  *stime = 0;
+  *cpu = -1;
+  while (*p != '\0') {
+    while (*p == ' ') p++;
+    if (*p == '\0') break;
+    field++;
+    if (field == 14) {
+      *utime = strtol(p, nullptr, 10);
+    } else if (field == 15) {
+      *stime = strtol(p, nullptr, 10);
+    } else if (field == 39) {
+      *cpu = (int)strtol(p, nullptr, 10);
+      return true;
+    }
+    while (*p != ' ' && *p != '\0') p++;
+  }
+  return false;
+}
+
+TaskSampler::TaskSampler(pid_t pid, int interval_ms)
+    : pid_(pid), interval_us_(interval_ms * 1000) {
+  ticks_per_s_ = sysconf(_SC_CLK_TCK);
+  if (ticks_per_s_ <= 0) ticks_per_s_ = 100;
+  // The first interval starts at the fork
+  last_sample_us_ = anicet_get_timestamp();
+  if (interval_us_ <= 0) {
+    return;
+  }
+  thread_ = std::thread(&TaskSampler::thread_main, this);
+}
+
+TaskSampler::~TaskSampler() { finish(); }
+
+void TaskSampler::finish() {
+  if (!thread_.joinable()) {
+    return;
+  }
+  stop_.store(true, std::memory_order_release);
+  thread_.join();
+}
+
+void TaskSampler::sample_process(pid_t pid, int64_t now_us, int depth,
+                                 double* cpu_ms, double* run_delay_ms,
+                                 int* threads, int* busy_threads) {
+  char path[128];
+  snprintf(path, sizeof(path), "/proc/%d/task", pid);
+  DIR* dir = opendir(path);
+  if (dir == nullptr) {
+    return;
+  }
+  std::vector<pid_t> children;
+  struct dirent* entry;
+  while ((entry = readdir(dir)) != nullptr) {
+    if (entry->d_name[0] < '0' || entry->d_name[0] > '9') {
+      continue;
+    }
+    pid_t tid = (pid_t)atoi(entry->d_name);
+    char buf[1024];
+    snprintf(path, sizeof(path), "/proc/%d/task/%d/stat", pid, tid);
+    std::string comm;
+    long utime;
+    long stime;
+    int cpu;
+    if (!read_proc_file(path, buf, sizeof(buf)) ||
+        !parse_task_stat(buf, &comm, &utime, &stime, &cpu)) {
+      continue;
+    }
+
+    auto it = thread_index_.find(tid);
+    if (it == thread_index_.end()) {
+      ThreadStats stats;
+      stats.pid = pid;
+      stats.tid = tid;
+      stats.first_seen_us = now_us;
+      it = thread_index_.emplace(tid, threads_.size()).first;
+      threads_.push_back(stats);
+    }
+    ThreadStats& stats = threads_[it->second];
+    double prev_cpu_ms = stats.cpu_time_ms();
+    int64_t prev_run_delay_ns = stats.run_delay_ns;
+    bool seen_before = stats.last_seen_us != 0;
+
+    stats.comm = comm;
+    stats.utime_ms = utime * 1000 / ticks_per_s_;
+    stats.stime_ms = stime * 1000 / ticks_per_s_;
+    stats.last_cpu = cpu;
+    stats.cpu_samples[cpu]++;
+    stats.last_seen_us = now_us;
+    // schedstat: run time, run-queue wait (ns) and timeslices
+    snprintf(path, sizeof(path), "/proc/%d/task/%d/schedstat", pid, tid);
+    long long run_ns;
+    long long wait_ns;
+    long long slices;
+    if (read_proc_file(path, buf, sizeof(buf)) &&
+        sscanf(buf, "%lld %lld %lld", &run_ns, &wait_ns, &slices) == 3) {
+      stats.run_time_ns = run_ns;
+      stats.run_delay_ns = wait_ns;
+      stats.timeslices = slices;
+    }
+
+    // A new thread counts from 0 (it started during the interval)
+    double delta_cpu_ms =
+        stats.cpu_time_ms() - (seen_before ? prev_cpu_ms : 0.0);
+    (*threads)++;
+    if (delta_cpu_ms > 0.0) {
+      *cpu_ms += delta_cpu_ms;
+      (*busy_threads)++;
+    }
+    if (stats.run_delay_ns >= 0) {
+      int64_t prev =
+          (seen_before && prev_run_delay_ns >= 0) ? prev_run_delay_ns : 0;
+      *run_delay_ms += (stats.run_delay_ns - prev) / 1e6;
+    }
+
+    // Child processes of this thread (needs CONFIG_PROC_CHILDREN)
+    if (depth < MAX_DEPTH) {
+      snprintf(path, sizeof(path), "/proc/%d/task/%d/children", pid, tid);
+      if (read_proc_file(path, buf, sizeof(buf))) {
+        char* p = buf;
+        char* end;
+        for (long child = strtol(p, &end, 10); end != p;
+             child = strtol(p, &end, 10)) {
+          children.push_back((pid_t)child);
+          p = end;
+        }
+      }
+    }
+  }
+  closedir(dir);
+
+  for (pid_t child : children) {
+    sample_process(child, now_us, depth + 1, cpu_ms, run_delay_ms, threads,
+                   busy_threads);
+  }
+}
+
+void TaskSampler::sample(int64_t now_us) {
+  TimelineSample sample = {};
+  sample.time_us = now_us;
+  double cpu_ms = 0.0;
+  sample_process(pid_, now_us, 0, &cpu_ms, &sample.run_delay_ms,
+                 &sample.threads, &sample.busy_threads);
+  pending_cpu_ms_ += cpu_ms;
+  pending_run_delay_ms_ += sample.run_delay_ms;
+  // Short intervals (the last sample, or a sample right after another one)
+  // are merged into the next one, or dropped at the end, so that the
+  // utilization is not measured over a few microseconds
+  if (now_us - last_sample_us_ < interval_us_ / 2) {
+    return;
+  }
+  sample.busy_cpus = pending_cpu_ms_ * 1000.0 / (now_us - last_sample_us_);
+  sample.run_delay_ms = pending_run_delay_ms_;
+  last_sample_us_ = now_us;
+  pending_cpu_ms_ = 0.0;
+  pending_run_delay_ms_ = 0.0;
+  // A child that is gone (no thread left) adds nothing
+  if (sample.threads > 0) {
+    timeline_.push_back(sample);
+  }
+}
+
+void TaskSampler::thread_main() {
+  // The last sample after stop still sees the exited child (not reaped yet)
+  anicet::run_sampler_loop(interval_us_, stop_, [&]() {
+    sample(anicet_get_timestamp());
+  });
+}
+
+}  // namespace sched
+}  // namespace anicet
@@ -0,0 +1,228 @@
+// anicet_stats.cc
+// Summary statistics implementation
+
+#include "anicet_stats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include "anicet_runner.h"
+
+namespace anicet {
+namespace stats {
+
+// Scale factor from MAD to standard deviation (normal distribution)
+static constexpr double MAD_SCALE = 1.4826;
+// Outlier threshold in scaled MADs
+static constexpr double OUTLIER_MADS = 3.0;
+// z value of the 95% confidence interval
+static constexpr double Z_95 = 1.96;
+
+// Helper: percentile of sorted values (linear interpolation between ranks)
+static double percentile(const std::vector<double>& sorted, double p) {
+  double rank = p / 100.0 * (sorted.size() - 1);
+  size_t lo = (size_t)std::floor(rank);
+  size_t hi = (size_t)std::ceil(rank);
+  return sorted[lo] + (sorted[hi] - sorted[lo]) * (rank - lo);
+}
+
+bool summarize(std::vector<double> values, Summary* summary) {
+  *summary = Summary();
+  if (values.empty()) {
+    return false;
+  }
+  std::sort(values.begin(), values.end());
+  size_t n = values.size();
+  summary->count = (int)n;
+  summary->min = values.front();
+  summary->max = values.back();
+
+  double sum = 0.0;
+  for (double value : values) sum += value;
+  summary->mean = sum / n;
+  if (n > 1) {
+    double squares = 0.0;
+    for (double value : values) {
+      squares += (value - summary->mean) * (value - summary->mean);
+    }
+    summary->stddev = std::sqrt(squares / (n - 1));
+  }
+
+  summary->median = percentile(values, 50.0);
+  summary->p90 = percentile(values, 90.0);
+  summary->p99 = percentile(values, 99.0);
+
+  std::vector<double> deviations(n);
+  for (size_t i = 0; i < n; i++) {
+    deviations[i] = std::fabs(values[i] - summary->median);
+  }
+  std::sort(deviations.begin(), deviations.end());
+  summary->mad = percentile(deviations, 50.0);
+  if (summary->mad > 0.0) {
+    double limit = OUTLIER_MADS * MAD_SCALE * summary->mad;
+    for (double deviation : deviations) {
+      if (deviation > limit) summary->outliers++;
+    }
+  }
+
+  // Ranks n/2 -/+ z*sqrt(n)/2 (1-based) bound the median with 95%
+  // confidence, whatever the distribution
+  double half_width = Z_95 * std::sqrt((double)n) / 2.0;
+  long lo = (long)std::floor(n / 2.0 - half_width);
+  long hi = (long)std::ceil(1.0 + n / 2.0 + half_width);
+  lo = std::max(1L, std::min((long)n, lo));
+  hi = std::max(1L, std::min((long)n, hi));
+  summary->median_ci_low = values[lo - 1];
+  summary->median_ci_high = values[hi - 1];
+  if (summary->median > 0.0) {
+    summary->median_ci_percent =
+        (summary->median_ci_high - summary->median_ci_low) / 2.0 /
+        summary->median * 100.0;
+  }
+  return true;
+}
+
+double mann_whitney_greater_p(const std::vector<double>& baseline,
+                              const std::vector<double>& current) {
+  size_t n1 = baseline.size();
+  size_t n2 = current.size();
+  if (n1 == 0 || n2 == 0) {
+    return 1.0;
+  }
+  // Pool the values (second = from current) and rank them, ties getting
+  // their average rank
+  std::vector<std::pair<double, bool>> pooled;
+  pooled.reserve(n1 + n2);
+  for (double value : baseline) pooled.emplace_back(value, false);
+  for (double value : current) pooled.emplace_back(value, true);
+  std::sort(pooled.begin(), pooled.end());
+  size_t n = pooled.size();
+  double rank_sum = 0.0;
+  double ties = 0.0;
+  for (size_t i = 0; i < n;) {
+    size_t j = i;
+    while (j < n && pooled[j].first == pooled[i].first) j++;
+    double rank = (i + 1 + j) / 2.0;
+    for (size_t k = i; k < j; k++) {
+      if (pooled[k].second) rank_sum += rank;
+    }
+    double t = (double)(j - i);
+    ties += t * t * t - t;
+    i = j;
+  }
+  double u = rank_sum - n2 * (n2 + 1) / 2.0;
+  double mean = n1 * n2 / 2.0;
+  double variance =
+      n1 * n2 / 12.0 * ((n + 1) - ties / ((double)n * (n - 1)));
+  if (variance <= 0.0) {
+    // All values equal
+    return 1.0;
+  }
+  double z = (u - mean - 0.5) / std::sqrt(variance);
+  return 0.5 * std::erfc(z / std::sqrt(2.0));
+}
+
+// Helper: whether frame i is a warm-up frame
+static bool is_warmup(const CodecOutput& output, size_t i) {
+  return i < output.warmup_frames.size() && output.warmup_frames[i];
+}
+
+std::vector<double> encode_times_us(const CodecOutput& output) {
+  std::vector<double> values;
+  for (size_t i = 0; i < output.timings.size(); i++) {
+    if (is_warmup(output, i)) continue;
+    values.push_back((double)(output.timings[i].output_timestamp_us -
+                              output.timings[i].input_timestamp_us));
+  }
+  return values;
+}
+
+std::vector<double> cpu_times_ms(const CodecOutput& output) {
+  std::vector<double> values;
+  for (size_t i = 0; i < output.profile_encode_cpu_ms.size(); i++) {
+    if (is_warmup(output, i)) continue;
+    values.push_back(output.profile_encode_cpu_ms[i]);
+  }
+  return values;
+}
+
+std::vector<double> energy_mj(const CodecOutput& output) {
+  std::vector<double> values;
+  for (size_t i = 0; i < output.frame_energy.size(); i++) {
+    if (is_warmup(output, i) || output.frame_energy[i].energy_mj < 0.0) {
+      continue;
+    }
+    values.push_back(output.frame_energy[i].energy_mj);
+  }
+  return values;
+}
+
+std::vector<double> alloc_counts(const CodecOutput& output) {
+  std::vector<double> values;
+  for (size_t i = 0; i < output.frame_allocs.size(); i++) {
+    if (is_warmup(output, i) || !output.frame_allocs[i].valid) {
+      continue;
+    }
+    values.push_back((double)output.frame_allocs[i].allocs);
+  }
+  return values;
+}
+
+std::vector<double> alloc_bytes(const CodecOutput& output) {
+  std::vector<double> values;
+  for (size_t i = 0; i < output.frame_allocs.size(); i++) {
+    if (is_warmup(output, i) || !output.frame_allocs[i].valid) {
+      continue;
+    }
+    values.push_back((double)output.frame_allocs[i].bytes);
+  }
+  return values;
+}
+
+int num_measured_frames(const CodecOutput& output) {
+  int count = 0;
+  for (size_t i = 0; i < output.num_frames(); i++) {
+    if (!is_warmup(output, i)) count++;
+  }
+  return count;
+}
+
+double throughput_fps(const CodecOutput& output) {
+  std::vector<std::pair<int64_t, int64_t>> windows;
+  for (size_t i = 0; i < output.timings.size(); i++) {
+    const CodecFrameTiming& timing = output.timings[i];
+    if (is_warmup(output, i) ||
+        timing.output_timestamp_us < timing.input_timestamp_us) {
+      continue;
+    }
+    windows.emplace_back(timing.input_timestamp_us,
+                         timing.output_timestamp_us);
+  }
+  if (windows.empty()) {
+    return 0.0;
+  }
+  std::sort(windows.begin(), windows.end());
+  int64_t busy_us = 0;
+  int64_t start_us = windows[0].first;
+  int64_t end_us = windows[0].second;
+  for (const auto& window : windows) {
+    if (window.first > end_us) {
+      busy_us += end_us - start_us;
+      start_us = window.first;
+    }
+    end_us = std::max(end_us, window.second);
+  }
+  busy_us += end_us - start_us;
+  return (busy_us > 0) ? windows.size() * 1e6 / busy_us : 0.0;
+}
+
+double encode_cpu_per_frame_ms(const CodecOutput& output) {
+  if (output.num_frames() == 0) {
+    return 0.0;
+  }
+  return output.phases[CODEC_PHASE_ENCODE].cpu_time_ms / output.num_frames();
+}
+
+}  // namespace stats
+}  // namespace anicet
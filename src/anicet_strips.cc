@@ -0,0 +1,266 @@
+// anicet_strips.cc
+// Strip-parallel JPEG encoding implementation
+
+#include "anicet_strips.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace anicet {
+namespace strips {
+
+std::vector<Strip> split_strips(int height, int num_strips, int mcu_height) {
+  std::vector<Strip> strips;
+  int mcu_rows = (height + mcu_height - 1) / mcu_height;
+  if (num_strips < 1) num_strips = 1;
+  if (num_strips > mcu_rows) num_strips = mcu_rows;
+  if (num_strips < 1) return strips;
+  int strip_rows = (mcu_rows + num_strips - 1) / num_strips;
+  for (int y = 0; y < height; y += strip_rows * mcu_height) {
+    Strip strip;
+    strip.y = y;
+    strip.height = std::min(strip_rows * mcu_height, height - y);
+    strips.push_back(strip);
+  }
+  return strips;
+}
+
+// Marker layout of a single-scan baseline JPEG
+struct JpegLayout {
+  // Offsets of the SOF height field, the SOS marker, the entropy-coded data
+  // and the EOI marker
+  size_t sof_height = 0;
+  size_t sos = 0;
+  size_t scan = 0;
+  size_t eoi = 0;
+  int width = 0;
+  int height = 0;
+  int mcu_width = 0;
+  int mcu_height = 0;
+};
+
+// Helper: read a big-endian 16-bit value
+static inline int read_be16(const uint8_t* data) {
+  return (data[0] << 8) | data[1];
+}
+
+// Helper: locate the headers and the scan of a JPEG. Returns false if it is
+// not a single-scan baseline JPEG without restart markers.
+static bool parse_jpeg(const uint8_t* data, size_t size, JpegLayout* layout) {
+  if (size < 4 || data[0] != 0xFF || data[1] != 0xD8) {
+    return false;
+  }
+  size_t pos = 2;
+  while (true) {
+    if (pos + 4 > size || data[pos] != 0xFF) {
+      return false;
+    }
+    uint8_t marker = data[pos + 1];
+    size_t end = pos + 2 + read_be16(data + pos + 2);
+    if (end > size) {
+      return false;
+    }
+    if (marker == 0xC0 || marker == 0xC1) {
+      // Baseline/extended sequential frame header
+      if (end - pos < 10) return false;
+      layout->sof_height = pos + 5;
+      layout->height = read_be16(data + pos + 5);
+      layout->width = read_be16(data + pos + 7);
+      int num_components = data[pos + 9];
+      if (end - pos < 10 + 3 * (size_t)num_components) return false;
+      int max_h = 1;
+      int max_v = 1;
+      for (int i = 0; i < num_components; i++) {
+        uint8_t sampling = data[pos + 11 + 3 * i];
+        max_h = std::max(max_h, sampling >> 4);
+        max_v = std::max(max_v, sampling & 0x0F);
+      }
+      layout->mcu_width = 8 * max_h;
+      layout->mcu_height = 8 * max_v;
+    } else if (marker >= 0xC2 && marker <= 0xCF && marker != 0xC4 &&
+               marker != 0xC8 && marker != 0xCC) {
+      // Progressive, lossless or arithmetic-coded frame
+      return false;
+    } else if (marker == 0xDD) {
+      // Already has a restart interval
+      return false;
+    } else if (marker == 0xDA) {
+      layout->sos = pos;
+      layout->scan = end;
+      break;
+    }
+    pos = end;
+  }
+  if (layout->sof_height == 0) {
+    return false;
+  }
+
+  // The scan runs up to the EOI: any other marker (restart, or the tables
+  // of another scan) is rejected. 0xFF bytes of the data are stuffed (0xFF
+  // 0x00).
+  pos = layout->scan;
+  while (true) {
+    const void* ff = memchr(data + pos, 0xFF, size - pos);
+    if (ff == nullptr) {
+      return false;
+    }
+    pos = (const uint8_t*)ff - data;
+    if (pos + 1 >= size) {
+      return false;
+    }
+    if (data[pos + 1] == 0x00) {
+      pos += 2;
+      continue;
+    }
+    if (data[pos + 1] == 0xD9 && pos + 2 == size) {
+      layout->eoi = pos;
+      return true;
+    }
+    return false;
+  }
+}
+
+bool stitch_strips(const std::vector<EncodedStrip>& strips, int height,
+                   std::vector<uint8_t>* out) {
+  if (strips.empty()) {
+    fprintf(stderr, "strips: No strips to stitch\n");
+    return false;
+  }
+  std::vector<JpegLayout> layouts(strips.size());
+  for (size_t i = 0; i < strips.size(); i++) {
+    if (!parse_jpeg(strips[i].data, strips[i].size, &layouts[i])) {
+      fprintf(stderr,
+              "strips: Strip %zu is not a single-scan baseline JPEG without "
+              "restart markers\n",
+              i);
+      return false;
+    }
+  }
+
+  // All strips must share the headers (tables, sampling, width) of the
+  // first one: only the frame height may differ
+  const JpegLayout& first = layouts[0];
+  const uint8_t* header = strips[0].data;
+  for (size_t i = 1; i < strips.size(); i++) {
+    const uint8_t* data = strips[i].data;
+    if (layouts[i].scan != first.scan ||
+        layouts[i].sof_height != first.sof_height ||
+        memcmp(data, header, first.sof_height) != 0 ||
+        memcmp(data + first.sof_height + 2, header + first.sof_height + 2,
+               first.scan - first.sof_height - 2) != 0) {
+      fprintf(stderr, "strips: Strip %zu headers differ from strip 0\n", i);
+      return false;
+    }
+    if (i + 1 < strips.size() && layouts[i].height != first.height) {
+      fprintf(stderr, "strips: Strip %zu height %d differs from %d\n", i,
+              layouts[i].height, first.height);
+      return false;
+    }
+  }
+
+  // One restart interval per strip: the MCUs of a full strip
+  if (strips.size() > 1 && first.height % first.mcu_height != 0) {
+    fprintf(stderr, "strips: Strip height %d is not a multiple of the MCU\n",
+            first.height);
+    return false;
+  }
+  long restart_interval =
+      (long)(first.height / first.mcu_height) *
+      ((first.width + first.mcu_width - 1) / first.mcu_width);
+  if (restart_interval > 0xFFFF) {
+    fprintf(stderr,
+            "strips: %ld MCUs per strip exceed the restart interval limit "
+            "(65535), use more strips\n",
+            restart_interval);
+    return false;
+  }
+
+  // Output: headers of strip 0 (with the frame height), DRI, SOS, then the
+  // scans of the strips separated by RST0..RST7 (modulo 8), EOI
+  size_t size = first.sos + 6 + (first.scan - first.sos) + 2;
+  for (size_t i = 0; i < strips.size(); i++) {
+    size += layouts[i].eoi - layouts[i].scan + (i > 0 ? 2 : 0);
+  }
+  out->resize(size);
+  uint8_t* dst = out->data();
+  memcpy(dst, header, first.sos);
+  dst[first.sof_height] = (uint8_t)(height >> 8);
+  dst[first.sof_height + 1] = (uint8_t)height;
+  dst += first.sos;
+  const uint8_t dri[6] = {0xFF, 0xDD, 0x00, 0x04,
+                          (uint8_t)(restart_interval >> 8),
+                          (uint8_t)restart_interval};
+  memcpy(dst, dri, sizeof(dri));
+  dst += sizeof(dri);
+  memcpy(dst, header + first.sos, first.scan - first.sos);
+  dst += first.scan - first.sos;
+  for (size_t i = 0; i < strips.size(); i++) {
+    if (i > 0) {
+      *dst++ = 0xFF;
+      *dst++ = (uint8_t)(0xD0 + ((i - 1) & 7));
+    }
+    size_t scan_size = layouts[i].eoi - layouts[i].scan;
+    memcpy(dst, strips[i].data + layouts[i].scan, scan_size);
+    dst += scan_size;
+  }
+  *dst++ = 0xFF;
+  *dst++ = 0xD9;
+  return true;
+}
+
+StripPool::StripPool(int num_threads) {
+  for (int i = 1; i < num_threads; i++) {
+    threads_.emplace_back(&StripPool::thread_main, this);
+  }
+}
+
+StripPool::~StripPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  work_cv_.notify_all();
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+void StripPool::run(int count, const std::function<void(int)>& task) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  task_ = &task;
+  count_ = count;
+  next_ = 0;
+  pending_ = count;
+  work_cv_.notify_all();
+  run_tasks(lock);
+  done_cv_.wait(lock, [this] { return pending_ == 0; });
+  task_ = nullptr;
+}
+
+void StripPool::run_tasks(std::unique_lock<std::mutex>& lock) {
+  while (next_ < count_) {
+    int index = next_++;
+    const std::function<void(int)>* task = task_;
+    lock.unlock();
+    (*task)(index);
+    lock.lock();
+    if (--pending_ == 0) {
+      done_cv_.notify_all();
+    }
+  }
+}
+
+void StripPool::thread_main() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    work_cv_.wait(lock, [this] { return stop_ || next_ < count_; });
+    if (stop_) {
+      return;
+    }
+    run_tasks(lock);
+  }
+}
+
+}  // namespace strips
+}  // namespace anicet
@@ -0,0 +1,276 @@
+// anicet_thermal.cc
+// CPU frequency and thermal zone sampling implementation
+
+#include "anicet_thermal.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "anicet_common.h"
+#include "anicet_cpu.h"
+#include "anicet_runner.h"
+
+namespace anicet {
+namespace thermal {
+
+// Thermal zone directory
+static const char* SYSFS_THERMAL = "/sys/class/thermal";
+// Zones slower to read than this are skipped (some sensors sit on a slow bus)
+static constexpr int64_t MAX_ZONE_READ_US = 1000;
+// Cooldown polling interval
+static constexpr int COOLDOWN_POLL_MS = 100;
+// Initial timeline capacity (grows if needed)
+static constexpr size_t INITIAL_SAMPLES = 1024;
+
+// Helper: pread an integer from a sysfs fd (-1 on error)
+static int64_t read_fd_int(int fd) {
+  char buf[32];
+  ssize_t n = pread(fd, buf, sizeof(buf) - 1, 0);
+  if (n <= 0) {
+    return -1;
+  }
+  buf[n] = '\0';
+  return strtoll(buf, nullptr, 10);
+}
+
+// Helper: read the first line of a file (without the newline)
+static bool read_line(const std::string& path, std::string* line) {
+  FILE* fp = fopen(path.c_str(), "r");
+  if (fp == nullptr) {
+    return false;
+  }
+  char buf[128];
+  bool ok = fgets(buf, sizeof(buf), fp) != nullptr;
+  fclose(fp);
+  if (ok) {
+    buf[strcspn(buf, "\n")] = '\0';
+    *line = buf;
+  }
+  return ok;
+}
+
+// Helper: whether a zone type contains one of the comma-separated patterns
+static bool zone_matches(const std::string& type, const std::string& patterns) {
+  std::string lower = type;
+  std::transform(lower.begin(), lower.end(), lower.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+  size_t pos = 0;
+  while (pos <= patterns.length()) {
+    size_t comma = patterns.find(',', pos);
+    if (comma == std::string::npos) {
+      comma = patterns.length();
+    }
+    std::string pattern = patterns.substr(pos, comma - pos);
+    pos = comma + 1;
+    if (!pattern.empty() && lower.find(pattern) != std::string::npos) {
+      return true;
+    }
+  }
+  return false;
+}
+
+ThermalReader::ThermalReader(const char* zones, const std::set<int>& cpus) {
+  // One frequency per cluster
+  for (const auto& cluster : anicet::cpu::get_topology().clusters) {
+    for (int c : cluster.cpus) {
+      if (cpus.count(c) == 0) continue;
+      std::string path = "/sys/devices/system/cpu/cpu" + std::to_string(c) +
+                         "/cpufreq/scaling_cur_freq";
+      int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+      if (fd >= 0) {
+        freq_domains_.push_back(cluster.name);
+        freq_fds_.push_back(fd);
+      }
+      break;
+    }
+  }
+
+  // Thermal zones, in directory order
+  std::vector<std::pair<std::string, int>> all_zones;
+  DIR* dir = opendir(SYSFS_THERMAL);
+  if (dir != nullptr) {
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != nullptr) {
+      if (strncmp(entry->d_name, "thermal_zone", 12) != 0) continue;
+      std::string zone_dir = std::string(SYSFS_THERMAL) + "/" + entry->d_name;
+      std::string type;
+      if (!read_line(zone_dir + "/type", &type)) continue;
+      int fd = open((zone_dir + "/temp").c_str(), O_RDONLY | O_CLOEXEC);
+      if (fd < 0) continue;
+      int64_t start_us = anicet_get_timestamp();
+      int64_t temp = read_fd_int(fd);
+      if (temp < 0 || anicet_get_timestamp() - start_us > MAX_ZONE_READ_US) {
+        close(fd);
+        continue;
+      }
+      all_zones.emplace_back(type, fd);
+    }
+    closedir(dir);
+  }
+  std::string patterns = (zones != nullptr && zones[0] != '\0') ? zones : "";
+  bool any_default = false;
+  if (patterns.empty()) {
+    for (const auto& [type, fd] : all_zones) {
+      if (zone_matches(type, "cpu,soc")) any_default = true;
+    }
+  }
+  for (const auto& [type, fd] : all_zones) {
+    bool keep = !patterns.empty()
+                    ? zone_matches(type, patterns)
+                    : !any_default || zone_matches(type, "cpu,soc");
+    if (keep) {
+      zones_.push_back(type);
+      zone_fds_.push_back(fd);
+    } else {
+      close(fd);
+    }
+  }
+}
+
+ThermalReader::~ThermalReader() {
+  for (int fd : freq_fds_) close(fd);
+  for (int fd : zone_fds_) close(fd);
+}
+
+void ThermalReader::read(std::vector<int64_t>* freq_khz,
+                         std::vector<int64_t>* temp_mc) const {
+  freq_khz->resize(freq_fds_.size());
+  for (size_t i = 0; i < freq_fds_.size(); i++) {
+    (*freq_khz)[i] = read_fd_int(freq_fds_[i]);
+  }
+  temp_mc->resize(zone_fds_.size());
+  for (size_t i = 0; i < zone_fds_.size(); i++) {
+    (*temp_mc)[i] = read_fd_int(zone_fds_[i]);
+  }
+}
+
+int64_t ThermalReader::max_temp_mc() const {
+  int64_t max_temp = -1;
+  for (int fd : zone_fds_) {
+    max_temp = std::max(max_temp, read_fd_int(fd));
+  }
+  return max_temp;
+}
+
+ThermalSampler::ThermalSampler(const CodecInput* input) {
+  if (input->thermal_sample_interval_ms <= 0) {
+    return;
+  }
+  reader_ = std::make_unique<ThermalReader>(input->thermal_zones,
+                                            anicet::cpu::get_affinity());
+  if (reader_->freq_domains().empty() && reader_->zones().empty()) {
+    fprintf(stderr, "Warning: no CPU frequency or thermal zone to sample\n");
+    return;
+  }
+  interval_us_ = input->thermal_sample_interval_ms * 1000;
+  samples_.reserve(INITIAL_SAMPLES);
+  thread_ = std::thread(&ThermalSampler::thread_main, this);
+}
+
+ThermalSampler::~ThermalSampler() {
+  if (thread_.joinable()) {
+    stop_.store(true, std::memory_order_release);
+    thread_.join();
+  }
+}
+
+void ThermalSampler::thread_main() {
+  anicet::run_sampler_loop(interval_us_, stop_, [&]() {
+    ThermalSample sample;
+    sample.time_us = anicet_get_timestamp();
+    sample.run = -1;
+    reader_->read(&sample.freq_khz, &sample.temp_mc);
+    samples_.push_back(std::move(sample));
+  });
+}
+
+void ThermalSampler::finish(CodecOutput* output) {
+  output->thermal_timeline = ThermalTimeline();
+  output->thermal_frames.clear();
+  if (!thread_.joinable()) {
+    return;
+  }
+  stop_.store(true, std::memory_order_release);
+  thread_.join();
+
+  // Match the samples to the frames by time (frames are in timestamp order,
+  // except for pipelined encoders where they may overlap)
+  const std::vector<std::string>& domains = reader_->freq_domains();
+  output->thermal_frames.resize(output->timings.size());
+  size_t first = 0;
+  for (size_t i = 0; i < output->timings.size(); i++) {
+    int64_t start_us = output->timings[i].input_timestamp_us;
+    int64_t end_us = output->timings[i].output_timestamp_us;
+    FrameThermal& frame = output->thermal_frames[i];
+    while (first < samples_.size() && samples_[first].time_us < start_us) {
+      first++;
+    }
+    size_t s = first;
+    for (; s < samples_.size() && samples_[s].time_us <= end_us; s++) {
+      samples_[s].run = (int)i;
+    }
+    // Samples [first, s) are inside the frame, otherwise use the last one
+    // before its end
+    size_t begin = first, end = s;
+    if (begin == end && begin > 0) {
+      begin--;
+    } else if (begin == end) {
+      continue;
+    }
+    for (size_t k = begin; k < end; k++) {
+      const ThermalSample& sample = samples_[k];
+      for (size_t d = 0; d < domains.size(); d++) {
+        if (sample.freq_khz[d] < 0) continue;
+        auto it = frame.freq_khz.find(domains[d]);
+        if (it == frame.freq_khz.end() || sample.freq_khz[d] < it->second) {
+          frame.freq_khz[domains[d]] = sample.freq_khz[d];
+        }
+      }
+      for (int64_t temp : sample.temp_mc) {
+        frame.max_temp_mc = std::max(frame.max_temp_mc, temp);
+      }
+    }
+  }
+  output->thermal_timeline.freq_domains = domains;
+  output->thermal_timeline.zones = reader_->zones();
+  output->thermal_timeline.samples = std::move(samples_);
+  samples_.clear();
+}
+
+void cooldown(const char* zones, double temp_c, int max_ms,
+              CooldownStats* stats) {
+  if (temp_c <= 0.0 && max_ms <= 0) {
+    return;
+  }
+  int64_t start_us = anicet_get_timestamp();
+  if (temp_c <= 0.0) {
+    // Fixed pause
+    usleep((useconds_t)max_ms * 1000);
+  } else {
+    ThermalReader reader(zones, std::set<int>());
+    int64_t temp_mc = reader.max_temp_mc();
+    stats->max_start_temp_mc = std::max(stats->max_start_temp_mc, temp_mc);
+    int64_t target_mc = (int64_t)(temp_c * 1000.0);
+    while (temp_mc > target_mc) {
+      if (max_ms > 0 &&
+          anicet_get_timestamp() - start_us >= (int64_t)max_ms * 1000) {
+        stats->timeouts++;
+        break;
+      }
+      usleep(COOLDOWN_POLL_MS * 1000);
+      temp_mc = reader.max_temp_mc();
+    }
+  }
+  stats->waits++;
+  stats->wait_ms += (anicet_get_timestamp() - start_us) / 1000.0;
+}
+
+}  // namespace thermal
+}  // namespace anicet
@@ -0,0 +1,119 @@
+#!/usr/bin/env python3
+"""
+bench.corpus.py - Generate the --bench regression corpus.
+
+Writes the synthetic yuv420p images used by bench/suite.json. The content
+is generated from fixed formulas and a fixed-seed xorshift generator, so the
+corpus is byte-identical on every host and needs no stored media. Bump the
+suite "version" when the corpus changes.
+
+Usage:
+    ./bench.corpus.py --output-dir ../bench/corpus
+    ./bench.corpus.py --output-dir corpus --list
+"""
+
+import argparse
+import hashlib
+import os
+import sys
+
+
+class XorShift32:
+    """Deterministic 32-bit xorshift generator."""
+
+    def __init__(self, seed):
+        self.state = seed & 0xFFFFFFFF or 1
+
+    def next(self):
+        x = self.state
+        x ^= (x << 13) & 0xFFFFFFFF
+        x ^= x >> 17
+        x ^= (x << 5) & 0xFFFFFFFF
+        self.state = x
+        return x
+
+
+def gradient(x, y, width, height, rng):
+    """Smooth diagonal ramps (easy to predict)."""
+    return (255 * (x + y)) // (width + height - 2)
+
+
+def noise(x, y, width, height, rng):
+    """Film-grain-like noise over a flat gray (hard to predict)."""
+    return 96 + (rng.next() >> 24) // 2
+
+
+def edges(x, y, width, height, rng):
+    """Checkerboard of 16x16 blocks with thin lines (sharp edges)."""
+    value = 32 if ((x // 16) + (y // 16)) % 2 else 224
+    if x % 61 == 0 or y % 47 == 0:
+        value = 255 - value
+    return value
+
+
+def mixed(x, y, width, height, rng):
+    """Gradient, edge and noise regions side by side (natural-image mix)."""
+    if x < width // 3:
+        return gradient(x, y, width, height, rng)
+    if x < 2 * width // 3:
+        return edges(x, y, width, height, rng)
+    return noise(x, y, width, height, rng)
+
+
+# Corpus images: name, width, height, luma pattern, generator seed
+CORPUS = (
+    ("gradient", 640, 480, gradient, 1),
+    ("noise", 640, 480, noise, 2),
+    ("edges", 640, 480, edges, 3),
+    ("mixed", 1280, 720, mixed, 4),
+)
+
+
+def make_image(width, height, pattern, seed):
+    """Build a yuv420p frame: the luma pattern, and slowly varying chroma."""
+    rng = XorShift32(seed)
+    data = bytearray()
+    for y in range(height):
+        data.extend(pattern(x, y, width, height, rng) for x in range(width))
+    chroma_width = (width + 1) // 2
+    chroma_height = (height + 1) // 2
+    for plane in range(2):
+        for y in range(chroma_height):
+            data.extend(
+                (128 + (x if plane == 0 else y) % 64 - 32) & 0xFF
+                for x in range(chroma_width)
+            )
+    return bytes(data)
+
+
+def image_filename(name, width, height):
+    return "%s_%dx%d.yuv" % (name, width, height)
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Generate the --bench regression corpus (yuv420p)"
+    )
+    parser.add_argument(
+        "--output-dir", required=True, help="Directory to write the images to"
+    )
+    parser.add_argument(
+        "--list",
+        action="store_true",
+        help="Print the file names and SHA-256 digests of the images",
+    )
+    args = parser.parse_args()
+
+    os.makedirs(args.output_dir, exist_ok=True)
+    for name, width, height, pattern, seed in CORPUS:
+        filename = image_filename(name, width, height)
+        data = make_image(width, height, pattern, seed)
+        with open(os.path.join(args.output_dir, filename), "wb") as f:
+            f.write(data)
+        if args.list:
+            print("%s %s" % (hashlib.sha256(data).hexdigest(), filename))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())